@@ -0,0 +1,61 @@
+/**
+ * @file bench.h
+ * @brief Utilidades comunes de los benchmarks: reloj monotónico y series sintéticas.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "../include/metric_store.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * @brief Tiempo monotónico en nanosegundos.
+ * @return Nanosegundos desde un origen arbitrario.
+ */
+static inline uint64_t bench_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Registra series sintéticas con etiquetas en familias de `per_family` series.
+ * @param count Cantidad total de series.
+ * @param per_family Series por familia.
+ */
+static inline void bench_register_series(size_t count, size_t per_family)
+{
+    int family = -1;
+    char name[64];
+    char labels[64];
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i % per_family == 0)
+        {
+            snprintf(name, sizeof(name), "bench_family_%zu", i / per_family);
+            family = metric_store_add_family(name, "Serie sintética de benchmark", METRIC_TYPE_GAUGE);
+        }
+        snprintf(labels, sizeof(labels), "{instance=\"%zu\",shard=\"%zu\"}", i, i % 16);
+        MetricSeries series = metric_store_add_series(family, labels);
+        metric_store_set(series, (double)i * 1.5);
+    }
+    metric_store_publish();
+}
+
+/**
+ * @brief Imprime una línea de resultado en formato uniforme.
+ * @param name Nombre del caso.
+ * @param ops Operaciones realizadas.
+ * @param elapsed_ns Tiempo total en nanosegundos.
+ */
+static inline void bench_report(const char* name, uint64_t ops, uint64_t elapsed_ns)
+{
+    printf("%-40s %12.0f ns/op %10llu ops\n", name, (double)elapsed_ns / (double)ops, (unsigned long long)ops);
+}
+
+#endif // BENCH_H
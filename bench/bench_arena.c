@@ -0,0 +1,122 @@
+/**
+ * @file bench_arena.c
+ * @brief Llamadas a malloc y tiempo por scrape filtrado, con y sin la arena de la petición.
+ *
+ * Cuenta las llamadas reales a malloc/calloc/realloc interponiendo esas funciones sobre las de
+ * glibc, así que incluye también las de zlib.
+ *
+ * Uso: bench_arena [series] [scrapes]
+ */
+
+#include "bench.h"
+#include "../include/arena.h"
+#include "../include/exposition.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+/** Implementaciones de glibc a las que se delega */
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+/** Llamadas a malloc, calloc o realloc desde el inicio */
+static atomic_ulong malloc_calls;
+
+void* malloc(size_t size)
+{
+    atomic_fetch_add_explicit(&malloc_calls, 1, memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    atomic_fetch_add_explicit(&malloc_calls, 1, memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    atomic_fetch_add_explicit(&malloc_calls, 1, memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr)
+{
+    __libc_free(ptr);
+}
+
+/**
+ * @brief Un scrape filtrado sin arena: buffer propio que se libera al terminar.
+ * @param filter Familias pedidas.
+ * @param encoding Codificación de la respuesta.
+ */
+static void scrape_libc(const ExpositionFilter* filter, ContentEncoding encoding)
+{
+    const ExpositionBody* body = exposition_cache_acquire(EXPOSITION_FORMAT_TEXT);
+    Buffer out;
+    buffer_init(&out);
+    exposition_cache_filter(body, filter, encoding, &out);
+    buffer_free(&out);
+    exposition_cache_release(body);
+}
+
+/**
+ * @brief Un scrape filtrado con la arena reutilizada de la petición, reiniciada al terminar.
+ * @param arena Arena de la petición.
+ * @param filter Familias pedidas.
+ * @param encoding Codificación de la respuesta.
+ */
+static void scrape_arena(Arena* arena, const ExpositionFilter* filter, ContentEncoding encoding)
+{
+    const ExpositionBody* body = exposition_cache_acquire(EXPOSITION_FORMAT_TEXT);
+    Buffer out;
+    buffer_init(&out);
+    Arena* previous = arena_activate(arena);
+    exposition_cache_filter(body, filter, encoding, &out);
+    arena_activate(previous);
+    arena_reset(arena);
+    exposition_cache_release(body);
+}
+
+/**
+ * @brief Ejecuta un caso e informa tiempo y llamadas a malloc por scrape.
+ */
+static void run_case(const char* name, Arena* arena, const ExpositionFilter* filter, ContentEncoding encoding,
+                     uint64_t scrapes)
+{
+    // Calentamiento: el cuerpo queda renderizado y la arena dimensionada
+    arena != NULL ? scrape_arena(arena, filter, encoding) : scrape_libc(filter, encoding);
+
+    unsigned long calls = atomic_load(&malloc_calls);
+    uint64_t start = bench_now_ns();
+    for (uint64_t i = 0; i < scrapes; i++)
+    {
+        arena != NULL ? scrape_arena(arena, filter, encoding) : scrape_libc(filter, encoding);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    bench_report(name, scrapes, elapsed);
+    printf("%-40s %12.2f mallocs/scrape\n", "", (double)(atomic_load(&malloc_calls) - calls) / (double)scrapes);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t series = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000;
+    uint64_t scrapes = argc > 2 ? strtoull(argv[2], NULL, 10) : 2000;
+
+    metric_store_init(series);
+    bench_register_series(series, 100);
+    printf("series=%zu\n", series);
+
+    ExpositionFilter filter = {{"bench_family_0", "bench_family_3"}, 2, {"bench_family_19"}, 1};
+    Arena arena;
+    arena_init(&arena, ARENA_DEFAULT_CHUNK_SIZE);
+
+    run_case("filtrado identity (libc)", NULL, &filter, CONTENT_ENCODING_IDENTITY, scrapes);
+    run_case("filtrado identity (arena)", &arena, &filter, CONTENT_ENCODING_IDENTITY, scrapes);
+    run_case("filtrado gzip (libc)", NULL, &filter, CONTENT_ENCODING_GZIP, scrapes);
+    run_case("filtrado gzip (arena)", &arena, &filter, CONTENT_ENCODING_GZIP, scrapes);
+
+    arena_destroy(&arena);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file bench_formats.c
+ * @brief Tiempo de codificación y tamaño del cuerpo para cada formato de exposición.
+ *
+ * Uso: bench_formats [series] [iteraciones]
+ */
+
+#include "bench.h"
+#include "../include/exposition.h"
+#include <stdlib.h>
+
+int main(int argc, char* argv[])
+{
+    size_t series = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000;
+    uint64_t iterations = argc > 2 ? strtoull(argv[2], NULL, 10) : 200;
+    static const char* names[EXPOSITION_FORMAT_COUNT] = {"texto", "openmetrics", "protobuf"};
+
+    metric_store_init(series);
+    bench_register_series(series, 100);
+    printf("series=%zu\n", series);
+
+    Buffer out;
+    buffer_init(&out);
+    for (int format = 0; format < EXPOSITION_FORMAT_COUNT; format++)
+    {
+        // Calentamiento: el buffer de salida queda dimensionado y se reutiliza
+        exposition_render((ExpositionFormat)format, &out);
+
+        uint64_t start = bench_now_ns();
+        for (uint64_t i = 0; i < iterations; i++)
+        {
+            exposition_render((ExpositionFormat)format, &out);
+        }
+        uint64_t elapsed = bench_now_ns() - start;
+
+        char label[64];
+        snprintf(label, sizeof(label), "render %s (%zu bytes)", names[format], out.len);
+        bench_report(label, iterations, elapsed);
+    }
+
+    buffer_free(&out);
+    return EXIT_SUCCESS;
+}
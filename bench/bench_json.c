@@ -0,0 +1,179 @@
+/**
+ * @file bench_json.c
+ * @brief JSON de métricas: árbol de cJSON (ruta anterior) contra escritor directo sobre un buffer.
+ *
+ * Con los mismos valores compara la ruta anterior de `create_metrics_json` (árbol de cJSON,
+ * `cJSON_Print` con sangría, eco a la salida y liberación) con `format_metrics_json` sobre un
+ * buffer reutilizado. Cuenta reservas de memoria por operación: las de cJSON con sus hooks y las
+ * del escritor como crecimientos del buffer. Mide también la conversión de números por separado
+ * (`snprintf` contra Grisu2) y verifica que dtoa_shortest conserve cada valor; si no, termina
+ * con error.
+ *
+ * La medición de las funciones `get_*` queda afuera: es igual en ambas rutas.
+ *
+ * Uso: bench_json [iteraciones]
+ */
+
+#include "bench.h"
+#include "../include/config.h"
+#include "../include/dtoa.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Valores de prueba en conversiones de números; potencia de 2 para recorrerlos con máscara.
+ */
+#define BENCH_VALUE_COUNT 4096
+
+/** Acumula las longitudes convertidas para que el compilador no descarte las conversiones */
+static volatile uint64_t sink;
+
+/** Reservas hechas por cJSON */
+static uint64_t cjson_allocations;
+
+/**
+ * @brief malloc que cuenta las reservas de cJSON.
+ * @param size Bytes.
+ * @return Memoria reservada.
+ */
+static void* counting_malloc(size_t size)
+{
+    cjson_allocations++;
+    return malloc(size);
+}
+
+/**
+ * @brief Genera un número pseudoaleatorio (xorshift64).
+ * @param state Estado.
+ * @return Número.
+ */
+static uint64_t next_random(uint64_t* state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/**
+ * @brief Arma el JSON como lo hacía `create_metrics_json` antes de usar el escritor directo.
+ * @param sample Valores.
+ * @param echo Destino del eco que antes iba a stdout.
+ */
+static void cjson_path(const MetricsSample* sample, FILE* echo)
+{
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "cpu_usage", sample->cpu_usage);
+    cJSON_AddNumberToObject(json, "memory_usage", sample->memory_usage);
+    cJSON_AddNumberToObject(json, "disk_usage", sample->disk_usage);
+    cJSON_AddNumberToObject(json, "network_usage", sample->network_usage);
+    cJSON_AddNumberToObject(json, "process_count", sample->process_count);
+    cJSON_AddNumberToObject(json, "context_switches", sample->context_switches);
+    char* json_string = cJSON_Print(json);
+    if (json_string != NULL)
+    {
+        fprintf(echo, "JSON de métricas creado con éxito:\n%s\n", json_string);
+    }
+    cJSON_Delete(json);
+    free(json_string);
+}
+
+int main(int argc, char* argv[])
+{
+    uint64_t iterations = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+    if (iterations == 0)
+    {
+        fprintf(stderr, "Uso: %s [iteraciones]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    FILE* devnull = fopen("/dev/null", "w");
+    if (devnull == NULL)
+    {
+        perror("Error al abrir /dev/null");
+        return EXIT_FAILURE;
+    }
+
+    MetricsConfig config = {1, 1, 1, 1, 1, 1};
+    MetricsSample sample = {37.52173913043478, 61.84, 18446744.0, 9876543210.0, 412.0, 123456789.0};
+
+    cJSON_Hooks hooks = {counting_malloc, free};
+    cJSON_InitHooks(&hooks);
+    uint64_t start = bench_now_ns();
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        cjson_path(&sample, devnull);
+    }
+    uint64_t cjson_ns = bench_now_ns() - start;
+
+    Buffer out;
+    buffer_init(&out);
+    uint64_t growths = 0;
+    start = bench_now_ns();
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        size_t capacity = out.capacity;
+        buffer_reset(&out);
+        format_metrics_json(config, &sample, &out);
+        growths += out.capacity != capacity;
+    }
+    uint64_t writer_ns = bench_now_ns() - start;
+
+    // Valores con magnitudes y cantidades de dígitos variadas
+    static double values[BENCH_VALUE_COUNT];
+    uint64_t state = 88172645463325252ull;
+    for (int i = 0; i < BENCH_VALUE_COUNT; i++)
+    {
+        uint64_t r = next_random(&state);
+        values[i] = (double)(r % 100000000) / (double)(1 + next_random(&state) % 10000);
+    }
+    char text[DTOA_BUFFER_SIZE];
+    start = bench_now_ns();
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        double value = values[i & (BENCH_VALUE_COUNT - 1)];
+        int len = snprintf(text, sizeof(text), "%.15g", value);
+        if (strtod(text, NULL) != value)
+        {
+            len = snprintf(text, sizeof(text), "%.17g", value);
+        }
+        sink += (uint64_t)len;
+    }
+    uint64_t snprintf_ns = bench_now_ns() - start;
+    start = bench_now_ns();
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        sink += (uint64_t)dtoa_shortest(values[i & (BENCH_VALUE_COUNT - 1)], text);
+    }
+    uint64_t dtoa_ns = bench_now_ns() - start;
+
+    // Ida y vuelta con patrones de bits arbitrarios, incluidos subnormales y extremos
+    uint64_t mismatches = 0;
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        uint64_t bits = next_random(&state);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        if (isfinite(value))
+        {
+            dtoa_shortest(value, text);
+            mismatches += strtod(text, NULL) != value;
+        }
+    }
+
+    bench_report("cJSON_Print + eco (ruta anterior)", iterations, cjson_ns);
+    bench_report("format_metrics_json (buffer reutilizado)", iterations, writer_ns);
+    printf("%-40s %12.2f reservas/op\n", "cJSON", (double)cjson_allocations / (double)iterations);
+    printf("%-40s %12.2f reservas/op\n", "format_metrics_json", (double)growths / (double)iterations);
+    bench_report("snprintf %.15g + strtod", iterations, snprintf_ns);
+    bench_report("dtoa_shortest (Grisu2)", iterations, dtoa_ns);
+    printf("%-40s %s\n", "ejemplo", out.data);
+    buffer_free(&out);
+    fclose(devnull);
+    if (mismatches > 0)
+    {
+        fprintf(stderr, "dtoa_shortest no conservó %llu valores\n", (unsigned long long)mismatches);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file bench_sampler.c
+ * @brief CPU que consume el hilo de muestreo de alta frecuencia, como porcentaje de un núcleo.
+ *
+ * Corre el muestreo real (todas las fuentes disponibles) durante el tiempo indicado y compara
+ * el CPU del hilo con el presupuesto de 0.5% de un núcleo; termina con error si lo excede.
+ * Antes mide un hilo que solo despierta a la misma frecuencia, para separar el costo del
+ * despertar (que depende del kernel y, en máquinas virtuales, del hipervisor) del de leer las
+ * fuentes.
+ *
+ * Uso: bench_sampler [segundos] [rate_hz], con rate_hz hasta SAMPLER_MAX_RATE_HZ (por defecto).
+ */
+
+#include "bench.h"
+#include "../include/sampler.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ * @brief CPU máximo aceptado para el muestreo, en porcentaje de un núcleo.
+ */
+#define SAMPLER_BUDGET_PERCENT 0.5
+
+/**
+ * @struct IdleLoop
+ * @brief Parámetros y resultado del hilo que solo despierta.
+ */
+typedef struct
+{
+    int rate;    /**< Despertares por segundo. */
+    int seconds; /**< Duración. */
+    double cpu;  /**< CPU consumido, en segundos. */
+} IdleLoop;
+
+/**
+ * @brief Duerme hasta instantes absolutos a la frecuencia pedida, sin hacer nada más.
+ * @param arg IdleLoop.
+ * @return Siempre NULL.
+ */
+static void* idle_loop(void* arg)
+{
+    IdleLoop* loop = arg;
+    uint64_t period_ns = 1000000000ull / (uint64_t)loop->rate;
+    uint64_t next_ns = bench_now_ns();
+    for (int i = 0; i < loop->rate * loop->seconds; i++)
+    {
+        next_ns += period_ns;
+        struct timespec next = {(time_t)(next_ns / 1000000000ull), (long)(next_ns % 1000000000ull)};
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+    struct timespec cpu;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+    loop->cpu = (double)cpu.tv_sec + (double)cpu.tv_nsec / 1e9;
+    return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 10;
+    int rate = argc > 2 ? atoi(argv[2]) : SAMPLER_MAX_RATE_HZ;
+    if (seconds <= 0 || rate <= 0 || rate > SAMPLER_MAX_RATE_HZ)
+    {
+        fprintf(stderr, "Uso: %s [segundos] [rate_hz <= %d]\n", argv[0], SAMPLER_MAX_RATE_HZ);
+        return EXIT_FAILURE;
+    }
+
+    IdleLoop idle = {rate, seconds, 0.0};
+    pthread_t idle_thread;
+    pthread_create(&idle_thread, NULL, idle_loop, &idle);
+    pthread_join(idle_thread, NULL);
+
+    metric_store_init(1024);
+    SamplerConfig config = {rate, 1, 1, 1, 1};
+    if (sampler_start(&config) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    uint64_t start = bench_now_ns();
+    sleep((unsigned)seconds);
+    double cpu = sampler_cpu_seconds();
+    uint64_t ticks = sampler_ticks();
+    uint64_t elapsed = bench_now_ns() - start;
+    sampler_stop();
+
+    double percent = cpu / ((double)elapsed / 1e9) * 100.0;
+    bench_report("despertar sin muestrear (CPU del hilo)", (uint64_t)rate * (uint64_t)seconds,
+                 (uint64_t)(idle.cpu * 1e9));
+    bench_report("sampler tick (CPU del hilo)", ticks, (uint64_t)(cpu * 1e9));
+    printf("%-40s %12.1f Hz efectivos\n", "sampler", (double)ticks / ((double)elapsed / 1e9));
+    printf("%-40s %12.3f %% de un núcleo (presupuesto %.1f %%)\n", "sampler", percent, SAMPLER_BUDGET_PERCENT);
+    return percent <= SAMPLER_BUDGET_PERCENT ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file bench_scrape_cache.c
+ * @brief Latencia de producir el cuerpo de /metrics con y sin el caché de exposición.
+ *
+ * Uso: bench_scrape_cache [series] [scrapes_por_generacion] [hilos]
+ */
+
+#include "bench.h"
+#include "../include/exposition.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+/**
+ * @brief Scrapes por hilo en el caso concurrente.
+ */
+#define SCRAPES_PER_THREAD 2000
+
+/** Generaciones a recorrer en los casos secuenciales */
+static const uint64_t generations = 200;
+
+/**
+ * @brief Simula un scrape sin caché: renderiza la generación completa.
+ * @param out Buffer reutilizado entre scrapes.
+ * @return Bytes renderizados.
+ */
+static size_t scrape_uncached(Buffer* out)
+{
+    exposition_render_text(out);
+    return out->len;
+}
+
+/**
+ * @brief Simula un scrape con caché: obtiene y libera el cuerpo compartido.
+ * @return Bytes del cuerpo.
+ */
+static size_t scrape_cached()
+{
+    const ExpositionBody* body = exposition_cache_acquire(EXPOSITION_FORMAT_TEXT);
+    size_t len = body->content.len;
+    exposition_cache_release(body);
+    return len;
+}
+
+/**
+ * @brief Hilo de scrapes concurrentes sobre el caché.
+ */
+static void* concurrent_scraper(void* arg)
+{
+    uint64_t* elapsed = arg;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < SCRAPES_PER_THREAD; i++)
+    {
+        scrape_cached();
+    }
+    *elapsed = bench_now_ns() - start;
+    return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t series = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000;
+    uint64_t per_generation = argc > 2 ? strtoull(argv[2], NULL, 10) : 10;
+    int threads = argc > 3 ? atoi(argv[3]) : 4;
+
+    metric_store_init(series);
+    bench_register_series(series, 100);
+
+    Buffer out;
+    buffer_init(&out);
+    size_t body_len = scrape_uncached(&out);
+    printf("series=%zu body=%zu bytes scrapes/generacion=%llu\n", series, body_len,
+           (unsigned long long)per_generation);
+
+    // Caché apagado: cada scrape renderiza el registro entero
+    uint64_t start = bench_now_ns();
+    for (uint64_t g = 0; g < generations; g++)
+    {
+        metric_store_publish();
+        for (uint64_t i = 0; i < per_generation; i++)
+        {
+            scrape_uncached(&out);
+        }
+    }
+    bench_report("scrape sin cache", generations * per_generation, bench_now_ns() - start);
+
+    // Caché encendido: un renderizado por generación, el resto comparte el cuerpo
+    start = bench_now_ns();
+    for (uint64_t g = 0; g < generations; g++)
+    {
+        metric_store_publish();
+        for (uint64_t i = 0; i < per_generation; i++)
+        {
+            scrape_cached();
+        }
+    }
+    bench_report("scrape con cache", generations * per_generation, bench_now_ns() - start);
+
+    // Caché encendido sin cambios de generación (réplicas que repiten el scrape)
+    start = bench_now_ns();
+    for (uint64_t i = 0; i < generations * per_generation; i++)
+    {
+        scrape_cached();
+    }
+    bench_report("scrape con cache (misma generacion)", generations * per_generation, bench_now_ns() - start);
+
+    // Scrapes concurrentes con una generación nueva: un solo renderizado compartido
+    pthread_t tids[threads];
+    uint64_t elapsed[threads];
+    metric_store_publish();
+    for (int t = 0; t < threads; t++)
+    {
+        pthread_create(&tids[t], NULL, concurrent_scraper, &elapsed[t]);
+    }
+    uint64_t total = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        pthread_join(tids[t], NULL);
+        total += elapsed[t];
+    }
+    bench_report("scrape con cache (concurrente)", (uint64_t)threads * SCRAPES_PER_THREAD, total);
+
+    buffer_free(&out);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file bench_series_index.c
+ * @brief Registro, búsqueda por etiquetas y escritura por identificador con muchas series.
+ *
+ * Compara la búsqueda en el índice (con hash precalculado y calculándolo) contra recorrer la
+ * lista de series de la familia, y contra escribir con el identificador guardado.
+ *
+ * Uso: bench_series_index [series] [series_por_familia]
+ */
+
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Tamaño de las etiquetas formateadas de cada serie.
+ */
+#define LABELS_SIZE 96
+
+/**
+ * @brief Búsqueda sin índice: recorre las series de la familia comparando etiquetas.
+ * @param family Índice de la familia.
+ * @param labels Etiquetas buscadas.
+ * @return Serie encontrada, o METRIC_SERIES_INVALID.
+ */
+static MetricSeries find_linear(int family, const char* labels)
+{
+    const MetricFamily* owner = metric_store_family((size_t)family);
+    MetricSeries series = atomic_load_explicit(&owner->head, memory_order_acquire);
+    while (series != METRIC_SERIES_INVALID)
+    {
+        const MetricSeriesInfo* info = metric_store_series(series);
+        if (strcmp(info->labels, labels) == 0)
+        {
+            return series;
+        }
+        series = atomic_load_explicit(&info->next, memory_order_acquire);
+    }
+    return METRIC_SERIES_INVALID;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+    size_t per_family = argc > 2 ? strtoul(argv[2], NULL, 10) : 500;
+
+    char (*labels)[LABELS_SIZE] = malloc(count * LABELS_SIZE);
+    int* families = malloc(count * sizeof(int));
+    uint64_t* hashes = malloc(count * sizeof(uint64_t));
+    MetricSeries* handles = malloc(count * sizeof(MetricSeries));
+    if (labels == NULL || families == NULL || hashes == NULL || handles == NULL || metric_store_init(count) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    printf("series=%zu series/familia=%zu\n", count, per_family);
+
+    // Etiquetas por proceso, al estilo de un recolector por PID y cgroup
+    char name[64];
+    int family = -1;
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i % per_family == 0)
+        {
+            snprintf(name, sizeof(name), "bench_process_family_%zu", i / per_family);
+            family = metric_store_add_family(name, "Serie sintética por proceso", METRIC_TYPE_GAUGE);
+        }
+        snprintf(labels[i], LABELS_SIZE, "{pid=\"%zu\",comm=\"worker-%zu\",cgroup=\"/system.slice/s%zu\"}", i,
+                 i % 64, i % 128);
+        families[i] = family;
+        handles[i] = metric_store_add_series(family, labels[i]);
+    }
+    bench_report("registro", count, bench_now_ns() - start);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        hashes[i] = metric_store_labels_hash(families[i], labels[i]);
+    }
+
+    // Orden de acceso pseudoaleatorio para no favorecer la caché
+    size_t lookups = count;
+    size_t step = 7919;
+    size_t misses = 0;
+
+    start = bench_now_ns();
+    for (size_t n = 0, i = 0; n < lookups; n++, i = (i + step) % count)
+    {
+        misses += metric_store_find_series(families[i], labels[i], hashes[i]) != handles[i];
+    }
+    bench_report("busqueda en indice (hash precalculado)", lookups, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (size_t n = 0, i = 0; n < lookups; n++, i = (i + step) % count)
+    {
+        uint64_t hash = metric_store_labels_hash(families[i], labels[i]);
+        misses += metric_store_find_series(families[i], labels[i], hash) != handles[i];
+    }
+    bench_report("busqueda en indice (calculando hash)", lookups, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (size_t n = 0, i = 0; n < lookups; n++, i = (i + step) % count)
+    {
+        misses += find_linear(families[i], labels[i]) != handles[i];
+    }
+    bench_report("busqueda lineal en la familia", lookups, bench_now_ns() - start);
+
+    start = bench_now_ns();
+    for (size_t n = 0, i = 0; n < lookups; n++, i = (i + step) % count)
+    {
+        metric_store_set(handles[i], (double)n);
+    }
+    bench_report("escritura por identificador", lookups, bench_now_ns() - start);
+
+    // Volver a registrar devuelve el mismo identificador
+    start = bench_now_ns();
+    for (size_t i = 0; i < count; i++)
+    {
+        misses += metric_store_add_series(families[i], labels[i]) != handles[i];
+    }
+    bench_report("registro repetido (existente)", count, bench_now_ns() - start);
+
+    if (misses != 0)
+    {
+        fprintf(stderr, "Error: %zu búsquedas devolvieron otra serie\n", misses);
+        return EXIT_FAILURE;
+    }
+    free(labels);
+    free(families);
+    free(hashes);
+    free(handles);
+    return EXIT_SUCCESS;
+}
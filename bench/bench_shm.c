@@ -0,0 +1,156 @@
+/**
+ * @file bench_shm.c
+ * @brief Latencia de lectura del segmento de memoria compartida, con y sin escritor activo.
+ *
+ * Un lector con shm_metrics.h lee el segmento en un bucle cerrado, primero sin escrituras y
+ * después mientras otro hilo actualiza el segmento sin pausa (el peor caso del seqlock). El
+ * escritor copia el mismo valor a dos campos y el lector verifica que siempre coincidan:
+ * termina con error si ve una lectura cortada. Como referencia se mide un `pread` de
+ * /proc/loadavg, el costo mínimo de cualquier lectura que pase por el kernel.
+ *
+ * Uso: bench_shm [lecturas]
+ */
+
+#include "bench.h"
+#include "../include/shm_output.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/** Series en las que el escritor copia el mismo valor */
+static MetricSeries cpu_metric;
+
+/** Segunda copia del valor */
+static MetricSeries memory_metric;
+
+/** Pide al escritor que termine */
+static atomic_int stopping;
+
+/** Actualizaciones hechas por el escritor */
+static uint64_t updates;
+
+/**
+ * @brief Actualiza el segmento sin pausa hasta que se le pida terminar.
+ * @param arg Argumento no utilizado.
+ * @return Siempre NULL.
+ */
+static void* writer_loop(void* arg)
+{
+    (void)arg;
+    while (!atomic_load(&stopping))
+    {
+        updates++;
+        metric_store_set(cpu_metric, (double)updates);
+        metric_store_set(memory_metric, (double)updates);
+        metric_store_publish();
+        shm_output_update();
+    }
+    return NULL;
+}
+
+/**
+ * @brief Lee el segmento `reads` veces y verifica la consistencia de cada lectura.
+ * @param reader Lector abierto.
+ * @param reads Lecturas.
+ * @param torn Recibe las lecturas cortadas o fallidas.
+ * @return Nanosegundos totales.
+ */
+static uint64_t read_loop(const ShmMetricsReader* reader, uint64_t reads, uint64_t* torn)
+{
+    ShmMetricsValues values;
+    *torn = 0;
+    uint64_t start = bench_now_ns();
+    for (uint64_t i = 0; i < reads; i++)
+    {
+        if (shm_metrics_read(reader, &values) != 0 || values.cpu_usage_percent != values.memory_usage_percent)
+        {
+            (*torn)++;
+        }
+    }
+    return bench_now_ns() - start;
+}
+
+int main(int argc, char* argv[])
+{
+    uint64_t reads = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+    if (reads == 0)
+    {
+        fprintf(stderr, "Uso: %s [lecturas]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "/bench_shm_%d", (int)getpid());
+    metric_store_init(1024);
+    cpu_metric = metric_store_register("cpu_usage_percentage", "Uso de CPU", METRIC_TYPE_GAUGE);
+    memory_metric = metric_store_register("memory_usage_percentage", "Uso de memoria", METRIC_TYPE_GAUGE);
+    metric_store_set(cpu_metric, 0.0);
+    metric_store_set(memory_metric, 0.0);
+    metric_store_publish();
+    if (shm_output_start(name) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    shm_output_update();
+
+    ShmMetricsReader reader;
+    if (shm_metrics_open(&reader, name) != 0)
+    {
+        fprintf(stderr, "Error al abrir el segmento %s\n", name);
+        shm_unlink(name);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t idle_torn;
+    uint64_t idle_ns = read_loop(&reader, reads, &idle_torn);
+
+    pthread_t writer;
+    pthread_create(&writer, NULL, writer_loop, NULL);
+    uint64_t busy_torn;
+    uint64_t busy_ns = read_loop(&reader, reads, &busy_torn);
+    atomic_store(&stopping, 1);
+    pthread_join(writer, NULL);
+
+    uint64_t update_count = 100000;
+    uint64_t start = bench_now_ns();
+    for (uint64_t i = 0; i < update_count; i++)
+    {
+        shm_output_update();
+    }
+    uint64_t update_ns = bench_now_ns() - start;
+
+    int fd = open("/proc/loadavg", O_RDONLY);
+    char buffer[128];
+    uint64_t syscall_count = 1000000;
+    start = bench_now_ns();
+    for (uint64_t i = 0; i < syscall_count && fd >= 0; i++)
+    {
+        if (pread(fd, buffer, sizeof(buffer), 0) < 0)
+        {
+            break;
+        }
+    }
+    uint64_t syscall_ns = bench_now_ns() - start;
+
+    shm_metrics_close(&reader);
+    shm_output_stop();
+    shm_unlink(name);
+
+    bench_report("lectura shm (escritor inactivo)", reads, idle_ns);
+    bench_report("lectura shm (escritor sin pausa)", reads, busy_ns);
+    printf("%-40s %12llu actualizaciones durante las lecturas\n", "escritor", (unsigned long long)updates);
+    bench_report("actualización del segmento (con PSI)", update_count, update_ns);
+    if (fd >= 0)
+    {
+        bench_report("pread /proc/loadavg (referencia)", syscall_count, syscall_ns);
+        close(fd);
+    }
+    if (idle_torn + busy_torn > 0)
+    {
+        fprintf(stderr, "Lecturas inconsistentes: %llu\n", (unsigned long long)(idle_torn + busy_torn));
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
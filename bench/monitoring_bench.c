@@ -0,0 +1,452 @@
+/**
+ * @file monitoring_bench.c
+ * @brief Costo por operación de cada collector, de cada `update_*` y de las rutas de salida.
+ *
+ * Mide en bucles cerrados cada función `get_*`, cada `update_*_gauge`, el renderizado de la
+ * exposición en los tres formatos y la creación del JSON de métricas. Cada caso se repite en
+ * tandas crecientes hasta cubrir el tiempo pedido e informa ns/op, reservas/op y syscalls/op.
+ *
+ * Las reservas se cuentan interponiendo malloc/calloc/realloc sobre las de glibc (incluye las
+ * que hace `fopen`). Las syscalls se cuentan con el tracepoint raw_syscalls:sys_enter de perf
+ * sobre el hilo actual; si el kernel no lo permite, con las lecturas y escrituras de
+ * /proc/self/io (`syscr` + `syscw`), que no ven open/close. El contador usado se informa en cada
+ * resultado y el costo de leerlo se descuenta.
+ *
+ * Los collectors que fallan en la máquina (por ejemplo, un disco que no existe) se omiten con
+ * un aviso, junto con su `update_*`. Durante las mediciones stderr va a /dev/null: llamado más
+ * rápido que el tick del kernel, `get_cpu_usage` sale por error (sin tiempo transcurrido) y
+ * esas salidas se cuentan en errors/op; las escrituras de los mensajes siguen contando como
+ * syscalls porque son parte del costo.
+ *
+ * Con -r los collectors leen bajo otra raíz de procfs, por ejemplo un fixture escrito con
+ * `procfs_fixture extract` (o que `procfs_fixture replay` va actualizando); los resultados
+ * indican "fixture" en lugar de "live" como fuente.
+ *
+ * Con -j cada resultado sale como un objeto JSON por línea, para comparar entre commits:
+ *
+ * @code
+ * {"bench":"get_cpu_usage","source":"live","iterations":8192,"ns_per_op":10234.5,
+ *  "allocs_per_op":2,"syscalls_per_op":4,"errors_per_op":0,"syscall_counter":"perf"}
+ * @endcode
+ *
+ * Uso: monitoring_bench [-j] [-t milisegundos_por_caso] [-s series_sintéticas] [-f filtro] [-r raíz_procfs]
+ */
+
+#include "bench.h"
+#include "../include/collector_plan.h"
+#include "../include/config.h"
+#include "../include/expose_metrics.h"
+#include "../include/exposition.h"
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/** Implementaciones de glibc a las que se delega */
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+/** Llamadas a malloc, calloc o realloc desde el inicio */
+static atomic_ulong malloc_calls;
+
+void* malloc(size_t size)
+{
+    atomic_fetch_add_explicit(&malloc_calls, 1, memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    atomic_fetch_add_explicit(&malloc_calls, 1, memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    atomic_fetch_add_explicit(&malloc_calls, 1, memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr)
+{
+    __libc_free(ptr);
+}
+
+/**
+ * @struct BenchCollector
+ * @brief Collector medido: su función `get_*` (a través del descriptor) y su `update_*`.
+ */
+typedef struct
+{
+    const char* get_name;    /**< Nombre del caso de la medición. */
+    const char* update_name; /**< Nombre del caso de la actualización. */
+    CollectorId id;          /**< Descriptor con la función de medición. */
+    void (*update)();        /**< Función `update_*` de expose_metrics.c. */
+} BenchCollector;
+
+/** Collectors en el orden de ejecución de la recolección */
+static const BenchCollector bench_collectors[] = {
+    {"get_cpu_usage", "update_cpu_gauge", COLLECTOR_CPU, update_cpu_gauge},
+    {"get_memory_usage", "update_memory_gauge", COLLECTOR_MEMORY, update_memory_gauge},
+    {"get_memory_fragmentation", "update_memory_fragmentation", COLLECTOR_MEMORY_FRAGMENTATION,
+     update_memory_fragmentation},
+    {"get_disk_usage", "update_disk_gauge", COLLECTOR_DISK, update_disk_gauge},
+    {"get_network_usage(lo)", "update_network_gauge", COLLECTOR_NETWORK, update_network_gauge},
+    {"get_process_usage", "update_procs_gauge", COLLECTOR_PROCESSES, update_procs_gauge},
+    {"get_ctxt_usage", "update_ctxt_gauge", COLLECTOR_CONTEXT_SWITCHES, update_ctxt_gauge},
+};
+
+/** Nombre de cada caso de renderizado, indexado por ExpositionFormat */
+static const char* render_names[EXPOSITION_FORMAT_COUNT] = {
+    "exposition_render(text)",
+    "exposition_render(openmetrics)",
+    "exposition_render(protobuf)",
+};
+
+/** Acumula resultados para que el compilador no descarte las llamadas */
+static volatile double sink;
+
+/** Descriptor de perf que cuenta syscalls del hilo, -1 si se usa /proc/self/io */
+static int perf_fd = -1;
+
+/** Salida de los casos de renderizado y de format_metrics_json; se reutiliza */
+static Buffer out;
+
+/** Tiempo mínimo de cada caso en nanosegundos */
+static uint64_t budget_ns = 200000000ull;
+
+/** Resultados en JSON por línea en lugar de texto */
+static int json_output;
+
+/** Fuente de los collectors: "live" (/proc) o "fixture" (-r) */
+static const char* source = "live";
+
+/**
+ * @brief Abre el contador de syscalls de perf (tracepoint raw_syscalls:sys_enter).
+ * @return Descriptor, o -1 si no hay tracefs o el kernel no lo permite.
+ */
+static int open_perf_counter()
+{
+    static const char* paths[] = {"/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+                                  "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"};
+    unsigned long long id = 0;
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]) && id == 0; i++)
+    {
+        FILE* fp = fopen(paths[i], "r");
+        if (fp != NULL)
+        {
+            if (fscanf(fp, "%llu", &id) != 1)
+            {
+                id = 0;
+            }
+            fclose(fp);
+        }
+    }
+    if (id == 0)
+    {
+        return -1;
+    }
+
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_TRACEPOINT;
+    attr.size = sizeof(attr);
+    attr.config = id;
+    attr.sample_period = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+/**
+ * @brief Lee el contador de syscalls vigente.
+ * @return Syscalls desde un origen arbitrario.
+ */
+static uint64_t read_syscalls()
+{
+    if (perf_fd >= 0)
+    {
+        uint64_t count = 0;
+        if (read(perf_fd, &count, sizeof(count)) != (ssize_t)sizeof(count))
+        {
+            return 0;
+        }
+        return count;
+    }
+
+    unsigned long long reads = 0;
+    unsigned long long writes = 0;
+    FILE* fp = fopen("/proc/self/io", "r");
+    if (fp == NULL)
+    {
+        return 0;
+    }
+    char line[128];
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        sscanf(line, "syscr: %llu", &reads);
+        sscanf(line, "syscw: %llu", &writes);
+    }
+    fclose(fp);
+    return reads + writes;
+}
+
+/**
+ * @brief Mide un caso hasta cubrir `budget_ns` e informa el resultado.
+ * @param name Nombre del caso.
+ * @param run Operación medida; devuelve 0, o -1 si falló.
+ * @param arg Argumento de la operación.
+ */
+static void run_case(const char* name, int (*run)(size_t), size_t arg)
+{
+    fflush(stderr);
+    int saved_stderr = dup(STDERR_FILENO);
+    int devnull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (devnull >= 0)
+    {
+        dup2(devnull, STDERR_FILENO);
+        close(devnull);
+    }
+
+    // Calentamiento: buffers dimensionados y estado previo de los collectors cargado
+    run(arg);
+
+    // Costo de leer los contadores sin nada en el medio, para descontarlo
+    uint64_t overhead = read_syscalls();
+    overhead = read_syscalls() - overhead;
+
+    uint64_t syscalls = read_syscalls();
+    unsigned long allocs = atomic_load(&malloc_calls);
+    uint64_t start = bench_now_ns();
+    uint64_t iterations = 0;
+    uint64_t errors = 0;
+    uint64_t elapsed;
+    for (uint64_t batch = 1;; batch *= 2)
+    {
+        for (uint64_t i = 0; i < batch; i++)
+        {
+            errors += run(arg) != 0;
+        }
+        iterations += batch;
+        elapsed = bench_now_ns() - start;
+        if (elapsed >= budget_ns)
+        {
+            break;
+        }
+    }
+    allocs = atomic_load(&malloc_calls) - allocs;
+    syscalls = read_syscalls() - syscalls - overhead;
+    if (saved_stderr >= 0)
+    {
+        dup2(saved_stderr, STDERR_FILENO);
+        close(saved_stderr);
+    }
+
+    double ns_per_op = (double)elapsed / (double)iterations;
+    double allocs_per_op = (double)allocs / (double)iterations;
+    double syscalls_per_op = (double)syscalls / (double)iterations;
+    double errors_per_op = (double)errors / (double)iterations;
+    const char* counter = perf_fd >= 0 ? "perf" : "proc_io";
+    if (json_output)
+    {
+        printf("{\"bench\":\"%s\",\"source\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.1f,"
+               "\"allocs_per_op\":%.3f,\"syscalls_per_op\":%.3f,\"errors_per_op\":%.3f,\"syscall_counter\":\"%s\"}\n",
+               name, source, (unsigned long long)iterations, ns_per_op, allocs_per_op, syscalls_per_op, errors_per_op,
+               counter);
+    }
+    else
+    {
+        printf("%-34s %12.0f ns/op %8.2f allocs/op %8.2f syscalls/op %6.2f errors/op\n", name, ns_per_op,
+               allocs_per_op, syscalls_per_op, errors_per_op);
+    }
+    fflush(stdout);
+}
+
+/**
+ * @brief Mide una vez con la función `get_*` de un collector.
+ * @param index Índice en `bench_collectors`.
+ */
+static int run_get(size_t index)
+{
+    double value = collector_descriptor(bench_collectors[index].id)->read();
+    sink = value;
+    return value >= 0 ? 0 : -1;
+}
+
+/**
+ * @brief Mide y guarda en el almacén con la función `update_*` de un collector.
+ * @param index Índice en `bench_collectors`.
+ */
+static int run_update(size_t index)
+{
+    bench_collectors[index].update();
+    return 0;
+}
+
+/**
+ * @brief Renderiza la exposición sobre el buffer reutilizado.
+ * @param format ExpositionFormat.
+ */
+static int run_render(size_t format)
+{
+    exposition_render((ExpositionFormat)format, &out);
+    sink = (double)out.len;
+    return 0;
+}
+
+/**
+ * @brief Crea el JSON de métricas como el endpoint, con una cadena nueva por llamada.
+ * @param unused Sin uso.
+ */
+static int run_create_json(size_t unused)
+{
+    (void)unused;
+    MetricsConfig config = {1, 1, 1, 1, 1, 1};
+    char* json = create_metrics_json(config);
+    if (json == NULL)
+    {
+        return -1;
+    }
+    sink = (double)strlen(json);
+    free(json);
+    return 0;
+}
+
+/**
+ * @brief Crea el JSON de métricas sobre el buffer reutilizado.
+ * @param unused Sin uso.
+ */
+static int run_format_json(size_t unused)
+{
+    (void)unused;
+    MetricsConfig config = {1, 1, 1, 1, 1, 1};
+    MetricsSample sample;
+    collector_plan_current_sample(&sample);
+    buffer_reset(&out);
+    int ret = format_metrics_json(config, &sample, &out);
+    sink = (double)out.len;
+    return ret;
+}
+
+/**
+ * @brief Indica si un caso pasa el filtro de la línea de comandos.
+ * @param filter Subcadena pedida, o NULL.
+ * @param name Nombre del caso.
+ * @return Distinto de 0 si debe ejecutarse.
+ */
+static int selected(const char* filter, const char* name)
+{
+    return filter == NULL || strstr(name, filter) != NULL;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t series = 0;
+    const char* filter = NULL;
+    int option;
+    while ((option = getopt(argc, argv, "jt:s:f:r:")) != -1)
+    {
+        switch (option)
+        {
+        case 'j':
+            json_output = 1;
+            break;
+        case 't':
+            budget_ns = strtoull(optarg, NULL, 10) * 1000000ull;
+            break;
+        case 's':
+            series = strtoul(optarg, NULL, 10);
+            break;
+        case 'f':
+            filter = optarg;
+            break;
+        case 'r':
+            if (metrics_set_procfs_root(optarg) != 0)
+            {
+                return EXIT_FAILURE;
+            }
+            source = "fixture";
+            break;
+        default:
+            fprintf(stderr,
+                    "Uso: %s [-j] [-t milisegundos_por_caso] [-s series_sintéticas] [-f filtro] [-r raíz_procfs]\n",
+                    argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (budget_ns == 0)
+    {
+        fprintf(stderr, "El tiempo por caso debe ser mayor que 0\n");
+        return EXIT_FAILURE;
+    }
+
+    if (metric_store_init(series + 64) != 0 || exposition_init() != 0 || collector_plan_init() != 0)
+    {
+        fprintf(stderr, "Error al inicializar el almacén de métricas\n");
+        return EXIT_FAILURE;
+    }
+    if (series > 0)
+    {
+        bench_register_series(series, 100);
+    }
+    perf_fd = open_perf_counter();
+    if (!json_output)
+    {
+        printf("fuente=%s series_sintéticas=%zu syscalls=%s\n", source, series,
+               perf_fd >= 0 ? "perf (todas)" : "/proc/self/io (solo lecturas y escrituras)");
+    }
+
+    // Una recolección completa publicada: la exposición y el JSON tienen valores que mostrar
+    size_t count = sizeof(bench_collectors) / sizeof(bench_collectors[0]);
+    int available[sizeof(bench_collectors) / sizeof(bench_collectors[0])];
+    for (size_t i = 0; i < count; i++)
+    {
+        available[i] = collector_run_one(bench_collectors[i].id) >= 0;
+        if (!available[i])
+        {
+            fprintf(stderr, "Se omiten %s y %s: el collector falla en esta máquina\n", bench_collectors[i].get_name,
+                    bench_collectors[i].update_name);
+        }
+    }
+    metric_store_publish();
+
+    buffer_init(&out);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (available[i] && selected(filter, bench_collectors[i].get_name))
+        {
+            run_case(bench_collectors[i].get_name, run_get, i);
+        }
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        if (available[i] && selected(filter, bench_collectors[i].update_name))
+        {
+            run_case(bench_collectors[i].update_name, run_update, i);
+        }
+    }
+    for (size_t format = 0; format < EXPOSITION_FORMAT_COUNT; format++)
+    {
+        if (selected(filter, render_names[format]))
+        {
+            run_case(render_names[format], run_render, format);
+        }
+    }
+    if (selected(filter, "create_metrics_json"))
+    {
+        run_case("create_metrics_json", run_create_json, 0);
+    }
+    if (selected(filter, "format_metrics_json"))
+    {
+        run_case("format_metrics_json", run_format_json, 0);
+    }
+    buffer_free(&out);
+    if (perf_fd >= 0)
+    {
+        close(perf_fd);
+    }
+    return EXIT_SUCCESS;
+}
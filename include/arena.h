@@ -0,0 +1,132 @@
+/**
+ * @file arena.h
+ * @brief Arena de asignación por bloques con reinicio O(1), conectada a los hooks de prom_alloc.h.
+ *
+ * Un hilo activa una arena con `arena_activate` durante un scrape o un ciclo de recolección;
+ * mientras está activa, prom_malloc, prom_realloc, prom_strdup y prom_free toman memoria de
+ * ella, y sin arena activa van a libc. Lo asignado dentro del alcance no puede sobrevivir al
+ * reinicio de la arena: los datos compartidos (cuerpos del caché, series) se asignan fuera.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Tamaño por defecto de cada bloque de una arena.
+ *
+ * Una respuesta filtrada típica crece en el lugar dentro de un único bloque; el estado de
+ * deflate (~260 KiB) ocupa un bloque propio que también se conserva entre usos.
+ */
+#define ARENA_DEFAULT_CHUNK_SIZE (256 * 1024)
+
+/**
+ * @brief Bloque de memoria de una arena (definido en arena.c).
+ */
+typedef struct ArenaChunk ArenaChunk;
+
+/**
+ * @struct Arena
+ * @brief Asignador por incremento de puntero sobre una lista de bloques.
+ *
+ * `arena_reset` no libera los bloques: el siguiente uso los recorre de nuevo, así que tras
+ * el primer scrape o ciclo una arena no vuelve a pedir memoria a libc.
+ */
+typedef struct
+{
+    ArenaChunk* head;    /**< Primer bloque. */
+    ArenaChunk* current; /**< Bloque del que se asigna ahora. */
+    size_t chunk_size;   /**< Tamaño mínimo de los bloques nuevos. */
+    size_t allocations;  /**< Asignaciones desde el último reinicio. */
+} Arena;
+
+/**
+ * @struct ArenaStats
+ * @brief Contadores globales de los hooks de asignación.
+ */
+typedef struct
+{
+    uint64_t arena_allocations; /**< Asignaciones servidas por una arena. */
+    uint64_t libc_allocations;  /**< Asignaciones que fueron a libc por no haber arena activa. */
+    uint64_t chunk_allocations; /**< Bloques pedidos a libc por las arenas. */
+    uint64_t resets;            /**< Reinicios de arenas. */
+} ArenaStats;
+
+/**
+ * @brief Inicializa una arena vacía; el primer bloque se reserva en la primera asignación.
+ * @param arena Arena a inicializar.
+ * @param chunk_size Tamaño mínimo de cada bloque (0 para ARENA_DEFAULT_CHUNK_SIZE).
+ */
+void arena_init(Arena* arena, size_t chunk_size);
+
+/**
+ * @brief Libera todos los bloques de la arena.
+ * @param arena Arena a destruir.
+ */
+void arena_destroy(Arena* arena);
+
+/**
+ * @brief Asigna memoria alineada a 16 bytes desde la arena.
+ * @param arena Arena origen.
+ * @param size Bytes pedidos.
+ * @return Puntero válido hasta el próximo `arena_reset`, o NULL si no hay memoria.
+ */
+void* arena_alloc(Arena* arena, size_t size);
+
+/**
+ * @brief Descarta todo lo asignado en O(1), conservando los bloques para el próximo uso.
+ * @param arena Arena a reiniciar.
+ */
+void arena_reset(Arena* arena);
+
+/**
+ * @brief Indica si un puntero pertenece a alguno de los bloques de la arena.
+ * @param arena Arena a consultar.
+ * @param ptr Puntero.
+ * @return 1 si pertenece, 0 en caso contrario.
+ */
+int arena_owns(const Arena* arena, const void* ptr);
+
+/**
+ * @brief Activa una arena para los hooks de asignación del hilo actual.
+ * @param arena Arena a activar, o NULL para volver a libc.
+ * @return Arena activa anteriormente, para restaurarla al salir del alcance.
+ */
+Arena* arena_activate(Arena* arena);
+
+/**
+ * @brief Hook de prom_malloc: arena activa del hilo o malloc.
+ */
+void* arena_hook_malloc(size_t size);
+
+/**
+ * @brief Hook de prom_realloc: crece en el lugar si es la última asignación de la arena.
+ */
+void* arena_hook_realloc(void* ptr, size_t size);
+
+/**
+ * @brief Hook de prom_strdup.
+ */
+char* arena_hook_strdup(const char* str);
+
+/**
+ * @brief Hook de prom_free: no hace nada con memoria de la arena activa, libera el resto.
+ */
+void arena_hook_free(void* ptr);
+
+/**
+ * @brief Copia los contadores globales de asignación.
+ * @param stats Destino.
+ */
+void arena_stats(ArenaStats* stats);
+
+// Los hooks de prom_alloc.h pasan por la arena activa
+#define prom_malloc arena_hook_malloc
+#define prom_realloc arena_hook_realloc
+#define prom_strdup arena_hook_strdup
+#define prom_free arena_hook_free
+#include "../lib/prom_alloc.h"
+
+#endif // ARENA_H
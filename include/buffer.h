@@ -0,0 +1,85 @@
+/**
+ * @file buffer.h
+ * @brief Buffer de salida reutilizable que crece según se necesite.
+ */
+
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#include <stdarg.h>
+#include <stddef.h>
+
+/**
+ * @struct Buffer
+ * @brief Buffer de bytes contiguo. Se reutiliza entre usos con `buffer_reset` sin liberar memoria.
+ *
+ * La memoria se pide con los hooks de prom_alloc.h: un buffer que crece con una arena activa
+ * (ver arena.h) vive en esa arena y no debe usarse después de reiniciarla.
+ */
+typedef struct
+{
+    char* data;      /**< Contenido (terminado en '\0' mientras haya capacidad reservada). */
+    size_t len;      /**< Bytes escritos. */
+    size_t capacity; /**< Bytes reservados. */
+} Buffer;
+
+/**
+ * @brief Inicializa un buffer vacío sin reservar memoria.
+ * @param buffer Buffer a inicializar.
+ */
+void buffer_init(Buffer* buffer);
+
+/**
+ * @brief Libera la memoria del buffer y lo deja vacío.
+ * @param buffer Buffer a liberar.
+ */
+void buffer_free(Buffer* buffer);
+
+/**
+ * @brief Vacía el buffer conservando la memoria reservada.
+ * @param buffer Buffer a vaciar.
+ */
+void buffer_reset(Buffer* buffer);
+
+/**
+ * @brief Garantiza espacio para `extra` bytes más (y el '\0' final).
+ * @param buffer Buffer destino.
+ * @param extra Bytes adicionales requeridos.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int buffer_reserve(Buffer* buffer, size_t extra);
+
+/**
+ * @brief Agrega `len` bytes al final del buffer.
+ * @param buffer Buffer destino.
+ * @param data Bytes a agregar.
+ * @param len Cantidad de bytes.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int buffer_append(Buffer* buffer, const void* data, size_t len);
+
+/**
+ * @brief Agrega una cadena terminada en '\0'.
+ * @param buffer Buffer destino.
+ * @param str Cadena a agregar.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int buffer_append_str(Buffer* buffer, const char* str);
+
+/**
+ * @brief Agrega un único carácter.
+ * @param buffer Buffer destino.
+ * @param c Carácter a agregar.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int buffer_append_char(Buffer* buffer, char c);
+
+/**
+ * @brief Agrega texto con formato estilo printf.
+ * @param buffer Buffer destino.
+ * @param fmt Formato.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int buffer_printf(Buffer* buffer, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#endif // BUFFER_H
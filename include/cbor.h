@@ -0,0 +1,64 @@
+/**
+ * @file cbor.h
+ * @brief Codificación mínima de CBOR (RFC 8949) sobre un Buffer: mapas, textos, números,
+ *        booleanos y null.
+ *
+ * Solo lo que necesitan los mensajes del monitor: cabeceras de mapa de longitud conocida,
+ * cadenas UTF-8, enteros sin signo y reales de 64 bits (NaN e infinitos se codifican tal cual,
+ * CBOR los admite), más los valores simples que usa el modo delta.
+ */
+
+#ifndef CBOR_H
+#define CBOR_H
+
+#include "buffer.h"
+#include <stdint.h>
+
+/**
+ * @brief Agrega la cabecera de un mapa; deben seguirle `pairs` pares clave-valor.
+ * @param out Buffer destino.
+ * @param pairs Cantidad de pares.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int cbor_map(Buffer* out, uint64_t pairs);
+
+/**
+ * @brief Agrega una cadena de texto.
+ * @param out Buffer destino.
+ * @param text Cadena UTF-8 terminada en '\0'.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int cbor_text(Buffer* out, const char* text);
+
+/**
+ * @brief Agrega un entero sin signo con la codificación más corta.
+ * @param out Buffer destino.
+ * @param value Valor.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int cbor_uint(Buffer* out, uint64_t value);
+
+/**
+ * @brief Agrega un real de 64 bits.
+ * @param out Buffer destino.
+ * @param value Valor.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int cbor_double(Buffer* out, double value);
+
+/**
+ * @brief Agrega true o false.
+ * @param out Buffer destino.
+ * @param value Distinto de 0 para true.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int cbor_bool(Buffer* out, int value);
+
+/**
+ * @brief Agrega null.
+ * @param out Buffer destino.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int cbor_null(Buffer* out);
+
+#endif // CBOR_H
@@ -0,0 +1,82 @@
+/**
+ * @file collection.h
+ * @brief Recolección de métricas: callbacks registrados, ejecución serializada y modo scrape.
+ *
+ * Las funciones de recolección escriben en el buffer trasero del almacén (`metric_store_set`)
+ * y solo se ejecutan dentro de una recolección, así que nunca corren en paralelo aunque las
+ * dispare el bucle principal o el hilo HTTP de un scrape. Durante el ciclo tienen activa una
+ * arena (arena.h): lo que pidan con prom_malloc se descarta al terminar el ciclo.
+ */
+
+#ifndef COLLECTION_H
+#define COLLECTION_H
+
+#include "arena.h"
+#include "config.h"
+#include "metric_store.h"
+#include <stdint.h>
+
+/**
+ * @brief Cantidad máxima de funciones de recolección registradas.
+ */
+#define COLLECTION_MAX_CALLBACKS 16
+
+/**
+ * @brief Función de recolección, al estilo de `prom_collector_set_collect_fn`.
+ * @param arg Argumento indicado al registrarla.
+ */
+typedef void CollectFn(void* arg);
+
+/**
+ * @brief Función invocada tras cada publicación, en el hilo que recolectó.
+ *
+ * Mientras corre no puede haber otra publicación, así que el buffer frontal de
+ * `metric_store_read_begin` es estable y no hace falta validar la lectura. Debe ser breve:
+ * los scrapes que esperan la recolección no se liberan hasta que retorna. Lo que escriba en el
+ * almacén debe pasar por `metric_store_stage*` y se verá en la publicación siguiente.
+ *
+ * @param generation Generación recién publicada.
+ * @param arg Argumento indicado al registrarla.
+ */
+typedef void PublishFn(uint64_t generation, void* arg);
+
+/**
+ * @brief Registra las métricas propias de la recolección.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+int collection_init();
+
+/**
+ * @brief Agrega una función de recolección; se ejecutan en orden de registro.
+ * @param fn Función a invocar en cada recolección.
+ * @param arg Argumento para `fn`.
+ * @return 0 en caso de éxito, -1 si se alcanzó COLLECTION_MAX_CALLBACKS.
+ */
+int collection_add_callback(CollectFn* fn, void* arg);
+
+/**
+ * @brief Agrega una función a invocar tras cada publicación; se ejecutan en orden de registro.
+ * @param fn Función a invocar con la generación publicada.
+ * @param arg Argumento para `fn`.
+ * @return 0 en caso de éxito, -1 si se alcanzó COLLECTION_MAX_CALLBACKS.
+ */
+int collection_add_publish_callback(PublishFn* fn, void* arg);
+
+/**
+ * @brief Ejecuta una recolección completa y publica la generación resultante.
+ *
+ * Si ya hay una recolección en curso, espera a que termine y no ejecuta otra.
+ */
+void collection_run();
+
+/**
+ * @brief Recolecta bajo demanda antes de servir un scrape, si el modo es "scrape".
+ *
+ * Los scrapes concurrentes comparten una única recolección: el primero la ejecuta y el resto
+ * espera su publicación. Si la última recolección empezó hace menos de
+ * `collection.min_interval_ms`, se sirven los datos vigentes sin recolectar.
+ * En modo "interval" no hace nada.
+ */
+void collection_on_scrape();
+
+#endif // COLLECTION_H
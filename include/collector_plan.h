@@ -0,0 +1,133 @@
+/**
+ * @file collector_plan.h
+ * @brief Plan de recolección compilado a partir de MetricsConfig.
+ *
+ * Cada métrica del sistema tiene un descriptor fijo: la función que la mide, la serie del
+ * almacén donde queda y el campo de MetricsSample donde la encuentra el JSON. Compilar la
+ * configuración produce un arreglo con solo los descriptores habilitados, así que recorrerlo
+ * no evalúa nada de lo deshabilitado. Cada ciclo mide una sola vez; todas las salidas
+ * (exposición de Prometheus, remote_write, FIFO del monitor, memoria compartida, JSON) leen
+ * esos mismos valores del almacén en lugar de volver a medir.
+ */
+
+#ifndef COLLECTOR_PLAN_H
+#define COLLECTOR_PLAN_H
+
+#include "config.h"
+#include "metric_store.h"
+#include <stddef.h>
+
+/**
+ * @brief Valor de `sample_offset` para las métricas que no van en MetricsSample.
+ */
+#define COLLECTOR_NO_SAMPLE ((size_t)-1)
+
+/**
+ * @enum CollectorId
+ * @brief Métricas del sistema; indexan la tabla de descriptores.
+ */
+typedef enum
+{
+    COLLECTOR_CPU,                  /**< Uso de CPU. */
+    COLLECTOR_MEMORY,               /**< Uso de memoria. */
+    COLLECTOR_MEMORY_FRAGMENTATION, /**< Memoria fragmentada. */
+    COLLECTOR_DISK,                 /**< Lecturas y escrituras del disco. */
+    COLLECTOR_NETWORK,              /**< Bytes de la interfaz de red. */
+    COLLECTOR_PROCESSES,            /**< Procesos en ejecución. */
+    COLLECTOR_CONTEXT_SWITCHES,     /**< Cambios de contexto. */
+    COLLECTOR_COUNT                 /**< Cantidad de métricas. */
+} CollectorId;
+
+/**
+ * @brief Mide una métrica.
+ * @return Valor, o negativo en caso de error.
+ */
+typedef double CollectorReadFn(void);
+
+/**
+ * @struct CollectorDescriptor
+ * @brief Métrica del sistema con su función de medición y sus destinos.
+ */
+typedef struct
+{
+    const char* family;    /**< Familia del almacén. */
+    const char* help;      /**< Texto de ayuda de la familia. */
+    const char* error;     /**< Mensaje cuando la medición falla. */
+    size_t config_offset;  /**< Campo de MetricsConfig que la habilita. */
+    size_t sample_offset;  /**< Campo de MetricsSample, o COLLECTOR_NO_SAMPLE. */
+    CollectorReadFn* read; /**< Función que la mide. */
+} CollectorDescriptor;
+
+/**
+ * @struct CollectorPlan
+ * @brief Descriptores habilitados por una configuración, en orden de ejecución.
+ */
+typedef struct
+{
+    MetricsConfig config;                              /**< Configuración compilada. */
+    const CollectorDescriptor* steps[COLLECTOR_COUNT]; /**< Descriptores habilitados. */
+    size_t count;                                      /**< Pasos. */
+} CollectorPlan;
+
+/**
+ * @brief Registra en el almacén una serie por cada métrica del sistema.
+ *
+ * Conviene llamarla al final de la inicialización: las salidas que se inician antes resuelven
+ * estas series por nombre de familia al usarlas.
+ *
+ * @return 0 en caso de éxito, -1 si alguna serie no pudo registrarse.
+ */
+int collector_plan_init();
+
+/**
+ * @brief Devuelve el descriptor de una métrica.
+ * @param id Métrica.
+ * @return Descriptor.
+ */
+const CollectorDescriptor* collector_descriptor(CollectorId id);
+
+/**
+ * @brief Devuelve la serie del almacén de una métrica.
+ * @param id Métrica.
+ * @return Serie, o METRIC_SERIES_INVALID antes de `collector_plan_init`.
+ */
+MetricSeries collector_series_of(CollectorId id);
+
+/**
+ * @brief Compila una configuración en un plan.
+ *
+ * Las series de las métricas que el plan anterior medía y este no se marcan ausentes una sola
+ * vez, en el buffer trasero, para que dejen de exponerse desde la próxima publicación.
+ *
+ * @param plan Plan a reemplazar; `count` en 0 si es nuevo.
+ * @param config Métricas habilitadas.
+ */
+void collector_plan_compile(CollectorPlan* plan, const MetricsConfig* config);
+
+/**
+ * @brief Ejecuta una métrica fuera de un plan y deja el valor en el buffer trasero.
+ * @param id Métrica.
+ * @return Valor medido, o negativo si la medición falló (ya informado por stderr).
+ */
+double collector_run_one(CollectorId id);
+
+/**
+ * @brief Mide una vez cada métrica del plan y deja los valores en el buffer trasero.
+ *
+ * Debe llamarse desde una función de recolección (ver `collection_add_callback`). Las
+ * mediciones que fallan conservan el valor anterior.
+ *
+ * @param plan Plan compilado.
+ */
+void collector_plan_run(const CollectorPlan* plan);
+
+/**
+ * @brief Copia los últimos valores publicados de las métricas del sistema, sin medir.
+ *
+ * Los campos de las métricas que no se recolectan (o aún no se publicaron) quedan en NaN.
+ *
+ * @param sample Destino.
+ */
+void collector_plan_current_sample(MetricsSample* sample);
+
+#endif // COLLECTOR_PLAN_H
@@ -0,0 +1,54 @@
+/**
+ * @file compression.h
+ * @brief Codificaciones de contenido HTTP soportadas y negociación vía Accept-Encoding.
+ *
+ * gzip usa zlib y siempre está disponible; zstd solo si se compiló con HAVE_ZSTD.
+ */
+
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include "buffer.h"
+
+/**
+ * @enum ContentEncoding
+ * @brief Codificación del cuerpo de una respuesta.
+ */
+typedef enum
+{
+    CONTENT_ENCODING_IDENTITY, /**< Sin compresión. */
+    CONTENT_ENCODING_GZIP,     /**< gzip (RFC 1952). */
+    CONTENT_ENCODING_ZSTD,     /**< Zstandard (RFC 8878). */
+    CONTENT_ENCODING_COUNT     /**< Cantidad de codificaciones. */
+} ContentEncoding;
+
+/**
+ * @brief Nombre HTTP de una codificación.
+ * @param encoding Codificación.
+ * @return Token para Content-Encoding ("identity", "gzip" o "zstd").
+ */
+const char* content_encoding_name(ContentEncoding encoding);
+
+/**
+ * @brief Elige la codificación preferida por el cliente entre las habilitadas.
+ *
+ * Respeta los valores q del encabezado (q=0 excluye); ante empate prefiere zstd sobre gzip.
+ *
+ * @param accept_encoding Valor del encabezado Accept-Encoding, puede ser NULL.
+ * @param enabled Máscara de codificaciones habilitadas (bit 1 << ContentEncoding).
+ * @return Codificación elegida; CONTENT_ENCODING_IDENTITY si ninguna aplica.
+ */
+ContentEncoding negotiate_content_encoding(const char* accept_encoding, unsigned enabled);
+
+/**
+ * @brief Comprime un bloque completo.
+ * @param encoding Codificación (gzip o zstd).
+ * @param level Nivel de compresión.
+ * @param data Datos a comprimir.
+ * @param len Cantidad de bytes.
+ * @param out Buffer destino; se vacía antes de escribir.
+ * @return 0 en caso de éxito, -1 si la codificación no está disponible o falló.
+ */
+int compress_buffer(ContentEncoding encoding, int level, const char* data, size_t len, Buffer* out);
+
+#endif // COMPRESSION_H
@@ -1,11 +1,28 @@
+/**
+ * @file config.h
+ * @brief Configuración de métricas: lectura, snapshot inmutable y recarga en caliente.
+ */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "buffer.h"
 #include <cjson/cJSON.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+/**
+ * @brief Ruta por defecto del archivo de configuración, relativa al directorio de trabajo.
+ */
+#define DEFAULT_CONFIG_FILE "../config.json"
+
 /**
  * @struct MetricsConfig
  * @brief Estructura para almacenar las métricas que se desean monitorear.
@@ -22,6 +39,532 @@ typedef struct
     int context_switches; /**< Estado del monitoreo de cambios de contexto: 1 habilitado, 0 deshabilitado. */
 } MetricsConfig;
 
+/**
+ * @brief Nivel de compresión gzip por defecto para /metrics.
+ */
+#define DEFAULT_GZIP_LEVEL 6
+
+/**
+ * @brief Nivel de compresión zstd por defecto para /metrics.
+ */
+#define DEFAULT_ZSTD_LEVEL 3
+
+/**
+ * @struct ExpositionConfig
+ * @brief Opciones de la exposición HTTP (sección "exposition" del archivo).
+ *
+ * Se leen al comprimir cada generación, así que los cambios aplican sin reiniciar.
+ */
+typedef struct
+{
+    int gzip_level; /**< Nivel gzip (1-9); 0 deshabilita gzip. */
+    int zstd_level; /**< Nivel zstd (1-19); 0 deshabilita zstd. */
+} ExpositionConfig;
+
+/**
+ * @brief Puerto TCP por defecto del servidor HTTP.
+ */
+#define DEFAULT_HTTP_PORT 8000
+
+/**
+ * @brief Permisos por defecto de un socket AF_UNIX de exposición.
+ */
+#define DEFAULT_HTTP_UNIX_PERMISSIONS 0660
+
+/**
+ * @brief Cantidad de hilos por defecto del modo epoll.
+ */
+#define DEFAULT_HTTP_THREADS 4
+
+/**
+ * @brief Máximo de conexiones simultáneas por defecto.
+ */
+#define DEFAULT_HTTP_CONNECTION_LIMIT 256
+
+/**
+ * @brief Segundos por defecto antes de cerrar una conexión inactiva.
+ */
+#define DEFAULT_HTTP_TIMEOUT 10
+
+/**
+ * @enum HttpServerMode
+ * @brief Modelo de concurrencia del servidor HTTP.
+ */
+typedef enum
+{
+    HTTP_MODE_SELECT,                /**< Un único hilo con select(). */
+    HTTP_MODE_EPOLL,                 /**< Pool de hilos, cada uno con su propio epoll. */
+    HTTP_MODE_THREAD_PER_CONNECTION, /**< Un hilo por conexión. */
+} HttpServerMode;
+
+/**
+ * @brief Cantidad máxima de listeners HTTP configurables.
+ */
+#define HTTP_MAX_LISTENERS 8
+
+/**
+ * @brief Tamaño del campo de dirección de un listener (cubre `sun_path` de AF_UNIX).
+ */
+#define HTTP_LISTENER_ADDRESS_SIZE 108
+
+/**
+ * @enum HttpListenerType
+ * @brief Familia de socket de un listener HTTP.
+ */
+typedef enum
+{
+    HTTP_LISTENER_TCP,  /**< Dirección IPv4 o IPv6 y puerto. */
+    HTTP_LISTENER_UNIX, /**< Socket AF_UNIX en una ruta del sistema de archivos. */
+} HttpListenerType;
+
+/**
+ * @struct HttpListener
+ * @brief Un punto de escucha de la exposición (un elemento de "http.listeners").
+ */
+typedef struct
+{
+    HttpListenerType type;                    /**< Familia del socket. */
+    char address[HTTP_LISTENER_ADDRESS_SIZE]; /**< Dirección IP numérica (TCP) o ruta del socket (UNIX). */
+    int port;                                 /**< Puerto TCP; no se usa en AF_UNIX. */
+    int permissions;                          /**< Permisos del socket AF_UNIX (p. ej. 0660). */
+} HttpListener;
+
+/**
+ * @struct HttpConfig
+ * @brief Opciones del servidor HTTP (sección "http" del archivo).
+ *
+ * Se leen solo al iniciar el servidor: cambiarlas requiere reiniciar el proceso. Sin
+ * "listeners", se escucha en TCP en todas las interfaces IPv4 en "port" (por defecto 8000).
+ */
+typedef struct
+{
+    HttpListener listeners[HTTP_MAX_LISTENERS]; /**< Puntos de escucha; todos comparten manejador y caché. */
+    int listener_count;                         /**< Cantidad de listeners válidos. */
+    HttpServerMode mode;                        /**< Modelo de concurrencia ("select", "epoll", etc.). */
+    int threads;                                /**< Hilos del pool en modo epoll (por listener). */
+    int connection_limit;                       /**< Máximo de conexiones simultáneas (por listener). */
+    int timeout;                                /**< Segundos de inactividad por conexión (0 = sin límite). */
+} HttpConfig;
+
+/**
+ * @brief Intervalo mínimo por defecto entre recolecciones disparadas por scrapes, en milisegundos.
+ */
+#define DEFAULT_COLLECTION_MIN_INTERVAL_MS 500
+
+/**
+ * @enum CollectionMode
+ * @brief Momento en que se recolectan las métricas del sistema.
+ */
+typedef enum
+{
+    COLLECTION_MODE_INTERVAL, /**< El bucle principal recolecta cada segundo. */
+    COLLECTION_MODE_SCRAPE,   /**< Cada scrape de /metrics dispara la recolección. */
+} CollectionMode;
+
+/**
+ * @struct CollectionConfig
+ * @brief Opciones de recolección (sección "collection" del archivo).
+ *
+ * Se leen en cada ciclo y en cada scrape, así que los cambios aplican sin reiniciar.
+ */
+typedef struct
+{
+    CollectionMode mode; /**< "interval" o "scrape". */
+    int min_interval_ms; /**< En modo scrape, edad mínima de los datos antes de volver a recolectar. */
+} CollectionConfig;
+
+/**
+ * @brief Tamaño de los campos de texto de "remote_write" (URL y directorio del WAL).
+ */
+#define REMOTE_WRITE_TEXT_SIZE 256
+
+/**
+ * @brief Máximo de muestras por petición de remote_write por defecto.
+ */
+#define DEFAULT_REMOTE_WRITE_MAX_SAMPLES 2000
+
+/**
+ * @brief Envíos simultáneos (shards) de remote_write por defecto.
+ */
+#define DEFAULT_REMOTE_WRITE_CONCURRENCY 2
+
+/**
+ * @brief Espera inicial entre reintentos de remote_write por defecto, en milisegundos.
+ */
+#define DEFAULT_REMOTE_WRITE_MIN_BACKOFF_MS 100
+
+/**
+ * @brief Espera máxima entre reintentos de remote_write por defecto, en milisegundos.
+ */
+#define DEFAULT_REMOTE_WRITE_MAX_BACKOFF_MS 30000
+
+/**
+ * @brief Tamaño de cada segmento del WAL de remote_write por defecto, en KiB.
+ */
+#define DEFAULT_REMOTE_WRITE_SEGMENT_KB 1024
+
+/**
+ * @brief Segmentos del WAL que se conservan por shard por defecto.
+ */
+#define DEFAULT_REMOTE_WRITE_MAX_SEGMENTS 16
+
+/**
+ * @struct RemoteWriteConfig
+ * @brief Opciones del envío por remote_write (sección "remote_write" del archivo).
+ *
+ * Se leen solo al iniciar: cambiarlas requiere reiniciar el proceso. Sin "url" el envío está
+ * deshabilitado.
+ */
+typedef struct
+{
+    char url[REMOTE_WRITE_TEXT_SIZE];     /**< Endpoint `http://host[:puerto]/ruta`; vacío si está deshabilitado. */
+    int max_samples_per_send;             /**< Máximo de muestras por petición. */
+    int concurrency;                      /**< Shards: cada uno con su WAL, su conexión y su hilo. */
+    int min_backoff_ms;                   /**< Espera tras el primer fallo. */
+    int max_backoff_ms;                   /**< Tope de la espera, que se duplica en cada reintento. */
+    int timeout;                          /**< Segundos de espera de conexión y respuesta. */
+    char wal_dir[REMOTE_WRITE_TEXT_SIZE]; /**< Directorio del WAL (un subdirectorio por shard). */
+    int wal_segment_kb;                   /**< Tamaño a partir del cual se cierra un segmento. */
+    int wal_max_segments;                 /**< Segmentos por shard antes de descartar el más viejo. */
+} RemoteWriteConfig;
+
+/**
+ * @brief Tamaño de los campos de texto de "line_output" (dirección y prefijo).
+ */
+#define LINE_OUTPUT_TEXT_SIZE 128
+
+/**
+ * @brief Puerto por defecto del protocolo plaintext de Graphite (carbon).
+ */
+#define DEFAULT_GRAPHITE_PORT 2003
+
+/**
+ * @brief Puerto por defecto de StatsD.
+ */
+#define DEFAULT_STATSD_PORT 8125
+
+/**
+ * @brief Tamaño máximo por defecto de cada datagrama UDP (1500 menos cabeceras IP/UDP con margen).
+ */
+#define DEFAULT_LINE_OUTPUT_MTU 1432
+
+/**
+ * @enum LineProtocol
+ * @brief Formato de las líneas enviadas por "line_output".
+ */
+typedef enum
+{
+    LINE_PROTOCOL_GRAPHITE, /**< `nombre;etiqueta=valor valor timestamp` (plaintext de carbon). */
+    LINE_PROTOCOL_STATSD,   /**< `nombre:valor|g` o `|c`, con etiquetas al estilo DogStatsD. */
+} LineProtocol;
+
+/**
+ * @enum LineTransport
+ * @brief Transporte de las líneas enviadas por "line_output".
+ */
+typedef enum
+{
+    LINE_TRANSPORT_UDP, /**< Datagramas de hasta `mtu` bytes con líneas completas. */
+    LINE_TRANSPORT_TCP, /**< Conexión persistente; se reconecta si se pierde. */
+} LineTransport;
+
+/**
+ * @struct LineOutputConfig
+ * @brief Opciones del envío en protocolo de líneas (sección "line_output" del archivo).
+ *
+ * Se leen solo al iniciar: cambiarlas requiere reiniciar el proceso. Sin "address" el envío
+ * está deshabilitado.
+ */
+typedef struct
+{
+    LineProtocol protocol;               /**< "graphite" o "statsd". */
+    LineTransport transport;             /**< "udp" o "tcp". */
+    char address[LINE_OUTPUT_TEXT_SIZE]; /**< Nombre o dirección del servidor; vacío si está deshabilitado. */
+    int port;                            /**< Puerto; por defecto el del protocolo. */
+    char prefix[LINE_OUTPUT_TEXT_SIZE];  /**< Prefijo de los nombres (se agrega con un punto). */
+    int mtu;                             /**< Tamaño máximo de cada datagrama UDP. */
+} LineOutputConfig;
+
+/**
+ * @brief Tamaño de la ruta del archivo de historia.
+ */
+#define HISTORY_PATH_SIZE 256
+
+/**
+ * @brief Ventana de retención por defecto de la historia local, en horas.
+ */
+#define DEFAULT_HISTORY_RETENTION_HOURS 24
+
+/**
+ * @brief Resolución por defecto de la historia local, en segundos.
+ */
+#define DEFAULT_HISTORY_RESOLUTION_SECONDS 1
+
+/**
+ * @brief Series que admite por defecto el archivo de historia.
+ */
+#define DEFAULT_HISTORY_MAX_SERIES 256
+
+/**
+ * @struct HistoryConfig
+ * @brief Opciones de la historia local (sección "history" del archivo).
+ *
+ * Se leen solo al iniciar. Sin "path" la historia está deshabilitada. Cambiar la retención,
+ * la resolución o la cantidad de series cambia la geometría del archivo y lo recrea vacío.
+ */
+typedef struct
+{
+    char path[HISTORY_PATH_SIZE]; /**< Archivo mapeado en memoria; vacío si está deshabilitada. */
+    int retention_hours;          /**< Ventana que debe caber en el anillo de cada serie. */
+    int resolution_seconds;       /**< Separación mínima entre dos puntos de una serie. */
+    int max_series;               /**< Series que caben en el archivo. */
+} HistoryConfig;
+
+/**
+ * @brief Ventana por defecto del muestreo de alta frecuencia, en segundos (un scrape típico).
+ */
+#define DEFAULT_SAMPLER_WINDOW_SECONDS 15
+
+/**
+ * @brief Frecuencia máxima del muestreo: la más alta que entra en el presupuesto de 0.5% de un
+ *        núcleo de bench_sampler, incluso en máquinas virtuales con despertares caros.
+ */
+#define SAMPLER_MAX_RATE_HZ 50
+
+/**
+ * @struct SamplerConfig
+ * @brief Opciones del muestreo de alta frecuencia (sección "sampler" del archivo).
+ *
+ * Se leen solo al iniciar. Con "rate_hz" en 0 el muestreo está deshabilitado; admite hasta
+ * SAMPLER_MAX_RATE_HZ.
+ */
+typedef struct
+{
+    int rate_hz;        /**< Muestras por segundo de cada fuente. */
+    int window_seconds; /**< Duración de la ventana que resumen min, max, media y cuantiles. */
+    int cpu;            /**< Muestrear el uso de CPU. */
+    int run_queue;      /**< Muestrear los procesos ejecutables. */
+    int psi;            /**< Muestrear la presión (PSI) de CPU, memoria y E/S. */
+} SamplerConfig;
+
+/**
+ * @brief Bandas muertas configurables por sección en el modo delta.
+ */
+#define DELTA_DEADBAND_MAX 16
+
+/**
+ * @brief Tamaño del nombre de familia de una banda muerta.
+ */
+#define DELTA_FAMILY_SIZE 64
+
+/**
+ * @brief Ciclos por defecto entre dos keyframes del modo delta.
+ */
+#define DEFAULT_DELTA_KEYFRAME_INTERVAL 60
+
+/**
+ * @struct DeltaDeadband
+ * @brief Cambio mínimo de una métrica para que se envíe en un delta.
+ */
+typedef struct
+{
+    char family[DELTA_FAMILY_SIZE]; /**< Familia del almacén (p. ej. "cpu_usage_percentage"). */
+    double deadband;                /**< Diferencia absoluta con el último valor enviado que se ignora. */
+} DeltaDeadband;
+
+/**
+ * @struct DeltaConfig
+ * @brief Opciones del modo delta de una salida en streaming ("mode", "keyframe_interval" y
+ *        "deadband" de su sección).
+ */
+typedef struct
+{
+    int enabled;                                 /**< "mode": "full" (0) o "delta" (1). */
+    int keyframe_interval;                       /**< Ciclos entre dos keyframes. */
+    DeltaDeadband deadbands[DELTA_DEADBAND_MAX]; /**< Bandas muertas; sin banda se envía cualquier cambio. */
+    int deadband_count;                          /**< Elementos de `deadbands`. */
+} DeltaConfig;
+
+/**
+ * @brief Tamaño de la ruta del FIFO del monitor.
+ */
+#define MONITOR_PATH_SIZE 256
+
+/**
+ * @brief Capacidad por defecto de la cola del FIFO del monitor, en KiB.
+ */
+#define DEFAULT_MONITOR_QUEUE_KB 256
+
+/**
+ * @enum MonitorFraming
+ * @brief Delimitación de los mensajes escritos en el FIFO del monitor.
+ */
+typedef enum
+{
+    MONITOR_FRAMING_NDJSON, /**< Un mensaje JSON por línea (solo con codificación JSON). */
+    MONITOR_FRAMING_LENGTH, /**< Cada mensaje precedido por su longitud (u32 big-endian). */
+} MonitorFraming;
+
+/**
+ * @enum MonitorEncoding
+ * @brief Codificación de los mensajes del monitor.
+ */
+typedef enum
+{
+    MONITOR_ENCODING_JSON, /**< Objeto JSON compacto. */
+    MONITOR_ENCODING_CBOR, /**< Mapa CBOR (RFC 8949), más barato de parsear. */
+} MonitorEncoding;
+
+/**
+ * @struct MonitorConfig
+ * @brief Opciones del envío al monitor por FIFO (sección "monitor" del archivo).
+ *
+ * Se leen solo al iniciar. Sin "fifo_path" el envío está deshabilitado.
+ */
+typedef struct
+{
+    char fifo_path[MONITOR_PATH_SIZE]; /**< FIFO; se crea si no existe. */
+    MonitorFraming framing;            /**< "ndjson" o "length". */
+    MonitorEncoding encoding;          /**< "json" o "cbor". */
+    int queue_kb;                      /**< Bytes encolados como máximo mientras el lector no consume. */
+    DeltaConfig delta;                 /**< Modo delta. */
+} MonitorConfig;
+
+/**
+ * @brief Tamaño del nombre del segmento de memoria compartida.
+ */
+#define SHM_NAME_SIZE 64
+
+/**
+ * @struct ShmConfig
+ * @brief Opciones del segmento de memoria compartida (sección "shm" del archivo).
+ *
+ * Se leen solo al iniciar. Sin "name" el segmento no se publica.
+ */
+typedef struct
+{
+    char name[SHM_NAME_SIZE]; /**< Nombre para shm_open: "/" seguido de un nombre sin más "/". */
+} ShmConfig;
+
+/**
+ * @brief Tamaño de la ruta del socket de suscripción (el de sun_path).
+ */
+#define PUBSUB_PATH_SIZE 108
+
+/**
+ * @brief Mensajes encolados por defecto para cada suscriptor.
+ */
+#define DEFAULT_PUBSUB_QUEUE_MESSAGES 64
+
+/**
+ * @brief Suscriptores simultáneos por defecto.
+ */
+#define DEFAULT_PUBSUB_MAX_SUBSCRIBERS 16
+
+/**
+ * @enum PubsubSlowPolicy
+ * @brief Qué hacer con un suscriptor cuya cola se llenó.
+ */
+typedef enum
+{
+    PUBSUB_SLOW_DROP,       /**< Descartar sus mensajes más viejos y seguir. */
+    PUBSUB_SLOW_DISCONNECT, /**< Desconectarlo. */
+} PubsubSlowPolicy;
+
+/**
+ * @struct PubsubConfig
+ * @brief Opciones del socket de suscripción (sección "pubsub" del archivo).
+ *
+ * Se leen solo al iniciar. Sin "socket_path" el socket no se abre.
+ */
+typedef struct
+{
+    char socket_path[PUBSUB_PATH_SIZE]; /**< Socket AF_UNIX; uno que quedó de una ejecución anterior se reemplaza. */
+    MonitorFraming framing;             /**< "ndjson" o "length". */
+    MonitorEncoding encoding;           /**< "json" o "cbor". */
+    int queue_messages;                 /**< Mensajes encolados como máximo por suscriptor. */
+    PubsubSlowPolicy slow_policy;       /**< "drop" o "disconnect". */
+    int max_subscribers;                /**< Suscriptores simultáneos; los que sobran se rechazan. */
+    DeltaConfig delta;                  /**< Modo delta. */
+} PubsubConfig;
+
+/**
+ * @brief Tamaño de las raíces de procfs y sysfs; deja lugar para el nombre de archivo más largo.
+ */
+#define PATHS_PROCFS_SIZE 192
+
+/**
+ * @brief Raíz de procfs por defecto.
+ */
+#define DEFAULT_PROCFS_ROOT "/proc"
+
+/**
+ * @brief Raíz de sysfs por defecto.
+ */
+#define DEFAULT_SYSFS_ROOT "/sys"
+
+/**
+ * @struct PathsConfig
+ * @brief Rutas del sistema que leen los collectors (sección "paths" del archivo).
+ *
+ * Se leen solo al iniciar. Cambiar "procfs" y "sysfs" permite recolectar (collectors,
+ * muestreador y PSI del segmento compartido) desde un fixture grabado o sintético en lugar del
+ * /proc y el /sys reales.
+ */
+typedef struct
+{
+    char procfs[PATHS_PROCFS_SIZE]; /**< Directorio que reemplaza a /proc. */
+    char sysfs[PATHS_PROCFS_SIZE];  /**< Directorio que reemplaza a /sys (cgroups). */
+} PathsConfig;
+
+/**
+ * @brief Series por familia por defecto de las series sintéticas.
+ */
+#define DEFAULT_SYNTHETIC_PER_FAMILY 100
+
+/**
+ * @brief Familias sintéticas como máximo; el almacén admite METRIC_STORE_MAX_FAMILIES en total.
+ */
+#define SYNTHETIC_MAX_FAMILIES 128
+
+/**
+ * @struct SyntheticConfig
+ * @brief Series sintéticas para pruebas de carga (sección "synthetic" del archivo).
+ *
+ * Se leen solo al iniciar. Con "series" en 0 no se registra ninguna. Sirven para medir la
+ * exposición con registros grandes (ver tools/scrape_loadgen.c), no para producción.
+ */
+typedef struct
+{
+    int series;     /**< Series sintéticas en total. */
+    int per_family; /**< Series por familia, es decir, cardinalidad de cada métrica. */
+} SyntheticConfig;
+
+/**
+ * @struct ConfigSnapshot
+ * @brief Configuración parseada y validada, inmutable una vez publicada.
+ *
+ * Los lectores obtienen el snapshot vigente con `config_read_lock` y nunca lo modifican.
+ * Una recarga publica un snapshot nuevo y libera el anterior cuando ya no quedan lectores.
+ */
+typedef struct
+{
+    MetricsConfig metrics;          /**< Métricas habilitadas. */
+    ExpositionConfig exposition;    /**< Opciones de la exposición HTTP. */
+    HttpConfig http;                /**< Opciones del servidor HTTP. */
+    CollectionConfig collection;    /**< Opciones de recolección. */
+    RemoteWriteConfig remote_write; /**< Opciones del envío por remote_write. */
+    LineOutputConfig line_output;   /**< Opciones del envío en protocolo de líneas. */
+    HistoryConfig history;          /**< Opciones de la historia local. */
+    SamplerConfig sampler;          /**< Opciones del muestreo de alta frecuencia. */
+    MonitorConfig monitor;          /**< Opciones del envío al monitor por FIFO. */
+    ShmConfig shm;                  /**< Opciones del segmento de memoria compartida. */
+    PubsubConfig pubsub;            /**< Opciones del socket de suscripción. */
+    PathsConfig paths;              /**< Rutas del sistema que leen los collectors. */
+    SyntheticConfig synthetic;      /**< Series sintéticas para pruebas de carga. */
+    unsigned long version;          /**< Número de versión, incrementado en cada recarga publicada. */
+} ConfigSnapshot;
+
 /**
  * @brief Lee la configuración de métricas desde un archivo JSON.
  *
@@ -35,25 +578,191 @@ typedef struct
  */
 MetricsConfig read_metrics_config(const char* config_file);
 
+/**
+ * @brief Lee y valida la configuración de métricas desde un archivo JSON.
+ *
+ * A diferencia de `read_metrics_config`, distingue un archivo inválido de una configuración
+ * con todas las métricas deshabilitadas: el archivo debe existir, ser JSON válido, contener
+ * el objeto "metrics" y cada clave presente debe ser booleana.
+ *
+ * @param config_file Ruta del archivo JSON de configuración.
+ * @param config Estructura donde se escribe la configuración leída.
+ * @return 0 si la configuración es válida, -1 en caso de error (config queda sin modificar).
+ */
+int parse_metrics_config(const char* config_file, MetricsConfig* config);
+
+/**
+ * @brief Carga la configuración inicial y prepara la recarga en caliente.
+ *
+ * Resuelve la ruta absoluta del archivo, publica el primer snapshot y bloquea SIGHUP en el
+ * hilo que la llama para que los hilos creados después lo hereden bloqueado y solo el hilo
+ * de `config_watch` lo reciba. Debe llamarse antes de crear cualquier otro hilo.
+ * Si el archivo no es válido se publica una configuración con todas las métricas habilitadas.
+ *
+ * @param config_file Ruta del archivo de configuración (absoluta o relativa al directorio actual).
+ * @return 0 si se cargó el archivo, -1 si se usó la configuración por defecto.
+ */
+int config_init(const char* config_file);
+
+/**
+ * @brief Obtiene el snapshot de configuración vigente sin bloquear.
+ *
+ * El snapshot devuelto permanece válido hasta la llamada a `config_read_unlock` con el mismo
+ * token. La sección de lectura debe ser corta: una recarga espera a que terminen los lectores
+ * antes de liberar el snapshot anterior, pero nunca bloquea a los lectores.
+ *
+ * @param token Token de lectura que debe pasarse a `config_read_unlock`.
+ * @return Snapshot vigente.
+ */
+const ConfigSnapshot* config_read_lock(unsigned* token);
+
+/**
+ * @brief Finaliza una sección de lectura iniciada con `config_read_lock`.
+ * @param token Token devuelto por `config_read_lock`.
+ */
+void config_read_unlock(unsigned token);
+
+/**
+ * @brief Copia las métricas habilitadas del snapshot vigente.
+ * @return Configuración de métricas vigente.
+ */
+MetricsConfig config_current_metrics();
+
+/**
+ * @brief Copia las opciones del servidor HTTP del snapshot vigente.
+ * @return Configuración HTTP vigente.
+ */
+HttpConfig config_current_http();
+
+/**
+ * @brief Copia las opciones de recolección del snapshot vigente.
+ * @return Configuración de recolección vigente.
+ */
+CollectionConfig config_current_collection();
+
+/**
+ * @brief Copia las opciones de remote_write del snapshot vigente.
+ * @return Configuración de remote_write vigente.
+ */
+RemoteWriteConfig config_current_remote_write();
+
+/**
+ * @brief Copia las opciones del envío en protocolo de líneas del snapshot vigente.
+ * @return Configuración de "line_output" vigente.
+ */
+LineOutputConfig config_current_line_output();
+
+/**
+ * @brief Copia las opciones de la historia local del snapshot vigente.
+ * @return Configuración de "history" vigente.
+ */
+HistoryConfig config_current_history();
+
+/**
+ * @brief Copia las opciones del muestreo de alta frecuencia del snapshot vigente.
+ * @return Configuración de "sampler" vigente.
+ */
+SamplerConfig config_current_sampler();
+
+/**
+ * @brief Copia las opciones del envío al monitor del snapshot vigente.
+ * @return Configuración de "monitor" vigente.
+ */
+MonitorConfig config_current_monitor();
+
+/**
+ * @brief Copia las opciones del segmento de memoria compartida del snapshot vigente.
+ * @return Configuración de "shm" vigente.
+ */
+ShmConfig config_current_shm();
+
+/**
+ * @brief Copia las opciones del socket de suscripción del snapshot vigente.
+ * @return Configuración de "pubsub" vigente.
+ */
+PubsubConfig config_current_pubsub();
+
+/**
+ * @brief Copia las rutas del sistema del snapshot vigente.
+ * @return Configuración de "paths" vigente.
+ */
+PathsConfig config_current_paths();
+
+/**
+ * @brief Copia las opciones de las series sintéticas del snapshot vigente.
+ * @return Configuración de "synthetic" vigente.
+ */
+SyntheticConfig config_current_synthetic();
+
+/**
+ * @brief Vuelve a leer el archivo de configuración y publica el nuevo snapshot.
+ *
+ * Si el archivo no es válido se conserva el snapshot vigente. Si la configuración no cambió
+ * no se publica nada. El snapshot reemplazado se libera tras esperar a sus lectores.
+ *
+ * @return 0 si se publicó una configuración nueva o no hubo cambios, -1 si el archivo no es válido.
+ */
+int config_reload();
+
+/**
+ * @brief Función del hilo que detecta cambios en la configuración.
+ *
+ * Observa el directorio del archivo con inotify (cubre tanto escrituras como reemplazos por
+ * rename) y espera SIGHUP mediante signalfd; ante cualquiera de los dos llama a `config_reload`.
+ *
+ * @param arg Argumento no utilizado.
+ * @return NULL
+ */
+void* config_watch(void* arg);
+
+/**
+ * @struct MetricsSample
+ * @brief Valores de las métricas del sistema que van en el JSON de `create_metrics_json`.
+ */
+typedef struct
+{
+    double cpu_usage;        /**< Porcentaje de uso de CPU. */
+    double memory_usage;     /**< Porcentaje de uso de memoria. */
+    double disk_usage;       /**< Lecturas y escrituras completadas del disco. */
+    double network_usage;    /**< Bytes de la interfaz de red. */
+    double process_count;    /**< Procesos en ejecución. */
+    double context_switches; /**< Cambios de contexto. */
+} MetricsSample;
+
+/**
+ * @brief Escribe el JSON compacto de las métricas habilitadas a continuación del contenido de `out`.
+ *
+ * No reserva memoria salvo que `out` tenga que crecer, así que con un buffer reutilizado entre
+ * llamadas no hay reservas en régimen. Los valores no finitos se escriben como null.
+ *
+ * @param config Métricas que deben incluirse.
+ * @param sample Valores.
+ * @param out Buffer destino, propiedad de quien llama.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int format_metrics_json(MetricsConfig config, const MetricsSample* sample, Buffer* out);
+
 /**
  * @brief Crea una cadena JSON con las métricas seleccionadas en la configuración.
  *
- * A partir de una estructura `MetricsConfig`, esta función genera un objeto JSON
- * que contiene las métricas habilitadas en la configuración. Cada métrica activa
- * se mide mediante funciones auxiliares (no incluidas aquí) que obtienen los valores
- * actuales para CPU, memoria, disco, red, número de procesos e interrupciones de contexto.
+ * Toma los valores de la última recolección publicada (ver `collector_plan_current_sample`),
+ * sin volver a medir, y los escribe en JSON compacto con `format_metrics_json`. Las métricas
+ * que la recolección no mide salen como null. Quien llame con frecuencia debería usar directamente
+ * `format_metrics_json` con un buffer propio reutilizado.
  *
  * @param config Estructura `MetricsConfig` con las métricas que deben incluirse en el JSON.
- * @return char* Cadena JSON que contiene las métricas solicitadas. La cadena devuelta
- *         debe liberarse con `free` cuando ya no sea necesaria.
+ * @return char* Cadena JSON que contiene las métricas solicitadas, o NULL si no hay memoria. La
+ *         cadena devuelta debe liberarse con `free` cuando ya no sea necesaria.
  */
 char* create_metrics_json(MetricsConfig config);
 
 /**
  * @brief Envía las métricas al monitor.
  *
- * Esta función lee la configuración de métricas desde un archivo JSON, genera un JSON
- * con las métricas seleccionadas y envía los datos a través de un pipe (FIFO) al monitor.
- * Si el JSON no se puede generar o el pipe no está disponible, se muestra un mensaje de error.
+ * Encola un mensaje con los últimos valores publicados para el escritor persistente del FIFO
+ * (ver monitor_fifo.h), que ya envía uno tras cada recolección. Si el envío no está
+ * configurado en la sección "monitor", se muestra un mensaje de error.
  */
 void send_metrics_to_monitor();
+
+#endif // CONFIG_H
@@ -0,0 +1,70 @@
+/**
+ * @file ddsketch.h
+ * @brief Sketch de cuantiles con error relativo acotado (DDSketch, Masson et al., VLDB 2019).
+ *
+ * Cada valor positivo cae en el bucket `ceil(log_gamma(x))`, con `gamma = (1 + a) / (1 - a)`,
+ * y el cuantil estimado difiere del real en menos de `a` (relativo). Los buckets son un arreglo
+ * denso de tamaño fijo, así que agregar un valor no reserva memoria y dos sketches con la misma
+ * precisión se combinan sumando buckets. Los valores fuera del rango representable van al
+ * bucket del extremo; los menores o iguales a cero se cuentan aparte como cero.
+ */
+
+#ifndef DDSKETCH_H
+#define DDSKETCH_H
+
+#include <stdint.h>
+
+/**
+ * @brief Buckets del sketch; con 1% de precisión cubren de 1e-9 a 8e8.
+ */
+#define DDSKETCH_BINS 2048
+
+/**
+ * @struct DDSketch
+ * @brief Sketch de cuantiles.
+ */
+typedef struct
+{
+    double gamma;                 /**< Razón entre los límites de buckets consecutivos. */
+    double inv_log_gamma;         /**< 1 / ln(gamma). */
+    uint64_t count;               /**< Valores agregados. */
+    uint64_t zero_count;          /**< Valores menores o iguales a cero. */
+    uint32_t bins[DDSKETCH_BINS]; /**< Cantidad por bucket; el índice está desplazado en DDSKETCH_BINS / 2. */
+} DDSketch;
+
+/**
+ * @brief Inicializa un sketch vacío.
+ * @param sketch Sketch.
+ * @param relative_accuracy Error relativo máximo de los cuantiles (por ejemplo 0.01).
+ */
+void ddsketch_init(DDSketch* sketch, double relative_accuracy);
+
+/**
+ * @brief Vacía el sketch conservando la precisión.
+ * @param sketch Sketch.
+ */
+void ddsketch_clear(DDSketch* sketch);
+
+/**
+ * @brief Agrega un valor.
+ * @param sketch Sketch.
+ * @param value Valor; NaN se ignora.
+ */
+void ddsketch_add(DDSketch* sketch, double value);
+
+/**
+ * @brief Suma a `dst` los valores de `src`; ambos deben tener la misma precisión.
+ * @param dst Sketch destino.
+ * @param src Sketch a combinar.
+ */
+void ddsketch_merge(DDSketch* dst, const DDSketch* src);
+
+/**
+ * @brief Estima un cuantil.
+ * @param sketch Sketch.
+ * @param quantile Cuantil entre 0 y 1.
+ * @return Valor estimado, o NaN si el sketch está vacío.
+ */
+double ddsketch_quantile(const DDSketch* sketch, double quantile);
+
+#endif // DDSKETCH_H
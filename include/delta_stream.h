@@ -0,0 +1,93 @@
+/**
+ * @file delta_stream.h
+ * @brief Modo delta de las salidas en streaming: keyframes periódicos y, entre ellos, solo los
+ *        valores que cambiaron más que su banda muerta.
+ *
+ * El estado de referencia es el último valor enviado de cada métrica. En cada ciclo se marcan
+ * como cambiadas las métricas que aparecieron, desaparecieron o se alejaron de la referencia
+ * más que su banda muerta, y solo ellas actualizan la referencia; así el error acumulado de un
+ * consumidor nunca supera la banda. Cada `keyframe_interval` ciclos (o cuando se pide) se envía
+ * la referencia completa.
+ *
+ * Cada mensaje emitido lleva un número de secuencia consecutivo. Los ciclos sin cambios no
+ * emiten nada y no consumen secuencia, así que un salto en la secuencia siempre significa un
+ * mensaje perdido: el consumidor debe descartar deltas hasta el próximo keyframe (o pedir uno,
+ * si la salida lo permite).
+ */
+
+#ifndef DELTA_STREAM_H
+#define DELTA_STREAM_H
+
+#include "config.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Métricas como máximo en un stream (una por bit de la máscara de cambios).
+ */
+#define DELTA_STREAM_MAX_VALUES 32
+
+/**
+ * @enum DeltaFrame
+ * @brief Resultado de avanzar un ciclo.
+ */
+typedef enum
+{
+    DELTA_FRAME_NONE,     /**< Nada cambió: no se emite mensaje. */
+    DELTA_FRAME_DELTA,    /**< Se emiten las métricas cambiadas. */
+    DELTA_FRAME_KEYFRAME, /**< Se emite la referencia completa. */
+} DeltaFrame;
+
+/**
+ * @struct DeltaStream
+ * @brief Estado del modo delta de una salida.
+ */
+typedef struct
+{
+    size_t count;                              /**< Métricas del stream. */
+    int keyframe_interval;                     /**< Ciclos entre dos keyframes. */
+    int cycles;                                /**< Ciclos desde el último keyframe. */
+    atomic_int keyframe_requested;             /**< El próximo ciclo debe ser un keyframe. */
+    uint64_t sequence;                         /**< Secuencia del último mensaje emitido (0 antes del primero). */
+    double deadband[DELTA_STREAM_MAX_VALUES];  /**< Banda muerta de cada métrica. */
+    double reference[DELTA_STREAM_MAX_VALUES]; /**< Último valor enviado de cada métrica, NaN si ausente. */
+} DeltaStream;
+
+/**
+ * @brief Inicializa el stream; el primer ciclo es un keyframe.
+ *
+ * Las bandas muertas de la configuración se asignan por nombre de familia; las que nombran
+ * métricas que este stream no tiene se ignoran.
+ *
+ * @param stream Stream.
+ * @param config Opciones del modo delta.
+ * @param families Familia de cada métrica del stream.
+ * @param count Métricas (hasta DELTA_STREAM_MAX_VALUES).
+ */
+void delta_stream_init(DeltaStream* stream, const DeltaConfig* config, const char* const* families, size_t count);
+
+/**
+ * @brief Avanza un ciclo con los valores vigentes y actualiza la referencia.
+ * @param stream Stream.
+ * @param values Valor de cada métrica, NaN si está ausente.
+ * @param changed Recibe las métricas a enviar (un bit por métrica): las cambiadas en un delta,
+ *        las presentes en la referencia en un keyframe.
+ * @return Tipo de mensaje a emitir; si no es DELTA_FRAME_NONE, `sequence` ya avanzó.
+ */
+DeltaFrame delta_stream_next(DeltaStream* stream, const double* values, uint32_t* changed);
+
+/**
+ * @brief Pide que el próximo ciclo sea un keyframe; puede llamarse desde cualquier hilo.
+ * @param stream Stream.
+ */
+void delta_stream_request_keyframe(DeltaStream* stream);
+
+/**
+ * @brief Devuelve las métricas presentes en la referencia.
+ * @param stream Stream.
+ * @return Un bit por métrica.
+ */
+uint32_t delta_stream_present(const DeltaStream* stream);
+
+#endif // DELTA_STREAM_H
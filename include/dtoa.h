@@ -0,0 +1,36 @@
+/**
+ * @file dtoa.h
+ * @brief Conversión rápida de double a texto con la representación corta que lo conserva.
+ *
+ * Implementa Grisu2 (Loitsch, PLDI 2010) con aritmética de 64 bits y una tabla de potencias de
+ * 10: el texto siempre vuelve al mismo double al parsearlo y casi siempre es el más corto
+ * posible, sin pasar por `snprintf` ni comprobar con `strtod`. El formato es el de los números
+ * de JSON: notación decimal entre 1e-6 y 1e21 y exponencial fuera de ese rango. Los enteros
+ * exactos (contadores, bytes) toman un camino directo sin Grisu.
+ */
+
+#ifndef DTOA_H
+#define DTOA_H
+
+/**
+ * @brief Tamaño suficiente para cualquier resultado, con el '\0' final.
+ */
+#define DTOA_BUFFER_SIZE 32
+
+/**
+ * @brief Escribe un double finito.
+ * @param value Valor; NaN e infinitos no son válidos (JSON no los admite).
+ * @param out Destino de al menos DTOA_BUFFER_SIZE bytes; queda terminado en '\0'.
+ * @return Cantidad de caracteres escritos, sin el '\0'.
+ */
+int dtoa_shortest(double value, char* out);
+
+/**
+ * @brief Escribe un entero en decimal, de a dos dígitos por paso.
+ * @param value Valor.
+ * @param out Destino de al menos DTOA_BUFFER_SIZE bytes; queda terminado en '\0'.
+ * @return Cantidad de caracteres escritos, sin el '\0'.
+ */
+int dtoa_integer(long long value, char* out);
+
+#endif // DTOA_H
@@ -3,14 +3,31 @@
  * @brief Programa para leer el uso de CPU y memoria y exponerlos como métricas de Prometheus.
  */
 
+#include "arena.h"
+#include "collection.h"
+#include "collector_plan.h"
+#include "config.h"
+#include "exposition.h"
+#include "history.h"
+#include "json_writer.h"
+#include "line_output.h"
+#include "listener.h"
+#include "metric_store.h"
 #include "metrics.h"
+#include "monitor_fifo.h"
+#include "pubsub.h"
+#include "range_query.h"
+#include "remote_write.h"
+#include "sampler.h"
+#include "shm_output.h"
+#include "synthetic.h"
 #include <errno.h>
-#include <prom.h>
-#include <promhttp.h>
+#include <microhttpd.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h> // Para sleep
 
 /**
@@ -57,18 +74,41 @@ void update_procs_gauge();
 void update_ctxt_gauge();
 
 /**
- * @brief Función del hilo para exponer las métricas vía HTTP en el puerto 8000.
+ * @brief Actualiza solo las métricas habilitadas en la configuración.
+ *
+ * La configuración se compila en un plan (ver collector_plan.h) solo cuando cambia; en cada
+ * ciclo se recorren únicamente las métricas habilitadas. Las que se deshabilitan se marcan
+ * ausentes una vez para dejar de exponerse; al volver a habilitarse retoman la recolección en
+ * el siguiente ciclo. Los valores quedan en el buffer trasero hasta llamar a
+ * `metric_store_publish`. No es segura para llamarse desde más de un hilo.
+ *
+ * @param config Métricas habilitadas.
+ */
+void update_gauges(const MetricsConfig* config);
+
+/**
+ * @brief Función del hilo para exponer las métricas vía HTTP.
+ *
+ * Los listeners (TCP y/o sockets AF_UNIX), el modelo de concurrencia (select, epoll con un
+ * pool de hilos o un hilo por conexión), el límite de conexiones y el timeout de inactividad
+ * salen de la sección "http" de la configuración al iniciar. Cada listener tiene su propio
+ * daemon, pero todos comparten el manejador y el caché de exposición. Las conexiones HTTP/1.1 se mantienen abiertas (keep-alive)
+ * entre peticiones. Cada petición alimenta `http_request_duration_seconds`,
+ * `http_response_size_bytes` y `http_requests_in_flight`. Con "collection.mode" en "scrape",
+ * cada scrape dispara la recolección (ver `collection_on_scrape`) antes de servir.
+ *
+ * Cada generación publicada se renderiza una sola vez y se comparte entre scrapes; las
+ * respuestas llevan un ETag derivado de la generación y las peticiones condicionales que
+ * coinciden reciben 304. Si el cliente acepta gzip o zstd (Accept-Encoding), el cuerpo
+ * comprimido también se produce una vez por generación y se reutiliza. El formato (texto,
+ * OpenMetrics o protobuf delimitado) se negocia con el encabezado Accept.
+ *
  * @param arg Argumento no utilizado.
  * @return NULL
  */
 void* expose_metrics(void* arg);
 
 /**
- * @brief Inicializar mutex y métricas.
+ * @brief Inicializar el almacén y registrar las métricas.
  */
 void init_metrics();
-
-/**
- * @brief Destructor de mutex
- */
-void destroy_mutex();
@@ -0,0 +1,222 @@
+/**
+ * @file exposition.h
+ * @brief Renderizado del almacén de métricas en los formatos de exposición de Prometheus.
+ */
+
+#ifndef EXPOSITION_H
+#define EXPOSITION_H
+
+#include "buffer.h"
+#include "compression.h"
+#include "metric_store.h"
+
+/**
+ * @brief Content-Type del formato de texto clásico de Prometheus.
+ */
+#define EXPOSITION_TEXT_CONTENT_TYPE "text/plain; version=0.0.4; charset=utf-8"
+
+/**
+ * @brief Content-Type del formato OpenMetrics.
+ */
+#define EXPOSITION_OPENMETRICS_CONTENT_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+/**
+ * @brief Content-Type del formato protobuf delimitado (MetricFamily).
+ */
+#define EXPOSITION_PROTOBUF_CONTENT_TYPE                                                                           \
+    "application/vnd.google.protobuf; proto=io.prometheus.client.MetricFamily; encoding=delimited"
+
+/**
+ * @enum ExpositionFormat
+ * @brief Formato de exposición; el orden define la preferencia ante valores q iguales.
+ */
+typedef enum
+{
+    EXPOSITION_FORMAT_TEXT,        /**< Texto clásico 0.0.4. */
+    EXPOSITION_FORMAT_OPENMETRICS, /**< OpenMetrics 1.0.0. */
+    EXPOSITION_FORMAT_PROTOBUF,    /**< MetricFamily protobuf con prefijo de longitud. */
+    EXPOSITION_FORMAT_COUNT        /**< Cantidad de formatos. */
+} ExpositionFormat;
+
+/**
+ * @brief Registra las métricas propias de la exposición (compresión).
+ * @return 0 en caso de éxito, -1 si no se pudieron registrar.
+ */
+int exposition_init();
+
+/**
+ * @brief Renderiza en formato de texto un snapshot consistente del almacén.
+ *
+ * Lee el buffer frontal sin locks; si el recolector publica durante el renderizado, descarta
+ * lo escrito y repite, de modo que todas las series pertenecen a la generación devuelta.
+ * Las series ausentes no se exponen, ni tampoco las familias sin series presentes.
+ *
+ * @param out Buffer de salida; se vacía antes de escribir.
+ * @return Generación renderizada.
+ */
+uint64_t exposition_render_text(Buffer* out);
+
+/**
+ * @brief Renderiza un snapshot consistente del almacén en el formato indicado.
+ *
+ * Los codificadores escriben directamente desde el buffer frontal al buffer de salida,
+ * sin estructuras intermedias, con las mismas garantías que `exposition_render_text`.
+ *
+ * @param format Formato de salida.
+ * @param out Buffer de salida; se vacía antes de escribir.
+ * @return Generación renderizada.
+ */
+uint64_t exposition_render(ExpositionFormat format, Buffer* out);
+
+/**
+ * @brief Elige el formato según el encabezado Accept (valores q incluidos).
+ *
+ * Reconoce protobuf delimitado (proto=io.prometheus.client.MetricFamily), OpenMetrics y
+ * texto. Ante empate prefiere protobuf, luego OpenMetrics; sin coincidencias usa texto.
+ *
+ * @param accept Valor del encabezado Accept, puede ser NULL.
+ * @return Formato elegido.
+ */
+ExpositionFormat negotiate_exposition_format(const char* accept);
+
+/**
+ * @brief Content-Type de un formato.
+ * @param format Formato.
+ * @return Valor para el encabezado Content-Type.
+ */
+const char* exposition_content_type(ExpositionFormat format);
+
+/**
+ * @brief Tamaño del buffer para el ETag de un cuerpo renderizado.
+ */
+#define EXPOSITION_ETAG_SIZE 48
+
+/**
+ * @brief Cantidad máxima de nombres y de prefijos en un filtro de familias.
+ */
+#define EXPOSITION_FILTER_MAX 32
+
+/**
+ * @struct ExpositionFragment
+ * @brief Porción de un cuerpo renderizado que corresponde a una familia.
+ */
+typedef struct
+{
+    size_t offset; /**< Inicio dentro del cuerpo. */
+    size_t length; /**< Longitud; 0 si la familia no tiene series presentes. */
+} ExpositionFragment;
+
+/**
+ * @struct ExpositionFilter
+ * @brief Selección de familias pedida con /metrics?name[]=...&prefix=...
+ *
+ * Una familia se incluye si su nombre coincide con alguno de `names` o empieza con alguno de
+ * `prefixes`. Los punteros solo deben ser válidos durante la llamada que usa el filtro.
+ */
+typedef struct
+{
+    const char* names[EXPOSITION_FILTER_MAX];    /**< Nombres exactos. */
+    size_t name_count;                           /**< Cantidad de nombres. */
+    const char* prefixes[EXPOSITION_FILTER_MAX]; /**< Prefijos de nombre. */
+    size_t prefix_count;                         /**< Cantidad de prefijos. */
+} ExpositionFilter;
+
+/**
+ * @struct ExpositionVariant
+ * @brief Versión comprimida de un cuerpo, producida como mucho una vez por generación.
+ */
+typedef struct
+{
+    Buffer data;                     /**< Cuerpo comprimido. */
+    char etag[EXPOSITION_ETAG_SIZE]; /**< ETag propio de esta representación. */
+    int state;                       /**< Estado (vacío, comprimiendo, listo, fallido). */
+} ExpositionVariant;
+
+/**
+ * @struct ExpositionBody
+ * @brief Cuerpo de exposición renderizado una vez por generación y compartido entre scrapes.
+ *
+ * El contenido no cambia mientras haya referencias, así que puede entregarse a libmicrohttpd
+ * con MHD_RESPMEM_PERSISTENT sin copiarlo.
+ */
+typedef struct ExpositionBody
+{
+    Buffer content;                  /**< Cuerpo renderizado. */
+    ExpositionFormat format;         /**< Formato del cuerpo. */
+    uint64_t generation;             /**< Generación renderizada. */
+    char etag[EXPOSITION_ETAG_SIZE]; /**< ETag derivado de la generación (entre comillas). */
+    ExpositionVariant encoded[CONTENT_ENCODING_COUNT];       /**< Versiones comprimidas (identity no se usa). */
+    ExpositionFragment fragments[METRIC_STORE_MAX_FAMILIES]; /**< Porción de cada familia, por índice. */
+    uint16_t by_name[METRIC_STORE_MAX_FAMILIES];             /**< Índices de familia ordenados por nombre. */
+    size_t family_count;             /**< Familias renderizadas. */
+    unsigned refs;                   /**< Scrapes que lo están usando (protegido por el lock del caché). */
+    struct ExpositionBody* next;     /**< Siguiente cuerpo del pool. */
+} ExpositionBody;
+
+/**
+ * @brief Obtiene el cuerpo de la última generación publicada, renderizándolo si hace falta.
+ *
+ * Si varios scrapes piden en el mismo formato una generación que todavía no está renderizada,
+ * solo uno la renderiza y el resto espera ese resultado. Cada llamada debe emparejarse con
+ * `exposition_cache_release` cuando la respuesta terminó de enviarse.
+ *
+ * @param format Formato del cuerpo.
+ * @return Cuerpo renderizado, o NULL si no hay memoria.
+ */
+const ExpositionBody* exposition_cache_acquire(ExpositionFormat format);
+
+/**
+ * @brief Libera una referencia obtenida con `exposition_cache_acquire`.
+ * @param body Cuerpo a liberar.
+ */
+void exposition_cache_release(const ExpositionBody* body);
+
+/**
+ * @brief Codificaciones habilitadas según la configuración vigente y lo compilado.
+ * @return Máscara de bits (1 << ContentEncoding) para `negotiate_content_encoding`.
+ */
+unsigned exposition_enabled_encodings();
+
+/**
+ * @brief Obtiene el cuerpo en la codificación pedida, comprimiéndolo una única vez.
+ *
+ * La primera petición de una codificación para una generación comprime con el nivel de la
+ * configuración vigente; las concurrentes esperan ese resultado y las siguientes lo reutilizan.
+ * Registra la duración y la relación de compresión como métricas.
+ *
+ * @param body Cuerpo obtenido con `exposition_cache_acquire`.
+ * @param encoding Codificación deseada.
+ * @param data Recibe el contenido a enviar.
+ * @param len Recibe el tamaño del contenido.
+ * @param etag Recibe el ETag de la representación.
+ * @return Codificación efectivamente entregada (identity si la compresión falló).
+ */
+ContentEncoding exposition_cache_encoded(const ExpositionBody* body, ContentEncoding encoding, const char** data,
+                                         size_t* len, const char** etag);
+
+/**
+ * @brief Arma una respuesta con las familias seleccionadas de un cuerpo ya renderizado.
+ *
+ * Las familias se buscan en el índice por nombre del cuerpo (búsqueda binaria por nombre o
+ * por prefijo) y se copian sus porciones en el orden de registro, así que el costo depende de
+ * lo seleccionado y no del tamaño del almacén. OpenMetrics incluye su "# EOF" final. Si se
+ * pide una codificación, la respuesta filtrada se comprime en cada petición.
+ *
+ * @param body Cuerpo obtenido con `exposition_cache_acquire`.
+ * @param filter Familias a incluir.
+ * @param encoding Codificación deseada.
+ * @param out Buffer destino; se vacía antes de escribir.
+ * @return Codificación efectivamente usada (identity si la compresión falló).
+ */
+ContentEncoding exposition_cache_filter(const ExpositionBody* body, const ExpositionFilter* filter,
+                                        ContentEncoding encoding, Buffer* out);
+
+/**
+ * @brief Verifica si un encabezado If-None-Match coincide con un ETag.
+ * @param if_none_match Valor del encabezado (lista separada por comas o "*"), puede ser NULL.
+ * @param etag ETag de la representación que se enviaría.
+ * @return 1 si el cliente ya tiene esta versión, 0 en caso contrario.
+ */
+int exposition_etag_matches(const char* if_none_match, const char* etag);
+
+#endif // EXPOSITION_H
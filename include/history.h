@@ -0,0 +1,113 @@
+/**
+ * @file history.h
+ * @brief Historia local de las series en un archivo mapeado en memoria, comprimida al estilo Gorilla.
+ *
+ * Si Prometheus no está disponible o se pierde un scrape, el agente solo conserva el último
+ * valor. Con "history.path" configurado, tras cada publicación se agrega un punto por serie
+ * presente (a lo sumo uno cada `resolution_seconds`) a un archivo que sobrevive reinicios.
+ *
+ * Cada serie tiene un anillo fijo de chunks de `HISTORY_CHUNK_BYTES`. Dentro de un chunk el
+ * primer punto va completo y los siguientes codifican el timestamp como delta de delta y el
+ * valor como XOR con el anterior (Facebook Gorilla, VLDB 2015). Al llenarse el anillo el
+ * chunk más viejo se reutiliza; la cantidad de chunks sale de la retención suponiendo
+ * `HISTORY_BYTES_PER_SAMPLE` bytes por punto, así que una serie muy ruidosa cubre algo menos
+ * y una constante bastante más.
+ *
+ * Escribe solo el hilo que publica y los puntos solo se agregan: cada chunk publica con
+ * release cuántos puntos y bits son válidos, y los lectores no toman locks. Un chunk que se
+ * reutiliza cambia de secuencia, y el lector que lo estaba copiando descarta la copia.
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "metric_store.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Tamaño de cada chunk del archivo, cabecera incluida (una página).
+ */
+#define HISTORY_CHUNK_BYTES 4096
+
+/**
+ * @brief Bytes por punto supuestos al dimensionar el anillo de cada serie a partir de la retención.
+ *
+ * Un gauge constante ocupa unos 2 bits por punto; uno con la mantisa completa distinta en
+ * cada punto (un porcentaje de CPU, por ejemplo) ronda los 9 bytes.
+ */
+#define HISTORY_BYTES_PER_SAMPLE 10
+
+/**
+ * @brief Tamaño de la clave que identifica una serie entre ejecuciones (nombre, sufijo y etiquetas).
+ */
+#define HISTORY_KEY_SIZE 240
+
+/**
+ * @brief Función que recibe cada punto leído de la historia, en orden de tiempo.
+ * @param timestamp_ms Tiempo Unix del punto en milisegundos.
+ * @param value Valor del punto.
+ * @param arg Argumento pasado a `history_read`.
+ */
+typedef void (*HistoryVisitFn)(int64_t timestamp_ms, double value, void* arg);
+
+/**
+ * @brief Abre o crea el archivo si la configuración vigente tiene "history.path".
+ *
+ * Si el archivo existe con la misma geometría se retoma donde quedó; si no, se recrea vacío.
+ * Registra las métricas de la historia y se engancha a la publicación de cada recolección.
+ * Debe llamarse después de `collection_init`.
+ *
+ * @return 0 si se inició o está deshabilitada, -1 en caso de error.
+ */
+int history_init();
+
+/**
+ * @brief Indica si la historia está habilitada.
+ * @return 1 si hay un archivo abierto, 0 en caso contrario.
+ */
+int history_enabled();
+
+/**
+ * @brief Arma la clave con que una serie del almacén se guarda en la historia.
+ * @param series Serie del almacén.
+ * @param key Destino de al menos `HISTORY_KEY_SIZE` bytes.
+ * @return 0 en caso de éxito, -1 si la clave no entra.
+ */
+int history_series_key(MetricSeries series, char* key);
+
+/**
+ * @brief Busca una serie de la historia por su clave.
+ *
+ * Las series de ejecuciones anteriores se conservan aunque ya no existan en el almacén.
+ *
+ * @param key Clave armada con `history_series_key` (por ejemplo `cpu_usage_percentage`).
+ * @return Índice de la serie, o -1 si no tiene historia.
+ */
+int history_find(const char* key);
+
+/**
+ * @brief Cantidad de series con historia.
+ * @return Series guardadas en el archivo; sus índices van de 0 a este valor menos uno.
+ */
+size_t history_series_count();
+
+/**
+ * @brief Clave de una serie de la historia.
+ * @param index Índice de la serie.
+ * @return Clave, o NULL si el índice no existe.
+ */
+const char* history_key(size_t index);
+
+/**
+ * @brief Recorre los puntos de una serie dentro de un intervalo. Puede llamarse desde cualquier hilo.
+ * @param index Índice de la serie.
+ * @param from_ms Inicio del intervalo, inclusive.
+ * @param to_ms Fin del intervalo, inclusive.
+ * @param visit Función llamada por cada punto, en orden de tiempo.
+ * @param arg Argumento para `visit`.
+ * @return Cantidad de puntos visitados, o -1 si el índice no existe.
+ */
+long history_read(size_t index, int64_t from_ms, int64_t to_ms, HistoryVisitFn visit, void* arg);
+
+#endif // HISTORY_H
@@ -0,0 +1,58 @@
+/**
+ * @file http_client.h
+ * @brief Cliente HTTP/1.1 mínimo para los envíos salientes (POST sobre una conexión persistente).
+ *
+ * Solo soporta URLs `http://host[:puerto]/ruta`: sin TLS ni redirecciones. La conexión se
+ * reutiliza entre peticiones mientras el servidor la mantenga abierta y se restablece sola
+ * si el servidor la cerró entre dos envíos.
+ */
+
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include <stddef.h>
+
+/**
+ * @brief Tamaño de los campos de host, puerto y ruta de un cliente.
+ */
+#define HTTP_CLIENT_FIELD_SIZE 256
+
+/**
+ * @struct HttpClient
+ * @brief Destino parseado y conexión abierta hacia él.
+ */
+typedef struct
+{
+    char host[HTTP_CLIENT_FIELD_SIZE]; /**< Nombre o dirección del servidor. */
+    char port[8];                      /**< Puerto, como texto para getaddrinfo. */
+    char path[HTTP_CLIENT_FIELD_SIZE]; /**< Ruta de la petición (incluye la query). */
+    int timeout;                       /**< Segundos de espera para conectar, enviar y recibir. */
+    int fd;                            /**< Conexión abierta, o -1. */
+} HttpClient;
+
+/**
+ * @brief Parsea la URL de destino; no abre la conexión.
+ * @param client Cliente a inicializar.
+ * @param url URL `http://host[:puerto][/ruta]` (IPv6 entre corchetes).
+ * @param timeout Segundos de espera de cada operación.
+ * @return 0 en caso de éxito, -1 si la URL no es válida.
+ */
+int http_client_init(HttpClient* client, const char* url, int timeout);
+
+/**
+ * @brief Envía un POST y espera la respuesta, descartando su cuerpo.
+ * @param client Cliente.
+ * @param headers Encabezados adicionales, cada uno terminado en "\r\n"; puede ser NULL.
+ * @param body Cuerpo de la petición.
+ * @param len Longitud del cuerpo.
+ * @return Código de estado HTTP, o -1 si falló la conexión o la respuesta no es válida.
+ */
+int http_client_post(HttpClient* client, const char* headers, const void* body, size_t len);
+
+/**
+ * @brief Cierra la conexión si está abierta.
+ * @param client Cliente.
+ */
+void http_client_close(HttpClient* client);
+
+#endif // HTTP_CLIENT_H
@@ -0,0 +1,114 @@
+/**
+ * @file json_writer.h
+ * @brief Escritor de JSON en streaming sobre un Buffer, sin armar un árbol en memoria.
+ *
+ * Cada llamada agrega su fragmento al buffer y el escritor solo recuerda, por nivel de
+ * anidamiento, si hace falta una coma. Los errores (falta de memoria, anidamiento excesivo)
+ * quedan anotados y las llamadas siguientes no hacen nada: basta con consultar
+ * `json_writer_error` al final.
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include "buffer.h"
+#include <stdint.h>
+
+/**
+ * @brief Niveles de anidamiento admitidos (un bit de `JsonWriter.has_items` por nivel).
+ */
+#define JSON_WRITER_MAX_DEPTH 64
+
+/**
+ * @struct JsonWriter
+ * @brief Estado del escritor.
+ */
+typedef struct
+{
+    Buffer* out;        /**< Destino; el JSON se agrega a continuación de lo que ya tenga. */
+    uint64_t has_items; /**< Bit n: el contenedor del nivel n ya tiene algún elemento. */
+    int depth;          /**< Contenedores abiertos. */
+    int after_key;      /**< Se escribió una clave y falta su valor. */
+    int error;          /**< Hubo un error; el contenido del buffer no es JSON válido. */
+} JsonWriter;
+
+/**
+ * @brief Inicializa el escritor.
+ * @param writer Escritor.
+ * @param out Buffer destino.
+ */
+void json_writer_init(JsonWriter* writer, Buffer* out);
+
+/**
+ * @brief Indica si hubo un error o quedaron contenedores abiertos.
+ * @param writer Escritor.
+ * @return 0 si el documento está completo, -1 en caso contrario.
+ */
+int json_writer_error(const JsonWriter* writer);
+
+/**
+ * @brief Abre un objeto.
+ * @param writer Escritor.
+ */
+void json_begin_object(JsonWriter* writer);
+
+/**
+ * @brief Cierra el objeto abierto.
+ * @param writer Escritor.
+ */
+void json_end_object(JsonWriter* writer);
+
+/**
+ * @brief Abre un arreglo.
+ * @param writer Escritor.
+ */
+void json_begin_array(JsonWriter* writer);
+
+/**
+ * @brief Cierra el arreglo abierto.
+ * @param writer Escritor.
+ */
+void json_end_array(JsonWriter* writer);
+
+/**
+ * @brief Escribe la clave del próximo valor de un objeto.
+ * @param writer Escritor.
+ * @param key Clave (se escapa).
+ */
+void json_key(JsonWriter* writer, const char* key);
+
+/**
+ * @brief Escribe una cadena.
+ * @param writer Escritor.
+ * @param value Cadena UTF-8 (se escapa).
+ */
+void json_string(JsonWriter* writer, const char* value);
+
+/**
+ * @brief Escribe un número con la representación corta que se lee igual (Grisu2, ver dtoa.h).
+ * @param writer Escritor.
+ * @param value Valor; NaN e infinitos se escriben como null, porque JSON no los admite.
+ */
+void json_number(JsonWriter* writer, double value);
+
+/**
+ * @brief Escribe un entero.
+ * @param writer Escritor.
+ * @param value Valor.
+ */
+void json_int(JsonWriter* writer, long long value);
+
+/**
+ * @brief Escribe un booleano.
+ * @param writer Escritor.
+ * @param value 0 para false, cualquier otro valor para true.
+ */
+void json_bool(JsonWriter* writer, int value);
+
+/**
+ * @brief Escribe null.
+ * @param writer Escritor.
+ */
+void json_null(JsonWriter* writer);
+
+#endif // JSON_WRITER_H
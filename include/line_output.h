@@ -0,0 +1,32 @@
+/**
+ * @file line_output.h
+ * @brief Envío de cada ciclo en protocolo de líneas: plaintext de Graphite o StatsD.
+ *
+ * Tras cada publicación se formatea una línea por serie presente en un buffer que se reutiliza
+ * entre ciclos (solo crece si aparecen series nuevas). Por UDP las líneas se agrupan en
+ * datagramas de hasta `mtu` bytes sin partir ninguna y se envían con un único `sendmmsg`. Por
+ * TCP el ciclo se escribe sin bloquear sobre una conexión persistente; lo que el socket no
+ * acepta queda pendiente y se completa en los ciclos siguientes, así nunca llega una línea
+ * cortada. Un ciclo que no entra detrás de lo pendiente se descarta entero y se cuenta en
+ * "line_output_dropped_lines_total".
+ *
+ * En StatsD los gauges se envían con `|g` (un valor negativo va precedido de un 0, porque
+ * `-n|g` significaría restar) y los contadores e histogramas con `|c`, como diferencia
+ * respecto del ciclo anterior. Las etiquetas van como tags: `;k=v` en Graphite y `|#k:v` en
+ * StatsD (extensión de DogStatsD).
+ */
+
+#ifndef LINE_OUTPUT_H
+#define LINE_OUTPUT_H
+
+/**
+ * @brief Inicia el envío si la configuración vigente tiene "line_output.address".
+ *
+ * Resuelve la dirección, abre el socket, registra las métricas del envío y se engancha a la
+ * publicación de cada recolección. Debe llamarse después de `collection_init`.
+ *
+ * @return 0 si se inició o está deshabilitado, -1 en caso de error.
+ */
+int line_output_init();
+
+#endif // LINE_OUTPUT_H
@@ -0,0 +1,31 @@
+/**
+ * @file listener.h
+ * @brief Creación de los sockets de escucha de la exposición (TCP y AF_UNIX).
+ */
+
+#ifndef LISTENER_H
+#define LISTENER_H
+
+#include "config.h"
+
+/**
+ * @brief Crea, enlaza y pone en escucha el socket de un listener.
+ *
+ * TCP acepta direcciones IPv4 o IPv6 numéricas. Para AF_UNIX se elimina un socket previo en
+ * la misma ruta (restos de una ejecución anterior; cualquier otro tipo de archivo se respeta)
+ * y se aplican los permisos configurados antes de aceptar conexiones.
+ *
+ * @param listener Listener a abrir.
+ * @return Descriptor del socket no bloqueante en escucha, o -1 en caso de error.
+ */
+int listener_open(const HttpListener* listener);
+
+/**
+ * @brief Describe un listener para los mensajes de log.
+ * @param listener Listener a describir.
+ * @param out Buffer destino ("address:port" o "unix:path").
+ * @param size Tamaño de `out`.
+ */
+void listener_describe(const HttpListener* listener, char* out, size_t size);
+
+#endif // LISTENER_H
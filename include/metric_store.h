@@ -0,0 +1,291 @@
+/**
+ * @file metric_store.h
+ * @brief Almacén de métricas con doble buffer y publicación por generación.
+ *
+ * Los recolectores escriben valores planos en el buffer trasero. Al final de cada ciclo
+ * `metric_store_publish` lo convierte en el buffer frontal incrementando la generación.
+ * Los lectores (scrapes) leen el buffer frontal sin locks y validan la generación al terminar,
+ * por lo que todas las series de una misma respuesta pertenecen a la misma generación.
+ */
+
+#ifndef METRIC_STORE_H
+#define METRIC_STORE_H
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Cantidad máxima de familias de métricas registrables.
+ */
+#define METRIC_STORE_MAX_FAMILIES 256
+
+/**
+ * @brief Cantidad máxima de series por defecto.
+ */
+#define METRIC_STORE_DEFAULT_SERIES 4096
+
+/**
+ * @brief Identificador de serie inválido.
+ */
+#define METRIC_SERIES_INVALID UINT32_MAX
+
+/**
+ * @brief Valor que indica que una serie no tiene dato en la generación (no se expone).
+ */
+#define METRIC_VALUE_ABSENT NAN
+
+/**
+ * @brief Identificador estable de una serie; indexa directamente los buffers de valores.
+ */
+typedef uint32_t MetricSeries;
+
+/**
+ * @enum MetricType
+ * @brief Tipo de una familia de métricas según el modelo de Prometheus.
+ */
+typedef enum
+{
+    METRIC_TYPE_GAUGE,    /**< Valor que puede subir o bajar. */
+    METRIC_TYPE_COUNTER,  /**< Valor monótono creciente. */
+    METRIC_TYPE_HISTOGRAM /**< Buckets acumulados, suma y cantidad de observaciones. */
+} MetricType;
+
+/**
+ * @struct MetricFamily
+ * @brief Familia de métricas: nombre, ayuda, tipo y lista de sus series.
+ */
+typedef struct
+{
+    char* name;                /**< Nombre de la métrica. */
+    char* help;                /**< Texto de ayuda. */
+    MetricType type;           /**< Tipo de la métrica. */
+    _Atomic MetricSeries head; /**< Primera serie de la familia. */
+    MetricSeries tail;         /**< Última serie (solo la usa quien registra). */
+} MetricFamily;
+
+/**
+ * @struct MetricSeriesInfo
+ * @brief Descriptor de una serie: familia, etiquetas y enlace a la siguiente serie de la familia.
+ */
+typedef struct
+{
+    uint32_t family;            /**< Índice de la familia. */
+    char* labels;               /**< Etiquetas ya formateadas (`{k="v"}`) o cadena vacía. */
+    size_t label_count;         /**< Cantidad de pares de etiquetas. */
+    char** label_pairs;         /**< Nombres y valores sin escapar, alternados (2 * label_count). */
+    const char* suffix;         /**< Sufijo del nombre de la muestra (`_bucket`, `_sum`, `_count`) o "". */
+    uint32_t histogram_buckets; /**< En el primer bucket de un histograma: cantidad de buckets (con +Inf). */
+    double bound;               /**< Límite superior (le) si la serie es un bucket. */
+    _Atomic MetricSeries next;  /**< Siguiente serie de la misma familia. */
+} MetricSeriesInfo;
+
+/**
+ * @struct MetricHistogram
+ * @brief Histograma registrado: buckets contiguos seguidos de las series _sum y _count.
+ */
+typedef struct
+{
+    MetricSeries first;   /**< Primer bucket; el resto de las series le siguen en orden. */
+    const double* bounds; /**< Límites superiores finitos, en orden creciente. */
+    size_t bound_count;   /**< Cantidad de límites finitos (los buckets son bound_count + 1). */
+} MetricHistogram;
+
+/**
+ * @brief Inicializa el almacén.
+ * @param max_series Capacidad de series; fija durante toda la ejecución.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int metric_store_init(size_t max_series);
+
+/**
+ * @brief Registra una familia de métricas.
+ * @param name Nombre de la métrica.
+ * @param help Texto de ayuda.
+ * @param type Tipo de la métrica.
+ * @return Índice de la familia, o -1 en caso de error.
+ */
+int metric_store_add_family(const char* name, const char* help, MetricType type);
+
+/**
+ * @brief Registra una serie dentro de una familia, o devuelve la existente con esas etiquetas.
+ *
+ * La serie empieza ausente en ambos buffers, así que los lectores pueden verla enlazada
+ * antes de su primer valor sin exponer datos inválidos. Las etiquetas también se guardan
+ * separadas en pares para los formatos que no usan la forma de texto. El identificador es
+ * estable durante toda la ejecución: los recolectores lo guardan y escriben directamente.
+ *
+ * @param family Índice de la familia.
+ * @param labels Etiquetas ya formateadas (`{k="v",...}`), o NULL si no tiene. El orden de
+ *               las etiquetas forma parte de la identidad de la serie.
+ * @return Identificador de la serie, o METRIC_SERIES_INVALID en caso de error.
+ */
+MetricSeries metric_store_add_series(int family, const char* labels);
+
+/**
+ * @brief Calcula el hash de un conjunto de etiquetas para `metric_store_find_series`.
+ *
+ * Un recolector con series dinámicas (por proceso, por interfaz) puede calcularlo una vez
+ * junto con las etiquetas formateadas y reutilizarlo en cada búsqueda.
+ *
+ * @param family Índice de la familia.
+ * @param labels Etiquetas ya formateadas, o NULL.
+ * @return Hash distinto de cero.
+ */
+uint64_t metric_store_labels_hash(int family, const char* labels);
+
+/**
+ * @brief Busca una serie por familia y etiquetas en el índice del almacén.
+ *
+ * El índice usa direccionamiento abierto con sondeo lineal y guarda hash e identificador en
+ * la misma entrada; la búsqueda no toma locks y puede hacerse desde cualquier hilo.
+ *
+ * @param family Índice de la familia.
+ * @param labels Etiquetas ya formateadas, o NULL.
+ * @param hash Resultado de `metric_store_labels_hash` para la misma familia y etiquetas.
+ * @return Identificador de la serie, o METRIC_SERIES_INVALID si no está registrada.
+ */
+MetricSeries metric_store_find_series(int family, const char* labels, uint64_t hash);
+
+/**
+ * @brief Registra una familia con una única serie sin etiquetas.
+ * @param name Nombre de la métrica.
+ * @param help Texto de ayuda.
+ * @param type Tipo de la métrica.
+ * @return Identificador de la serie, o METRIC_SERIES_INVALID en caso de error.
+ */
+MetricSeries metric_store_register(const char* name, const char* help, MetricType type);
+
+/**
+ * @brief Registra un histograma dentro de una familia de tipo METRIC_TYPE_HISTOGRAM.
+ *
+ * Crea una serie `_bucket` por límite (más +Inf), y las series `_sum` y `_count`, con índices
+ * consecutivos. Todas empiezan en 0 a partir de la siguiente publicación.
+ *
+ * @param family Índice de la familia.
+ * @param labels Etiquetas comunes ya formateadas, o NULL.
+ * @param bounds Límites superiores finitos en orden creciente; deben vivir mientras exista el histograma.
+ * @param bound_count Cantidad de límites.
+ * @param histogram Recibe el histograma registrado.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+int metric_store_add_histogram(int family, const char* labels, const double* bounds, size_t bound_count,
+                               MetricHistogram* histogram);
+
+/**
+ * @brief Registra una observación en un histograma desde cualquier hilo.
+ *
+ * Usa el área de `metric_store_stage_add`, así que se aplica en la siguiente publicación.
+ *
+ * @param histogram Histograma destino.
+ * @param value Valor observado.
+ */
+void metric_store_stage_observe(const MetricHistogram* histogram, double value);
+
+/**
+ * @brief Escribe un valor en el buffer trasero. Solo debe llamarla el hilo recolector.
+ * @param series Serie destino.
+ * @param value Valor a escribir.
+ */
+void metric_store_set(MetricSeries series, double value);
+
+/**
+ * @brief Suma un valor al de la serie en el buffer trasero. Solo debe llamarla el hilo recolector.
+ * @param series Serie destino.
+ * @param value Valor a sumar (una serie ausente cuenta como 0).
+ */
+void metric_store_add(MetricSeries series, double value);
+
+/**
+ * @brief Marca la serie como ausente en el buffer trasero (deja de exponerse).
+ * @param series Serie destino.
+ */
+void metric_store_clear(MetricSeries series);
+
+/**
+ * @brief Fija el valor de una serie desde cualquier hilo.
+ *
+ * Pensada para métricas propias del agente que se actualizan fuera del hilo recolector
+ * (por ejemplo desde los hilos HTTP). El valor queda en un área atómica y se copia al buffer
+ * trasero en el siguiente `metric_store_publish`.
+ *
+ * @param series Serie destino.
+ * @param value Valor a fijar.
+ */
+void metric_store_stage(MetricSeries series, double value);
+
+/**
+ * @brief Suma un valor a una serie desde cualquier hilo (contadores).
+ *
+ * El acumulado nunca se reinicia: cada publicación expone el total sumado hasta ese momento.
+ *
+ * @param series Serie destino.
+ * @param value Valor a sumar.
+ */
+void metric_store_stage_add(MetricSeries series, double value);
+
+/**
+ * @brief Publica el buffer trasero como frontal con un único incremento de generación.
+ *
+ * Tras publicar, el nuevo buffer trasero parte de los valores recién publicados, de modo que
+ * las series que no se actualicen en el siguiente ciclo conservan su último valor.
+ *
+ * @return Generación publicada.
+ */
+uint64_t metric_store_publish();
+
+/**
+ * @brief Generación publicada actualmente.
+ * @return Generación vigente (0 antes de la primera publicación).
+ */
+uint64_t metric_store_generation();
+
+/**
+ * @brief Comienza una lectura del buffer frontal.
+ * @param values Recibe el buffer de valores de la generación devuelta.
+ * @return Generación leída; debe validarse con `metric_store_read_valid`.
+ */
+uint64_t metric_store_read_begin(const double** values);
+
+/**
+ * @brief Valida que la lectura iniciada en `generation` no fue pisada por el recolector.
+ * @param generation Generación devuelta por `metric_store_read_begin`.
+ * @return 1 si lo leído es consistente, 0 si hay que repetir la lectura.
+ */
+int metric_store_read_valid(uint64_t generation);
+
+/**
+ * @brief Cantidad de familias registradas.
+ * @return Número de familias.
+ */
+size_t metric_store_family_count();
+
+/**
+ * @brief Obtiene una familia registrada.
+ * @param family Índice de la familia.
+ * @return Descriptor de la familia.
+ */
+const MetricFamily* metric_store_family(size_t family);
+
+/**
+ * @brief Busca una familia por nombre.
+ * @param name Nombre de la métrica.
+ * @return Índice de la familia, o -1 si no está registrada.
+ */
+int metric_store_find_family(const char* name);
+
+/**
+ * @brief Cantidad de series registradas.
+ * @return Número de series.
+ */
+size_t metric_store_series_count();
+
+/**
+ * @brief Obtiene el descriptor de una serie.
+ * @param series Identificador de la serie.
+ * @return Descriptor de la serie.
+ */
+const MetricSeriesInfo* metric_store_series(MetricSeries series);
+
+#endif // METRIC_STORE_H
@@ -1,8 +1,14 @@
 /**
  * @file metrics.h
  * @brief Funciones para obtener el uso de CPU y memoria desde el sistema de archivos /proc.
+ *
+ * Los archivos se leen bajo una raíz de procfs configurable (por defecto /proc), de modo que
+ * los collectors puedan correr contra fixtures grabados o sintéticos (ver tools/procfs_fixture.c).
  */
 
+#ifndef METRICS_H
+#define METRICS_H
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,6 +22,81 @@
  */
 #define BUFFER_SIZE 256
 
+/**
+ * @brief Tamaño máximo de la ruta completa de un archivo de procfs.
+ */
+#define METRICS_PATH_SIZE 256
+
+/**
+ * @enum ProcfsFile
+ * @brief Archivos de procfs y sysfs que leen los collectors, el muestreador y el segmento de
+ *        memoria compartida.
+ */
+typedef enum
+{
+    PROCFS_MEMINFO,                /**< meminfo: memoria y fragmentación. */
+    PROCFS_STAT,                   /**< stat: CPU, procesos y cambios de contexto. */
+    PROCFS_DISKSTATS,              /**< diskstats: lecturas y escrituras del disco. */
+    PROCFS_NET_DEV,                /**< net/dev: bytes de las interfaces de red. */
+    PROCFS_LOADAVG,                /**< loadavg: procesos ejecutables. */
+    PROCFS_PRESSURE_CPU,           /**< pressure/cpu: PSI de CPU. */
+    PROCFS_PRESSURE_MEMORY,        /**< pressure/memory: PSI de memoria. */
+    PROCFS_PRESSURE_IO,            /**< pressure/io: PSI de E/S. */
+    SYSFS_CGROUP_CPU_STAT,         /**< fs/cgroup/cpu.stat: CPU del cgroup v2 raíz (bajo la raíz de sysfs). */
+    SYSFS_CGROUP_UNIFIED_CPU_STAT, /**< fs/cgroup/unified/cpu.stat: ídem en la jerarquía híbrida. */
+    SYSFS_CGROUP_CPU_MAX,          /**< fs/cgroup/cpu.max: cuota de CPU del cgroup v2 raíz (en un contenedor). */
+    PROCFS_FILE_COUNT,             /**< Cantidad de archivos. */
+} ProcfsFile;
+
+/**
+ * @brief Cambia la raíz de procfs bajo la que leen todos los collectors.
+ *
+ * Debe llamarse antes de empezar a recolectar: las lecturas en curso no se sincronizan con el
+ * cambio. Si la raíz es demasiado larga se conserva la anterior.
+ *
+ * @param root Directorio que reemplaza a /proc (sin barra final).
+ * @return 0 en caso de éxito, -1 si alguna ruta no entra en METRICS_PATH_SIZE.
+ */
+int metrics_set_procfs_root(const char* root);
+
+/**
+ * @brief Cambia la raíz de sysfs (archivos SYSFS_*), con las mismas reglas que la de procfs.
+ * @param root Directorio que reemplaza a /sys (sin barra final).
+ * @return 0 en caso de éxito, -1 si alguna ruta no entra en METRICS_PATH_SIZE.
+ */
+int metrics_set_sysfs_root(const char* root);
+
+/**
+ * @brief Devuelve la ruta de un archivo relativa a la raíz del sistema de archivos, con el
+ *        prefijo de su montaje (p. ej. "proc/net/dev" o "sys/fs/cgroup/cpu.stat").
+ *
+ * Es el nombre con que los fixtures guardan el archivo (ver tools/procfs_fixture.c).
+ *
+ * @param file Archivo.
+ * @return Nombre relativo.
+ */
+const char* metrics_procfs_file(ProcfsFile file);
+
+/**
+ * @brief Devuelve la ruta completa de un archivo bajo la raíz configurada.
+ * @param file Archivo.
+ * @return Ruta, válida hasta el próximo cambio de raíz.
+ */
+const char* metrics_procfs_path(ProcfsFile file);
+
+/**
+ * @brief Prepara un descriptor que se relee con pread para ver el contenido vigente.
+ *
+ * Los archivos del /proc y el /sys reales se regeneran en cada lectura y no hace nada. Bajo
+ * otra raíz (un fixture que `procfs_fixture replay` reemplaza con rename) el descriptor
+ * seguiría leyendo el archivo anterior, así que se reabre sobre el mismo número con dup2; si
+ * la ruta ya no existe se conserva el anterior.
+ *
+ * @param file Archivo al que apunta `fd`.
+ * @param fd Descriptor abierto de `metrics_procfs_path(file)`.
+ */
+void metrics_procfs_refresh(ProcfsFile file, int fd);
+
 /**
  * @brief Obtiene el porcentaje de uso de memoria desde /proc/meminfo.
  *
@@ -86,3 +167,5 @@ int get_process_usage();
  * @return Numero de cambios de contexto, o -1 en caso de error.
  */
 double get_ctxt_usage();
+
+#endif // METRICS_H
@@ -0,0 +1,67 @@
+/**
+ * @file monitor_fifo.h
+ * @brief Envío persistente de las métricas del sistema al monitor a través de un FIFO.
+ *
+ * Tras cada publicación se codifica un mensaje con las métricas del sistema presentes, con las
+ * claves de siempre (`cpu_usage`, `memory_usage`, `disk_usage`, `network_usage`,
+ * `process_count`, `context_switches`) más `timestamp` en milisegundos, en JSON compacto o en
+ * CBOR. Cada mensaje se delimita con un salto de línea (NDJSON) o con su longitud en 4 bytes
+ * big-endian, y se encola en un anillo de `queue_kb` KiB.
+ *
+ * Un hilo escritor mantiene el FIFO abierto y vacía la cola. Si no hay lector o es lento los
+ * mensajes esperan en el anillo; cuando se llena se descartan los más viejos y se cuentan en
+ * `monitor_fifo_dropped_messages_total`. Un mensaje escrito a medias se completa antes de
+ * pasar al siguiente y, si el lector se va en el medio, el mensaje se reenvía completo al
+ * próximo: el lector nunca ve mensajes cortados ni intercalados.
+ *
+ * Con "mode": "delta" (ver delta_stream.h) cada mensaje lleva además `seq` y `keyframe` y,
+ * fuera de los keyframes, solo las claves que cambiaron más que su banda muerta (null si
+ * desaparecieron); los ciclos sin cambios no encolan nada. Como el FIFO no tiene canal de
+ * vuelta, se fuerza un keyframe cada vez que se descartan mensajes y cada vez que se abre el
+ * FIFO para un lector nuevo.
+ */
+
+#ifndef MONITOR_FIFO_H
+#define MONITOR_FIFO_H
+
+#include "config.h"
+#include <stddef.h>
+
+/**
+ * @brief Inicia el envío si la configuración vigente tiene "monitor.fifo_path".
+ *
+ * Debe llamarse después de `collection_init`: los mensajes se arman tras cada publicación.
+ *
+ * @return 0 si se inició o está deshabilitado, -1 en caso de error.
+ */
+int monitor_fifo_init();
+
+/**
+ * @brief Crea el FIFO si no existe, registra las métricas del envío y arranca el hilo escritor.
+ * @param config Opciones; `fifo_path` no puede estar vacío.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+int monitor_fifo_start(const MonitorConfig* config);
+
+/**
+ * @brief Detiene el hilo escritor, cierra el FIFO y descarta lo encolado.
+ */
+void monitor_fifo_stop();
+
+/**
+ * @brief Encola un mensaje con los últimos valores publicados, fuera del ciclo de recolección.
+ * @return 0 si se encoló (o en modo delta no hubo cambios), -1 si el envío no está iniciado o no
+ *         hay memoria.
+ */
+int monitor_fifo_send_current();
+
+/**
+ * @brief Encola un mensaje ya codificado; se le agrega la delimitación configurada.
+ * @param message Contenido.
+ * @param len Longitud en bytes.
+ * @return 0 si se encoló (aunque para hacerle lugar se hayan descartado otros), -1 si el
+ *         envío no está iniciado o el mensaje no entra en la cola.
+ */
+int monitor_fifo_enqueue(const void* message, size_t len);
+
+#endif // MONITOR_FIFO_H
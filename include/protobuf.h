@@ -0,0 +1,93 @@
+/**
+ * @file protobuf.h
+ * @brief Codificación mínima de Protocol Buffers (wire format) sobre un Buffer.
+ *
+ * Solo cubre lo que necesitan los formatos de Prometheus: varints, doubles, cadenas y
+ * mensajes anidados cuyo tamaño se calcula antes de escribirlos.
+ */
+
+#ifndef PROTOBUF_H
+#define PROTOBUF_H
+
+#include "buffer.h"
+#include <stdint.h>
+
+/**
+ * @brief Tipo de cable para varints.
+ */
+#define PB_WIRE_VARINT 0
+
+/**
+ * @brief Tipo de cable para valores de 64 bits (double, fixed64).
+ */
+#define PB_WIRE_FIXED64 1
+
+/**
+ * @brief Tipo de cable para cadenas, bytes y mensajes anidados.
+ */
+#define PB_WIRE_LENGTH 2
+
+/**
+ * @brief Bytes que ocupa un varint.
+ * @param value Valor a codificar.
+ * @return Tamaño en bytes (1 a 10).
+ */
+size_t pb_varint_size(uint64_t value);
+
+/**
+ * @brief Bytes que ocupa un campo de longitud variable (clave + longitud + contenido).
+ * @param field Número de campo.
+ * @param len Longitud del contenido.
+ * @return Tamaño total del campo.
+ */
+size_t pb_length_field_size(uint32_t field, size_t len);
+
+/**
+ * @brief Escribe un varint.
+ * @param out Buffer destino.
+ * @param value Valor a escribir.
+ */
+void pb_put_varint(Buffer* out, uint64_t value);
+
+/**
+ * @brief Escribe la clave de un campo (número y tipo de cable).
+ * @param out Buffer destino.
+ * @param field Número de campo.
+ * @param wire_type Tipo de cable.
+ */
+void pb_put_tag(Buffer* out, uint32_t field, uint32_t wire_type);
+
+/**
+ * @brief Escribe un campo double.
+ * @param out Buffer destino.
+ * @param field Número de campo.
+ * @param value Valor.
+ */
+void pb_put_double(Buffer* out, uint32_t field, double value);
+
+/**
+ * @brief Escribe un campo varint.
+ * @param out Buffer destino.
+ * @param field Número de campo.
+ * @param value Valor.
+ */
+void pb_put_uint64(Buffer* out, uint32_t field, uint64_t value);
+
+/**
+ * @brief Escribe un campo de bytes o cadena.
+ * @param out Buffer destino.
+ * @param field Número de campo.
+ * @param data Contenido.
+ * @param len Longitud del contenido.
+ */
+void pb_put_bytes(Buffer* out, uint32_t field, const void* data, size_t len);
+
+/**
+ * @brief Escribe la cabecera de un mensaje anidado; el contenido se escribe a continuación.
+ * @param out Buffer destino.
+ * @param field Número de campo.
+ * @param len Longitud del mensaje anidado, calculada de antemano.
+ */
+void pb_put_message_header(Buffer* out, uint32_t field, size_t len);
+
+#endif // PROTOBUF_H
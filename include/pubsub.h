@@ -0,0 +1,68 @@
+/**
+ * @file pubsub.h
+ * @brief Socket AF_UNIX de suscripción: cualquier cantidad de consumidores locales reciben las
+ *        métricas del sistema tras cada recolección.
+ *
+ * Cada mensaje es un objeto (JSON compacto o mapa CBOR) con `timestamp` en milisegundos y las
+ * métricas presentes con el nombre de su familia (`cpu_usage_percentage`, ...), delimitado con
+ * un salto de línea o con su longitud en 4 bytes big-endian, como el FIFO del monitor.
+ *
+ * Un suscriptor puede enviar en cualquier momento una línea con su filtro; las claves que
+ * incluya reemplazan a las anteriores y sin filtro recibe todo:
+ *
+ * @code
+ * {"names": ["cpu_usage_percentage", "memory_usage_percentage"], "min_interval_ms": 5000}
+ * @endcode
+ *
+ * Los nombres desconocidos se ignoran. Con "min_interval_ms" se salta las publicaciones que
+ * lleguen antes de ese intervalo desde el último mensaje que se le encoló.
+ *
+ * Con "mode": "delta" (ver delta_stream.h) cada mensaje lleva además `seq` y `keyframe`: los
+ * keyframes traen todas las métricas pedidas y los deltas solo las que cambiaron más que su
+ * banda muerta (null si desaparecieron); los ciclos sin cambios no envían nada. Un suscriptor
+ * recibe un keyframe al conectarse, al cambiar de métricas, tras saltearse ciclos por su
+ * intervalo o perder mensajes por su cola, y cuando lo pide con `{"resync": true}` al
+ * detectar un salto en `seq`.
+ *
+ * Los valores se codifican una sola vez por ciclo; cada combinación distinta de métricas
+ * pedidas arma su mensaje concatenando esos fragmentos, y los suscriptores con la misma
+ * combinación comparten el mensaje. Cada suscriptor tiene su propia cola de `queue_messages`
+ * mensajes. Si se llena, según "slow_policy" se descartan sus mensajes más viejos
+ * (`pubsub_dropped_messages_total`) o se lo desconecta (`pubsub_slow_disconnects_total`). Un
+ * hilo propio escribe sin bloquear en todos los sockets, así que un suscriptor lento no
+ * demora la recolección ni a los demás.
+ */
+
+#ifndef PUBSUB_H
+#define PUBSUB_H
+
+#include "config.h"
+
+/**
+ * @brief Abre el socket si la configuración vigente tiene "pubsub.socket_path".
+ *
+ * Debe llamarse después de `collection_init`: los mensajes se arman tras cada publicación.
+ *
+ * @return 0 si se inició o está deshabilitado, -1 en caso de error.
+ */
+int pubsub_init();
+
+/**
+ * @brief Abre el socket, registra las métricas del envío y arranca el hilo que atiende a los
+ *        suscriptores, sin engancharse a la recolección.
+ * @param config Opciones; `socket_path` no puede estar vacío.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+int pubsub_start(const PubsubConfig* config);
+
+/**
+ * @brief Codifica los últimos valores publicados y los encola para cada suscriptor.
+ */
+void pubsub_publish_current();
+
+/**
+ * @brief Desconecta a los suscriptores, detiene el hilo y elimina el socket.
+ */
+void pubsub_stop();
+
+#endif // PUBSUB_H
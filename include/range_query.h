@@ -0,0 +1,77 @@
+/**
+ * @file range_query.h
+ * @brief Consultas de rango sobre la historia local (`/api/range`), agregadas por paso.
+ *
+ * Los chunks de cada serie se decodifican punto a punto y cada punto se acumula en el paso
+ * que le corresponde; al pasar al siguiente se escribe el anterior con min, max, avg, last y
+ * la cantidad de puntos, así que nunca se arma la lista de puntos crudos. La respuesta se
+ * genera con el escritor de JSON en streaming:
+ *
+ * @code
+ * {"status":"success","data":{"start":1700000000,"end":1700003600,"step":60,
+ *  "columns":["timestamp","min","max","avg","last","count"],
+ *  "series":[{"metric":"cpu_usage_percentage","values":[[1700000000,3.1,7.9,4.2,5,60],...]}]}}
+ * @endcode
+ *
+ * Cada fila corresponde al intervalo [timestamp, timestamp + step); los pasos sin puntos se omiten.
+ */
+
+#ifndef RANGE_QUERY_H
+#define RANGE_QUERY_H
+
+#include "buffer.h"
+#include <stdint.h>
+
+/**
+ * @brief Máximo de pasos por consulta (el mismo límite que la API de Prometheus).
+ */
+#define RANGE_QUERY_MAX_STEPS 11000
+
+/**
+ * @brief Ventana por defecto si falta "start", en milisegundos.
+ */
+#define RANGE_QUERY_DEFAULT_WINDOW_MS (3600 * 1000)
+
+/**
+ * @brief Paso por defecto si falta "step", en milisegundos.
+ */
+#define RANGE_QUERY_DEFAULT_STEP_MS (60 * 1000)
+
+/**
+ * @struct RangeQuery
+ * @brief Consulta ya validada.
+ */
+typedef struct
+{
+    const char* metric; /**< Clave exacta (`nombre{k="v"}`) o nombre: todas las series de ese nombre. */
+    int64_t start_ms;   /**< Inicio, inclusive. */
+    int64_t end_ms;     /**< Fin, inclusive. */
+    int64_t step_ms;    /**< Ancho de cada paso. */
+} RangeQuery;
+
+/**
+ * @brief Valida los argumentos de la URL y arma la consulta.
+ *
+ * "start" y "end" son segundos Unix (admiten decimales), "now" o "now-<duración>"; "step" es
+ * una duración: segundos, o un número con sufijo s, m, h o d. Sin "end" se usa el momento
+ * actual, sin "start" la hora anterior a "end" y sin "step" un minuto.
+ *
+ * @param query Consulta a completar.
+ * @param metric Argumento "metric" (obligatorio).
+ * @param start Argumento "start", o NULL.
+ * @param end Argumento "end", o NULL.
+ * @param step Argumento "step", o NULL.
+ * @return NULL si es válida, o el motivo del rechazo (texto estático).
+ */
+const char* range_query_parse(RangeQuery* query, const char* metric, const char* start, const char* end,
+                              const char* step);
+
+/**
+ * @brief Ejecuta la consulta y escribe la respuesta JSON.
+ * @param query Consulta validada.
+ * @param out Buffer destino.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+int range_query_write(const RangeQuery* query, Buffer* out);
+
+#endif // RANGE_QUERY_H
@@ -0,0 +1,27 @@
+/**
+ * @file remote_write.h
+ * @brief Envío de las métricas a un endpoint de Prometheus remote_write.
+ *
+ * Tras cada publicación se codifican las series presentes como `WriteRequest` (protobuf),
+ * en lotes de hasta `max_samples_per_send` muestras, se comprimen con snappy y se agregan al
+ * WAL de su shard. Cada serie va siempre al mismo shard, así sus muestras llegan en orden
+ * aunque haya varios envíos simultáneos. El hilo de cada shard envía los lotes en orden y
+ * reintenta con espera exponencial ante errores de red, 5xx y 429; un 4xx descarta el lote.
+ * Mientras el endpoint no responde los lotes se acumulan en disco hasta `wal_max_segments`.
+ */
+
+#ifndef REMOTE_WRITE_H
+#define REMOTE_WRITE_H
+
+/**
+ * @brief Inicia el envío si la configuración vigente tiene "remote_write.url".
+ *
+ * Debe llamarse después de `collection_init` y antes de la primera recolección: abre el WAL
+ * de cada shard (reanudando lo pendiente de una ejecución anterior), registra las métricas
+ * del envío y crea un hilo por shard.
+ *
+ * @return 0 si se inició o está deshabilitado, -1 en caso de error.
+ */
+int remote_write_init();
+
+#endif // REMOTE_WRITE_H
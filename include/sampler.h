@@ -0,0 +1,85 @@
+/**
+ * @file sampler.h
+ * @brief Muestreo de alta frecuencia (10 a 50 Hz) de CPU, cola de ejecución y PSI.
+ *
+ * Una lectura de CPU por recolección esconde las ráfagas que afectan la latencia de cola. Un
+ * hilo dedicado lee las fuentes elegidas `rate_hz` veces por segundo y resume cada ventana de
+ * `window_seconds` en mínimo, máximo, media y un DDSketch (ddsketch.h, 1% de error relativo).
+ * Cada recolección exporta la última ventana completa:
+ *
+ * - `<fuente>{quantile="0.5|0.9|0.99"}`, al estilo de un summary.
+ * - `<fuente>_min`, `<fuente>_max` y `<fuente>_mean`.
+ *
+ * Las fuentes son `sampled_cpu_usage_percent` (cpu.stat del cgroup v2 raíz, o /proc/stat si
+ * no está), `sampled_run_queue_length` (procesos ejecutables de /proc/loadavg, sin contar al
+ * muestreador) y `sampled_psi_{cpu,memory,io}_some_percent` (tiempo con alguna tarea demorada
+ * según /proc/pressure). Solo la CPU se lee en cada tick; la cola de ejecución y PSI, a lo
+ * sumo 10 veces por segundo.
+ *
+ * Con cpu.stat el uso de CPU es el del cgroup raíz visible: dentro de un contenedor con su
+ * propio namespace de cgroups es el del contenedor, en porcentaje de su cuota (cpu.max) o de
+ * los CPUs en línea si no tiene, no el de la máquina. /proc/stat da el de la máquina y cuenta
+ * en ticks de 10 ms: a 50 Hz cada muestra abarca dos ticks y con pocos CPUs los valores se
+ * agrupan en escalones de 50 / CPUs. Los
+ * archivos se abren al iniciar bajo las raíces de procfs y sysfs configuradas (metrics.h), así
+ * que un fixture reproduce también el muestreo.
+ *
+ * Para que el costo sea mínimo los archivos quedan abiertos y se releen con `pread`, el
+ * parseo no usa stdio y el hilo duerme hasta instantes absolutos con holgura de timer. El
+ * costo propio se exporta en `sampler_cpu_seconds_total`; bench_sampler lo mide.
+ */
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "config.h"
+#include <stdint.h>
+
+/**
+ * @brief Inicia el muestreo si la configuración vigente tiene "sampler.rate_hz".
+ *
+ * Debe llamarse después de `collection_init`: la exportación se registra como función de
+ * recolección.
+ *
+ * @return 0 si se inició o está deshabilitado, -1 en caso de error.
+ */
+int sampler_init();
+
+/**
+ * @brief Registra las métricas del muestreo y crea su hilo, sin engancharse a la recolección.
+ * @param config Opciones; `rate_hz` debe ser mayor que cero.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+int sampler_start(const SamplerConfig* config);
+
+/**
+ * @brief Detiene el hilo de muestreo y cierra las fuentes.
+ */
+void sampler_stop();
+
+/**
+ * @brief CPU consumido por el hilo de muestreo desde que se inició.
+ * @return Segundos de CPU, o 0 si no está corriendo.
+ */
+double sampler_cpu_seconds();
+
+/**
+ * @brief Ticks de muestreo realizados (cada uno lee todas las fuentes).
+ * @return Cantidad de ticks.
+ */
+uint64_t sampler_ticks();
+
+/**
+ * @brief Tiempo de CPU disponible hasta un instante con la capacidad dada: el total contra el
+ *        que se compara el `usage_usec` de cpu.stat.
+ *
+ * Se divide antes de multiplicar para no desbordar con instantes grandes (días de uptime por
+ * cientos de CPUs o cuotas altas) sin perder la precisión de microsegundos.
+ *
+ * @param now_ns Instante monotónico en nanosegundos.
+ * @param capacity_milli Capacidad en milésimas de CPU.
+ * @return Microsegundos de CPU.
+ */
+uint64_t sampler_cpu_capacity_us(uint64_t now_ns, uint64_t capacity_milli);
+
+#endif // SAMPLER_H
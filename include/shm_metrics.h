@@ -0,0 +1,176 @@
+/**
+ * @file shm_metrics.h
+ * @brief Formato del segmento de memoria compartida con los valores vigentes, y lector.
+ *
+ * El agente publica tras cada recolección una estructura de tamaño fijo en un segmento de
+ * shm_open (sección "shm" de la configuración). Un consumidor local lo mapea en solo lectura
+ * una vez y después lee sin llamadas al sistema: la consistencia la da un seqlock (la
+ * secuencia es impar mientras el agente escribe y cambia con cada publicación).
+ *
+ * Este archivo no depende del resto del proyecto; los consumidores pueden copiarlo tal cual y
+ * enlazar con -lrt si su libc lo necesita para shm_open:
+ *
+ * @code
+ * ShmMetricsReader reader;
+ * ShmMetricsValues values;
+ * if (shm_metrics_open(&reader, "/monitoring_metrics") == 0 && shm_metrics_read(&reader, &values) == 0)
+ * {
+ *     printf("%.1f %% CPU\n", values.cpu_usage_percent);
+ * }
+ * @endcode
+ *
+ * Compatibilidad: los campos nuevos se agregan al final de ShmMetricsValues y el lector acepta
+ * segmentos con `values_size` mayor que el suyo. Un cambio incompatible incrementa
+ * SHM_METRICS_VERSION. Los valores ausentes son NaN.
+ */
+
+#ifndef SHM_METRICS_H
+#define SHM_METRICS_H
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Identifica el segmento ("PMSHMETR" en little-endian).
+ */
+#define SHM_METRICS_MAGIC 0x5254454d48534d50ULL
+
+/**
+ * @brief Versión del formato.
+ */
+#define SHM_METRICS_VERSION 1
+
+/**
+ * @brief Intentos de lectura antes de dar por muerto a un escritor que quedó a mitad de camino.
+ */
+#define SHM_METRICS_READ_SPINS 100000
+
+/**
+ * @struct ShmMetricsValues
+ * @brief Valores de una publicación.
+ */
+typedef struct
+{
+    uint64_t generation;                 /**< Generación del almacén del agente; crece con cada publicación. */
+    int64_t timestamp_ns;                /**< Instante de la publicación (CLOCK_REALTIME). */
+    double cpu_usage_percent;            /**< Uso de CPU. */
+    double memory_usage_percent;         /**< Uso de memoria. */
+    double memory_fragmentation_percent; /**< Memoria fragmentada. */
+    double disk_usage;                   /**< Lecturas y escrituras completadas del disco. */
+    double network_usage;                /**< Bytes enviados por la interfaz de red. */
+    double process_count;                /**< Procesos en ejecución. */
+    double context_switches;             /**< Cambios de contexto. */
+    double psi_cpu_some_avg10;           /**< % de tiempo con tareas demoradas por CPU (últimos 10 s). */
+    double psi_memory_some_avg10;        /**< % de tiempo con tareas demoradas por memoria (últimos 10 s). */
+    double psi_io_some_avg10;            /**< % de tiempo con tareas demoradas por E/S (últimos 10 s). */
+} ShmMetricsValues;
+
+/**
+ * @struct ShmMetricsSegment
+ * @brief Contenido del segmento. La secuencia ocupa su propia línea de caché.
+ */
+typedef struct
+{
+    uint64_t magic;            /**< SHM_METRICS_MAGIC. */
+    uint32_t version;          /**< SHM_METRICS_VERSION del escritor. */
+    uint32_t values_size;      /**< sizeof(ShmMetricsValues) del escritor. */
+    int32_t writer_pid;        /**< PID del agente; sirve para detectar un segmento huérfano. */
+    uint32_t reserved[11];     /**< Relleno hasta la línea de caché siguiente. */
+    _Atomic uint64_t sequence; /**< Impar mientras el agente escribe. */
+    uint64_t padding[7];       /**< Relleno hasta la línea de caché siguiente. */
+    ShmMetricsValues values;   /**< Última publicación. */
+} ShmMetricsSegment;
+
+/**
+ * @struct ShmMetricsReader
+ * @brief Segmento mapeado por un consumidor.
+ */
+typedef struct
+{
+    const ShmMetricsSegment* segment; /**< Mapeo de solo lectura, o NULL. */
+    size_t size;                      /**< Bytes mapeados. */
+} ShmMetricsReader;
+
+/**
+ * @brief Mapea el segmento en solo lectura y verifica su formato.
+ * @param reader Lector a inicializar.
+ * @param name Nombre del segmento (el "shm.name" del agente).
+ * @return 0 en caso de éxito, -1 si no existe, no se puede mapear o el formato no es compatible.
+ */
+static inline int shm_metrics_open(ShmMetricsReader* reader, const char* name)
+{
+    reader->segment = NULL;
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmMetricsSegment))
+    {
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return -1;
+    }
+    const ShmMetricsSegment* segment = (const ShmMetricsSegment*)map;
+    if (segment->magic != SHM_METRICS_MAGIC || segment->version != SHM_METRICS_VERSION ||
+        segment->values_size < sizeof(ShmMetricsValues))
+    {
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+    reader->segment = segment;
+    reader->size = (size_t)st.st_size;
+    return 0;
+}
+
+/**
+ * @brief Copia la última publicación sin llamadas al sistema.
+ * @param reader Lector abierto.
+ * @param values Destino.
+ * @return 0 en caso de éxito, -1 si el escritor no termina de escribir (murió a mitad de camino).
+ */
+static inline int shm_metrics_read(const ShmMetricsReader* reader, ShmMetricsValues* values)
+{
+    const ShmMetricsSegment* segment = reader->segment;
+    for (long i = 0; i < SHM_METRICS_READ_SPINS; i++)
+    {
+        uint64_t before = atomic_load_explicit(&segment->sequence, memory_order_acquire);
+        if (before & 1)
+        {
+            continue;
+        }
+        memcpy(values, (const void*)&segment->values, sizeof(*values));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&segment->sequence, memory_order_relaxed) == before)
+        {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Desmapea el segmento.
+ * @param reader Lector abierto.
+ */
+static inline void shm_metrics_close(ShmMetricsReader* reader)
+{
+    if (reader->segment != NULL)
+    {
+        munmap((void*)reader->segment, reader->size);
+        reader->segment = NULL;
+    }
+}
+
+#endif // SHM_METRICS_H
@@ -0,0 +1,43 @@
+/**
+ * @file shm_output.h
+ * @brief Publicación de los valores vigentes en un segmento de memoria compartida.
+ *
+ * Tras cada publicación se copian al segmento (formato en shm_metrics.h) las métricas del
+ * sistema y el PSI de /proc/pressure (bajo la raíz de procfs configurada, ver metrics.h), bajo
+ * un seqlock. Los consumidores locales lo leen sin llamadas al sistema. El segmento se
+ * reutiliza entre reinicios del agente para que los lectores ya conectados sigan viendo los
+ * valores nuevos.
+ */
+
+#ifndef SHM_OUTPUT_H
+#define SHM_OUTPUT_H
+
+#include "shm_metrics.h"
+
+/**
+ * @brief Publica el segmento si la configuración vigente tiene "shm.name".
+ *
+ * Debe llamarse después de `collection_init`: el segmento se actualiza tras cada publicación.
+ *
+ * @return 0 si se inició o está deshabilitado, -1 en caso de error.
+ */
+int shm_output_init();
+
+/**
+ * @brief Crea (o reutiliza) y mapea el segmento, sin engancharse a la recolección.
+ * @param name Nombre para shm_open.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+int shm_output_start(const char* name);
+
+/**
+ * @brief Copia al segmento los últimos valores publicados; la llama la publicación de cada ciclo.
+ */
+void shm_output_update();
+
+/**
+ * @brief Desmapea el segmento y cierra las fuentes de PSI; el segmento sigue existiendo.
+ */
+void shm_output_stop();
+
+#endif // SHM_OUTPUT_H
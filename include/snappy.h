@@ -0,0 +1,41 @@
+/**
+ * @file snappy.h
+ * @brief Compresión snappy en formato de bloque (sin framing), la que exige remote_write.
+ *
+ * Implementa el formato descrito en format_description.txt de snappy: la longitud sin
+ * comprimir como varint seguida de literales y copias con desplazamientos de 1 y 2 bytes.
+ * La entrada se procesa en bloques de 64 KiB, así que nunca se emiten copias de 4 bytes.
+ */
+
+#ifndef SNAPPY_H
+#define SNAPPY_H
+
+#include "buffer.h"
+#include <stddef.h>
+
+/**
+ * @brief Tamaño máximo de la salida comprimida para una entrada dada.
+ * @param len Bytes sin comprimir.
+ * @return Cota superior del tamaño comprimido.
+ */
+size_t snappy_max_compressed_length(size_t len);
+
+/**
+ * @brief Comprime un bloque completo.
+ * @param data Datos a comprimir.
+ * @param len Cantidad de bytes (hasta 4 GiB - 1).
+ * @param out Buffer destino; se vacía antes de escribir.
+ * @return 0 en caso de éxito, -1 si no hay memoria o la entrada es demasiado grande.
+ */
+int snappy_compress(const char* data, size_t len, Buffer* out);
+
+/**
+ * @brief Descomprime un bloque completo validando cada elemento.
+ * @param data Datos comprimidos.
+ * @param len Cantidad de bytes.
+ * @param out Buffer destino; se vacía antes de escribir.
+ * @return 0 en caso de éxito, -1 si la entrada está corrupta o no hay memoria.
+ */
+int snappy_uncompress(const char* data, size_t len, Buffer* out);
+
+#endif // SNAPPY_H
@@ -0,0 +1,34 @@
+/**
+ * @file synthetic.h
+ * @brief Series sintéticas con etiquetas para medir la exposición con registros grandes.
+ *
+ * Con "synthetic.series" se registran familias `synthetic_series_<n>` de "per_family" series
+ * cada una, con etiquetas `instance` y `shard`. Sus valores cambian en cada recolección, así
+ * que cada generación invalida el caché de la exposición como lo haría un registro real.
+ */
+
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include "config.h"
+#include <stddef.h>
+
+/**
+ * @brief Series que agregará `synthetic_init` con la configuración vigente.
+ *
+ * Sirve para dimensionar el almacén antes de `metric_store_init`.
+ *
+ * @return Cantidad de series sintéticas.
+ */
+size_t synthetic_series_count();
+
+/**
+ * @brief Registra las series sintéticas si la configuración vigente tiene "synthetic.series".
+ *
+ * Debe llamarse después de `collection_init`: los valores se actualizan en cada recolección.
+ *
+ * @return 0 si se registraron o está deshabilitado, -1 en caso de error.
+ */
+int synthetic_init();
+
+#endif // SYNTHETIC_H
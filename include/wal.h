@@ -0,0 +1,153 @@
+/**
+ * @file wal.h
+ * @brief Cola FIFO persistente en segmentos de disco (write-ahead log) para los envíos pendientes.
+ *
+ * Cada registro es `[longitud u32][muestras u32][crc32 u32][contenido]` (enteros en el orden
+ * de la máquina) y se agrega al último segmento; al superar el tamaño configurado se abre uno
+ * nuevo. Los lectores toman registros en orden y los confirman con `wal_ack` cuando se
+ * enviaron o se descartaron; un segmento cerrado con todos sus registros confirmados se borra.
+ * Si se supera el máximo de segmentos se descarta el más viejo aunque tenga registros sin
+ * enviar, y sus muestras se cuentan como perdidas. Al abrir se reanudan los segmentos que
+ * quedaron de una ejecución anterior (los que excedan el máximo se descartan de la misma
+ * forma); un registro final truncado o corrupto se descarta.
+ *
+ * Las escrituras no se sincronizan una por una: cada segmento se sincroniza con `fdatasync`
+ * al abrir el siguiente, y el último junto con el checkpoint en `wal_close`. Una caída del
+ * sistema puede perder lo escrito en el segmento abierto.
+ *
+ * El archivo `checkpoint` guarda hasta dónde se confirmó en orden, para no reenviar al
+ * reanudar lo que ya se había enviado. Con un único lector las confirmaciones siempre llegan
+ * en orden; con varios, una confirmación adelantada no avanza el checkpoint y ese registro
+ * podría reenviarse tras un reinicio.
+ */
+
+#ifndef WAL_H
+#define WAL_H
+
+#include "buffer.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Máximo de segmentos que se conservan en un WAL.
+ */
+#define WAL_MAX_SEGMENTS 64
+
+/**
+ * @brief Tamaño máximo de la ruta del directorio de un WAL.
+ */
+#define WAL_PATH_SIZE 512
+
+/**
+ * @struct WalSegment
+ * @brief Un archivo de segmento y la cuenta de sus registros.
+ */
+typedef struct
+{
+    uint64_t id;           /**< Número de segmento; da nombre al archivo. */
+    int fd;                /**< Descriptor abierto para leer y agregar. */
+    size_t size;           /**< Bytes válidos escritos. */
+    uint32_t records;      /**< Registros escritos. */
+    uint32_t read_records; /**< Registros entregados a los lectores. */
+    uint32_t acked;        /**< Registros confirmados. */
+    size_t acked_size;     /**< Bytes del prefijo confirmado en orden. */
+    uint64_t samples;      /**< Muestras escritas. */
+    uint64_t read_samples; /**< Muestras entregadas a los lectores. */
+} WalSegment;
+
+/**
+ * @struct WalPosition
+ * @brief Registro entregado por `wal_read`, a confirmar con `wal_ack`.
+ */
+typedef struct
+{
+    uint64_t segment; /**< Segmento del registro. */
+    size_t offset;    /**< Posición del registro en el segmento. */
+    size_t size;      /**< Bytes del registro, cabecera incluida. */
+    uint32_t samples; /**< Muestras del registro. */
+} WalPosition;
+
+/**
+ * @struct WalStats
+ * @brief Estado de un WAL para las métricas.
+ */
+typedef struct
+{
+    uint64_t pending_samples; /**< Muestras escritas que aún no se confirmaron. */
+    uint64_t dropped_samples; /**< Muestras descartadas con segmentos sin enviar (acumulado). */
+    int segments;             /**< Segmentos en disco. */
+} WalStats;
+
+/**
+ * @struct Wal
+ * @brief WAL de un directorio. Un escritor y cualquier cantidad de lectores.
+ */
+typedef struct
+{
+    char dir[WAL_PATH_SIZE];               /**< Directorio de los segmentos. */
+    size_t segment_bytes;                  /**< Tamaño a partir del cual se abre un segmento nuevo. */
+    int max_segments;                      /**< Segmentos conservados antes de descartar el más viejo. */
+    WalSegment segments[WAL_MAX_SEGMENTS]; /**< Segmentos, del más viejo al más nuevo (cola circular). */
+    int first;                             /**< Posición del segmento más viejo. */
+    int count;                             /**< Cantidad de segmentos. */
+    uint64_t read_segment;                 /**< Segmento del próximo registro a leer. */
+    size_t read_offset;                    /**< Posición del próximo registro a leer. */
+    uint64_t pending_samples;              /**< Muestras sin confirmar. */
+    uint64_t dropped_samples;              /**< Muestras descartadas sin enviar. */
+    int checkpoint_fd;                     /**< Archivo con el segmento y la posición confirmados. */
+    int closed;                            /**< `wal_close` despertó a los lectores. */
+    pthread_mutex_t lock;                  /**< Protege todo el estado. */
+    pthread_cond_t available;              /**< Señala registros nuevos o el cierre. */
+} Wal;
+
+/**
+ * @brief Abre (o crea) un WAL y reanuda los segmentos existentes.
+ * @param wal WAL a inicializar.
+ * @param dir Directorio de los segmentos; se crea si no existe.
+ * @param segment_bytes Tamaño a partir del cual se abre un segmento nuevo.
+ * @param max_segments Segmentos a conservar (2 a WAL_MAX_SEGMENTS).
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+int wal_open(Wal* wal, const char* dir, size_t segment_bytes, int max_segments);
+
+/**
+ * @brief Agrega un registro al final de la cola.
+ * @param wal WAL.
+ * @param data Contenido del registro.
+ * @param len Longitud del contenido.
+ * @param samples Muestras que contiene (para las métricas de pendientes y descartes).
+ * @return 0 en caso de éxito, -1 si no se pudo escribir o `len` supera el tamaño de segmento.
+ */
+int wal_append(Wal* wal, const void* data, size_t len, uint32_t samples);
+
+/**
+ * @brief Toma el próximo registro, esperando si no hay ninguno.
+ * @param wal WAL.
+ * @param out Recibe el contenido; se vacía antes de escribir.
+ * @param position Recibe la posición a pasar a `wal_ack`.
+ * @return 0 si se leyó un registro, -1 si el WAL se cerró.
+ */
+int wal_read(Wal* wal, Buffer* out, WalPosition* position);
+
+/**
+ * @brief Confirma un registro leído (enviado o descartado definitivamente).
+ * @param wal WAL.
+ * @param position Posición devuelta por `wal_read`.
+ */
+void wal_ack(Wal* wal, const WalPosition* position);
+
+/**
+ * @brief Copia el estado del WAL.
+ * @param wal WAL.
+ * @param stats Destino.
+ */
+void wal_stats(Wal* wal, WalStats* stats);
+
+/**
+ * @brief Despierta a los lectores bloqueados, sincroniza y cierra los segmentos (sin borrarlos).
+ * @param wal WAL.
+ */
+void wal_close(Wal* wal);
+
+#endif // WAL_H
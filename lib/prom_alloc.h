@@ -28,21 +28,29 @@ limitations under the License.
 /**
  * @brief Redefine this macro if you wish to override it. The default value is malloc.
  */
+#ifndef prom_malloc
 #define prom_malloc malloc
+#endif
 
 /**
  * @brief Redefine this macro if you wish to override it. The default value is realloc.
  */
+#ifndef prom_realloc
 #define prom_realloc realloc
+#endif
 
 /**
  * @brief Redefine this macro if you wish to override it. The default value is strdup.
  */
+#ifndef prom_strdup
 #define prom_strdup strdup
+#endif
 
 /**
  * @brief Redefine this macro if you wish to override it. The default value is free.
  */
+#ifndef prom_free
 #define prom_free free
+#endif
 
 #endif  // PROM_ALLOC_H
@@ -0,0 +1,233 @@
+#include "../include/arena.h"
+#include <stdatomic.h>
+
+/**
+ * @brief Alineación de cada asignación.
+ */
+#define ARENA_ALIGNMENT 16
+
+/**
+ * @brief Encabezado de cada asignación: guarda el tamaño para prom_realloc.
+ */
+#define ARENA_HEADER_SIZE ARENA_ALIGNMENT
+
+/**
+ * @brief Redondea hacia arriba a la alineación de la arena.
+ */
+#define ARENA_ALIGN(size) (((size) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+/**
+ * @struct ArenaChunk
+ * @brief Bloque contiguo del que se asigna incrementando `used`.
+ */
+struct ArenaChunk
+{
+    ArenaChunk* next;   /**< Siguiente bloque de la arena. */
+    size_t size;        /**< Bytes utilizables en `data`. */
+    size_t used;        /**< Bytes asignados desde el último reinicio. */
+    max_align_t data[]; /**< Memoria de las asignaciones. */
+};
+
+/** Arena activa del hilo, usada por los hooks */
+static _Thread_local Arena* active_arena;
+
+/** Asignaciones servidas por arenas */
+static atomic_uint_fast64_t arena_allocations;
+
+/** Asignaciones de los hooks que fueron a libc */
+static atomic_uint_fast64_t libc_allocations;
+
+/** Bloques pedidos a libc */
+static atomic_uint_fast64_t chunk_allocations;
+
+/** Reinicios de arenas */
+static atomic_uint_fast64_t resets;
+
+void arena_init(Arena* arena, size_t chunk_size)
+{
+    arena->head = NULL;
+    arena->current = NULL;
+    arena->chunk_size = chunk_size ? chunk_size : ARENA_DEFAULT_CHUNK_SIZE;
+    arena->allocations = 0;
+}
+
+void arena_destroy(Arena* arena)
+{
+    ArenaChunk* chunk = arena->head;
+    while (chunk != NULL)
+    {
+        ArenaChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena_init(arena, arena->chunk_size);
+}
+
+/**
+ * @brief Pasa al siguiente bloque con al menos `need` bytes, reservando uno nuevo si no hay.
+ * @param arena Arena.
+ * @param need Bytes requeridos.
+ * @return Bloque vacío con espacio suficiente, o NULL si no hay memoria.
+ */
+static ArenaChunk* next_chunk(Arena* arena, size_t need)
+{
+    // Los bloques que quedaron de usos anteriores se reutilizan en orden
+    ArenaChunk* tail = arena->current;
+    for (ArenaChunk* chunk = tail ? tail->next : arena->head; chunk != NULL; chunk = chunk->next)
+    {
+        chunk->used = 0;
+        arena->current = chunk;
+        tail = chunk;
+        if (need <= chunk->size)
+        {
+            return chunk;
+        }
+    }
+
+    size_t size = need > arena->chunk_size ? need : arena->chunk_size;
+    ArenaChunk* chunk = malloc(sizeof(ArenaChunk) + size);
+    if (chunk == NULL)
+    {
+        return NULL;
+    }
+    atomic_fetch_add_explicit(&chunk_allocations, 1, memory_order_relaxed);
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    if (tail == NULL)
+    {
+        arena->head = chunk;
+    }
+    else
+    {
+        tail->next = chunk;
+    }
+    arena->current = chunk;
+    return chunk;
+}
+
+void* arena_alloc(Arena* arena, size_t size)
+{
+    size_t need = ARENA_HEADER_SIZE + ARENA_ALIGN(size);
+    ArenaChunk* chunk = arena->current;
+    if (chunk == NULL || chunk->used + need > chunk->size)
+    {
+        chunk = next_chunk(arena, need);
+        if (chunk == NULL)
+        {
+            return NULL;
+        }
+    }
+
+    char* block = (char*)chunk->data + chunk->used;
+    chunk->used += need;
+    *(size_t*)block = size;
+    arena->allocations++;
+    atomic_fetch_add_explicit(&arena_allocations, 1, memory_order_relaxed);
+    return block + ARENA_HEADER_SIZE;
+}
+
+void arena_reset(Arena* arena)
+{
+    arena->current = arena->head;
+    if (arena->head != NULL)
+    {
+        arena->head->used = 0;
+    }
+    arena->allocations = 0;
+    atomic_fetch_add_explicit(&resets, 1, memory_order_relaxed);
+}
+
+int arena_owns(const Arena* arena, const void* ptr)
+{
+    for (const ArenaChunk* chunk = arena->head; chunk != NULL; chunk = chunk->next)
+    {
+        const char* data = (const char*)chunk->data;
+        if ((const char*)ptr >= data && (const char*)ptr < data + chunk->size)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+Arena* arena_activate(Arena* arena)
+{
+    Arena* previous = active_arena;
+    active_arena = arena;
+    return previous;
+}
+
+void* arena_hook_malloc(size_t size)
+{
+    if (active_arena != NULL)
+    {
+        return arena_alloc(active_arena, size);
+    }
+    atomic_fetch_add_explicit(&libc_allocations, 1, memory_order_relaxed);
+    return malloc(size);
+}
+
+void* arena_hook_realloc(void* ptr, size_t size)
+{
+    Arena* arena = active_arena;
+    if (ptr == NULL)
+    {
+        return arena_hook_malloc(size);
+    }
+    if (arena == NULL || !arena_owns(arena, ptr))
+    {
+        atomic_fetch_add_explicit(&libc_allocations, 1, memory_order_relaxed);
+        return realloc(ptr, size);
+    }
+
+    size_t* header = (size_t*)((char*)ptr - ARENA_HEADER_SIZE);
+    size_t old_size = *header;
+    ArenaChunk* chunk = arena->current;
+
+    // La última asignación del bloque actual crece sin copiar
+    char* end = (char*)ptr + ARENA_ALIGN(old_size);
+    if (chunk != NULL && end == (char*)chunk->data + chunk->used &&
+        (size_t)((char*)ptr - (char*)chunk->data) + ARENA_ALIGN(size) <= chunk->size)
+    {
+        chunk->used = (size_t)((char*)ptr - (char*)chunk->data) + ARENA_ALIGN(size);
+        *header = size;
+        return ptr;
+    }
+
+    void* moved = arena_alloc(arena, size);
+    if (moved != NULL)
+    {
+        memcpy(moved, ptr, old_size < size ? old_size : size);
+    }
+    return moved;
+}
+
+char* arena_hook_strdup(const char* str)
+{
+    size_t len = strlen(str) + 1;
+    char* copy = arena_hook_malloc(len);
+    if (copy != NULL)
+    {
+        memcpy(copy, str, len);
+    }
+    return copy;
+}
+
+void arena_hook_free(void* ptr)
+{
+    // La memoria de la arena se recupera entera en arena_reset
+    if (ptr == NULL || (active_arena != NULL && arena_owns(active_arena, ptr)))
+    {
+        return;
+    }
+    free(ptr);
+}
+
+void arena_stats(ArenaStats* stats)
+{
+    stats->arena_allocations = atomic_load_explicit(&arena_allocations, memory_order_relaxed);
+    stats->libc_allocations = atomic_load_explicit(&libc_allocations, memory_order_relaxed);
+    stats->chunk_allocations = atomic_load_explicit(&chunk_allocations, memory_order_relaxed);
+    stats->resets = atomic_load_explicit(&resets, memory_order_relaxed);
+}
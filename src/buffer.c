@@ -0,0 +1,108 @@
+#include "../include/buffer.h"
+#include "../include/arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Capacidad mínima reservada en el primer crecimiento.
+ */
+#define BUFFER_MIN_CAPACITY 256
+
+void buffer_init(Buffer* buffer)
+{
+    buffer->data = NULL;
+    buffer->len = 0;
+    buffer->capacity = 0;
+}
+
+void buffer_free(Buffer* buffer)
+{
+    prom_free(buffer->data);
+    buffer_init(buffer);
+}
+
+void buffer_reset(Buffer* buffer)
+{
+    buffer->len = 0;
+    if (buffer->data != NULL)
+    {
+        buffer->data[0] = '\0';
+    }
+}
+
+int buffer_reserve(Buffer* buffer, size_t extra)
+{
+    size_t needed = buffer->len + extra + 1;
+    if (needed <= buffer->capacity)
+    {
+        return 0;
+    }
+
+    // Crecimiento geométrico para amortizar las copias
+    size_t capacity = buffer->capacity ? buffer->capacity : BUFFER_MIN_CAPACITY;
+    while (capacity < needed)
+    {
+        capacity *= 2;
+    }
+
+    char* data = prom_realloc(buffer->data, capacity);
+    if (data == NULL)
+    {
+        return -1;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return 0;
+}
+
+int buffer_append(Buffer* buffer, const void* data, size_t len)
+{
+    if (buffer_reserve(buffer, len) != 0)
+    {
+        return -1;
+    }
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+    buffer->data[buffer->len] = '\0';
+    return 0;
+}
+
+int buffer_append_str(Buffer* buffer, const char* str)
+{
+    return buffer_append(buffer, str, strlen(str));
+}
+
+int buffer_append_char(Buffer* buffer, char c)
+{
+    return buffer_append(buffer, &c, 1);
+}
+
+int buffer_printf(Buffer* buffer, const char* fmt, ...)
+{
+    va_list args;
+
+    // Primer intento en el espacio libre; si no alcanza, se reserva lo justo y se repite
+    size_t available = buffer->capacity > buffer->len ? buffer->capacity - buffer->len : 0;
+    va_start(args, fmt);
+    int written = vsnprintf(available ? buffer->data + buffer->len : NULL, available, fmt, args);
+    va_end(args);
+    if (written < 0)
+    {
+        return -1;
+    }
+
+    if ((size_t)written >= available)
+    {
+        if (buffer_reserve(buffer, (size_t)written) != 0)
+        {
+            return -1;
+        }
+        va_start(args, fmt);
+        vsnprintf(buffer->data + buffer->len, (size_t)written + 1, fmt, args);
+        va_end(args);
+    }
+
+    buffer->len += (size_t)written;
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "../include/cbor.h"
+#include <string.h>
+
+/**
+ * @brief Tipo mayor de los enteros sin signo.
+ */
+#define CBOR_MAJOR_UINT 0
+
+/**
+ * @brief Tipo mayor de las cadenas de texto.
+ */
+#define CBOR_MAJOR_TEXT 3
+
+/**
+ * @brief Tipo mayor de los mapas.
+ */
+#define CBOR_MAJOR_MAP 5
+
+/**
+ * @brief Byte inicial de un real de 64 bits (tipo mayor 7, información adicional 27).
+ */
+#define CBOR_FLOAT64 0xfb
+
+/**
+ * @brief Valor simple false (tipo mayor 7, información adicional 20); true es el siguiente.
+ */
+#define CBOR_FALSE 0xf4
+
+/**
+ * @brief Valor simple null (tipo mayor 7, información adicional 22).
+ */
+#define CBOR_NULL 0xf6
+
+/**
+ * @brief Agrega `value` en big-endian con `bytes` bytes.
+ * @param out Buffer destino.
+ * @param value Valor.
+ * @param bytes 1, 2, 4 u 8.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int append_big_endian(Buffer* out, uint64_t value, int bytes)
+{
+    unsigned char data[8];
+    for (int i = 0; i < bytes; i++)
+    {
+        data[i] = (unsigned char)(value >> (8 * (bytes - 1 - i)));
+    }
+    return buffer_append(out, data, (size_t)bytes);
+}
+
+/**
+ * @brief Agrega el byte inicial de un elemento y su argumento con la codificación más corta.
+ * @param out Buffer destino.
+ * @param major Tipo mayor.
+ * @param argument Valor, longitud o cantidad de pares.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int append_head(Buffer* out, int major, uint64_t argument)
+{
+    unsigned char initial = (unsigned char)(major << 5);
+    if (argument < 24)
+    {
+        return buffer_append_char(out, (char)(initial | argument));
+    }
+    int bytes = argument <= 0xff ? 1 : argument <= 0xffff ? 2 : argument <= 0xffffffffULL ? 4 : 8;
+    // Información adicional 24..27: el argumento sigue en 1, 2, 4 u 8 bytes
+    int additional = bytes == 1 ? 24 : bytes == 2 ? 25 : bytes == 4 ? 26 : 27;
+    if (buffer_append_char(out, (char)(initial | additional)) != 0)
+    {
+        return -1;
+    }
+    return append_big_endian(out, argument, bytes);
+}
+
+int cbor_map(Buffer* out, uint64_t pairs)
+{
+    return append_head(out, CBOR_MAJOR_MAP, pairs);
+}
+
+int cbor_text(Buffer* out, const char* text)
+{
+    size_t len = strlen(text);
+    if (append_head(out, CBOR_MAJOR_TEXT, len) != 0)
+    {
+        return -1;
+    }
+    return buffer_append(out, text, len);
+}
+
+int cbor_uint(Buffer* out, uint64_t value)
+{
+    return append_head(out, CBOR_MAJOR_UINT, value);
+}
+
+int cbor_double(Buffer* out, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if (buffer_append_char(out, (char)CBOR_FLOAT64) != 0)
+    {
+        return -1;
+    }
+    return append_big_endian(out, bits, 8);
+}
+
+int cbor_bool(Buffer* out, int value)
+{
+    return buffer_append_char(out, (char)(CBOR_FALSE + (value != 0)));
+}
+
+int cbor_null(Buffer* out)
+{
+    return buffer_append_char(out, (char)CBOR_NULL);
+}
@@ -0,0 +1,245 @@
+#include "../include/collection.h"
+#include <pthread.h>
+#include <time.h>
+
+/**
+ * @struct CollectCallback
+ * @brief Función de recolección registrada con su argumento.
+ */
+typedef struct
+{
+    CollectFn* fn; /**< Función a invocar. */
+    void* arg;     /**< Argumento de la función. */
+} CollectCallback;
+
+/**
+ * @struct PublishCallback
+ * @brief Función a invocar tras cada publicación, con su argumento.
+ */
+typedef struct
+{
+    PublishFn* fn; /**< Función a invocar. */
+    void* arg;     /**< Argumento de la función. */
+} PublishCallback;
+
+/** Funciones registradas */
+static CollectCallback callbacks[COLLECTION_MAX_CALLBACKS];
+
+/** Cantidad de funciones registradas */
+static int callback_count;
+
+/** Funciones a invocar tras cada publicación */
+static PublishCallback publish_callbacks[COLLECTION_MAX_CALLBACKS];
+
+/** Cantidad de funciones de publicación registradas */
+static int publish_callback_count;
+
+/** Protege el estado de la recolección en curso */
+static pthread_mutex_t collection_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Señala el fin de cada recolección a los scrapes que la esperan */
+static pthread_cond_t collection_done = PTHREAD_COND_INITIALIZER;
+
+/** Hay una recolección en curso */
+static int collecting;
+
+/** Cantidad de recolecciones terminadas */
+static uint64_t completed;
+
+/** Inicio de la última recolección (CLOCK_MONOTONIC, ns); 0 si nunca hubo una */
+static uint64_t last_start_ns;
+
+/** Recolecciones ejecutadas, por disparador */
+static MetricSeries collections_metric[2] = {METRIC_SERIES_INVALID, METRIC_SERIES_INVALID};
+
+/** Scrapes que compartieron una recolección en curso */
+static MetricSeries coalesced_metric = METRIC_SERIES_INVALID;
+
+/** Scrapes servidos sin recolectar por el intervalo mínimo */
+static MetricSeries throttled_metric = METRIC_SERIES_INVALID;
+
+/** Duración de la última recolección */
+static MetricSeries duration_metric = METRIC_SERIES_INVALID;
+
+/** Memoria temporal de las funciones de recolección; se reinicia al terminar cada ciclo */
+static Arena cycle_arena;
+
+/** Asignaciones de los hooks de prom_alloc.h, por origen (arena o libc) */
+static MetricSeries allocations_metric[2] = {METRIC_SERIES_INVALID, METRIC_SERIES_INVALID};
+
+/** Bloques pedidos a libc por las arenas */
+static MetricSeries arena_chunks_metric = METRIC_SERIES_INVALID;
+
+/**
+ * @brief Lee el reloj monotónico.
+ * @return Nanosegundos desde un origen arbitrario.
+ */
+static uint64_t monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int collection_init()
+{
+    int collections = metric_store_add_family("metrics_collections_total", "Recolecciones de métricas ejecutadas",
+                                              METRIC_TYPE_COUNTER);
+    if (collections < 0)
+    {
+        return -1;
+    }
+    collections_metric[COLLECTION_MODE_INTERVAL] = metric_store_add_series(collections, "{trigger=\"interval\"}");
+    collections_metric[COLLECTION_MODE_SCRAPE] = metric_store_add_series(collections, "{trigger=\"scrape\"}");
+    coalesced_metric = metric_store_register("metrics_collections_coalesced_total",
+                                             "Scrapes que compartieron una recolección en curso", METRIC_TYPE_COUNTER);
+    throttled_metric =
+        metric_store_register("metrics_collections_throttled_total",
+                              "Scrapes servidos sin recolectar por el intervalo mínimo", METRIC_TYPE_COUNTER);
+    duration_metric = metric_store_register("metrics_collection_duration_seconds",
+                                            "Duración de la última recolección", METRIC_TYPE_GAUGE);
+    if (collections_metric[COLLECTION_MODE_INTERVAL] == METRIC_SERIES_INVALID ||
+        collections_metric[COLLECTION_MODE_SCRAPE] == METRIC_SERIES_INVALID ||
+        coalesced_metric == METRIC_SERIES_INVALID || throttled_metric == METRIC_SERIES_INVALID ||
+        duration_metric == METRIC_SERIES_INVALID)
+    {
+        return -1;
+    }
+
+    int allocations = metric_store_add_family("memory_hook_allocations_total",
+                                              "Asignaciones por los hooks de prom_alloc.h", METRIC_TYPE_COUNTER);
+    if (allocations < 0)
+    {
+        return -1;
+    }
+    allocations_metric[0] = metric_store_add_series(allocations, "{source=\"arena\"}");
+    allocations_metric[1] = metric_store_add_series(allocations, "{source=\"libc\"}");
+    arena_chunks_metric = metric_store_register("memory_arena_chunk_allocations_total",
+                                                "Bloques pedidos a libc por las arenas", METRIC_TYPE_COUNTER);
+    if (allocations_metric[0] == METRIC_SERIES_INVALID || allocations_metric[1] == METRIC_SERIES_INVALID ||
+        arena_chunks_metric == METRIC_SERIES_INVALID)
+    {
+        return -1;
+    }
+    arena_init(&cycle_arena, ARENA_DEFAULT_CHUNK_SIZE);
+
+    metric_store_stage_add(collections_metric[COLLECTION_MODE_INTERVAL], 0.0);
+    metric_store_stage_add(collections_metric[COLLECTION_MODE_SCRAPE], 0.0);
+    metric_store_stage_add(coalesced_metric, 0.0);
+    metric_store_stage_add(throttled_metric, 0.0);
+    return 0;
+}
+
+int collection_add_callback(CollectFn* fn, void* arg)
+{
+    pthread_mutex_lock(&collection_lock);
+    if (callback_count == COLLECTION_MAX_CALLBACKS)
+    {
+        pthread_mutex_unlock(&collection_lock);
+        fprintf(stderr, "Error: demasiadas funciones de recolección registradas\n");
+        return -1;
+    }
+    callbacks[callback_count].fn = fn;
+    callbacks[callback_count].arg = arg;
+    callback_count++;
+    pthread_mutex_unlock(&collection_lock);
+    return 0;
+}
+
+int collection_add_publish_callback(PublishFn* fn, void* arg)
+{
+    pthread_mutex_lock(&collection_lock);
+    if (publish_callback_count == COLLECTION_MAX_CALLBACKS)
+    {
+        pthread_mutex_unlock(&collection_lock);
+        fprintf(stderr, "Error: demasiadas funciones de publicación registradas\n");
+        return -1;
+    }
+    publish_callbacks[publish_callback_count].fn = fn;
+    publish_callbacks[publish_callback_count].arg = arg;
+    publish_callback_count++;
+    pthread_mutex_unlock(&collection_lock);
+    return 0;
+}
+
+/**
+ * @brief Ejecuta o comparte una recolección.
+ *
+ * @param trigger Disparador, para el contador de recolecciones.
+ * @param min_interval_ns Edad mínima de la última recolección para ejecutar otra; 0 sin límite.
+ */
+static void collect(CollectionMode trigger, uint64_t min_interval_ns)
+{
+    pthread_mutex_lock(&collection_lock);
+
+    // Una recolección en curso sirve a todos los que llegan mientras tanto
+    if (collecting)
+    {
+        uint64_t target = completed;
+        while (completed == target)
+        {
+            pthread_cond_wait(&collection_done, &collection_lock);
+        }
+        pthread_mutex_unlock(&collection_lock);
+        metric_store_stage_add(coalesced_metric, 1.0);
+        return;
+    }
+
+    uint64_t start = monotonic_ns();
+    if (min_interval_ns > 0 && last_start_ns != 0 && start - last_start_ns < min_interval_ns)
+    {
+        pthread_mutex_unlock(&collection_lock);
+        metric_store_stage_add(throttled_metric, 1.0);
+        return;
+    }
+    collecting = 1;
+    last_start_ns = start;
+    int count = callback_count;
+    int publish_count = publish_callback_count;
+    pthread_mutex_unlock(&collection_lock);
+
+    // Solo este hilo escribe en el buffer trasero hasta publicar; lo temporal va a la arena del ciclo
+    Arena* previous = arena_activate(&cycle_arena);
+    for (int i = 0; i < count; i++)
+    {
+        callbacks[i].fn(callbacks[i].arg);
+    }
+    arena_activate(previous);
+    arena_reset(&cycle_arena);
+
+    ArenaStats stats;
+    arena_stats(&stats);
+    metric_store_set(allocations_metric[0], (double)stats.arena_allocations);
+    metric_store_set(allocations_metric[1], (double)stats.libc_allocations);
+    metric_store_set(arena_chunks_metric, (double)stats.chunk_allocations);
+    metric_store_stage_add(collections_metric[trigger], 1.0);
+    metric_store_set(duration_metric, (double)(monotonic_ns() - start) / 1e9);
+    uint64_t generation = metric_store_publish();
+
+    // Nadie más publica hasta liberar `collecting`: el buffer frontal queda fijo para estas funciones
+    for (int i = 0; i < publish_count; i++)
+    {
+        publish_callbacks[i].fn(generation, publish_callbacks[i].arg);
+    }
+
+    pthread_mutex_lock(&collection_lock);
+    collecting = 0;
+    completed++;
+    pthread_cond_broadcast(&collection_done);
+    pthread_mutex_unlock(&collection_lock);
+}
+
+void collection_run()
+{
+    collect(COLLECTION_MODE_INTERVAL, 0);
+}
+
+void collection_on_scrape()
+{
+    CollectionConfig config = config_current_collection();
+    if (config.mode != COLLECTION_MODE_SCRAPE)
+    {
+        return;
+    }
+    collect(COLLECTION_MODE_SCRAPE, (uint64_t)config.min_interval_ms * 1000000ULL);
+}
@@ -0,0 +1,169 @@
+#include "../include/collector_plan.h"
+#include "../include/metrics.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief Mide los bytes de la interfaz de red monitoreada.
+ * @return Bytes, o negativo en caso de error.
+ */
+static double read_network_usage()
+{
+    return get_network_usage("lo");
+}
+
+/**
+ * @brief Mide la cantidad de procesos en ejecución.
+ * @return Procesos, o negativo en caso de error.
+ */
+static double read_process_usage()
+{
+    return get_process_usage();
+}
+
+/** Métricas del sistema, indexadas por CollectorId; el orden es el de ejecución */
+static const CollectorDescriptor collectors[COLLECTOR_COUNT] = {
+    [COLLECTOR_CPU] = {"cpu_usage_percentage", "Porcentaje de uso de CPU", "Error al obtener el uso de CPU",
+                       offsetof(MetricsConfig, cpu), offsetof(MetricsSample, cpu_usage), get_cpu_usage},
+    [COLLECTOR_MEMORY] = {"memory_usage_percentage", "Porcentaje de uso de memoria",
+                          "Error al obtener el uso de memoria", offsetof(MetricsConfig, memory),
+                          offsetof(MetricsSample, memory_usage), get_memory_usage},
+    [COLLECTOR_MEMORY_FRAGMENTATION] = {"memory_fragmentation_percentage", "Porcentaje de memoria fragmentada",
+                                        "Error al obtener la memoria fragmentada", offsetof(MetricsConfig, memory),
+                                        COLLECTOR_NO_SAMPLE, get_memory_fragmentation},
+    [COLLECTOR_DISK] = {"disk_usage", "Lecturas y escrituras totales completadas del disco",
+                        "Error al obtener el uso de disco", offsetof(MetricsConfig, disk),
+                        offsetof(MetricsSample, disk_usage), get_disk_usage},
+    [COLLECTOR_NETWORK] = {"network_usage_metric", "Bytes totales enviados por la interfaz de red",
+                           "Error al obtener el uso de red", offsetof(MetricsConfig, network),
+                           offsetof(MetricsSample, network_usage), read_network_usage},
+    [COLLECTOR_PROCESSES] = {"procs_usage_count", "Cantidad de procesos en ejecucion",
+                             "Error al obtener el numero de procesos", offsetof(MetricsConfig, processes),
+                             offsetof(MetricsSample, process_count), read_process_usage},
+    [COLLECTOR_CONTEXT_SWITCHES] = {"ctxt_usage_count", "Cantidad de cambios de contexto",
+                                    "Error al obtener el numero de cambios de contexto",
+                                    offsetof(MetricsConfig, context_switches),
+                                    offsetof(MetricsSample, context_switches), get_ctxt_usage},
+};
+
+/** Serie del almacén de cada métrica, indexada por CollectorId */
+static MetricSeries collector_series[COLLECTOR_COUNT] = {
+    METRIC_SERIES_INVALID, METRIC_SERIES_INVALID, METRIC_SERIES_INVALID, METRIC_SERIES_INVALID,
+    METRIC_SERIES_INVALID, METRIC_SERIES_INVALID, METRIC_SERIES_INVALID,
+};
+
+/**
+ * @brief Indica si una configuración habilita una métrica.
+ * @param config Configuración.
+ * @param collector Descriptor.
+ * @return Distinto de 0 si está habilitada.
+ */
+static int collector_enabled(const MetricsConfig* config, const CollectorDescriptor* collector)
+{
+    int enabled;
+    memcpy(&enabled, (const char*)config + collector->config_offset, sizeof(enabled));
+    return enabled;
+}
+
+/**
+ * @brief Mide una métrica y deja el valor en su serie.
+ * @param collector Descriptor.
+ * @return Valor medido, o negativo si la medición falló.
+ */
+static double run_collector(const CollectorDescriptor* collector)
+{
+    double value = collector->read();
+    if (value >= 0)
+    {
+        metric_store_set(collector_series[collector - collectors], value);
+    }
+    else
+    {
+        fprintf(stderr, "%s\n", collector->error);
+    }
+    return value;
+}
+
+int collector_plan_init()
+{
+    int ret = 0;
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+    {
+        collector_series[i] = metric_store_register(collectors[i].family, collectors[i].help, METRIC_TYPE_GAUGE);
+        if (collector_series[i] == METRIC_SERIES_INVALID)
+        {
+            fprintf(stderr, "Error al crear la métrica %s\n", collectors[i].family);
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+const CollectorDescriptor* collector_descriptor(CollectorId id)
+{
+    return &collectors[id];
+}
+
+MetricSeries collector_series_of(CollectorId id)
+{
+    return collector_series[id];
+}
+
+void collector_plan_compile(CollectorPlan* plan, const MetricsConfig* config)
+{
+    // Las que dejan de medirse se marcan ausentes una vez; el almacén conserva el valor entre ciclos
+    for (size_t i = 0; i < plan->count; i++)
+    {
+        if (!collector_enabled(config, plan->steps[i]))
+        {
+            metric_store_clear(collector_series[plan->steps[i] - collectors]);
+        }
+    }
+
+    plan->config = *config;
+    plan->count = 0;
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+    {
+        if (collector_enabled(config, &collectors[i]))
+        {
+            plan->steps[plan->count++] = &collectors[i];
+        }
+    }
+}
+
+double collector_run_one(CollectorId id)
+{
+    return run_collector(&collectors[id]);
+}
+
+void collector_plan_run(const CollectorPlan* plan)
+{
+    for (size_t i = 0; i < plan->count; i++)
+    {
+        run_collector(plan->steps[i]);
+    }
+}
+
+void collector_plan_current_sample(MetricsSample* sample)
+{
+    double values[COLLECTOR_COUNT];
+    uint64_t generation;
+    do
+    {
+        const double* store;
+        generation = metric_store_read_begin(&store);
+        for (int i = 0; i < COLLECTOR_COUNT; i++)
+        {
+            values[i] = collector_series[i] == METRIC_SERIES_INVALID ? NAN : store[collector_series[i]];
+        }
+    } while (!metric_store_read_valid(generation));
+
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+    {
+        if (collectors[i].sample_offset != COLLECTOR_NO_SAMPLE)
+        {
+            memcpy((char*)sample + collectors[i].sample_offset, &values[i], sizeof(values[i]));
+        }
+    }
+}
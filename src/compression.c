@@ -0,0 +1,175 @@
+#include "../include/compression.h"
+#include "../include/arena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/**
+ * @brief Bits de ventana de zlib para producir formato gzip en lugar de zlib.
+ */
+#define GZIP_WINDOW_BITS (15 + 16)
+
+/**
+ * @brief Asignador de zlib sobre los hooks de prom_alloc.h (arena activa o libc).
+ */
+static voidpf zlib_alloc(voidpf opaque, uInt items, uInt size)
+{
+    (void)opaque;
+    return prom_malloc((size_t)items * size);
+}
+
+/**
+ * @brief Liberador de zlib sobre los hooks de prom_alloc.h.
+ */
+static void zlib_free(voidpf opaque, voidpf ptr)
+{
+    (void)opaque;
+    prom_free(ptr);
+}
+
+const char* content_encoding_name(ContentEncoding encoding)
+{
+    switch (encoding)
+    {
+    case CONTENT_ENCODING_GZIP:
+        return "gzip";
+    case CONTENT_ENCODING_ZSTD:
+        return "zstd";
+    default:
+        return "identity";
+    }
+}
+
+ContentEncoding negotiate_content_encoding(const char* accept_encoding, unsigned enabled)
+{
+    double best_q = 0.0;
+    ContentEncoding best = CONTENT_ENCODING_IDENTITY;
+
+    if (accept_encoding == NULL)
+    {
+        return best;
+    }
+
+    const char* cursor = accept_encoding;
+    while (*cursor != '\0')
+    {
+        while (*cursor == ' ' || *cursor == ',')
+        {
+            cursor++;
+        }
+        const char* token = cursor;
+        while (*cursor != '\0' && *cursor != ',' && *cursor != ';' && *cursor != ' ')
+        {
+            cursor++;
+        }
+        size_t token_len = (size_t)(cursor - token);
+
+        // Parámetros del token: solo interesa q
+        double q = 1.0;
+        while (*cursor != '\0' && *cursor != ',')
+        {
+            if (*cursor == 'q' && cursor[1] == '=')
+            {
+                q = strtod(cursor + 2, NULL);
+            }
+            cursor++;
+        }
+
+        ContentEncoding candidate = CONTENT_ENCODING_IDENTITY;
+        if (token_len == 4 && strncasecmp(token, "gzip", 4) == 0)
+        {
+            candidate = CONTENT_ENCODING_GZIP;
+        }
+        else if (token_len == 4 && strncasecmp(token, "zstd", 4) == 0)
+        {
+            candidate = CONTENT_ENCODING_ZSTD;
+        }
+        if (candidate == CONTENT_ENCODING_IDENTITY || !(enabled & (1u << candidate)) || q <= 0.0)
+        {
+            continue;
+        }
+
+        if (q > best_q || (q == best_q && candidate == CONTENT_ENCODING_ZSTD))
+        {
+            best_q = q;
+            best = candidate;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * @brief Comprime en formato gzip con zlib.
+ */
+static int compress_gzip(int level, const char* data, size_t len, Buffer* out)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.zalloc = zlib_alloc;
+    stream.zfree = zlib_free;
+    if (deflateInit2(&stream, level, Z_DEFLATED, GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return -1;
+    }
+
+    uLong bound = deflateBound(&stream, (uLong)len);
+    if (buffer_reserve(out, bound) != 0)
+    {
+        deflateEnd(&stream);
+        return -1;
+    }
+
+    stream.next_in = (Bytef*)data;
+    stream.avail_in = (uInt)len;
+    stream.next_out = (Bytef*)out->data;
+    stream.avail_out = (uInt)bound;
+
+    int ret = deflate(&stream, Z_FINISH);
+    out->len = stream.total_out;
+    deflateEnd(&stream);
+    return ret == Z_STREAM_END ? 0 : -1;
+}
+
+#ifdef HAVE_ZSTD
+/**
+ * @brief Comprime en formato Zstandard.
+ */
+static int compress_zstd(int level, const char* data, size_t len, Buffer* out)
+{
+    size_t bound = ZSTD_compressBound(len);
+    if (buffer_reserve(out, bound) != 0)
+    {
+        return -1;
+    }
+
+    size_t written = ZSTD_compress(out->data, bound, data, len, level);
+    if (ZSTD_isError(written))
+    {
+        return -1;
+    }
+    out->len = written;
+    return 0;
+}
+#endif
+
+int compress_buffer(ContentEncoding encoding, int level, const char* data, size_t len, Buffer* out)
+{
+    buffer_reset(out);
+
+    switch (encoding)
+    {
+    case CONTENT_ENCODING_GZIP:
+        return compress_gzip(level, data, len, out);
+#ifdef HAVE_ZSTD
+    case CONTENT_ENCODING_ZSTD:
+        return compress_zstd(level, data, len, out);
+#endif
+    default:
+        return -1;
+    }
+}
@@ -1,154 +1,1282 @@
 #include "../include/config.h"
-#include "../include/metrics.h"
+#include "../include/collector_plan.h"
+#include "../include/json_writer.h"
+#include "../include/monitor_fifo.h"
+#include <errno.h>
+#include <libgen.h>
+#include <math.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <time.h>
 
-MetricsConfig read_metrics_config(const char* config_file)
+/**
+ * @brief Tamaño del buffer para leer eventos de inotify.
+ */
+#define INOTIFY_BUFFER_SIZE 4096
+
+/** Ruta absoluta del archivo de configuración */
+static char config_path[PATH_MAX];
+
+/** Snapshot publicado actualmente */
+static _Atomic(ConfigSnapshot*) current_snapshot;
+
+/** Época de lectura vigente (0 o 1) */
+static atomic_uint read_epoch;
+
+/** Cantidad de lectores activos en cada época */
+static atomic_uint active_readers[2];
+
+/** Serializa las recargas entre SIGHUP, inotify y llamadas directas */
+static pthread_mutex_t reload_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Lee y parsea un archivo JSON completo.
+ * @param config_file Ruta del archivo.
+ * @return Árbol cJSON (liberar con cJSON_Delete), o NULL en caso de error.
+ */
+static cJSON* load_config_json(const char* config_file)
 {
-    MetricsConfig config = {0, 0, 0, 0, 0, 0};
     FILE* file = fopen(config_file, "r");
     if (!file)
     {
         fprintf(stderr, "Error al abrir el archivo de configuración: %s\n", config_file);
-        return config;
+        return NULL;
     }
 
     fseek(file, 0, SEEK_END);
     long length = ftell(file);
     fseek(file, 0, SEEK_SET);
+    if (length < 0)
+    {
+        fclose(file);
+        return NULL;
+    }
 
     char* data = malloc(length + 1);
-    fread(data, 1, length, file);
+    if (data == NULL)
+    {
+        fclose(file);
+        return NULL;
+    }
+    size_t read = fread(data, 1, length, file);
     fclose(file);
-    data[length] = '\0';
+    data[read] = '\0';
 
     cJSON* json = cJSON_Parse(data);
-    if (json)
+    free(data);
+    if (json == NULL)
+    {
+        fprintf(stderr, "Error al parsear el archivo JSON: %s\n", config_file);
+    }
+    return json;
+}
+
+/**
+ * @brief Lee y valida una clave booleana opcional de una sección.
+ *
+ * @param section Objeto JSON de la sección.
+ * @param section_name Nombre de la sección (para los mensajes de error).
+ * @param key Nombre de la clave.
+ * @param value Destino del valor; no se modifica si la clave no existe.
+ * @return 0 si la clave no existe o es booleana, -1 si tiene otro tipo.
+ */
+static int parse_bool_option(const cJSON* section, const char* section_name, const char* key, int* value)
+{
+    cJSON* item = cJSON_GetObjectItem(section, key);
+    if (item == NULL)
     {
-        // printf("Archivo JSON parseado con éxito.\n");
-        cJSON* metrics = cJSON_GetObjectItem(json, "metrics");
-        if (metrics)
+        return 0;
+    }
+    if (!cJSON_IsBool(item))
+    {
+        fprintf(stderr, "Configuración inválida: '%s.%s' debe ser booleano\n", section_name, key);
+        return -1;
+    }
+    *value = cJSON_IsTrue(item);
+    return 0;
+}
+
+/**
+ * @brief Lee y valida una clave entera opcional de una sección.
+ *
+ * @param section Objeto JSON de la sección.
+ * @param section_name Nombre de la sección (para los mensajes de error).
+ * @param key Nombre de la clave.
+ * @param min Valor mínimo aceptado.
+ * @param max Valor máximo aceptado.
+ * @param value Destino del valor; no se modifica si la clave no existe.
+ * @return 0 si la clave no existe o es válida, -1 si no es un entero dentro del rango.
+ */
+static int parse_int_option(const cJSON* section, const char* section_name, const char* key, long min, long max,
+                            int* value)
+{
+    cJSON* item = cJSON_GetObjectItem(section, key);
+    if (item == NULL)
+    {
+        return 0;
+    }
+
+    double number = cJSON_IsNumber(item) ? cJSON_GetNumberValue(item) : NAN;
+    if (!(number >= min && number <= max) || number != (double)(long)number)
+    {
+        fprintf(stderr, "Configuración inválida: '%s.%s' debe ser un entero entre %ld y %ld\n", section_name, key,
+                min, max);
+        return -1;
+    }
+    *value = (int)number;
+    return 0;
+}
+
+/**
+ * @brief Lee y valida una clave de texto opcional restringida a un conjunto de valores.
+ *
+ * @param section Objeto JSON de la sección.
+ * @param section_name Nombre de la sección (para los mensajes de error).
+ * @param key Nombre de la clave.
+ * @param choices Valores aceptados, terminados en NULL.
+ * @param value Destino del índice del valor en `choices`; no se modifica si la clave no existe.
+ * @return 0 si la clave no existe o es válida, -1 si no es uno de los valores aceptados.
+ */
+static int parse_choice_option(const cJSON* section, const char* section_name, const char* key,
+                               const char* const* choices, int* value)
+{
+    cJSON* item = cJSON_GetObjectItem(section, key);
+    if (item == NULL)
+    {
+        return 0;
+    }
+
+    const char* text = cJSON_IsString(item) ? cJSON_GetStringValue(item) : NULL;
+    for (int i = 0; text != NULL && choices[i] != NULL; i++)
+    {
+        if (strcmp(text, choices[i]) == 0)
         {
-            config.cpu = cJSON_IsTrue(cJSON_GetObjectItem(metrics, "cpu"));
-            config.memory = cJSON_IsTrue(cJSON_GetObjectItem(metrics, "memory"));
-            config.disk = cJSON_IsTrue(cJSON_GetObjectItem(metrics, "disk"));
-            config.network = cJSON_IsTrue(cJSON_GetObjectItem(metrics, "network"));
-            config.processes = cJSON_IsTrue(cJSON_GetObjectItem(metrics, "processes"));
-            config.context_switches = cJSON_IsTrue(cJSON_GetObjectItem(metrics, "context_switches"));
+            *value = i;
+            return 0;
         }
-        else
+    }
+    fprintf(stderr, "Configuración inválida: '%s.%s' no es un valor aceptado\n", section_name, key);
+    return -1;
+}
+
+/**
+ * @brief Parsea la sección obligatoria "metrics".
+ * @param json Raíz del documento.
+ * @param config Destino; las métricas no mencionadas quedan deshabilitadas.
+ * @return 0 si la sección es válida, -1 en caso contrario.
+ */
+static int parse_metrics_section(const cJSON* json, MetricsConfig* config)
+{
+    cJSON* metrics = cJSON_GetObjectItem(json, "metrics");
+    if (!cJSON_IsObject(metrics))
+    {
+        fprintf(stderr, "Objeto 'metrics' no encontrado en JSON.\n");
+        return -1;
+    }
+
+    MetricsConfig parsed = {0, 0, 0, 0, 0, 0};
+    int ret = 0;
+    ret |= parse_bool_option(metrics, "metrics", "cpu", &parsed.cpu);
+    ret |= parse_bool_option(metrics, "metrics", "memory", &parsed.memory);
+    ret |= parse_bool_option(metrics, "metrics", "disk", &parsed.disk);
+    ret |= parse_bool_option(metrics, "metrics", "network", &parsed.network);
+    ret |= parse_bool_option(metrics, "metrics", "processes", &parsed.processes);
+    ret |= parse_bool_option(metrics, "metrics", "context_switches", &parsed.context_switches);
+    if (ret != 0)
+    {
+        return -1;
+    }
+
+    *config = parsed;
+    return 0;
+}
+
+/**
+ * @brief Parsea la sección opcional "exposition".
+ * @param json Raíz del documento.
+ * @param config Destino; conserva los valores por defecto de las claves ausentes.
+ * @return 0 si la sección es válida o no existe, -1 en caso contrario.
+ */
+static int parse_exposition_section(const cJSON* json, ExpositionConfig* config)
+{
+    cJSON* exposition = cJSON_GetObjectItem(json, "exposition");
+    if (exposition == NULL)
+    {
+        return 0;
+    }
+    if (!cJSON_IsObject(exposition))
+    {
+        fprintf(stderr, "Configuración inválida: 'exposition' debe ser un objeto\n");
+        return -1;
+    }
+
+    int ret = 0;
+    ret |= parse_int_option(exposition, "exposition", "gzip_level", 0, 9, &config->gzip_level);
+    ret |= parse_int_option(exposition, "exposition", "zstd_level", 0, 19, &config->zstd_level);
+    return ret;
+}
+
+/**
+ * @brief Lee y valida una clave de texto opcional de una sección.
+ *
+ * @param section Objeto JSON de la sección.
+ * @param section_name Nombre de la sección (para los mensajes de error).
+ * @param key Nombre de la clave.
+ * @param value Destino del texto; no se modifica si la clave no existe.
+ * @param size Tamaño de `value`, incluido el terminador.
+ * @return 0 si la clave no existe o es un texto no vacío que entra en `value`, -1 en caso contrario.
+ */
+static int parse_string_option(const cJSON* section, const char* section_name, const char* key, char* value,
+                               size_t size)
+{
+    cJSON* item = cJSON_GetObjectItem(section, key);
+    if (item == NULL)
+    {
+        return 0;
+    }
+
+    const char* text = cJSON_IsString(item) ? cJSON_GetStringValue(item) : NULL;
+    if (text == NULL || text[0] == '\0' || strlen(text) >= size)
+    {
+        fprintf(stderr, "Configuración inválida: '%s.%s' debe ser un texto de 1 a %zu caracteres\n", section_name,
+                key, size - 1);
+        return -1;
+    }
+    strcpy(value, text);
+    return 0;
+}
+
+/**
+ * @brief Parsea un elemento de "http.listeners".
+ *
+ * Un elemento con "path" es un socket AF_UNIX ("permissions" en octal como texto, p. ej.
+ * "0660"); en otro caso es TCP con "address" numérica (por defecto 0.0.0.0) y "port".
+ *
+ * @param item Objeto JSON del listener.
+ * @param default_port Puerto usado si el listener TCP no indica uno.
+ * @param listener Destino.
+ * @return 0 si el listener es válido, -1 en caso contrario.
+ */
+static int parse_http_listener(const cJSON* item, int default_port, HttpListener* listener)
+{
+    if (!cJSON_IsObject(item))
+    {
+        fprintf(stderr, "Configuración inválida: cada elemento de 'http.listeners' debe ser un objeto\n");
+        return -1;
+    }
+
+    // En cero para que la comparación de snapshots no dependa del relleno
+    memset(listener, 0, sizeof(*listener));
+    int ret = 0;
+    if (cJSON_GetObjectItem(item, "path") != NULL)
+    {
+        char permissions[8] = "";
+        listener->type = HTTP_LISTENER_UNIX;
+        listener->permissions = DEFAULT_HTTP_UNIX_PERMISSIONS;
+        ret |= parse_string_option(item, "http.listeners", "path", listener->address, sizeof(listener->address));
+        ret |= parse_string_option(item, "http.listeners", "permissions", permissions, sizeof(permissions));
+        if (permissions[0] != '\0')
         {
-            printf("Objeto 'metrics' no encontrado en JSON.\n");
+            char* end;
+            long mode = strtol(permissions, &end, 8);
+            if (*end != '\0' || mode < 0 || mode > 0777)
+            {
+                fprintf(stderr,
+                        "Configuración inválida: 'http.listeners.permissions' debe ser octal (p. ej. \"0660\")\n");
+                ret = -1;
+            }
+            listener->permissions = (int)mode;
         }
-        cJSON_Delete(json);
     }
     else
     {
-        printf("Error al parsear el archivo JSON.\n");
+        listener->type = HTTP_LISTENER_TCP;
+        listener->port = default_port;
+        strcpy(listener->address, "0.0.0.0");
+        ret |= parse_string_option(item, "http.listeners", "address", listener->address, sizeof(listener->address));
+        ret |= parse_int_option(item, "http.listeners", "port", 1, 65535, &listener->port);
     }
+    return ret;
+}
 
-    free(data);
-    return config;
+/**
+ * @brief Parsea la sección opcional "http".
+ * @param json Raíz del documento.
+ * @param config Destino; conserva los valores por defecto de las claves ausentes.
+ * @return 0 si la sección es válida o no existe, -1 en caso contrario.
+ */
+static int parse_http_section(const cJSON* json, HttpConfig* config)
+{
+    static const char* const modes[] = {"select", "epoll", "thread_per_connection", NULL};
+
+    cJSON* http = cJSON_GetObjectItem(json, "http");
+    if (http == NULL)
+    {
+        return 0;
+    }
+    if (!cJSON_IsObject(http))
+    {
+        fprintf(stderr, "Configuración inválida: 'http' debe ser un objeto\n");
+        return -1;
+    }
+
+    int mode = (int)config->mode;
+    int port = config->listeners[0].port;
+    int ret = 0;
+    ret |= parse_int_option(http, "http", "port", 1, 65535, &port);
+    ret |= parse_choice_option(http, "http", "mode", modes, &mode);
+    ret |= parse_int_option(http, "http", "threads", 1, 256, &config->threads);
+    ret |= parse_int_option(http, "http", "connection_limit", 1, 65536, &config->connection_limit);
+    ret |= parse_int_option(http, "http", "timeout_seconds", 0, 3600, &config->timeout);
+    config->mode = (HttpServerMode)mode;
+    config->listeners[0].port = port;
+
+    cJSON* listeners = cJSON_GetObjectItem(http, "listeners");
+    if (listeners != NULL)
+    {
+        int count = cJSON_IsArray(listeners) ? cJSON_GetArraySize(listeners) : 0;
+        if (count < 1 || count > HTTP_MAX_LISTENERS)
+        {
+            fprintf(stderr, "Configuración inválida: 'http.listeners' debe ser un arreglo de 1 a %d elementos\n",
+                    HTTP_MAX_LISTENERS);
+            return -1;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            ret |= parse_http_listener(cJSON_GetArrayItem(listeners, i), port, &config->listeners[i]);
+        }
+        config->listener_count = count;
+    }
+    return ret;
 }
 
-char* create_metrics_json(MetricsConfig config)
+/**
+ * @brief Parsea la sección opcional "collection".
+ * @param json Raíz del documento.
+ * @param config Destino; conserva los valores por defecto de las claves ausentes.
+ * @return 0 si la sección es válida o no existe, -1 en caso contrario.
+ */
+static int parse_collection_section(const cJSON* json, CollectionConfig* config)
 {
-    // Crear un objeto cJSON para las métricas
-    cJSON* json = cJSON_CreateObject();
+    static const char* const modes[] = {"interval", "scrape", NULL};
 
-    if (config.cpu)
+    cJSON* collection = cJSON_GetObjectItem(json, "collection");
+    if (collection == NULL)
+    {
+        return 0;
+    }
+    if (!cJSON_IsObject(collection))
     {
-        double cpu_usage = get_cpu_usage();
-        cJSON_AddNumberToObject(json, "cpu_usage", cpu_usage);
+        fprintf(stderr, "Configuración inválida: 'collection' debe ser un objeto\n");
+        return -1;
     }
 
-    if (config.memory)
+    int mode = (int)config->mode;
+    int ret = 0;
+    ret |= parse_choice_option(collection, "collection", "mode", modes, &mode);
+    ret |= parse_int_option(collection, "collection", "min_interval_ms", 0, 60000, &config->min_interval_ms);
+    config->mode = (CollectionMode)mode;
+    return ret;
+}
+
+/**
+ * @brief Parsea la sección opcional "remote_write".
+ * @param json Raíz del documento.
+ * @param config Destino; conserva los valores por defecto de las claves ausentes.
+ * @return 0 si la sección es válida o no existe, -1 en caso contrario.
+ */
+static int parse_remote_write_section(const cJSON* json, RemoteWriteConfig* config)
+{
+    cJSON* remote_write = cJSON_GetObjectItem(json, "remote_write");
+    if (remote_write == NULL)
+    {
+        return 0;
+    }
+    if (!cJSON_IsObject(remote_write))
     {
-        double memory_usage = get_memory_usage();
-        cJSON_AddNumberToObject(json, "memory_usage", memory_usage);
+        fprintf(stderr, "Configuración inválida: 'remote_write' debe ser un objeto\n");
+        return -1;
     }
 
-    if (config.disk)
+    int ret = 0;
+    ret |= parse_string_option(remote_write, "remote_write", "url", config->url, sizeof(config->url));
+    ret |= parse_int_option(remote_write, "remote_write", "max_samples_per_send", 1, 100000,
+                            &config->max_samples_per_send);
+    ret |= parse_int_option(remote_write, "remote_write", "concurrency", 1, 64, &config->concurrency);
+    ret |= parse_int_option(remote_write, "remote_write", "min_backoff_ms", 1, 600000, &config->min_backoff_ms);
+    ret |= parse_int_option(remote_write, "remote_write", "max_backoff_ms", 1, 600000, &config->max_backoff_ms);
+    ret |= parse_int_option(remote_write, "remote_write", "timeout_seconds", 1, 3600, &config->timeout);
+    ret |= parse_string_option(remote_write, "remote_write", "wal_dir", config->wal_dir, sizeof(config->wal_dir));
+    ret |= parse_int_option(remote_write, "remote_write", "wal_segment_kb", 16, 1048576, &config->wal_segment_kb);
+    ret |= parse_int_option(remote_write, "remote_write", "wal_max_segments", 2, 64, &config->wal_max_segments);
+    if (config->url[0] != '\0' && strncmp(config->url, "http://", 7) != 0)
+    {
+        fprintf(stderr, "Configuración inválida: 'remote_write.url' debe empezar con http://\n");
+        ret = -1;
+    }
+    if (config->max_backoff_ms < config->min_backoff_ms)
     {
-        double disk_usage = get_disk_usage();
-        cJSON_AddNumberToObject(json, "disk_usage", disk_usage);
+        fprintf(stderr, "Configuración inválida: 'remote_write.max_backoff_ms' es menor que 'min_backoff_ms'\n");
+        ret = -1;
     }
+    return ret;
+}
 
-    if (config.network)
+/**
+ * @brief Parsea la sección opcional "line_output".
+ * @param json Raíz del documento.
+ * @param config Destino; conserva los valores por defecto de las claves ausentes.
+ * @return 0 si la sección es válida o no existe, -1 en caso contrario.
+ */
+static int parse_line_output_section(const cJSON* json, LineOutputConfig* config)
+{
+    static const char* const protocols[] = {"graphite", "statsd", NULL};
+    static const char* const transports[] = {"udp", "tcp", NULL};
+
+    cJSON* line_output = cJSON_GetObjectItem(json, "line_output");
+    if (line_output == NULL)
+    {
+        return 0;
+    }
+    if (!cJSON_IsObject(line_output))
     {
-        double network_usage = get_network_usage("lo");
-        cJSON_AddNumberToObject(json, "network_usage", network_usage);
+        fprintf(stderr, "Configuración inválida: 'line_output' debe ser un objeto\n");
+        return -1;
     }
 
-    if (config.processes)
+    int protocol = (int)config->protocol;
+    int transport = (int)config->transport;
+    int ret = 0;
+    ret |= parse_choice_option(line_output, "line_output", "protocol", protocols, &protocol);
+    ret |= parse_choice_option(line_output, "line_output", "transport", transports, &transport);
+    ret |= parse_string_option(line_output, "line_output", "address", config->address, sizeof(config->address));
+    ret |= parse_int_option(line_output, "line_output", "port", 1, 65535, &config->port);
+    ret |= parse_string_option(line_output, "line_output", "prefix", config->prefix, sizeof(config->prefix));
+    ret |= parse_int_option(line_output, "line_output", "mtu", 256, 65507, &config->mtu);
+    config->protocol = (LineProtocol)protocol;
+    config->transport = (LineTransport)transport;
+    if (cJSON_GetObjectItem(line_output, "port") == NULL)
     {
-        int process_count = get_process_usage();
-        cJSON_AddNumberToObject(json, "process_count", process_count);
+        config->port = config->protocol == LINE_PROTOCOL_STATSD ? DEFAULT_STATSD_PORT : DEFAULT_GRAPHITE_PORT;
     }
+    return ret;
+}
 
-    if (config.context_switches)
+/**
+ * @brief Parsea la sección opcional "history".
+ * @param json Raíz del documento.
+ * @param config Destino; conserva los valores por defecto de las claves ausentes.
+ * @return 0 si la sección es válida o no existe, -1 en caso contrario.
+ */
+static int parse_history_section(const cJSON* json, HistoryConfig* config)
+{
+    cJSON* history = cJSON_GetObjectItem(json, "history");
+    if (history == NULL)
+    {
+        return 0;
+    }
+    if (!cJSON_IsObject(history))
+    {
+        fprintf(stderr, "Configuración inválida: 'history' debe ser un objeto\n");
+        return -1;
+    }
+
+    int ret = 0;
+    ret |= parse_string_option(history, "history", "path", config->path, sizeof(config->path));
+    ret |= parse_int_option(history, "history", "retention_hours", 1, 24 * 31, &config->retention_hours);
+    ret |= parse_int_option(history, "history", "resolution_seconds", 1, 3600, &config->resolution_seconds);
+    ret |= parse_int_option(history, "history", "max_series", 1, 65536, &config->max_series);
+    return ret;
+}
+
+/**
+ * @brief Parsea la sección opcional "sampler".
+ * @param json Raíz del documento.
+ * @param config Destino; conserva los valores por defecto de las claves ausentes.
+ * @return 0 si la sección es válida o no existe, -1 en caso contrario.
+ */
+static int parse_sampler_section(const cJSON* json, SamplerConfig* config)
+{
+    cJSON* sampler = cJSON_GetObjectItem(json, "sampler");
+    if (sampler == NULL)
+    {
+        return 0;
+    }
+    if (!cJSON_IsObject(sampler))
+    {
+        fprintf(stderr, "Configuración inválida: 'sampler' debe ser un objeto\n");
+        return -1;
+    }
+
+    int ret = 0;
+    ret |= parse_int_option(sampler, "sampler", "rate_hz", 0, SAMPLER_MAX_RATE_HZ, &config->rate_hz);
+    ret |= parse_int_option(sampler, "sampler", "window_seconds", 1, 3600, &config->window_seconds);
+    ret |= parse_bool_option(sampler, "sampler", "cpu", &config->cpu);
+    ret |= parse_bool_option(sampler, "sampler", "run_queue", &config->run_queue);
+    ret |= parse_bool_option(sampler, "sampler", "psi", &config->psi);
+    return ret;
+}
+
+/**
+ * @brief Lee las opciones del modo delta de una sección en streaming.
+ *
+ * "mode" es "full" o "delta", "keyframe_interval" los ciclos entre keyframes y "deadband" un
+ * objeto con la banda muerta (no negativa) de cada familia de las métricas del sistema.
+ *
+ * @param section Objeto JSON de la sección.
+ * @param section_name Nombre de la sección (para los mensajes de error).
+ * @param config Destino; conserva los valores por defecto de las claves ausentes.
+ * @return 0 si las opciones son válidas o no existen, -1 en caso contrario.
+ */
+static int parse_delta_options(const cJSON* section, const char* section_name, DeltaConfig* config)
+{
+    static const char* const modes[] = {"full", "delta", NULL};
+    int ret = 0;
+    ret |= parse_choice_option(section, section_name, "mode", modes, &config->enabled);
+    ret |= parse_int_option(section, section_name, "keyframe_interval", 1, 1000000, &config->keyframe_interval);
+
+    cJSON* deadbands = cJSON_GetObjectItem(section, "deadband");
+    if (deadbands == NULL)
+    {
+        return ret;
+    }
+    if (!cJSON_IsObject(deadbands))
+    {
+        fprintf(stderr, "Configuración inválida: '%s.deadband' debe ser un objeto\n", section_name);
+        return -1;
+    }
+    config->deadband_count = 0;
+    cJSON* item;
+    cJSON_ArrayForEach(item, deadbands)
+    {
+        int known = 0;
+        for (int i = 0; i < COLLECTOR_COUNT; i++)
+        {
+            known |= strcmp(item->string, collector_descriptor((CollectorId)i)->family) == 0;
+        }
+        if (!known || !cJSON_IsNumber(item) || !(cJSON_GetNumberValue(item) >= 0) ||
+            config->deadband_count == DELTA_DEADBAND_MAX)
+        {
+            fprintf(stderr,
+                    "Configuración inválida: '%s.deadband.%s' debe ser una métrica del sistema y un número >= 0\n",
+                    section_name, item->string);
+            return -1;
+        }
+        DeltaDeadband* deadband = &config->deadbands[config->deadband_count++];
+        snprintf(deadband->family, sizeof(deadband->family), "%s", item->string);
+        deadband->deadband = cJSON_GetNumberValue(item);
+    }
+    return ret;
+}
+
+/**
+ * @brief Parsea la sección opcional "monitor".
+ * @param json Raíz del documento.
+ * @param config Destino; conserva los valores por defecto de las claves ausentes.
+ * @return 0 si la sección es válida o no existe, -1 en caso contrario.
+ */
+static int parse_monitor_section(const cJSON* json, MonitorConfig* config)
+{
+    cJSON* monitor = cJSON_GetObjectItem(json, "monitor");
+    if (monitor == NULL)
+    {
+        return 0;
+    }
+    if (!cJSON_IsObject(monitor))
+    {
+        fprintf(stderr, "Configuración inválida: 'monitor' debe ser un objeto\n");
+        return -1;
+    }
+
+    static const char* const framings[] = {"ndjson", "length", NULL};
+    static const char* const encodings[] = {"json", "cbor", NULL};
+    int framing = (int)config->framing;
+    int encoding = (int)config->encoding;
+    int ret = 0;
+    ret |= parse_string_option(monitor, "monitor", "fifo_path", config->fifo_path, sizeof(config->fifo_path));
+    ret |= parse_choice_option(monitor, "monitor", "framing", framings, &framing);
+    ret |= parse_choice_option(monitor, "monitor", "encoding", encodings, &encoding);
+    ret |= parse_int_option(monitor, "monitor", "queue_kb", 4, 64 * 1024, &config->queue_kb);
+    ret |= parse_delta_options(monitor, "monitor", &config->delta);
+    config->framing = (MonitorFraming)framing;
+    config->encoding = (MonitorEncoding)encoding;
+
+    // CBOR es binario: puede contener '\n' y no admite delimitar por líneas
+    if (ret == 0 && config->encoding == MONITOR_ENCODING_CBOR && config->framing == MONITOR_FRAMING_NDJSON)
+    {
+        if (cJSON_GetObjectItem(monitor, "framing") != NULL)
+        {
+            fprintf(stderr, "Configuración inválida: 'monitor.encoding' cbor requiere 'framing' length\n");
+            return -1;
+        }
+        config->framing = MONITOR_FRAMING_LENGTH;
+    }
+    return ret;
+}
+
+/**
+ * @brief Parsea la sección opcional "shm".
+ * @param json Raíz del documento.
+ * @param config Destino; conserva los valores por defecto de las claves ausentes.
+ * @return 0 si la sección es válida o no existe, -1 en caso contrario.
+ */
+static int parse_shm_section(const cJSON* json, ShmConfig* config)
+{
+    cJSON* shm = cJSON_GetObjectItem(json, "shm");
+    if (shm == NULL)
+    {
+        return 0;
+    }
+    if (!cJSON_IsObject(shm))
+    {
+        fprintf(stderr, "Configuración inválida: 'shm' debe ser un objeto\n");
+        return -1;
+    }
+
+    if (parse_string_option(shm, "shm", "name", config->name, sizeof(config->name)) != 0)
+    {
+        return -1;
+    }
+    if (config->name[0] != '\0' && (config->name[0] != '/' || config->name[1] == '\0' ||
+                                    strchr(config->name + 1, '/') != NULL))
+    {
+        fprintf(stderr, "Configuración inválida: 'shm.name' debe ser \"/nombre\" sin otras barras\n");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Parsea la sección opcional "pubsub".
+ * @param json Raíz del documento.
+ * @param config Destino; conserva los valores por defecto de las claves ausentes.
+ * @return 0 si la sección es válida o no existe, -1 en caso contrario.
+ */
+static int parse_pubsub_section(const cJSON* json, PubsubConfig* config)
+{
+    cJSON* pubsub = cJSON_GetObjectItem(json, "pubsub");
+    if (pubsub == NULL)
+    {
+        return 0;
+    }
+    if (!cJSON_IsObject(pubsub))
+    {
+        fprintf(stderr, "Configuración inválida: 'pubsub' debe ser un objeto\n");
+        return -1;
+    }
+
+    static const char* const framings[] = {"ndjson", "length", NULL};
+    static const char* const encodings[] = {"json", "cbor", NULL};
+    static const char* const policies[] = {"drop", "disconnect", NULL};
+    int framing = (int)config->framing;
+    int encoding = (int)config->encoding;
+    int policy = (int)config->slow_policy;
+    int ret = 0;
+    ret |= parse_string_option(pubsub, "pubsub", "socket_path", config->socket_path, sizeof(config->socket_path));
+    ret |= parse_choice_option(pubsub, "pubsub", "framing", framings, &framing);
+    ret |= parse_choice_option(pubsub, "pubsub", "encoding", encodings, &encoding);
+    ret |= parse_int_option(pubsub, "pubsub", "queue_messages", 2, 4096, &config->queue_messages);
+    ret |= parse_choice_option(pubsub, "pubsub", "slow_policy", policies, &policy);
+    ret |= parse_int_option(pubsub, "pubsub", "max_subscribers", 1, 1024, &config->max_subscribers);
+    ret |= parse_delta_options(pubsub, "pubsub", &config->delta);
+    config->framing = (MonitorFraming)framing;
+    config->encoding = (MonitorEncoding)encoding;
+    config->slow_policy = (PubsubSlowPolicy)policy;
+
+    // Igual que en "monitor": CBOR no puede delimitarse por líneas
+    if (ret == 0 && config->encoding == MONITOR_ENCODING_CBOR && config->framing == MONITOR_FRAMING_NDJSON)
+    {
+        if (cJSON_GetObjectItem(pubsub, "framing") != NULL)
+        {
+            fprintf(stderr, "Configuración inválida: 'pubsub.encoding' cbor requiere 'framing' length\n");
+            return -1;
+        }
+        config->framing = MONITOR_FRAMING_LENGTH;
+    }
+    return ret;
+}
+
+/**
+ * @brief Parsea la sección opcional "paths".
+ * @param json Raíz del documento.
+ * @param config Destino; conserva los valores por defecto de las claves ausentes.
+ * @return 0 si la sección es válida o no existe, -1 en caso contrario.
+ */
+static int parse_paths_section(const cJSON* json, PathsConfig* config)
+{
+    cJSON* paths = cJSON_GetObjectItem(json, "paths");
+    if (paths == NULL)
+    {
+        return 0;
+    }
+    if (!cJSON_IsObject(paths))
+    {
+        fprintf(stderr, "Configuración inválida: 'paths' debe ser un objeto\n");
+        return -1;
+    }
+
+    if (parse_string_option(paths, "paths", "procfs", config->procfs, sizeof(config->procfs)) != 0 ||
+        parse_string_option(paths, "paths", "sysfs", config->sysfs, sizeof(config->sysfs)) != 0)
+    {
+        return -1;
+    }
+    // Sin barra final: los collectors agregan "/<archivo>"
+    char* roots[] = {config->procfs, config->sysfs};
+    for (size_t i = 0; i < sizeof(roots) / sizeof(roots[0]); i++)
+    {
+        size_t len = strlen(roots[i]);
+        while (len > 1 && roots[i][len - 1] == '/')
+        {
+            roots[i][--len] = '\0';
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Parsea la sección opcional "synthetic".
+ * @param json Raíz del documento.
+ * @param config Destino; conserva los valores por defecto de las claves ausentes.
+ * @return 0 si la sección es válida o no existe, -1 en caso contrario.
+ */
+static int parse_synthetic_section(const cJSON* json, SyntheticConfig* config)
+{
+    cJSON* synthetic = cJSON_GetObjectItem(json, "synthetic");
+    if (synthetic == NULL)
+    {
+        return 0;
+    }
+    if (!cJSON_IsObject(synthetic))
+    {
+        fprintf(stderr, "Configuración inválida: 'synthetic' debe ser un objeto\n");
+        return -1;
+    }
+
+    int ret = 0;
+    ret |= parse_int_option(synthetic, "synthetic", "series", 0, 10000000, &config->series);
+    ret |= parse_int_option(synthetic, "synthetic", "per_family", 1, 10000000, &config->per_family);
+    if (ret == 0 && (config->series + config->per_family - 1) / config->per_family > SYNTHETIC_MAX_FAMILIES)
     {
-        double ctxt_usage = get_ctxt_usage();
-        cJSON_AddNumberToObject(json, "context_switches", ctxt_usage);
+        fprintf(stderr, "Configuración inválida: 'synthetic.series' / 'per_family' no puede superar %d familias\n",
+                SYNTHETIC_MAX_FAMILIES);
+        return -1;
     }
+    return ret;
+}
+
+/**
+ * @brief Carga los valores por defecto de todas las secciones opcionales.
+ * @param snapshot Snapshot destino.
+ */
+static void config_defaults(ConfigSnapshot* snapshot)
+{
+    snapshot->exposition.gzip_level = DEFAULT_GZIP_LEVEL;
+    snapshot->exposition.zstd_level = DEFAULT_ZSTD_LEVEL;
+    snapshot->http.listeners[0].type = HTTP_LISTENER_TCP;
+    strcpy(snapshot->http.listeners[0].address, "0.0.0.0");
+    snapshot->http.listeners[0].port = DEFAULT_HTTP_PORT;
+    snapshot->http.listener_count = 1;
+    snapshot->http.mode = HTTP_MODE_EPOLL;
+    snapshot->http.threads = DEFAULT_HTTP_THREADS;
+    snapshot->http.connection_limit = DEFAULT_HTTP_CONNECTION_LIMIT;
+    snapshot->http.timeout = DEFAULT_HTTP_TIMEOUT;
+    snapshot->collection.mode = COLLECTION_MODE_INTERVAL;
+    snapshot->collection.min_interval_ms = DEFAULT_COLLECTION_MIN_INTERVAL_MS;
+    snapshot->remote_write.max_samples_per_send = DEFAULT_REMOTE_WRITE_MAX_SAMPLES;
+    snapshot->remote_write.concurrency = DEFAULT_REMOTE_WRITE_CONCURRENCY;
+    snapshot->remote_write.min_backoff_ms = DEFAULT_REMOTE_WRITE_MIN_BACKOFF_MS;
+    snapshot->remote_write.max_backoff_ms = DEFAULT_REMOTE_WRITE_MAX_BACKOFF_MS;
+    snapshot->remote_write.timeout = DEFAULT_HTTP_TIMEOUT;
+    strcpy(snapshot->remote_write.wal_dir, "remote_write_wal");
+    snapshot->remote_write.wal_segment_kb = DEFAULT_REMOTE_WRITE_SEGMENT_KB;
+    snapshot->remote_write.wal_max_segments = DEFAULT_REMOTE_WRITE_MAX_SEGMENTS;
+    snapshot->line_output.protocol = LINE_PROTOCOL_GRAPHITE;
+    snapshot->line_output.transport = LINE_TRANSPORT_UDP;
+    snapshot->line_output.port = DEFAULT_GRAPHITE_PORT;
+    snapshot->line_output.mtu = DEFAULT_LINE_OUTPUT_MTU;
+    snapshot->history.retention_hours = DEFAULT_HISTORY_RETENTION_HOURS;
+    snapshot->history.resolution_seconds = DEFAULT_HISTORY_RESOLUTION_SECONDS;
+    snapshot->history.max_series = DEFAULT_HISTORY_MAX_SERIES;
+    snapshot->sampler.window_seconds = DEFAULT_SAMPLER_WINDOW_SECONDS;
+    snapshot->sampler.cpu = 1;
+    snapshot->sampler.run_queue = 1;
+    snapshot->sampler.psi = 1;
+    snapshot->monitor.framing = MONITOR_FRAMING_NDJSON;
+    snapshot->monitor.encoding = MONITOR_ENCODING_JSON;
+    snapshot->monitor.queue_kb = DEFAULT_MONITOR_QUEUE_KB;
+    snapshot->monitor.delta.keyframe_interval = DEFAULT_DELTA_KEYFRAME_INTERVAL;
+    snapshot->pubsub.framing = MONITOR_FRAMING_NDJSON;
+    snapshot->pubsub.encoding = MONITOR_ENCODING_JSON;
+    snapshot->pubsub.queue_messages = DEFAULT_PUBSUB_QUEUE_MESSAGES;
+    snapshot->pubsub.slow_policy = PUBSUB_SLOW_DROP;
+    snapshot->pubsub.max_subscribers = DEFAULT_PUBSUB_MAX_SUBSCRIBERS;
+    snapshot->pubsub.delta.keyframe_interval = DEFAULT_DELTA_KEYFRAME_INTERVAL;
+    strcpy(snapshot->paths.procfs, DEFAULT_PROCFS_ROOT);
+    strcpy(snapshot->paths.sysfs, DEFAULT_SYSFS_ROOT);
+    snapshot->synthetic.per_family = DEFAULT_SYNTHETIC_PER_FAMILY;
+}
 
-    // Convertir el objeto cJSON a una cadena
-    char* json_string = cJSON_Print(json);
-    if (json_string != NULL)
+/**
+ * @brief Lee y valida el archivo de configuración completo.
+ * @param config_file Ruta del archivo.
+ * @param snapshot Destino (debe venir en cero); no se publica aquí.
+ * @return 0 si la configuración es válida, -1 en caso de error.
+ */
+static int parse_config(const char* config_file, ConfigSnapshot* snapshot)
+{
+    cJSON* json = load_config_json(config_file);
+    if (json == NULL)
     {
-        printf("JSON de métricas creado con éxito:\n%s\n", json_string);
+        return -1;
     }
+
+    config_defaults(snapshot);
+    int ret = 0;
+    ret |= parse_metrics_section(json, &snapshot->metrics);
+    ret |= parse_exposition_section(json, &snapshot->exposition);
+    ret |= parse_http_section(json, &snapshot->http);
+    ret |= parse_collection_section(json, &snapshot->collection);
+    ret |= parse_remote_write_section(json, &snapshot->remote_write);
+    ret |= parse_line_output_section(json, &snapshot->line_output);
+    ret |= parse_history_section(json, &snapshot->history);
+    ret |= parse_sampler_section(json, &snapshot->sampler);
+    ret |= parse_monitor_section(json, &snapshot->monitor);
+    ret |= parse_shm_section(json, &snapshot->shm);
+    ret |= parse_pubsub_section(json, &snapshot->pubsub);
+    ret |= parse_paths_section(json, &snapshot->paths);
+    ret |= parse_synthetic_section(json, &snapshot->synthetic);
     cJSON_Delete(json);
+    return ret;
+}
 
-    return json_string;
+int parse_metrics_config(const char* config_file, MetricsConfig* config)
+{
+    cJSON* json = load_config_json(config_file);
+    if (json == NULL)
+    {
+        return -1;
+    }
+
+    int ret = parse_metrics_section(json, config);
+    cJSON_Delete(json);
+    return ret;
 }
 
-void send_metrics_to_monitor()
+MetricsConfig read_metrics_config(const char* config_file)
+{
+    MetricsConfig config = {0, 0, 0, 0, 0, 0};
+    parse_metrics_config(config_file, &config);
+    return config;
+}
+
+const ConfigSnapshot* config_read_lock(unsigned* token)
 {
-    // Obtener la ruta actual
-    char cwd[1024];
-    if (getcwd(cwd, sizeof(cwd)) != NULL)
+    unsigned epoch;
+
+    // Registrarse en la época vigente; si cambió mientras tanto, reintentar en la nueva
+    for (;;)
     {
-        // Construir la ruta absoluta al archivo de configuración
-        char config_file_path[1024];
-        snprintf(config_file_path, sizeof(config_file_path), "%s/../config.json", cwd);
+        epoch = atomic_load(&read_epoch);
+        atomic_fetch_add(&active_readers[epoch], 1);
+        if (atomic_load(&read_epoch) == epoch)
+        {
+            break;
+        }
+        atomic_fetch_sub(&active_readers[epoch], 1);
+    }
 
-        // Leer la configuración directamente en esta función
-        MetricsConfig config = read_metrics_config(config_file_path);
+    *token = epoch;
+    return atomic_load(&current_snapshot);
+}
 
-        char* json_string = create_metrics_json(config);
+void config_read_unlock(unsigned token)
+{
+    atomic_fetch_sub_explicit(&active_readers[token], 1, memory_order_release);
+}
 
-        if (json_string != NULL)
+MetricsConfig config_current_metrics()
+{
+    unsigned token;
+    const ConfigSnapshot* snapshot = config_read_lock(&token);
+    MetricsConfig metrics = snapshot->metrics;
+    config_read_unlock(token);
+    return metrics;
+}
+
+HttpConfig config_current_http()
+{
+    unsigned token;
+    const ConfigSnapshot* snapshot = config_read_lock(&token);
+    HttpConfig http = snapshot->http;
+    config_read_unlock(token);
+    return http;
+}
+
+CollectionConfig config_current_collection()
+{
+    unsigned token;
+    const ConfigSnapshot* snapshot = config_read_lock(&token);
+    CollectionConfig collection = snapshot->collection;
+    config_read_unlock(token);
+    return collection;
+}
+
+RemoteWriteConfig config_current_remote_write()
+{
+    unsigned token;
+    const ConfigSnapshot* snapshot = config_read_lock(&token);
+    RemoteWriteConfig remote_write = snapshot->remote_write;
+    config_read_unlock(token);
+    return remote_write;
+}
+
+LineOutputConfig config_current_line_output()
+{
+    unsigned token;
+    const ConfigSnapshot* snapshot = config_read_lock(&token);
+    LineOutputConfig line_output = snapshot->line_output;
+    config_read_unlock(token);
+    return line_output;
+}
+
+HistoryConfig config_current_history()
+{
+    unsigned token;
+    const ConfigSnapshot* snapshot = config_read_lock(&token);
+    HistoryConfig history = snapshot->history;
+    config_read_unlock(token);
+    return history;
+}
+
+SamplerConfig config_current_sampler()
+{
+    unsigned token;
+    const ConfigSnapshot* snapshot = config_read_lock(&token);
+    SamplerConfig sampler = snapshot->sampler;
+    config_read_unlock(token);
+    return sampler;
+}
+
+MonitorConfig config_current_monitor()
+{
+    unsigned token;
+    const ConfigSnapshot* snapshot = config_read_lock(&token);
+    MonitorConfig monitor = snapshot->monitor;
+    config_read_unlock(token);
+    return monitor;
+}
+
+ShmConfig config_current_shm()
+{
+    unsigned token;
+    const ConfigSnapshot* snapshot = config_read_lock(&token);
+    ShmConfig shm = snapshot->shm;
+    config_read_unlock(token);
+    return shm;
+}
+
+PubsubConfig config_current_pubsub()
+{
+    unsigned token;
+    const ConfigSnapshot* snapshot = config_read_lock(&token);
+    PubsubConfig pubsub = snapshot->pubsub;
+    config_read_unlock(token);
+    return pubsub;
+}
+
+PathsConfig config_current_paths()
+{
+    unsigned token;
+    const ConfigSnapshot* snapshot = config_read_lock(&token);
+    PathsConfig paths = snapshot->paths;
+    config_read_unlock(token);
+    return paths;
+}
+
+SyntheticConfig config_current_synthetic()
+{
+    unsigned token;
+    const ConfigSnapshot* snapshot = config_read_lock(&token);
+    SyntheticConfig synthetic = snapshot->synthetic;
+    config_read_unlock(token);
+    return synthetic;
+}
+
+/**
+ * @brief Publica un snapshot nuevo y espera a los lectores del anterior.
+ *
+ * Debe llamarse con `reload_lock` tomado. Los lectores que entren después del cambio de época
+ * ven el snapshot nuevo; el anterior se libera cuando la época vieja queda sin lectores.
+ *
+ * @param snapshot Snapshot a publicar.
+ */
+static void publish_snapshot(ConfigSnapshot* snapshot)
+{
+    ConfigSnapshot* old = atomic_exchange(&current_snapshot, snapshot);
+
+    unsigned epoch = atomic_load(&read_epoch);
+    atomic_store(&read_epoch, epoch ^ 1);
+
+    // Período de gracia: solo espera el hilo que recarga, nunca los lectores
+    struct timespec pause = {0, 1000000};
+    while (atomic_load(&active_readers[epoch]) != 0)
+    {
+        nanosleep(&pause, NULL);
+    }
+
+    free(old);
+}
+
+int config_init(const char* config_file)
+{
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    // Resolver la ruta una sola vez; la recarga no debe depender del directorio actual
+    if (config_file[0] == '/')
+    {
+        snprintf(config_path, sizeof(config_path), "%s", config_file);
+    }
+    else
+    {
+        char cwd[PATH_MAX];
+        if (getcwd(cwd, sizeof(cwd)) == NULL)
+        {
+            perror("Error al obtener el directorio actual");
+            cwd[0] = '\0';
+        }
+        if (snprintf(config_path, sizeof(config_path), "%s/%s", cwd, config_file) >= (int)sizeof(config_path))
+        {
+            fprintf(stderr, "Ruta de configuración demasiado larga: %s\n", config_file);
+        }
+    }
+
+    ConfigSnapshot* snapshot = calloc(1, sizeof(ConfigSnapshot));
+    if (snapshot == NULL)
+    {
+        fprintf(stderr, "Error al reservar memoria para la configuración\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int ret = parse_config(config_path, snapshot);
+    if (ret != 0)
+    {
+        // Sin configuración válida se mantiene el comportamiento histórico: todo habilitado
+        fprintf(stderr, "Usando configuración por defecto (todas las métricas habilitadas)\n");
+        memset(snapshot, 0, sizeof(ConfigSnapshot));
+        config_defaults(snapshot);
+        MetricsConfig all = {1, 1, 1, 1, 1, 1};
+        snapshot->metrics = all;
+    }
+
+    snapshot->version = 1;
+    atomic_store(&current_snapshot, snapshot);
+    return ret;
+}
+
+int config_reload()
+{
+    ConfigSnapshot* snapshot = calloc(1, sizeof(ConfigSnapshot));
+    if (snapshot == NULL)
+    {
+        fprintf(stderr, "Error al reservar memoria para la configuración\n");
+        return -1;
+    }
+    if (parse_config(config_path, snapshot) != 0)
+    {
+        free(snapshot);
+        fprintf(stderr, "Recarga rechazada, se mantiene la configuración vigente\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&reload_lock);
+
+    // Solo este hilo publica, así que el snapshot vigente puede leerse sin época
+    const ConfigSnapshot* current = atomic_load(&current_snapshot);
+    snapshot->version = current->version;
+    if (memcmp(current, snapshot, sizeof(ConfigSnapshot)) == 0)
+    {
+        pthread_mutex_unlock(&reload_lock);
+        free(snapshot);
+        return 0;
+    }
+    snapshot->version = current->version + 1;
+
+    const MetricsConfig* metrics = &snapshot->metrics;
+    printf("Configuración recargada (versión %lu): cpu=%d memory=%d disk=%d network=%d processes=%d "
+           "context_switches=%d\n",
+           snapshot->version, metrics->cpu, metrics->memory, metrics->disk, metrics->network, metrics->processes,
+           metrics->context_switches);
+
+    publish_snapshot(snapshot);
+    pthread_mutex_unlock(&reload_lock);
+    return 0;
+}
+
+void* config_watch(void* arg)
+{
+    (void)arg; // Argumento no utilizado
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGHUP);
+    int signal_fd = signalfd(-1, &mask, SFD_CLOEXEC);
+    if (signal_fd == -1)
+    {
+        perror("Error al crear signalfd para SIGHUP");
+    }
+
+    // Se observa el directorio: los editores suelen reemplazar el archivo con rename
+    char dir_copy[PATH_MAX];
+    char base_copy[PATH_MAX];
+    snprintf(dir_copy, sizeof(dir_copy), "%s", config_path);
+    snprintf(base_copy, sizeof(base_copy), "%s", config_path);
+    const char* dir = dirname(dir_copy);
+    const char* base = basename(base_copy);
+
+    int inotify_fd = inotify_init1(IN_CLOEXEC);
+    if (inotify_fd == -1 || inotify_add_watch(inotify_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) == -1)
+    {
+        perror("Error al observar el directorio de configuración");
+        if (inotify_fd != -1)
         {
-            // Abrir el FIFO en modo escritura
-            int fifo_fd = open("/tmp/monitor_fifo", O_WRONLY | O_NONBLOCK);
-            if (fifo_fd != -1)
+            close(inotify_fd);
+        }
+        inotify_fd = -1;
+    }
+
+    if (signal_fd == -1 && inotify_fd == -1)
+    {
+        fprintf(stderr, "Recarga de configuración deshabilitada\n");
+        return NULL;
+    }
+
+    struct pollfd fds[2] = {{signal_fd, POLLIN, 0}, {inotify_fd, POLLIN, 0}};
+
+    while (1)
+    {
+        if (poll(fds, 2, -1) == -1)
+        {
+            if (errno == EINTR)
             {
-                // Escribir los datos en el FIFO y cerrar el descriptor de archivo
-                ssize_t bytes_written = write(fifo_fd, json_string, strlen(json_string));
-                if (bytes_written == -1)
-                {
-                    perror("Error al escribir en el pipe");
-                }
-                else
-                {
-                    printf("Métricas enviadas a través del pipe.\n");
-                }
-                close(fifo_fd);
+                continue;
+            }
+            perror("Error en poll del observador de configuración");
+            break;
+        }
+
+        int changed = 0;
+
+        if (fds[0].revents & POLLIN)
+        {
+            struct signalfd_siginfo info;
+            if (read(signal_fd, &info, sizeof(info)) == sizeof(info))
+            {
+                changed = 1;
             }
-            else
+        }
+
+        if (fds[1].revents & POLLIN)
+        {
+            char buffer[INOTIFY_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+            ssize_t len = read(inotify_fd, buffer, sizeof(buffer));
+            for (char* ptr = buffer; len > 0 && ptr < buffer + len;)
             {
-                perror("Error al abrir el pipe para enviar métricas");
+                const struct inotify_event* event = (const struct inotify_event*)ptr;
+                if (event->len > 0 && strcmp(event->name, base) == 0)
+                {
+                    changed = 1;
+                }
+                ptr += sizeof(struct inotify_event) + event->len;
             }
+        }
 
-            // Liberar la cadena JSON
-            free(json_string);
+        if (changed)
+        {
+            config_reload();
         }
-        else
+    }
+
+    if (signal_fd != -1)
+    {
+        close(signal_fd);
+    }
+    if (inotify_fd != -1)
+    {
+        close(inotify_fd);
+    }
+    return NULL;
+}
+
+int format_metrics_json(MetricsConfig config, const MetricsSample* sample, Buffer* out)
+{
+    JsonWriter json;
+    json_writer_init(&json, out);
+    json_begin_object(&json);
+    if (config.cpu)
+    {
+        json_key(&json, "cpu_usage");
+        json_number(&json, sample->cpu_usage);
+    }
+    if (config.memory)
+    {
+        json_key(&json, "memory_usage");
+        json_number(&json, sample->memory_usage);
+    }
+    if (config.disk)
+    {
+        json_key(&json, "disk_usage");
+        json_number(&json, sample->disk_usage);
+    }
+    if (config.network)
+    {
+        json_key(&json, "network_usage");
+        json_number(&json, sample->network_usage);
+    }
+    if (config.processes)
+    {
+        json_key(&json, "process_count");
+        json_number(&json, sample->process_count);
+    }
+    if (config.context_switches)
+    {
+        json_key(&json, "context_switches");
+        json_number(&json, sample->context_switches);
+    }
+    json_end_object(&json);
+    return json_writer_error(&json) ? -1 : 0;
+}
+
+char* create_metrics_json(MetricsConfig config)
+{
+    // Los valores salen de la última recolección publicada: las métricas no se vuelven a medir
+    MetricsSample sample;
+    collector_plan_current_sample(&sample);
+
+    Buffer out;
+    buffer_init(&out);
+    char* json_string = NULL;
+    if (format_metrics_json(config, &sample, &out) == 0)
+    {
+        json_string = malloc(out.len + 1);
+        if (json_string != NULL)
         {
-            printf("Error: No se pudo crear el JSON de métricas.\n");
+            memcpy(json_string, out.data, out.len + 1);
         }
     }
-    else
+    buffer_free(&out);
+    return json_string;
+}
+
+void send_metrics_to_monitor()
+{
+    // El mensaje se arma con los últimos valores publicados y lo escribe el hilo del FIFO
+    if (monitor_fifo_send_current() != 0)
     {
-        perror("Error al obtener el directorio actual");
+        fprintf(stderr, "Error: no se pudo encolar el mensaje para el monitor (¿falta 'monitor.fifo_path'?)\n");
     }
 }
@@ -0,0 +1,81 @@
+#include "../include/ddsketch.h"
+#include <math.h>
+#include <string.h>
+
+/**
+ * @brief Desplazamiento entre el índice logarítmico de un valor y su posición en `bins`.
+ */
+#define DDSKETCH_OFFSET (DDSKETCH_BINS / 2)
+
+void ddsketch_init(DDSketch* sketch, double relative_accuracy)
+{
+    sketch->gamma = (1.0 + relative_accuracy) / (1.0 - relative_accuracy);
+    sketch->inv_log_gamma = 1.0 / log(sketch->gamma);
+    ddsketch_clear(sketch);
+}
+
+void ddsketch_clear(DDSketch* sketch)
+{
+    sketch->count = 0;
+    sketch->zero_count = 0;
+    memset(sketch->bins, 0, sizeof(sketch->bins));
+}
+
+void ddsketch_add(DDSketch* sketch, double value)
+{
+    if (isnan(value))
+    {
+        return;
+    }
+    sketch->count++;
+    if (value <= 0.0)
+    {
+        sketch->zero_count++;
+        return;
+    }
+    double index = ceil(log(value) * sketch->inv_log_gamma) + DDSKETCH_OFFSET;
+    if (index < 0.0)
+    {
+        index = 0.0;
+    }
+    else if (index > DDSKETCH_BINS - 1)
+    {
+        index = DDSKETCH_BINS - 1;
+    }
+    sketch->bins[(int)index]++;
+}
+
+void ddsketch_merge(DDSketch* dst, const DDSketch* src)
+{
+    dst->count += src->count;
+    dst->zero_count += src->zero_count;
+    for (int i = 0; i < DDSKETCH_BINS; i++)
+    {
+        dst->bins[i] += src->bins[i];
+    }
+}
+
+double ddsketch_quantile(const DDSketch* sketch, double quantile)
+{
+    if (sketch->count == 0)
+    {
+        return NAN;
+    }
+    // Rango (base 0) del valor buscado, como en la implementación de referencia
+    double rank = quantile * (double)(sketch->count - 1);
+    if ((double)sketch->zero_count > rank)
+    {
+        return 0.0;
+    }
+    uint64_t seen = sketch->zero_count;
+    for (int i = 0; i < DDSKETCH_BINS; i++)
+    {
+        seen += sketch->bins[i];
+        if ((double)seen > rank)
+        {
+            // Punto del bucket (gamma^(k-1), gamma^k] con el mismo error relativo a ambos extremos
+            return 2.0 * pow(sketch->gamma, i - DDSKETCH_OFFSET) / (sketch->gamma + 1.0);
+        }
+    }
+    return 2.0 * pow(sketch->gamma, DDSKETCH_BINS - 1 - DDSKETCH_OFFSET) / (sketch->gamma + 1.0);
+}
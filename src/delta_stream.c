@@ -0,0 +1,74 @@
+#include "../include/delta_stream.h"
+#include <math.h>
+#include <string.h>
+
+void delta_stream_init(DeltaStream* stream, const DeltaConfig* config, const char* const* families, size_t count)
+{
+    stream->count = count < DELTA_STREAM_MAX_VALUES ? count : DELTA_STREAM_MAX_VALUES;
+    stream->keyframe_interval = config->keyframe_interval > 0 ? config->keyframe_interval : 1;
+    stream->cycles = 0;
+    atomic_init(&stream->keyframe_requested, 1);
+    stream->sequence = 0;
+    for (size_t i = 0; i < stream->count; i++)
+    {
+        stream->deadband[i] = 0.0;
+        stream->reference[i] = NAN;
+        for (int j = 0; j < config->deadband_count; j++)
+        {
+            if (strcmp(config->deadbands[j].family, families[i]) == 0)
+            {
+                stream->deadband[i] = config->deadbands[j].deadband;
+            }
+        }
+    }
+}
+
+DeltaFrame delta_stream_next(DeltaStream* stream, const double* values, uint32_t* changed)
+{
+    int keyframe = atomic_exchange(&stream->keyframe_requested, 0) || ++stream->cycles >= stream->keyframe_interval;
+    uint32_t mask = 0;
+    for (size_t i = 0; i < stream->count; i++)
+    {
+        double reference = stream->reference[i];
+        double value = values[i];
+        // Aparecer o desaparecer siempre es un cambio; si no, cuenta solo lo que supera la banda
+        int moved = isnan(reference) != isnan(value) ||
+                    (!isnan(value) && (stream->deadband[i] > 0.0 ? fabs(value - reference) > stream->deadband[i]
+                                                                 : value != reference));
+        if (keyframe || moved)
+        {
+            stream->reference[i] = value;
+            mask |= moved ? 1u << i : 0;
+        }
+    }
+
+    if (keyframe)
+    {
+        stream->cycles = 0;
+        stream->sequence++;
+        *changed = delta_stream_present(stream);
+        return DELTA_FRAME_KEYFRAME;
+    }
+    *changed = mask;
+    if (mask == 0)
+    {
+        return DELTA_FRAME_NONE;
+    }
+    stream->sequence++;
+    return DELTA_FRAME_DELTA;
+}
+
+void delta_stream_request_keyframe(DeltaStream* stream)
+{
+    atomic_store(&stream->keyframe_requested, 1);
+}
+
+uint32_t delta_stream_present(const DeltaStream* stream)
+{
+    uint32_t present = 0;
+    for (size_t i = 0; i < stream->count; i++)
+    {
+        present |= isnan(stream->reference[i]) ? 0 : 1u << i;
+    }
+    return present;
+}
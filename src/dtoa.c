@@ -0,0 +1,471 @@
+#include "../include/dtoa.h"
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Bit implícito de la mantisa de un double normal.
+ */
+#define DTOA_HIDDEN_BIT 0x0010000000000000ULL
+
+/**
+ * @brief Bits de la mantisa almacenada de un double.
+ */
+#define DTOA_SIGNIFICAND_BITS 52
+
+/**
+ * @brief Desplazamiento del exponente de un double, contando la mantisa como entero.
+ */
+#define DTOA_EXPONENT_BIAS 1075
+
+/**
+ * @brief Exponente decimal de la primera potencia de la tabla.
+ */
+#define DTOA_FIRST_POWER (-348)
+
+/**
+ * @brief Paso decimal entre potencias consecutivas de la tabla.
+ */
+#define DTOA_POWER_STEP 8
+
+/**
+ * @struct DiyFp
+ * @brief Número en punto flotante "hecho a mano": f * 2^e con f de 64 bits.
+ */
+typedef struct
+{
+    uint64_t f; /**< Mantisa. */
+    int e;      /**< Exponente binario. */
+} DiyFp;
+
+/** Potencias 10^k normalizadas, para k = -348, -340, ..., 340 */
+static const DiyFp cached_powers[] = {
+    {0xfa8fd5a0081c0288ULL, -1220}, {0xbaaee17fa23ebf76ULL, -1193}, {0x8b16fb203055ac76ULL, -1166},
+    {0xcf42894a5dce35eaULL, -1140}, {0x9a6bb0aa55653b2dULL, -1113}, {0xe61acf033d1a45dfULL, -1087},
+    {0xab70fe17c79ac6caULL, -1060}, {0xff77b1fcbebcdc4fULL, -1034}, {0xbe5691ef416bd60cULL, -1007},
+    {0x8dd01fad907ffc3cULL, -980}, {0xd3515c2831559a83ULL, -954}, {0x9d71ac8fada6c9b5ULL, -927},
+    {0xea9c227723ee8bcbULL, -901}, {0xaecc49914078536dULL, -874}, {0x823c12795db6ce57ULL, -847},
+    {0xc21094364dfb5637ULL, -821}, {0x9096ea6f3848984fULL, -794}, {0xd77485cb25823ac7ULL, -768},
+    {0xa086cfcd97bf97f4ULL, -741}, {0xef340a98172aace5ULL, -715}, {0xb23867fb2a35b28eULL, -688},
+    {0x84c8d4dfd2c63f3bULL, -661}, {0xc5dd44271ad3cdbaULL, -635}, {0x936b9fcebb25c996ULL, -608},
+    {0xdbac6c247d62a584ULL, -582}, {0xa3ab66580d5fdaf6ULL, -555}, {0xf3e2f893dec3f126ULL, -529},
+    {0xb5b5ada8aaff80b8ULL, -502}, {0x87625f056c7c4a8bULL, -475}, {0xc9bcff6034c13053ULL, -449},
+    {0x964e858c91ba2655ULL, -422}, {0xdff9772470297ebdULL, -396}, {0xa6dfbd9fb8e5b88fULL, -369},
+    {0xf8a95fcf88747d94ULL, -343}, {0xb94470938fa89bcfULL, -316}, {0x8a08f0f8bf0f156bULL, -289},
+    {0xcdb02555653131b6ULL, -263}, {0x993fe2c6d07b7facULL, -236}, {0xe45c10c42a2b3b06ULL, -210},
+    {0xaa242499697392d3ULL, -183}, {0xfd87b5f28300ca0eULL, -157}, {0xbce5086492111aebULL, -130},
+    {0x8cbccc096f5088ccULL, -103}, {0xd1b71758e219652cULL, -77}, {0x9c40000000000000ULL, -50},
+    {0xe8d4a51000000000ULL, -24}, {0xad78ebc5ac620000ULL, 3}, {0x813f3978f8940984ULL, 30}, {0xc097ce7bc90715b3ULL, 56},
+    {0x8f7e32ce7bea5c70ULL, 83}, {0xd5d238a4abe98068ULL, 109}, {0x9f4f2726179a2245ULL, 136},
+    {0xed63a231d4c4fb27ULL, 162}, {0xb0de65388cc8ada8ULL, 189}, {0x83c7088e1aab65dbULL, 216},
+    {0xc45d1df942711d9aULL, 242}, {0x924d692ca61be758ULL, 269}, {0xda01ee641a708deaULL, 295},
+    {0xa26da3999aef774aULL, 322}, {0xf209787bb47d6b85ULL, 348}, {0xb454e4a179dd1877ULL, 375},
+    {0x865b86925b9bc5c2ULL, 402}, {0xc83553c5c8965d3dULL, 428}, {0x952ab45cfa97a0b3ULL, 455},
+    {0xde469fbd99a05fe3ULL, 481}, {0xa59bc234db398c25ULL, 508}, {0xf6c69a72a3989f5cULL, 534},
+    {0xb7dcbf5354e9beceULL, 561}, {0x88fcf317f22241e2ULL, 588}, {0xcc20ce9bd35c78a5ULL, 614},
+    {0x98165af37b2153dfULL, 641}, {0xe2a0b5dc971f303aULL, 667}, {0xa8d9d1535ce3b396ULL, 694},
+    {0xfb9b7cd9a4a7443cULL, 720}, {0xbb764c4ca7a44410ULL, 747}, {0x8bab8eefb6409c1aULL, 774},
+    {0xd01fef10a657842cULL, 800}, {0x9b10a4e5e9913129ULL, 827}, {0xe7109bfba19c0c9dULL, 853},
+    {0xac2820d9623bf429ULL, 880}, {0x80444b5e7aa7cf85ULL, 907}, {0xbf21e44003acdd2dULL, 933},
+    {0x8e679c2f5e44ff8fULL, 960}, {0xd433179d9c8cb841ULL, 986}, {0x9e19db92b4e31ba9ULL, 1013},
+    {0xeb96bf6ebadf77d9ULL, 1039}, {0xaf87023b9bf0ee6bULL, 1066},
+};
+
+/** Potencias de 10 que entran en 64 bits */
+static const uint64_t pow10_table[] = {1ULL,
+                                       10ULL,
+                                       100ULL,
+                                       1000ULL,
+                                       10000ULL,
+                                       100000ULL,
+                                       1000000ULL,
+                                       10000000ULL,
+                                       100000000ULL,
+                                       1000000000ULL,
+                                       10000000000ULL,
+                                       100000000000ULL,
+                                       1000000000000ULL,
+                                       10000000000000ULL,
+                                       100000000000000ULL,
+                                       1000000000000000ULL,
+                                       10000000000000000ULL,
+                                       100000000000000000ULL,
+                                       1000000000000000000ULL,
+                                       10000000000000000000ULL};
+
+/** Pares de dígitos "00" a "99", para escribir enteros de a dos dígitos */
+static const char digit_pairs[201] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                                     "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                                     "8081828384858687888990919293949596979899";
+
+/**
+ * @brief Límite de los enteros exactos que se escriben sin Grisu (2^53).
+ */
+#define DTOA_EXACT_INTEGER 9007199254740992.0
+
+/**
+ * @brief Escribe un entero sin signo.
+ * @param value Valor.
+ * @param out Destino.
+ * @return Cantidad de caracteres escritos.
+ */
+static int write_unsigned(uint64_t value, char* out)
+{
+    char digits[20];
+    int pos = sizeof(digits);
+    while (value >= 100)
+    {
+        unsigned pair = (unsigned)(value % 100) * 2;
+        value /= 100;
+        digits[--pos] = digit_pairs[pair + 1];
+        digits[--pos] = digit_pairs[pair];
+    }
+    if (value >= 10)
+    {
+        digits[--pos] = digit_pairs[value * 2 + 1];
+        digits[--pos] = digit_pairs[value * 2];
+    }
+    else
+    {
+        digits[--pos] = (char)('0' + value);
+    }
+    int len = (int)sizeof(digits) - pos;
+    memcpy(out, digits + pos, (size_t)len);
+    return len;
+}
+
+/**
+ * @brief Producto de dos DiyFp, redondeando los 64 bits altos.
+ * @param a Primer factor.
+ * @param b Segundo factor.
+ * @return Producto.
+ */
+static DiyFp diy_fp_multiply(DiyFp a, DiyFp b)
+{
+    unsigned __int128 product = (unsigned __int128)a.f * b.f;
+    uint64_t high = (uint64_t)(product >> 64);
+    if ((uint64_t)product & (1ULL << 63))
+    {
+        high++;
+    }
+    return (DiyFp){high, a.e + b.e + 64};
+}
+
+/**
+ * @brief Normaliza para que el bit 63 de la mantisa quede en 1.
+ * @param x Número distinto de cero.
+ * @return Número normalizado.
+ */
+static DiyFp diy_fp_normalize(DiyFp x)
+{
+    int shift = __builtin_clzll(x.f);
+    return (DiyFp){x.f << shift, x.e - shift};
+}
+
+/**
+ * @brief Calcula los límites del intervalo de números que se redondean a `v`.
+ * @param v Double como DiyFp (sin normalizar).
+ * @param minus Límite inferior, con el mismo exponente que `plus`.
+ * @param plus Límite superior, normalizado.
+ */
+static void normalized_boundaries(DiyFp v, DiyFp* minus, DiyFp* plus)
+{
+    DiyFp upper = diy_fp_normalize((DiyFp){(v.f << 1) + 1, v.e - 1});
+    // En una potencia de 2 el double anterior está a la mitad de distancia
+    DiyFp lower = v.f == DTOA_HIDDEN_BIT ? (DiyFp){(v.f << 2) - 1, v.e - 2} : (DiyFp){(v.f << 1) - 1, v.e - 1};
+    lower.f <<= lower.e - upper.e;
+    lower.e = upper.e;
+    *minus = lower;
+    *plus = upper;
+}
+
+/**
+ * @brief Elige la potencia de 10 que lleva el exponente binario `e` al rango [-60, -32].
+ * @param e Exponente binario del límite superior.
+ * @param k Recibe el exponente decimal opuesto al de la potencia elegida.
+ * @return Potencia de la tabla.
+ */
+static DiyFp cached_power(int e, int* k)
+{
+    // 0.30102999566398114 = log10(2)
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int rounded = (int)dk;
+    if (dk - rounded > 0.0)
+    {
+        rounded++;
+    }
+    unsigned index = (unsigned)((rounded >> 3) + 1);
+    *k = -(DTOA_FIRST_POWER + (int)index * DTOA_POWER_STEP);
+    return cached_powers[index];
+}
+
+/**
+ * @brief Acerca el último dígito al valor exacto mientras siga dentro del intervalo.
+ * @param buffer Dígitos.
+ * @param len Cantidad de dígitos.
+ * @param delta Ancho del intervalo.
+ * @param rest Distancia del número generado al límite superior.
+ * @param ten_kappa Valor de una unidad del último dígito.
+ * @param wp_w Distancia del valor exacto al límite superior.
+ */
+static void grisu_round(char* buffer, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w))
+    {
+        buffer[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+/**
+ * @brief Cantidad de dígitos decimales de un entero de 32 bits.
+ * @param n Entero.
+ * @return Dígitos (al menos 1).
+ */
+static int count_digits(uint32_t n)
+{
+    int digits = 1;
+    while (digits < 10 && n >= pow10_table[digits])
+    {
+        digits++;
+    }
+    return digits;
+}
+
+/**
+ * @brief Genera los dígitos más cortos dentro del intervalo (w_m, w_p).
+ * @param w Valor escalado.
+ * @param mp Límite superior escalado.
+ * @param delta Ancho del intervalo.
+ * @param buffer Recibe los dígitos.
+ * @param len Recibe la cantidad de dígitos.
+ * @param k Exponente decimal; se ajusta según los dígitos descartados.
+ */
+static void digit_gen(DiyFp w, DiyFp mp, uint64_t delta, char* buffer, int* len, int* k)
+{
+    DiyFp one = {1ULL << -mp.e, mp.e};
+    uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    int kappa = count_digits(p1);
+    *len = 0;
+
+    // Parte entera
+    while (kappa > 0)
+    {
+        // Divisores constantes: el compilador los convierte en multiplicaciones
+        uint32_t digit;
+        switch (kappa)
+        {
+        case 10:
+            digit = p1 / 1000000000;
+            p1 %= 1000000000;
+            break;
+        case 9:
+            digit = p1 / 100000000;
+            p1 %= 100000000;
+            break;
+        case 8:
+            digit = p1 / 10000000;
+            p1 %= 10000000;
+            break;
+        case 7:
+            digit = p1 / 1000000;
+            p1 %= 1000000;
+            break;
+        case 6:
+            digit = p1 / 100000;
+            p1 %= 100000;
+            break;
+        case 5:
+            digit = p1 / 10000;
+            p1 %= 10000;
+            break;
+        case 4:
+            digit = p1 / 1000;
+            p1 %= 1000;
+            break;
+        case 3:
+            digit = p1 / 100;
+            p1 %= 100;
+            break;
+        case 2:
+            digit = p1 / 10;
+            p1 %= 10;
+            break;
+        default:
+            digit = p1;
+            p1 = 0;
+            break;
+        }
+        if (digit != 0 || *len != 0)
+        {
+            buffer[(*len)++] = (char)('0' + digit);
+        }
+        kappa--;
+        uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+        if (rest <= delta)
+        {
+            *k += kappa;
+            grisu_round(buffer, *len, delta, rest, pow10_table[kappa] << -one.e, wp_w);
+            return;
+        }
+    }
+
+    // Parte fraccionaria
+    for (;;)
+    {
+        p2 *= 10;
+        delta *= 10;
+        char digit = (char)(p2 >> -one.e);
+        if (digit != 0 || *len != 0)
+        {
+            buffer[(*len)++] = (char)('0' + digit);
+        }
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta)
+        {
+            *k += kappa;
+            int index = -kappa;
+            grisu_round(buffer, *len, delta, p2, one.f, wp_w * (index < 20 ? pow10_table[index] : 0));
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Escribe un exponente decimal con signo ("e21", "e-7").
+ * @param exponent Exponente.
+ * @param out Destino.
+ * @return Caracteres escritos.
+ */
+static int write_exponent(int exponent, char* out)
+{
+    int len = 0;
+    out[len++] = 'e';
+    if (exponent < 0)
+    {
+        out[len++] = '-';
+        exponent = -exponent;
+    }
+    if (exponent >= 100)
+    {
+        out[len++] = (char)('0' + exponent / 100);
+        exponent %= 100;
+        out[len++] = (char)('0' + exponent / 10);
+    }
+    else if (exponent >= 10)
+    {
+        out[len++] = (char)('0' + exponent / 10);
+    }
+    out[len++] = (char)('0' + exponent % 10);
+    return len;
+}
+
+/**
+ * @brief Da formato a los dígitos: decimal entre 1e-6 y 1e21, exponencial fuera de ese rango.
+ * @param buffer Dígitos; recibe el texto.
+ * @param len Cantidad de dígitos.
+ * @param k Exponente decimal: el valor es dígitos * 10^k.
+ * @return Longitud del texto.
+ */
+static int prettify(char* buffer, int len, int k)
+{
+    // 10^(kk - 1) <= valor < 10^kk
+    int kk = len + k;
+    if (k >= 0 && kk <= 21)
+    {
+        // 1234e7 -> 12340000000
+        memset(buffer + len, '0', (size_t)k);
+        return kk;
+    }
+    if (kk > 0 && kk <= 21)
+    {
+        // 1234e-2 -> 12.34
+        memmove(buffer + kk + 1, buffer + kk, (size_t)(len - kk));
+        buffer[kk] = '.';
+        return len + 1;
+    }
+    if (kk > -6 && kk <= 0)
+    {
+        // 1234e-6 -> 0.001234
+        int offset = 2 - kk;
+        memmove(buffer + offset, buffer, (size_t)len);
+        buffer[0] = '0';
+        buffer[1] = '.';
+        memset(buffer + 2, '0', (size_t)(offset - 2));
+        return len + offset;
+    }
+    if (len == 1)
+    {
+        // 1e30
+        return 1 + write_exponent(kk - 1, buffer + 1);
+    }
+    // 1234e30 -> 1.234e33
+    memmove(buffer + 2, buffer + 1, (size_t)(len - 1));
+    buffer[1] = '.';
+    return len + 1 + write_exponent(kk - 1, buffer + len + 1);
+}
+
+int dtoa_integer(long long value, char* out)
+{
+    int len = 0;
+    uint64_t magnitude = (uint64_t)value;
+    if (value < 0)
+    {
+        out[len++] = '-';
+        magnitude = 0 - magnitude;
+    }
+    len += write_unsigned(magnitude, out + len);
+    out[len] = '\0';
+    return len;
+}
+
+int dtoa_shortest(double value, char* out)
+{
+    // Los enteros exactos se escriben tal cual; el texto de Grisu sería el mismo
+    if (value > -DTOA_EXACT_INTEGER && value < DTOA_EXACT_INTEGER && value == (double)(int64_t)value &&
+        value != 0.0)
+    {
+        return dtoa_integer((long long)value, out);
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    char* start = out;
+    if (bits >> 63)
+    {
+        *out++ = '-';
+    }
+    uint64_t significand = bits & (DTOA_HIDDEN_BIT - 1);
+    int biased_exponent = (int)((bits >> DTOA_SIGNIFICAND_BITS) & 0x7ff);
+    if (biased_exponent == 0 && significand == 0)
+    {
+        // -0 se escribe como 0
+        start[0] = '0';
+        start[1] = '\0';
+        return 1;
+    }
+
+    DiyFp v = biased_exponent != 0
+                  ? (DiyFp){significand + DTOA_HIDDEN_BIT, biased_exponent - DTOA_EXPONENT_BIAS}
+                  : (DiyFp){significand, 1 - DTOA_EXPONENT_BIAS};
+    DiyFp w_minus;
+    DiyFp w_plus;
+    normalized_boundaries(v, &w_minus, &w_plus);
+    int k;
+    DiyFp c_mk = cached_power(w_plus.e, &k);
+    DiyFp w = diy_fp_multiply(diy_fp_normalize(v), c_mk);
+    DiyFp wp = diy_fp_multiply(w_plus, c_mk);
+    DiyFp wm = diy_fp_multiply(w_minus, c_mk);
+    // Se achica el intervalo en una unidad a cada lado para absorber el error de las multiplicaciones
+    wm.f++;
+    wp.f--;
+
+    int len;
+    digit_gen(w, wp, wp.f - wm.f, out, &len, &k);
+    len = prettify(out, len, k);
+    out[len] = '\0';
+    return (int)(out - start) + len;
+}
@@ -1,135 +1,463 @@
 #include "../include/expose_metrics.h"
 
-/** Mutex para sincronización de hilos */
-pthread_mutex_t lock;
+/**
+ * @brief Contextos de petición que se conservan para reutilizar (con sus arenas).
+ */
+#define REQUEST_POOL_MAX 32
 
-/** Métrica de Prometheus para el uso de CPU */
-static prom_gauge_t* cpu_usage_metric;
+/**
+ * @struct RequestContext
+ * @brief Estado de una petición HTTP, desde la línea de petición hasta el fin de la respuesta.
+ */
+typedef struct RequestContext
+{
+    uint64_t start_ns;           /**< Instante de llegada (CLOCK_MONOTONIC). */
+    const ExpositionBody* body;  /**< Cuerpo del caché referenciado por la respuesta, o NULL. */
+    size_t response_bytes;       /**< Bytes del cuerpo de la respuesta. */
+    Buffer filtered;             /**< Respuesta armada para /metrics filtrado o /api/range (vive en `arena`). */
+    Arena arena;                 /**< Memoria de la petición; se reinicia al terminar. */
+    struct RequestContext* next; /**< Siguiente contexto libre del pool. */
+} RequestContext;
+
+/**
+ * @struct QueryFilter
+ * @brief Filtro de familias leído de los argumentos de /metrics.
+ */
+typedef struct
+{
+    ExpositionFilter filter; /**< Nombres y prefijos pedidos. */
+    int overflow;            /**< Se pidieron más de EXPOSITION_FILTER_MAX nombres o prefijos. */
+} QueryFilter;
+
+/** Límites de los buckets de duración de peticiones, en segundos */
+static const double request_duration_bounds[] = {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+                                                  0.05,   0.1,   0.25,   0.5,   1.0};
 
-/** Métrica de Prometheus para el uso de memoria */
-static prom_gauge_t* memory_usage_metric;
+/** Límites de los buckets de tamaño de respuesta, en bytes */
+static const double response_size_bounds[] = {256, 1024, 4096, 16384, 65536, 262144, 1048576, 4194304};
 
-/** Métrica de Prometheus para la memoria framentada */
-static prom_gauge_t* memory_fragmentation_metric;
+/** Histograma de duración de las peticiones HTTP */
+static MetricHistogram request_duration_metric;
 
-/** Métrica de Prometheus para el uso del disco */
-static prom_gauge_t* disk_usage_metric;
+/** Histograma de tamaño de las respuestas HTTP */
+static MetricHistogram response_size_metric;
 
-/** Métrica de Prometheus para los bytes totales */
-static prom_gauge_t* network_usage_metric;
+/** Contextos libres para reutilizar */
+static RequestContext* request_pool;
 
-/** Métrica de Prometheus para los procesos en ejecucion */
-static prom_gauge_t* procs_usage_metric;
+/** Cantidad de contextos en `request_pool` */
+static size_t request_pool_size;
 
-/** Métrica de Prometheus para los procesos en ejecucion */
-static prom_gauge_t* ctxt_usage_metric;
+/** Protege el pool de contextos */
+static pthread_mutex_t request_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Serie con las peticiones HTTP en curso */
+static MetricSeries requests_in_flight_metric = METRIC_SERIES_INVALID;
+
+/** Plan de recolección de las métricas del sistema; solo lo usa el hilo que recolecta */
+static CollectorPlan system_plan;
+
+/** Indica si `system_plan` ya se compiló */
+static int system_plan_compiled;
 
 void update_cpu_gauge()
 {
-    double usage = get_cpu_usage();
-    if (usage >= 0)
-    {
-        pthread_mutex_lock(&lock);
-        prom_gauge_set(cpu_usage_metric, usage, NULL);
-        pthread_mutex_unlock(&lock);
-    }
-    else
+    collector_run_one(COLLECTOR_CPU);
+}
+
+void update_memory_gauge()
+{
+    collector_run_one(COLLECTOR_MEMORY);
+}
+
+void update_memory_fragmentation()
+{
+    collector_run_one(COLLECTOR_MEMORY_FRAGMENTATION);
+}
+
+void update_disk_gauge()
+{
+    collector_run_one(COLLECTOR_DISK);
+}
+
+void update_network_gauge()
+{
+    collector_run_one(COLLECTOR_NETWORK);
+}
+
+void update_procs_gauge()
+{
+    collector_run_one(COLLECTOR_PROCESSES);
+}
+
+void update_ctxt_gauge()
+{
+    collector_run_one(COLLECTOR_CONTEXT_SWITCHES);
+}
+
+void update_gauges(const MetricsConfig* config)
+{
+    // Se recompila solo si la configuración cambió; las deshabilitadas no cuestan nada por ciclo
+    if (!system_plan_compiled || memcmp(&system_plan.config, config, sizeof(*config)) != 0)
     {
-        fprintf(stderr, "Error al obtener el uso de CPU\n");
+        collector_plan_compile(&system_plan, config);
+        system_plan_compiled = 1;
     }
+    collector_plan_run(&system_plan);
 }
 
-void update_memory_gauge()
+/**
+ * @brief Función de recolección de las métricas del sistema con la configuración vigente.
+ * @param arg Argumento no utilizado.
+ */
+static void collect_system_metrics(void* arg)
+{
+    (void)arg;
+
+    // Cada recolección toma la configuración vigente; una recarga nunca la bloquea
+    MetricsConfig config = config_current_metrics();
+    update_gauges(&config);
+}
+
+/**
+ * @brief Lee el reloj monotónico.
+ * @return Nanosegundos desde un origen arbitrario.
+ */
+static uint64_t monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Envía una respuesta de texto fijo.
+ * @param connection Conexión HTTP.
+ * @param request Contexto de la petición, donde se anota el tamaño de la respuesta.
+ * @param status Código de estado HTTP.
+ * @param body Cuerpo de la respuesta (estático).
+ * @return Resultado de encolar la respuesta.
+ */
+static enum MHD_Result send_text(struct MHD_Connection* connection, RequestContext* request, unsigned int status,
+                                 const char* body)
 {
-    double usage = get_memory_usage();
-    if (usage >= 0)
+    request->response_bytes = strlen(body);
+    struct MHD_Response* response =
+        MHD_create_response_from_buffer(strlen(body), (void*)body, MHD_RESPMEM_PERSISTENT);
+    enum MHD_Result ret = MHD_queue_response(connection, status, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+/**
+ * @brief Agrega al filtro los argumentos name[] (o name) y prefix de la URL.
+ * @param cls QueryFilter destino.
+ * @return Siempre MHD_YES, para recorrer todos los argumentos.
+ */
+static enum MHD_Result collect_filter(void* cls, enum MHD_ValueKind kind, const char* key, const char* value)
+{
+    (void)kind;
+    QueryFilter* query = cls;
+    if (value == NULL || value[0] == '\0')
     {
-        pthread_mutex_lock(&lock);
-        prom_gauge_set(memory_usage_metric, usage, NULL);
-        pthread_mutex_unlock(&lock);
-        // printf("Actualizando métrica de memoria: %f\n", usage);
+        return MHD_YES;
     }
-    else
+
+    ExpositionFilter* filter = &query->filter;
+    if (strcmp(key, "name[]") == 0 || strcmp(key, "name") == 0)
+    {
+        if (filter->name_count == EXPOSITION_FILTER_MAX)
+        {
+            query->overflow = 1;
+        }
+        else
+        {
+            filter->names[filter->name_count++] = value;
+        }
+    }
+    else if (strcmp(key, "prefix") == 0 || strcmp(key, "prefix[]") == 0)
+    {
+        if (filter->prefix_count == EXPOSITION_FILTER_MAX)
+        {
+            query->overflow = 1;
+        }
+        else
+        {
+            filter->prefixes[filter->prefix_count++] = value;
+        }
+    }
+    return MHD_YES;
+}
+
+/**
+ * @brief Envía como JSON la respuesta armada en `request->filtered`.
+ * @param connection Conexión HTTP.
+ * @param request Contexto de la petición.
+ * @param status Código de estado HTTP.
+ * @return Resultado de encolar la respuesta.
+ */
+static enum MHD_Result send_json(struct MHD_Connection* connection, RequestContext* request, unsigned int status)
+{
+    request->response_bytes = request->filtered.len;
+    struct MHD_Response* response = MHD_create_response_from_buffer(
+        request->filtered.len, (void*)request->filtered.data, MHD_RESPMEM_PERSISTENT);
+    if (response == NULL)
     {
-        fprintf(stderr, "Error al obtener el uso de memoria\n");
+        return MHD_NO;
     }
+    MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_TYPE, "application/json");
+    enum MHD_Result ret = MHD_queue_response(connection, status, response);
+    MHD_destroy_response(response);
+    return ret;
 }
 
-void update_memory_fragmentation()
+/**
+ * @brief Sirve /api/range: puntos de la historia local agregados por paso (ver range_query.h).
+ * @param connection Conexión HTTP.
+ * @param request Contexto de la petición; la respuesta se arma en su arena.
+ * @return Resultado de encolar la respuesta.
+ */
+static enum MHD_Result handle_range(struct MHD_Connection* connection, RequestContext* request)
 {
-    double usage = get_memory_fragmentation();
-    if (usage >= 0)
+    RangeQuery query;
+    const char* error = history_enabled() ? NULL : "history disabled";
+    if (error == NULL)
     {
-        pthread_mutex_lock(&lock);
-        prom_gauge_set(memory_fragmentation_metric, usage, NULL);
-        pthread_mutex_unlock(&lock);
+        error = range_query_parse(
+            &query, MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "metric"),
+            MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "start"),
+            MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "end"),
+            MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "step"));
+    }
+
+    Arena* previous = arena_activate(&request->arena);
+    int ret;
+    if (error != NULL)
+    {
+        JsonWriter writer;
+        json_writer_init(&writer, &request->filtered);
+        json_begin_object(&writer);
+        json_key(&writer, "status");
+        json_string(&writer, "error");
+        json_key(&writer, "error");
+        json_string(&writer, error);
+        json_end_object(&writer);
+        ret = json_writer_error(&writer);
     }
     else
     {
-        fprintf(stderr, "Error al obtener la memoria fragmentada\n");
+        ret = range_query_write(&query, &request->filtered);
     }
-    
-}
+    arena_activate(previous);
 
-void update_disk_gauge()
-{
-    double usage = get_disk_usage();
-    if (usage >= 0)
+    if (ret != 0)
     {
-        pthread_mutex_lock(&lock);
-        prom_gauge_set(disk_usage_metric, usage, NULL);
-        pthread_mutex_unlock(&lock);
+        return send_text(connection, request, MHD_HTTP_INTERNAL_SERVER_ERROR, "Internal Server Error\n");
     }
-    else
+    unsigned int status = MHD_HTTP_OK;
+    if (error != NULL)
     {
-        fprintf(stderr, "Error al obtener el uso de disco\n");
+        status = history_enabled() ? MHD_HTTP_BAD_REQUEST : MHD_HTTP_NOT_FOUND;
     }
+    return send_json(connection, request, status);
 }
 
-void update_network_gauge()
+/**
+ * @brief Manejador de peticiones HTTP: sirve /metrics desde el caché de exposición.
+ *
+ * El cuerpo se entrega sin copiar (MHD_RESPMEM_PERSISTENT); la referencia se guarda en el
+ * contexto de la petición (`con_cls`, creado por `request_started`) y se libera en
+ * `request_completed` cuando libmicrohttpd terminó de enviarlo. Con `name[]` o `prefix` en la
+ * URL se arma una respuesta solo con esas familias a partir del mismo cuerpo. /api/range
+ * responde desde la historia local.
+ */
+static enum MHD_Result handle_request(void* cls, struct MHD_Connection* connection, const char* url,
+                                      const char* method, const char* version, const char* upload_data,
+                                      size_t* upload_data_size, void** con_cls)
 {
-    double usage = get_network_usage("lo");
-    if (usage >= 0)
+    (void)cls;
+    (void)version;
+    (void)upload_data;
+    (void)upload_data_size;
+
+    RequestContext* request = *con_cls;
+    if (request == NULL)
     {
-        pthread_mutex_lock(&lock);
-        prom_gauge_set(network_usage_metric, usage, NULL);
-        pthread_mutex_unlock(&lock);
+        return MHD_NO;
     }
-    else
+    if (strcmp(method, MHD_HTTP_METHOD_GET) != 0)
     {
-        fprintf(stderr, "Error al obtener el uso de red\n");
+        return send_text(connection, request, MHD_HTTP_BAD_REQUEST, "Invalid HTTP Method\n");
+    }
+    if (strcmp(url, "/api/range") == 0)
+    {
+        return handle_range(connection, request);
+    }
+    if (strcmp(url, "/metrics") != 0)
+    {
+        return send_text(connection, request, MHD_HTTP_BAD_REQUEST, "Bad Request\n");
     }
-}
 
-void update_procs_gauge()
-{
-    int procs_usage = get_process_usage();
-    if (procs_usage >= 0)
+    QueryFilter query = {0};
+    MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, collect_filter, &query);
+    if (query.overflow)
     {
-        pthread_mutex_lock(&lock);
-        prom_gauge_set(procs_usage_metric, procs_usage, NULL);
-        pthread_mutex_unlock(&lock);
-        // printf("Actualizando métrica de procesos: %d\n", procs_usage);
+        return send_text(connection, request, MHD_HTTP_BAD_REQUEST, "Too many name[] or prefix arguments\n");
+    }
+    int filtered = query.filter.name_count > 0 || query.filter.prefix_count > 0;
+
+    // En modo scrape se recolecta ahora; los scrapes concurrentes comparten la recolección
+    collection_on_scrape();
+
+    // Formato según Accept: texto, OpenMetrics o protobuf delimitado
+    const char* accept = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT);
+    const ExpositionBody* body = exposition_cache_acquire(negotiate_exposition_format(accept));
+    if (body == NULL)
+    {
+        return send_text(connection, request, MHD_HTTP_INTERNAL_SERVER_ERROR, "Internal Server Error\n");
+    }
+    request->body = body;
+
+    // El cuerpo comprimido se produce una vez por generación y codificación
+    const char* accept_encoding =
+        MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT_ENCODING);
+    ContentEncoding wanted = negotiate_content_encoding(accept_encoding, exposition_enabled_encodings());
+    const char* data;
+    size_t len;
+    const char* etag;
+    ContentEncoding encoding;
+    int not_modified = 0;
+    if (filtered)
+    {
+        // Solo las familias pedidas, copiadas desde el cuerpo compartido; sin ETag propio. La
+        // respuesta y el estado del compresor salen de la arena de la petición
+        Arena* previous = arena_activate(&request->arena);
+        encoding = exposition_cache_filter(body, &query.filter, wanted, &request->filtered);
+        arena_activate(previous);
+        data = request->filtered.data;
+        len = request->filtered.len;
+        etag = NULL;
     }
     else
     {
-        fprintf(stderr, "Error al obtener el numero de procesos\n");
+        encoding = exposition_cache_encoded(body, wanted, &data, &len, &etag);
+
+        // Un cliente que ya tiene esta representación recibe 304 sin cuerpo
+        const char* if_none_match =
+            MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_IF_NONE_MATCH);
+        not_modified = exposition_etag_matches(if_none_match, etag);
+    }
+    request->response_bytes = not_modified ? 0 : len;
+
+    struct MHD_Response* response = not_modified
+                                        ? MHD_create_response_from_buffer(0, NULL, MHD_RESPMEM_PERSISTENT)
+                                        : MHD_create_response_from_buffer(len, (void*)data, MHD_RESPMEM_PERSISTENT);
+    if (response == NULL)
+    {
+        return MHD_NO;
+    }
+    if (etag != NULL)
+    {
+        MHD_add_response_header(response, MHD_HTTP_HEADER_ETAG, etag);
     }
+    MHD_add_response_header(response, MHD_HTTP_HEADER_VARY, "Accept, Accept-Encoding");
+    if (!not_modified)
+    {
+        MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_TYPE, exposition_content_type(body->format));
+        if (encoding != CONTENT_ENCODING_IDENTITY)
+        {
+            MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_ENCODING, content_encoding_name(encoding));
+        }
+    }
+    enum MHD_Result ret = MHD_queue_response(connection, not_modified ? MHD_HTTP_NOT_MODIFIED : MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
+    return ret;
 }
 
-void update_ctxt_gauge()
+/**
+ * @brief Toma un contexto del pool (o crea uno) al recibir la línea de petición.
+ *
+ * libmicrohttpd la invoca una vez por petición, también en conexiones keep-alive, y guarda el
+ * valor devuelto en `con_cls`.
+ *
+ * @return Contexto nuevo, o NULL si no hay memoria (la petición se rechaza).
+ */
+static void* request_started(void* cls, const char* uri, struct MHD_Connection* connection)
 {
-    double usage = get_ctxt_usage();
-    if (usage >= 0)
+    (void)cls;
+    (void)uri;
+    (void)connection;
+
+    pthread_mutex_lock(&request_pool_lock);
+    RequestContext* request = request_pool;
+    if (request != NULL)
     {
-        pthread_mutex_lock(&lock);
-        prom_gauge_set(ctxt_usage_metric, usage, NULL);
-        pthread_mutex_unlock(&lock);
-        // printf("Actualizando métrica de cambios de contextos: %f\n", usage);
+        request_pool = request->next;
+        request_pool_size--;
     }
-    else
+    pthread_mutex_unlock(&request_pool_lock);
+
+    if (request == NULL)
+    {
+        request = calloc(1, sizeof(RequestContext));
+        if (request == NULL)
+        {
+            return NULL;
+        }
+        arena_init(&request->arena, ARENA_DEFAULT_CHUNK_SIZE);
+    }
+    request->body = NULL;
+    request->response_bytes = 0;
+    buffer_init(&request->filtered);
+    request->start_ns = monotonic_ns();
+    metric_store_stage_add(requests_in_flight_metric, 1.0);
+    return request;
+}
+
+/**
+ * @brief Registra la duración y el tamaño de una petición terminada y devuelve su contexto al pool.
+ */
+static void request_completed(void* cls, struct MHD_Connection* connection, void** con_cls,
+                              enum MHD_RequestTerminationCode toe)
+{
+    (void)cls;
+    (void)connection;
+
+    RequestContext* request = *con_cls;
+    if (request == NULL)
+    {
+        return;
+    }
+
+    // Las peticiones abortadas no llegaron a enviar la respuesta completa
+    if (toe == MHD_REQUEST_TERMINATED_COMPLETED_OK)
+    {
+        metric_store_stage_observe(&request_duration_metric, (double)(monotonic_ns() - request->start_ns) / 1e9);
+        metric_store_stage_observe(&response_size_metric, (double)request->response_bytes);
+    }
+    metric_store_stage_add(requests_in_flight_metric, -1.0);
+
+    if (request->body != NULL)
     {
-        fprintf(stderr, "Error al obtener el numero de cambios de contexto\n");
+        exposition_cache_release(request->body);
+    }
+    *con_cls = NULL;
+
+    // Todo lo asignado durante la petición se descarta de una vez
+    arena_reset(&request->arena);
+    pthread_mutex_lock(&request_pool_lock);
+    if (request_pool_size < REQUEST_POOL_MAX)
+    {
+        request->next = request_pool;
+        request_pool = request;
+        request_pool_size++;
+        request = NULL;
+    }
+    pthread_mutex_unlock(&request_pool_lock);
+    if (request != NULL)
+    {
+        arena_destroy(&request->arena);
+        free(request);
     }
 }
 
@@ -137,14 +465,57 @@ void* expose_metrics(void* arg)
 {
     (void)arg; // Argumento no utilizado
 
-    // Aseguramos que el manejador HTTP esté adjunto al registro por defecto
-    promhttp_set_active_collector_registry(NULL);
+    // Las opciones del servidor solo se leen al iniciar
+    HttpConfig http = config_current_http();
+
+    unsigned int flags;
+    struct MHD_OptionItem mode_options[] = {
+        {MHD_OPTION_END, 0, NULL},
+        {MHD_OPTION_END, 0, NULL},
+    };
+    switch (http.mode)
+    {
+    case HTTP_MODE_EPOLL:
+        flags = MHD_USE_EPOLL_INTERNAL_THREAD;
+        mode_options[0] = (struct MHD_OptionItem){MHD_OPTION_THREAD_POOL_SIZE, http.threads, NULL};
+        break;
+    case HTTP_MODE_THREAD_PER_CONNECTION:
+        flags = MHD_USE_THREAD_PER_CONNECTION | MHD_USE_INTERNAL_POLLING_THREAD;
+        break;
+    default:
+        flags = MHD_USE_SELECT_INTERNALLY;
+        break;
+    }
 
-    // Iniciamos el servidor HTTP en el puerto 8000
-    struct MHD_Daemon* daemon = promhttp_start_daemon(MHD_USE_SELECT_INTERNALLY, 8000, NULL, NULL);
-    if (daemon == NULL)
+    // Un daemon por listener; todos comparten manejador, contexto de petición y caché
+    struct MHD_Daemon* daemons[HTTP_MAX_LISTENERS];
+    int started = 0;
+    for (int i = 0; i < http.listener_count; i++)
     {
-        fprintf(stderr, "Error al iniciar el servidor HTTP\n");
+        char name[HTTP_LISTENER_ADDRESS_SIZE + 16];
+        listener_describe(&http.listeners[i], name, sizeof(name));
+
+        int fd = listener_open(&http.listeners[i]);
+        if (fd < 0)
+        {
+            continue;
+        }
+        struct MHD_Daemon* daemon = MHD_start_daemon(
+            flags, 0, NULL, NULL, handle_request, NULL, MHD_OPTION_LISTEN_SOCKET, fd, MHD_OPTION_URI_LOG_CALLBACK,
+            request_started, NULL, MHD_OPTION_NOTIFY_COMPLETED, request_completed, NULL, MHD_OPTION_CONNECTION_LIMIT,
+            (unsigned int)http.connection_limit, MHD_OPTION_CONNECTION_TIMEOUT, (unsigned int)http.timeout,
+            MHD_OPTION_ARRAY, mode_options, MHD_OPTION_END);
+        if (daemon == NULL)
+        {
+            fprintf(stderr, "Error al iniciar el servidor HTTP en %s\n", name);
+            close(fd);
+            continue;
+        }
+        daemons[started++] = daemon;
+    }
+    if (started == 0)
+    {
+        fprintf(stderr, "Error al iniciar el servidor HTTP: ningún listener disponible\n");
         return NULL;
     }
 
@@ -155,106 +526,117 @@ void* expose_metrics(void* arg)
     }
 
     // Nunca debería llegar aquí
-    MHD_stop_daemon(daemon);
+    for (int i = 0; i < started; i++)
+    {
+        MHD_stop_daemon(daemons[i]);
+    }
     return NULL;
 }
 
 void init_metrics()
 {
-    // Inicializamos el mutex
-    if (pthread_mutex_init(&lock, NULL) != 0)
+    // Inicializamos el almacén de métricas, con lugar para las series sintéticas si las hay
+    if (metric_store_init(METRIC_STORE_DEFAULT_SERIES + synthetic_series_count()) != 0)
     {
-        fprintf(stderr, "Error al inicializar el mutex\n");
+        fprintf(stderr, "Error al inicializar el almacén de métricas\n");
     }
 
-    // Inicializamos el registro de coleccionistas de Prometheus
-    if (prom_collector_registry_default_init() != 0)
+    // Métricas propias de la exposición
+    if (exposition_init() != 0)
     {
-        fprintf(stderr, "Error al inicializar el registro de Prometheus\n");
+        fprintf(stderr, "Error al registrar las métricas de la exposición\n");
     }
 
-    // Creamos la métrica para el uso de CPU
-    cpu_usage_metric = prom_gauge_new("cpu_usage_percentage", "Porcentaje de uso de CPU", 0, NULL);
-    if (cpu_usage_metric == NULL)
+    // Raíces de procfs y sysfs de los collectors, antes de la primera recolección y del muestreo
+    PathsConfig paths = config_current_paths();
+    if (metrics_set_procfs_root(paths.procfs) != 0)
     {
-        fprintf(stderr, "Error al crear la métrica de uso de CPU\n");
+        fprintf(stderr, "Error al configurar la raíz de procfs, se usa /proc\n");
     }
-
-    // Creamos la métrica para el uso de memoria
-    memory_usage_metric = prom_gauge_new("memory_usage_percentage", "Porcentaje de uso de memoria", 0, NULL);
-    if (memory_usage_metric == NULL)
+    if (metrics_set_sysfs_root(paths.sysfs) != 0)
     {
-        fprintf(stderr, "Error al crear la métrica de uso de memoria\n");
+        fprintf(stderr, "Error al configurar la raíz de sysfs, se usa /sys\n");
     }
 
-    // Creamos la métrica para la cantidad de memoria fragmentada
-    memory_fragmentation_metric = prom_gauge_new("memory_fragmentation_percentage", "Porcentaje de memoria fragmentada", 0, NULL);
-    if (memory_fragmentation_metric == NULL)
+    // Métricas de la recolección y función que recolecta las métricas del sistema
+    if (collection_init() != 0 || collection_add_callback(collect_system_metrics, NULL) != 0)
     {
-        fprintf(stderr, "Error al crear la métrica de memoria fragmentada\n");
+        fprintf(stderr, "Error al registrar la recolección de métricas\n");
     }
 
-    // Creamos la métrica para el uso del disco
-    disk_usage_metric = prom_gauge_new("disk_usage", "Lecturas y escrituras totales completadas del disco", 0, NULL);
-    if (disk_usage_metric == NULL)
+    // Envío por remote_write, si está configurado; se engancha tras cada publicación
+    if (remote_write_init() != 0)
     {
-        fprintf(stderr, "Error al crear la métrica de uso del disco\n");
+        fprintf(stderr, "Error al iniciar el envío por remote_write\n");
     }
 
-    // Creamos la métrica para los bytes recibidos y enviados de la red
-    network_usage_metric =
-        prom_gauge_new("network_usage_metric", "Bytes totales enviados por la interfaz de red", 0, NULL);
-    if (network_usage_metric == NULL)
+    // Envío en protocolo de líneas (Graphite o StatsD), si está configurado
+    if (line_output_init() != 0)
     {
-        fprintf(stderr, "Error al crear la métrica de bytes totales\n");
+        fprintf(stderr, "Error al iniciar el envío a Graphite/StatsD\n");
     }
 
-    // Creamos la métrica para el uso de los procesos en ejecucion
-    procs_usage_metric = prom_gauge_new("procs_usage_count", "Cantidad de procesos en ejecucion", 0, NULL);
-    if (procs_usage_metric == NULL)
+    // Historia local en un archivo mapeado, si está configurada
+    if (history_init() != 0)
     {
-        fprintf(stderr, "Error al crear la métrica de cantidad de procesos\n");
+        fprintf(stderr, "Error al iniciar la historia local\n");
     }
 
-    // Creamos la métrica para el numero de cambios de contextos desde que inicio el sistema
-    ctxt_usage_metric = prom_gauge_new("ctxt_usage_count", "Cantidad de cambios de contexto", 0, NULL);
-    if (ctxt_usage_metric == NULL)
+    // Muestreo de alta frecuencia en su propio hilo, si está configurado
+    if (sampler_init() != 0)
     {
-        fprintf(stderr, "Error al crear la métrica de cantidad de cambios de contextos\n");
+        fprintf(stderr, "Error al iniciar el muestreo de alta frecuencia\n");
     }
 
-    // Registramos las métricas en el registro por defecto
-    if (prom_collector_registry_must_register_metric(memory_usage_metric) == NULL)
+    // Envío persistente al monitor por FIFO, si está configurado
+    if (monitor_fifo_init() != 0)
     {
-        fprintf(stderr, "Error al registrar las métricas - memoria\n");
+        fprintf(stderr, "Error al iniciar el envío al monitor por FIFO\n");
     }
-    if (prom_collector_registry_must_register_metric(memory_fragmentation_metric) == NULL)
+
+    // Segmento de memoria compartida para consumidores locales, si está configurado
+    if (shm_output_init() != 0)
     {
-        fprintf(stderr, "Error al registrar las métricas - memoria fragmentada\n");
+        fprintf(stderr, "Error al publicar el segmento de memoria compartida\n");
     }
-    if (prom_collector_registry_must_register_metric(cpu_usage_metric) == NULL)
+
+    // Socket de suscripción para varios consumidores locales, si está configurado
+    if (pubsub_init() != 0)
     {
-        fprintf(stderr, "Error al registrar las métricas - cpu\n");
+        fprintf(stderr, "Error al abrir el socket de suscripción\n");
     }
-    if (prom_collector_registry_must_register_metric(disk_usage_metric) == NULL)
-    {
-        fprintf(stderr, "Error al registrar las métricas - disk\n");
+
+    // Métricas del servidor HTTP
+    int duration_family = metric_store_add_family("http_request_duration_seconds",
+                                                  "Duración de las peticiones HTTP", METRIC_TYPE_HISTOGRAM);
+    int size_family =
+        metric_store_add_family("http_response_size_bytes", "Tamaño de las respuestas HTTP", METRIC_TYPE_HISTOGRAM);
+    requests_in_flight_metric =
+        metric_store_register("http_requests_in_flight", "Peticiones HTTP en curso", METRIC_TYPE_GAUGE);
+    if (duration_family < 0 || size_family < 0 || requests_in_flight_metric == METRIC_SERIES_INVALID ||
+        metric_store_add_histogram(duration_family, "", request_duration_bounds,
+                                   sizeof(request_duration_bounds) / sizeof(request_duration_bounds[0]),
+                                   &request_duration_metric) != 0 ||
+        metric_store_add_histogram(size_family, "", response_size_bounds,
+                                   sizeof(response_size_bounds) / sizeof(response_size_bounds[0]),
+                                   &response_size_metric) != 0)
+    {
+        fprintf(stderr, "Error al registrar las métricas del servidor HTTP\n");
     }
-    if (prom_collector_registry_must_register_metric(network_usage_metric) == NULL)
+    else
     {
-        fprintf(stderr, "Error al registrar las métricas - bytes totales\n");
+        metric_store_stage_add(requests_in_flight_metric, 0.0);
     }
-    if (prom_collector_registry_must_register_metric(procs_usage_metric) == NULL)
+
+    // Métricas del sistema; las salidas iniciadas antes las resuelven por nombre de familia
+    if (collector_plan_init() != 0)
     {
-        fprintf(stderr, "Error al registrar las métricas - procesos\n");
+        fprintf(stderr, "Error al registrar las métricas del sistema\n");
     }
-    if (prom_collector_registry_must_register_metric(ctxt_usage_metric) == NULL)
+
+    // Series sintéticas para pruebas de carga, si están configuradas
+    if (synthetic_init() != 0)
     {
-        fprintf(stderr, "Error al registrar las métricas - cambios de contexto\n");
+        fprintf(stderr, "Error al registrar las series sintéticas\n");
     }
 }
-
-void destroy_mutex()
-{
-    pthread_mutex_destroy(&lock);
-}
@@ -0,0 +1,962 @@
+#include "../include/exposition.h"
+#include "../include/config.h"
+#include "../include/protobuf.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Tamaño del buffer para formatear un valor numérico.
+ */
+#define VALUE_BUFFER_SIZE 32
+
+/**
+ * @brief Tamaño del buffer para copiar un rango de medios del encabezado Accept.
+ */
+#define MEDIA_RANGE_SIZE 256
+
+/**
+ * @brief Valores del enum MetricType de metrics.proto.
+ */
+enum
+{
+    PB_METRIC_TYPE_COUNTER = 0,
+    PB_METRIC_TYPE_GAUGE = 1,
+    PB_METRIC_TYPE_HISTOGRAM = 4
+};
+
+/**
+ * @brief Tamaño del campo Gauge/Counter de un Metric: clave, longitud y double (campo 1).
+ */
+#define PB_VALUE_FIELD_SIZE 11
+
+/**
+ * @brief Función que renderiza una familia con los valores de una generación.
+ */
+typedef void (*FamilyRenderer)(Buffer* out, const MetricFamily* family, const double* values);
+
+/**
+ * @brief Estados de una versión comprimida de un cuerpo.
+ */
+enum
+{
+    VARIANT_EMPTY,    /**< Todavía no se pidió. */
+    VARIANT_ENCODING, /**< Un scrape la está comprimiendo. */
+    VARIANT_READY,    /**< Lista para servirse. */
+    VARIANT_FAILED    /**< La compresión falló; se sirve identity. */
+};
+
+/** Protege el pool de cuerpos, el cuerpo vigente y el estado de renderizado */
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Señala que terminó un renderizado */
+static pthread_cond_t cache_rendered = PTHREAD_COND_INITIALIZER;
+
+/** Cuerpo de la generación más reciente renderizada, por formato */
+static ExpositionBody* cache_current[EXPOSITION_FORMAT_COUNT];
+
+/** Pool de cuerpos; uno se reutiliza cuando no es el vigente y no tiene referencias */
+static ExpositionBody* cache_pool;
+
+/** Indica que un scrape está renderizando una generación nueva, por formato */
+static int cache_rendering[EXPOSITION_FORMAT_COUNT];
+
+/** Duración de la última compresión por codificación */
+static MetricSeries compression_seconds_metric[CONTENT_ENCODING_COUNT];
+
+/** Relación tamaño original / comprimido de la última compresión por codificación */
+static MetricSeries compression_ratio_metric[CONTENT_ENCODING_COUNT];
+
+/** Identificador de esta ejecución: evita que un ETag de un proceso anterior coincida */
+static unsigned long cache_instance;
+
+int exposition_init()
+{
+    int seconds_family = metric_store_add_family("metrics_compression_duration_seconds",
+                                                 "Duración de la última compresión de /metrics", METRIC_TYPE_GAUGE);
+    int ratio_family = metric_store_add_family(
+        "metrics_compression_ratio", "Relación tamaño original / comprimido de /metrics", METRIC_TYPE_GAUGE);
+    if (seconds_family < 0 || ratio_family < 0)
+    {
+        return -1;
+    }
+
+    char labels[64];
+    for (int encoding = CONTENT_ENCODING_GZIP; encoding < CONTENT_ENCODING_COUNT; encoding++)
+    {
+        snprintf(labels, sizeof(labels), "{encoding=\"%s\"}", content_encoding_name((ContentEncoding)encoding));
+        compression_seconds_metric[encoding] = metric_store_add_series(seconds_family, labels);
+        compression_ratio_metric[encoding] = metric_store_add_series(ratio_family, labels);
+    }
+    return 0;
+}
+
+/**
+ * @brief Nombre del tipo de una familia en los formatos de texto.
+ * @param type Tipo de la familia.
+ * @return "gauge", "counter" o "histogram".
+ */
+static const char* type_name(MetricType type)
+{
+    switch (type)
+    {
+    case METRIC_TYPE_COUNTER:
+        return "counter";
+    case METRIC_TYPE_HISTOGRAM:
+        return "histogram";
+    default:
+        return "gauge";
+    }
+}
+
+/**
+ * @brief Formatea un valor según la sintaxis de Prometheus (+Inf, -Inf, NaN).
+ * @param buf Buffer destino de al menos VALUE_BUFFER_SIZE bytes.
+ * @param value Valor a formatear.
+ * @return Cantidad de caracteres escritos.
+ */
+static int format_value(char* buf, double value)
+{
+    if (isinf(value))
+    {
+        return snprintf(buf, VALUE_BUFFER_SIZE, "%s", value > 0 ? "+Inf" : "-Inf");
+    }
+    return snprintf(buf, VALUE_BUFFER_SIZE, "%.17g", value);
+}
+
+/**
+ * @brief Agrega el texto de ayuda escapando barras invertidas y saltos de línea.
+ * @param out Buffer destino.
+ * @param help Texto de ayuda.
+ * @param escape_quotes Si también deben escaparse las comillas (OpenMetrics).
+ */
+static void append_help(Buffer* out, const char* help, int escape_quotes)
+{
+    for (const char* c = help; *c != '\0'; c++)
+    {
+        if (*c == '\\')
+        {
+            buffer_append(out, "\\\\", 2);
+        }
+        else if (*c == '\n')
+        {
+            buffer_append(out, "\\n", 2);
+        }
+        else if (*c == '"' && escape_quotes)
+        {
+            buffer_append(out, "\\\"", 2);
+        }
+        else
+        {
+            buffer_append_char(out, *c);
+        }
+    }
+}
+
+/**
+ * @brief Renderiza una familia en formato de texto con los valores de una generación.
+ * @param out Buffer destino.
+ * @param family Familia a renderizar.
+ * @param values Buffer de valores de la generación.
+ */
+static void render_text_family(Buffer* out, const MetricFamily* family, const double* values)
+{
+    int header_written = 0;
+    char value[VALUE_BUFFER_SIZE];
+
+    MetricSeries series = atomic_load_explicit(&family->head, memory_order_acquire);
+    while (series != METRIC_SERIES_INVALID)
+    {
+        const MetricSeriesInfo* info = metric_store_series(series);
+        double sample = values[series];
+
+        if (!isnan(sample))
+        {
+            // La cabecera se escribe recién con la primera serie presente
+            if (!header_written)
+            {
+                buffer_printf(out, "# HELP %s ", family->name);
+                append_help(out, family->help, 0);
+                buffer_printf(out, "\n# TYPE %s %s\n", family->name, type_name(family->type));
+                header_written = 1;
+            }
+
+            int len = format_value(value, sample);
+            buffer_append_str(out, family->name);
+            buffer_append_str(out, info->suffix);
+            buffer_append_str(out, info->labels);
+            buffer_append_char(out, ' ');
+            buffer_append(out, value, (size_t)len);
+            buffer_append_char(out, '\n');
+        }
+
+        series = atomic_load_explicit(&info->next, memory_order_acquire);
+    }
+}
+
+/**
+ * @brief Renderiza una familia en formato OpenMetrics.
+ *
+ * Los contadores se exponen con el nombre de familia sin `_total` y las muestras con él.
+ *
+ * @param out Buffer destino.
+ * @param family Familia a renderizar.
+ * @param values Buffer de valores de la generación.
+ */
+static void render_openmetrics_family(Buffer* out, const MetricFamily* family, const double* values)
+{
+    int header_written = 0;
+    char value[VALUE_BUFFER_SIZE];
+    int counter = family->type == METRIC_TYPE_COUNTER;
+    size_t name_len = strlen(family->name);
+    int has_total = name_len > 6 && strcmp(family->name + name_len - 6, "_total") == 0;
+    size_t family_len = counter && has_total ? name_len - 6 : name_len;
+
+    MetricSeries series = atomic_load_explicit(&family->head, memory_order_acquire);
+    while (series != METRIC_SERIES_INVALID)
+    {
+        const MetricSeriesInfo* info = metric_store_series(series);
+        double sample = values[series];
+
+        if (!isnan(sample))
+        {
+            if (!header_written)
+            {
+                buffer_printf(out, "# TYPE %.*s %s\n# HELP %.*s ", (int)family_len, family->name,
+                              type_name(family->type), (int)family_len, family->name);
+                append_help(out, family->help, 1);
+                buffer_append_char(out, '\n');
+                header_written = 1;
+            }
+
+            int len = format_value(value, sample);
+            buffer_append(out, family->name, family_len);
+            if (counter)
+            {
+                buffer_append(out, "_total", 6);
+            }
+            buffer_append_str(out, info->suffix);
+            buffer_append_str(out, info->labels);
+            buffer_append_char(out, ' ');
+            buffer_append(out, value, (size_t)len);
+            buffer_append_char(out, '\n');
+        }
+
+        series = atomic_load_explicit(&info->next, memory_order_acquire);
+    }
+}
+
+/**
+ * @brief Tamaño de los pares de etiquetas de un Metric protobuf.
+ * @param info Descriptor de la serie con las etiquetas.
+ * @return Bytes de los campos LabelPair.
+ */
+static size_t protobuf_labels_size(const MetricSeriesInfo* info)
+{
+    size_t size = 0;
+    for (size_t i = 0; i < info->label_count; i++)
+    {
+        size_t pair = pb_length_field_size(1, strlen(info->label_pairs[2 * i])) +
+                      pb_length_field_size(2, strlen(info->label_pairs[2 * i + 1]));
+        size += pb_length_field_size(1, pair);
+    }
+    return size;
+}
+
+/**
+ * @brief Escribe los pares de etiquetas de un Metric protobuf.
+ * @param out Buffer destino.
+ * @param info Descriptor de la serie con las etiquetas.
+ */
+static void protobuf_put_labels(Buffer* out, const MetricSeriesInfo* info)
+{
+    for (size_t i = 0; i < info->label_count; i++)
+    {
+        size_t name = strlen(info->label_pairs[2 * i]);
+        size_t value = strlen(info->label_pairs[2 * i + 1]);
+        pb_put_message_header(out, 1, pb_length_field_size(1, name) + pb_length_field_size(2, value));
+        pb_put_bytes(out, 1, info->label_pairs[2 * i], name);
+        pb_put_bytes(out, 2, info->label_pairs[2 * i + 1], value);
+    }
+}
+
+/**
+ * @brief Tamaño del mensaje Metric protobuf de una serie.
+ * @param info Descriptor de la serie.
+ * @return Bytes del mensaje (sin su clave ni longitud).
+ */
+static size_t protobuf_metric_size(const MetricSeriesInfo* info)
+{
+    return PB_VALUE_FIELD_SIZE + protobuf_labels_size(info);
+}
+
+/**
+ * @brief Tamaño del mensaje Histogram protobuf de un histograma registrado.
+ * @param first Primer bucket del histograma.
+ * @param buckets Cantidad de buckets (con +Inf, que no se codifica).
+ * @param values Buffer de valores de la generación.
+ * @return Bytes del mensaje Histogram.
+ */
+static size_t protobuf_histogram_size(MetricSeries first, uint32_t buckets, const double* values)
+{
+    size_t size = 1 + pb_varint_size((uint64_t)values[first + buckets + 1]) + 9;
+    for (uint32_t i = 0; i + 1 < buckets; i++)
+    {
+        size_t bucket = 1 + pb_varint_size((uint64_t)values[first + i]) + 9;
+        size += pb_length_field_size(3, bucket);
+    }
+    return size;
+}
+
+/**
+ * @brief Renderiza una familia de histogramas como MetricFamily protobuf.
+ *
+ * Cada histograma (buckets, _sum y _count consecutivos) se agrupa en un único Metric con las
+ * etiquetas comunes; el bucket +Inf queda implícito en sample_count.
+ *
+ * @param out Buffer destino.
+ * @param family Familia a renderizar.
+ * @param values Buffer de valores de la generación.
+ */
+static void render_protobuf_histogram_family(Buffer* out, const MetricFamily* family, const double* values)
+{
+    size_t metrics_size = 0;
+
+    MetricSeries head = atomic_load_explicit(&family->head, memory_order_acquire);
+    for (MetricSeries series = head; series != METRIC_SERIES_INVALID;)
+    {
+        const MetricSeriesInfo* info = metric_store_series(series);
+        uint32_t buckets = info->histogram_buckets;
+        if (buckets > 0 && !isnan(values[series + buckets + 1]))
+        {
+            const MetricSeriesInfo* sum = metric_store_series(series + buckets);
+            size_t histogram = protobuf_histogram_size(series, buckets, values);
+            metrics_size +=
+                pb_length_field_size(4, protobuf_labels_size(sum) + pb_length_field_size(7, histogram));
+        }
+        series = atomic_load_explicit(&info->next, memory_order_acquire);
+    }
+    if (metrics_size == 0)
+    {
+        return;
+    }
+
+    size_t name_len = strlen(family->name);
+    size_t help_len = strlen(family->help);
+    pb_put_varint(out, pb_length_field_size(1, name_len) + pb_length_field_size(2, help_len) + 2 + metrics_size);
+    pb_put_bytes(out, 1, family->name, name_len);
+    pb_put_bytes(out, 2, family->help, help_len);
+    pb_put_uint64(out, 3, PB_METRIC_TYPE_HISTOGRAM);
+
+    for (MetricSeries series = head; series != METRIC_SERIES_INVALID;)
+    {
+        const MetricSeriesInfo* info = metric_store_series(series);
+        uint32_t buckets = info->histogram_buckets;
+        if (buckets > 0 && !isnan(values[series + buckets + 1]))
+        {
+            const MetricSeriesInfo* sum = metric_store_series(series + buckets);
+            size_t histogram = protobuf_histogram_size(series, buckets, values);
+            pb_put_message_header(out, 4, protobuf_labels_size(sum) + pb_length_field_size(7, histogram));
+            protobuf_put_labels(out, sum);
+            pb_put_message_header(out, 7, histogram);
+            pb_put_uint64(out, 1, (uint64_t)values[series + buckets + 1]);
+            pb_put_double(out, 2, values[series + buckets]);
+            for (uint32_t i = 0; i + 1 < buckets; i++)
+            {
+                pb_put_message_header(out, 3, 1 + pb_varint_size((uint64_t)values[series + i]) + 9);
+                pb_put_uint64(out, 1, (uint64_t)values[series + i]);
+                pb_put_double(out, 2, metric_store_series(series + i)->bound);
+            }
+        }
+        series = atomic_load_explicit(&info->next, memory_order_acquire);
+    }
+}
+
+/**
+ * @brief Renderiza una familia como MetricFamily protobuf precedido por su longitud.
+ *
+ * Primero calcula los tamaños de los mensajes anidados y luego escribe todo en una sola
+ * pasada, sin buffers intermedios.
+ *
+ * @param out Buffer destino.
+ * @param family Familia a renderizar.
+ * @param values Buffer de valores de la generación.
+ */
+static void render_protobuf_family(Buffer* out, const MetricFamily* family, const double* values)
+{
+    size_t metrics_size = 0;
+    size_t present = 0;
+
+    if (family->type == METRIC_TYPE_HISTOGRAM)
+    {
+        render_protobuf_histogram_family(out, family, values);
+        return;
+    }
+
+    MetricSeries head = atomic_load_explicit(&family->head, memory_order_acquire);
+    for (MetricSeries series = head; series != METRIC_SERIES_INVALID;)
+    {
+        const MetricSeriesInfo* info = metric_store_series(series);
+        if (!isnan(values[series]))
+        {
+            metrics_size += pb_length_field_size(4, protobuf_metric_size(info));
+            present++;
+        }
+        series = atomic_load_explicit(&info->next, memory_order_acquire);
+    }
+    if (present == 0)
+    {
+        return;
+    }
+
+    int counter = family->type == METRIC_TYPE_COUNTER;
+    size_t name_len = strlen(family->name);
+    size_t help_len = strlen(family->help);
+    size_t family_size = pb_length_field_size(1, name_len) + pb_length_field_size(2, help_len) + 2 + metrics_size;
+
+    pb_put_varint(out, family_size);
+    pb_put_bytes(out, 1, family->name, name_len);
+    pb_put_bytes(out, 2, family->help, help_len);
+    pb_put_uint64(out, 3, counter ? PB_METRIC_TYPE_COUNTER : PB_METRIC_TYPE_GAUGE);
+
+    // Segunda pasada: la cantidad de series solo crece, así que se escriben las mismas `present`
+    size_t written = 0;
+    for (MetricSeries series = head; series != METRIC_SERIES_INVALID && written < present;)
+    {
+        const MetricSeriesInfo* info = metric_store_series(series);
+        if (!isnan(values[series]))
+        {
+            pb_put_message_header(out, 4, protobuf_metric_size(info));
+            protobuf_put_labels(out, info);
+            pb_put_message_header(out, counter ? 3 : 2, 9);
+            pb_put_double(out, 1, values[series]);
+            written++;
+        }
+        series = atomic_load_explicit(&info->next, memory_order_acquire);
+    }
+}
+
+/**
+ * @brief Renderiza todas las familias con el renderizador indicado sobre una generación consistente.
+ * @param out Buffer de salida.
+ * @param renderer Renderizador de familias.
+ * @param trailer Texto final (por ejemplo "# EOF\n"), o NULL.
+ * @param fragments Recibe la porción de cada familia (METRIC_STORE_MAX_FAMILIES elementos), o NULL.
+ * @param family_count Recibe la cantidad de familias renderizadas, o NULL.
+ * @return Generación renderizada.
+ */
+static uint64_t render_consistent(Buffer* out, FamilyRenderer renderer, const char* trailer,
+                                  ExpositionFragment* fragments, size_t* family_count)
+{
+    const double* values;
+    uint64_t generation;
+    size_t count;
+
+    do
+    {
+        buffer_reset(out);
+        generation = metric_store_read_begin(&values);
+
+        count = metric_store_family_count();
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t start = out->len;
+            renderer(out, metric_store_family(i), values);
+            if (fragments != NULL)
+            {
+                fragments[i].offset = start;
+                fragments[i].length = out->len - start;
+            }
+        }
+    } while (!metric_store_read_valid(generation));
+
+    if (trailer != NULL)
+    {
+        buffer_append_str(out, trailer);
+    }
+    if (family_count != NULL)
+    {
+        *family_count = count;
+    }
+    return generation;
+}
+
+/**
+ * @brief Renderiza un formato registrando opcionalmente la porción de cada familia.
+ * @param format Formato de salida.
+ * @param out Buffer de salida.
+ * @param fragments Recibe la porción de cada familia, o NULL.
+ * @param family_count Recibe la cantidad de familias renderizadas, o NULL.
+ * @return Generación renderizada.
+ */
+static uint64_t render_format(ExpositionFormat format, Buffer* out, ExpositionFragment* fragments,
+                              size_t* family_count)
+{
+    switch (format)
+    {
+    case EXPOSITION_FORMAT_OPENMETRICS:
+        return render_consistent(out, render_openmetrics_family, "# EOF\n", fragments, family_count);
+    case EXPOSITION_FORMAT_PROTOBUF:
+        return render_consistent(out, render_protobuf_family, NULL, fragments, family_count);
+    default:
+        return render_consistent(out, render_text_family, NULL, fragments, family_count);
+    }
+}
+
+uint64_t exposition_render_text(Buffer* out)
+{
+    return render_format(EXPOSITION_FORMAT_TEXT, out, NULL, NULL);
+}
+
+uint64_t exposition_render(ExpositionFormat format, Buffer* out)
+{
+    return render_format(format, out, NULL, NULL);
+}
+
+/**
+ * @brief Compara dos índices de familia por nombre, para qsort.
+ */
+static int compare_family_names(const void* a, const void* b)
+{
+    return strcmp(metric_store_family(*(const uint16_t*)a)->name, metric_store_family(*(const uint16_t*)b)->name);
+}
+
+/**
+ * @brief Primera posición del índice por nombre cuyo nombre no es menor que `key`.
+ * @param body Cuerpo con el índice.
+ * @param key Nombre o prefijo buscado.
+ * @param key_len Caracteres de `key` a comparar.
+ * @return Posición en `body->by_name` (family_count si no hay ninguna).
+ */
+static size_t family_lower_bound(const ExpositionBody* body, const char* key, size_t key_len)
+{
+    size_t low = 0;
+    size_t high = body->family_count;
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (strncmp(metric_store_family(body->by_name[mid])->name, key, key_len) < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+const char* exposition_content_type(ExpositionFormat format)
+{
+    switch (format)
+    {
+    case EXPOSITION_FORMAT_OPENMETRICS:
+        return EXPOSITION_OPENMETRICS_CONTENT_TYPE;
+    case EXPOSITION_FORMAT_PROTOBUF:
+        return EXPOSITION_PROTOBUF_CONTENT_TYPE;
+    default:
+        return EXPOSITION_TEXT_CONTENT_TYPE;
+    }
+}
+
+/**
+ * @brief Nombre corto de un formato para los ETags.
+ * @param format Formato.
+ * @return Nombre corto.
+ */
+static const char* format_tag(ExpositionFormat format)
+{
+    switch (format)
+    {
+    case EXPOSITION_FORMAT_OPENMETRICS:
+        return "om";
+    case EXPOSITION_FORMAT_PROTOBUF:
+        return "pb";
+    default:
+        return "txt";
+    }
+}
+
+ExpositionFormat negotiate_exposition_format(const char* accept)
+{
+    ExpositionFormat best = EXPOSITION_FORMAT_TEXT;
+    double best_q = -1.0;
+    char range[MEDIA_RANGE_SIZE];
+
+    if (accept == NULL)
+    {
+        return best;
+    }
+
+    const char* cursor = accept;
+    while (*cursor != '\0')
+    {
+        while (*cursor == ' ' || *cursor == ',')
+        {
+            cursor++;
+        }
+        const char* end = strchr(cursor, ',');
+        size_t len = end ? (size_t)(end - cursor) : strlen(cursor);
+        size_t copy = len < sizeof(range) - 1 ? len : sizeof(range) - 1;
+        memcpy(range, cursor, copy);
+        range[copy] = '\0';
+        cursor += len;
+
+        const char* q_param = strstr(range, "q=");
+        double q = q_param != NULL && (q_param == range || q_param[-1] == ';' || q_param[-1] == ' ')
+                       ? strtod(q_param + 2, NULL)
+                       : 1.0;
+
+        int candidate = -1;
+        if (strncmp(range, "application/vnd.google.protobuf", 31) == 0)
+        {
+            if (strstr(range, "proto=io.prometheus.client.MetricFamily") != NULL &&
+                strstr(range, "encoding=delimited") != NULL)
+            {
+                candidate = EXPOSITION_FORMAT_PROTOBUF;
+            }
+        }
+        else if (strncmp(range, "application/openmetrics-text", 28) == 0)
+        {
+            candidate = EXPOSITION_FORMAT_OPENMETRICS;
+        }
+        else if (strncmp(range, "text/plain", 10) == 0 || strncmp(range, "text/*", 6) == 0 ||
+                 strncmp(range, "*/*", 3) == 0)
+        {
+            candidate = EXPOSITION_FORMAT_TEXT;
+        }
+
+        if (candidate < 0 || q <= 0.0)
+        {
+            continue;
+        }
+        if (q > best_q || (q == best_q && candidate > (int)best))
+        {
+            best_q = q;
+            best = (ExpositionFormat)candidate;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * @brief Obtiene un cuerpo libre del pool o crea uno nuevo. Requiere `cache_lock`.
+ * @return Cuerpo libre, o NULL si no hay memoria.
+ */
+static ExpositionBody* take_free_body()
+{
+    for (ExpositionBody* body = cache_pool; body != NULL; body = body->next)
+    {
+        if (body->refs == 0 && body != cache_current[body->format])
+        {
+            return body;
+        }
+    }
+
+    ExpositionBody* body = calloc(1, sizeof(ExpositionBody));
+    if (body == NULL)
+    {
+        return NULL;
+    }
+    buffer_init(&body->content);
+    body->next = cache_pool;
+    cache_pool = body;
+    return body;
+}
+
+const ExpositionBody* exposition_cache_acquire(ExpositionFormat format)
+{
+    uint64_t wanted = metric_store_generation();
+    ExpositionBody* body = NULL;
+
+    pthread_mutex_lock(&cache_lock);
+    if (cache_instance == 0)
+    {
+        cache_instance = ((unsigned long)time(NULL) << 16) ^ (unsigned long)getpid();
+    }
+
+    while (body == NULL)
+    {
+        ExpositionBody* current = cache_current[format];
+        if (current != NULL && current->generation >= wanted)
+        {
+            body = current;
+            body->refs++;
+            break;
+        }
+
+        if (cache_rendering[format])
+        {
+            // Otro scrape ya está renderizando: compartir su resultado
+            pthread_cond_wait(&cache_rendered, &cache_lock);
+            continue;
+        }
+
+        ExpositionBody* target = take_free_body();
+        if (target == NULL)
+        {
+            break;
+        }
+        target->refs = 1;
+        target->format = format;
+        for (int encoding = 0; encoding < CONTENT_ENCODING_COUNT; encoding++)
+        {
+            target->encoded[encoding].state = VARIANT_EMPTY;
+        }
+        cache_rendering[format] = 1;
+        pthread_mutex_unlock(&cache_lock);
+
+        // El renderizado ocurre fuera del lock: los scrapes de la generación vigente no esperan
+        uint64_t generation = render_format(format, &target->content, target->fragments, &target->family_count);
+        for (size_t i = 0; i < target->family_count; i++)
+        {
+            target->by_name[i] = (uint16_t)i;
+        }
+        qsort(target->by_name, target->family_count, sizeof(target->by_name[0]), compare_family_names);
+        snprintf(target->etag, sizeof(target->etag), "\"%lx-%llx-%s\"", cache_instance,
+                 (unsigned long long)generation, format_tag(format));
+
+        pthread_mutex_lock(&cache_lock);
+        target->generation = generation;
+        cache_current[format] = target;
+        cache_rendering[format] = 0;
+        pthread_cond_broadcast(&cache_rendered);
+        body = target;
+    }
+    pthread_mutex_unlock(&cache_lock);
+
+    return body;
+}
+
+void exposition_cache_release(const ExpositionBody* body)
+{
+    pthread_mutex_lock(&cache_lock);
+    ((ExpositionBody*)body)->refs--;
+    pthread_mutex_unlock(&cache_lock);
+}
+
+unsigned exposition_enabled_encodings()
+{
+    unsigned token;
+    const ConfigSnapshot* config = config_read_lock(&token);
+    unsigned enabled = 1u << CONTENT_ENCODING_IDENTITY;
+    if (config->exposition.gzip_level > 0)
+    {
+        enabled |= 1u << CONTENT_ENCODING_GZIP;
+    }
+#ifdef HAVE_ZSTD
+    if (config->exposition.zstd_level > 0)
+    {
+        enabled |= 1u << CONTENT_ENCODING_ZSTD;
+    }
+#endif
+    config_read_unlock(token);
+    return enabled;
+}
+
+/**
+ * @brief Nivel de compresión configurado para una codificación.
+ * @param encoding Codificación.
+ * @return Nivel de la configuración vigente.
+ */
+static int configured_level(ContentEncoding encoding)
+{
+    unsigned token;
+    const ConfigSnapshot* config = config_read_lock(&token);
+    int level = encoding == CONTENT_ENCODING_ZSTD ? config->exposition.zstd_level : config->exposition.gzip_level;
+    config_read_unlock(token);
+    return level;
+}
+
+ContentEncoding exposition_cache_encoded(const ExpositionBody* body, ContentEncoding encoding, const char** data,
+                                         size_t* len, const char** etag)
+{
+    ExpositionBody* shared = (ExpositionBody*)body;
+
+    *data = body->content.data;
+    *len = body->content.len;
+    *etag = body->etag;
+    if (encoding == CONTENT_ENCODING_IDENTITY || encoding >= CONTENT_ENCODING_COUNT)
+    {
+        return CONTENT_ENCODING_IDENTITY;
+    }
+
+    ExpositionVariant* variant = &shared->encoded[encoding];
+
+    pthread_mutex_lock(&cache_lock);
+    while (variant->state == VARIANT_ENCODING)
+    {
+        pthread_cond_wait(&cache_rendered, &cache_lock);
+    }
+    int state = variant->state;
+    if (state == VARIANT_EMPTY)
+    {
+        variant->state = VARIANT_ENCODING;
+    }
+    pthread_mutex_unlock(&cache_lock);
+
+    if (state == VARIANT_EMPTY)
+    {
+        // Este scrape comprime; el cuerpo no cambia mientras tenga la referencia
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        int ret = compress_buffer(encoding, configured_level(encoding), body->content.data, body->content.len,
+                                  &variant->data);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        if (ret == 0)
+        {
+            snprintf(variant->etag, sizeof(variant->etag), "\"%lx-%llx-%s-%s\"", cache_instance,
+                     (unsigned long long)body->generation, format_tag(body->format), content_encoding_name(encoding));
+            double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+            metric_store_stage(compression_seconds_metric[encoding], seconds);
+            if (variant->data.len > 0)
+            {
+                metric_store_stage(compression_ratio_metric[encoding],
+                                   (double)body->content.len / (double)variant->data.len);
+            }
+        }
+
+        pthread_mutex_lock(&cache_lock);
+        variant->state = ret == 0 ? VARIANT_READY : VARIANT_FAILED;
+        state = variant->state;
+        pthread_cond_broadcast(&cache_rendered);
+        pthread_mutex_unlock(&cache_lock);
+    }
+
+    if (state != VARIANT_READY)
+    {
+        return CONTENT_ENCODING_IDENTITY;
+    }
+
+    *data = variant->data.data;
+    *len = variant->data.len;
+    *etag = variant->etag;
+    return encoding;
+}
+
+ContentEncoding exposition_cache_filter(const ExpositionBody* body, const ExpositionFilter* filter,
+                                        ContentEncoding encoding, Buffer* out)
+{
+    unsigned char selected[METRIC_STORE_MAX_FAMILIES] = {0};
+    uint16_t order[METRIC_STORE_MAX_FAMILIES];
+    size_t count = 0;
+
+    for (size_t i = 0; i < filter->name_count; i++)
+    {
+        size_t len = strlen(filter->names[i]);
+        size_t pos = family_lower_bound(body, filter->names[i], len + 1);
+        if (pos < body->family_count && !selected[body->by_name[pos]] &&
+            strcmp(metric_store_family(body->by_name[pos])->name, filter->names[i]) == 0)
+        {
+            selected[body->by_name[pos]] = 1;
+            order[count++] = body->by_name[pos];
+        }
+    }
+    for (size_t i = 0; i < filter->prefix_count; i++)
+    {
+        size_t len = strlen(filter->prefixes[i]);
+        for (size_t pos = family_lower_bound(body, filter->prefixes[i], len); pos < body->family_count; pos++)
+        {
+            uint16_t family = body->by_name[pos];
+            if (strncmp(metric_store_family(family)->name, filter->prefixes[i], len) != 0)
+            {
+                break;
+            }
+            if (!selected[family])
+            {
+                selected[family] = 1;
+                order[count++] = family;
+            }
+        }
+    }
+
+    // Mismo orden que la respuesta completa: por registro
+    for (size_t i = 1; i < count; i++)
+    {
+        uint16_t family = order[i];
+        size_t j = i;
+        for (; j > 0 && order[j - 1] > family; j--)
+        {
+            order[j] = order[j - 1];
+        }
+        order[j] = family;
+    }
+
+    Buffer selection;
+    buffer_init(&selection);
+    Buffer* target = encoding == CONTENT_ENCODING_IDENTITY ? out : &selection;
+    buffer_reset(out);
+    for (size_t i = 0; i < count; i++)
+    {
+        const ExpositionFragment* fragment = &body->fragments[order[i]];
+        if (fragment->length > 0)
+        {
+            buffer_append(target, body->content.data + fragment->offset, fragment->length);
+        }
+    }
+    if (body->format == EXPOSITION_FORMAT_OPENMETRICS)
+    {
+        buffer_append_str(target, "# EOF\n");
+    }
+    if (target == out)
+    {
+        return CONTENT_ENCODING_IDENTITY;
+    }
+
+    int ret = compress_buffer(encoding, configured_level(encoding), selection.data, selection.len, out);
+    if (ret != 0)
+    {
+        // Sin compresión se envía la selección tal cual
+        buffer_reset(out);
+        buffer_append(out, selection.data, selection.len);
+        encoding = CONTENT_ENCODING_IDENTITY;
+    }
+    buffer_free(&selection);
+    return encoding;
+}
+
+int exposition_etag_matches(const char* if_none_match, const char* etag)
+{
+    if (if_none_match == NULL)
+    {
+        return 0;
+    }
+
+    size_t etag_len = strlen(etag);
+    const char* cursor = if_none_match;
+    while (*cursor != '\0')
+    {
+        while (*cursor == ' ' || *cursor == ',')
+        {
+            cursor++;
+        }
+        if (*cursor == '*')
+        {
+            return 1;
+        }
+
+        // Los validadores débiles (W/) se comparan igual que los fuertes para GET
+        if (strncmp(cursor, "W/", 2) == 0)
+        {
+            cursor += 2;
+        }
+        if (strncmp(cursor, etag, etag_len) == 0 &&
+            (cursor[etag_len] == '\0' || cursor[etag_len] == ',' || cursor[etag_len] == ' '))
+        {
+            return 1;
+        }
+
+        cursor = strchr(cursor, ',');
+        if (cursor == NULL)
+        {
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,865 @@
+#include "../include/history.h"
+#include "../include/collection.h"
+#include "../include/config.h"
+#include <fcntl.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Identifica el formato del archivo; cambia si cambia la disposición.
+ */
+#define HISTORY_MAGIC "PMHIST01"
+
+/**
+ * @brief Bytes de la cabecera del archivo (una página).
+ */
+#define HISTORY_HEADER_BYTES 4096
+
+/**
+ * @brief Bytes de la entrada de cada serie en la tabla de series.
+ */
+#define HISTORY_ENTRY_BYTES 256
+
+/**
+ * @brief Bits que puede ocupar un punto: 4 + 64 del timestamp y 2 + 5 + 6 + 64 del valor.
+ */
+#define HISTORY_MAX_POINT_BITS 145
+
+/**
+ * @brief Marca de `HistoryEncoder.leading` cuando todavía no hay ventana de bits significativos.
+ */
+#define HISTORY_NO_WINDOW 0xff
+
+/**
+ * @brief Marca de `slots` para las series del almacén que todavía no se buscaron en la historia.
+ */
+#define HISTORY_SLOT_UNKNOWN (-2)
+
+/**
+ * @brief Marca de `slots` para las series que no entran en la tabla o cuya clave es muy larga.
+ */
+#define HISTORY_SLOT_NONE (-1)
+
+/**
+ * @struct HistoryFileHeader
+ * @brief Cabecera del archivo; la geometría debe coincidir con la configuración para retomarlo.
+ */
+typedef struct
+{
+    char magic[8];                 /**< `HISTORY_MAGIC`. */
+    uint32_t chunk_bytes;          /**< `HISTORY_CHUNK_BYTES` al crearlo. */
+    uint32_t chunks_per_series;    /**< Chunks del anillo de cada serie. */
+    uint32_t max_series;           /**< Entradas de la tabla de series. */
+    _Atomic uint32_t series_count; /**< Entradas en uso; se publica con release tras llenar la entrada. */
+} HistoryFileHeader;
+
+/**
+ * @struct HistoryEntry
+ * @brief Entrada de la tabla de series.
+ */
+typedef struct
+{
+    char key[HISTORY_KEY_SIZE]; /**< Nombre, sufijo y etiquetas de la serie. */
+    _Atomic uint32_t head;      /**< Chunk que se está escribiendo. */
+    uint32_t reserved;          /**< Relleno hasta `HISTORY_ENTRY_BYTES`. */
+    uint64_t next_sequence;     /**< Secuencia del próximo chunk que se abra; nunca 0. */
+} HistoryEntry;
+
+_Static_assert(sizeof(HistoryEntry) == HISTORY_ENTRY_BYTES, "HistoryEntry debe ocupar HISTORY_ENTRY_BYTES");
+
+/**
+ * @struct HistoryChunk
+ * @brief Cabecera de un chunk; le sigue el flujo de bits de sus puntos.
+ */
+typedef struct
+{
+    _Atomic uint64_t sequence;      /**< Secuencia del chunk; 0 si está vacío o se está reutilizando. */
+    _Atomic uint32_t count;         /**< Puntos válidos; se publica con release tras `bits`. */
+    _Atomic uint32_t bits;          /**< Bits válidos del flujo. */
+    int64_t first_timestamp;        /**< Tiempo del primer punto, en milisegundos. */
+    _Atomic int64_t last_timestamp; /**< Tiempo del último punto, en milisegundos. */
+    uint8_t payload[];              /**< Flujo de bits, del más significativo al menos. */
+} HistoryChunk;
+
+/**
+ * @brief Bytes del flujo de bits de cada chunk.
+ */
+#define HISTORY_PAYLOAD_BYTES (HISTORY_CHUNK_BYTES - sizeof(HistoryChunk))
+
+/**
+ * @struct HistoryEncoder
+ * @brief Estado de la compresión del chunk abierto de una serie; también se usa para decodificar.
+ */
+typedef struct
+{
+    int64_t timestamp; /**< Tiempo del último punto. */
+    int64_t delta;     /**< Diferencia entre los dos últimos tiempos. */
+    uint64_t value;    /**< Bits del último valor. */
+    uint8_t leading;   /**< Ceros iniciales de la ventana vigente, o `HISTORY_NO_WINDOW`. */
+    uint8_t trailing;  /**< Ceros finales de la ventana vigente. */
+    uint32_t bits;     /**< Posición en el flujo de bits. */
+    uint32_t count;    /**< Puntos del chunk; 0 si hay que abrir uno. */
+} HistoryEncoder;
+
+/** Archivo mapeado, o NULL si la historia está deshabilitada */
+static uint8_t* map;
+
+/** Cabecera dentro del mapeo */
+static HistoryFileHeader* header;
+
+/** Tabla de series dentro del mapeo */
+static HistoryEntry* entries;
+
+/** Inicio de los chunks dentro del mapeo */
+static uint8_t* chunks;
+
+/** Separación mínima entre dos puntos de una serie, con un 10% de tolerancia al jitter del ciclo */
+static int64_t min_gap_ms;
+
+/** Estado de compresión de cada serie de la historia; solo lo usa el hilo que publica */
+static HistoryEncoder* encoders;
+
+/** Índice en la historia de cada serie del almacén, o una de las marcas `HISTORY_SLOT_*` */
+static int32_t* slots;
+
+/** Capacidad de `slots` */
+static size_t slots_capacity;
+
+/** Puntos agregados */
+static MetricSeries samples_metric = METRIC_SERIES_INVALID;
+
+/** Series con historia */
+static MetricSeries series_metric = METRIC_SERIES_INVALID;
+
+/** Chunks reutilizados al dar la vuelta el anillo de una serie */
+static MetricSeries rotations_metric = METRIC_SERIES_INVALID;
+
+/** Series del almacén sin historia porque la tabla está llena o la clave no entra */
+static MetricSeries overflow_metric = METRIC_SERIES_INVALID;
+
+/**
+ * @brief Devuelve un chunk del anillo de una serie.
+ * @param index Índice de la serie.
+ * @param chunk Posición en el anillo.
+ * @return Chunk dentro del mapeo.
+ */
+static HistoryChunk* chunk_at(size_t index, uint32_t chunk)
+{
+    return (HistoryChunk*)(chunks + ((size_t)index * header->chunks_per_series + chunk) * HISTORY_CHUNK_BYTES);
+}
+
+/**
+ * @brief Tiempo Unix actual en milisegundos.
+ * @return Milisegundos.
+ */
+static int64_t now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Escribe los `count` bits menos significativos de `value` en el flujo.
+ *
+ * Los bits se combinan con OR, así que el flujo debe estar en cero a partir de `pos`.
+ *
+ * @param payload Flujo de bits.
+ * @param pos Posición en bits; avanza `count`.
+ * @param value Bits a escribir.
+ * @param count Cantidad de bits (1 a 64).
+ */
+static void write_bits(uint8_t* payload, uint32_t* pos, uint64_t value, unsigned count)
+{
+    while (count > 0)
+    {
+        unsigned free_bits = 8 - (*pos & 7);
+        unsigned take = count < free_bits ? count : free_bits;
+        uint8_t bits = (uint8_t)((value >> (count - take)) & ((1u << take) - 1));
+        payload[*pos >> 3] |= (uint8_t)(bits << (free_bits - take));
+        *pos += take;
+        count -= take;
+    }
+}
+
+/**
+ * @brief Lee `count` bits del flujo.
+ * @param payload Flujo de bits.
+ * @param limit Bits válidos del flujo.
+ * @param pos Posición en bits; avanza `count`.
+ * @param count Cantidad de bits (1 a 64).
+ * @param value Bits leídos.
+ * @return 0 en caso de éxito, -1 si el flujo termina antes.
+ */
+static int read_bits(const uint8_t* payload, uint32_t limit, uint32_t* pos, unsigned count, uint64_t* value)
+{
+    if (*pos > limit || count > limit - *pos)
+    {
+        return -1;
+    }
+    *value = 0;
+    while (count > 0)
+    {
+        unsigned available = 8 - (*pos & 7);
+        unsigned take = count < available ? count : available;
+        uint64_t bits = (payload[*pos >> 3] >> (available - take)) & ((1u << take) - 1);
+        *value = (*value << take) | bits;
+        *pos += take;
+        count -= take;
+    }
+    return 0;
+}
+
+/**
+ * @brief Agrega un punto al flujo de bits de un chunk.
+ * @param payload Flujo de bits del chunk.
+ * @param state Estado de compresión; se actualiza.
+ * @param timestamp Tiempo del punto en milisegundos.
+ * @param value Valor del punto.
+ */
+static void encode_point(uint8_t* payload, HistoryEncoder* state, int64_t timestamp, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    // El primer punto del chunk va completo para poder decodificar cada chunk por separado
+    if (state->count == 0)
+    {
+        write_bits(payload, &state->bits, (uint64_t)timestamp, 64);
+        write_bits(payload, &state->bits, bits, 64);
+        state->timestamp = timestamp;
+        state->delta = 0;
+        state->value = bits;
+        state->leading = HISTORY_NO_WINDOW;
+        state->count = 1;
+        return;
+    }
+
+    // Timestamp: delta de delta con prefijos de largo variable
+    int64_t delta = timestamp - state->timestamp;
+    int64_t dod = delta - state->delta;
+    if (dod == 0)
+    {
+        write_bits(payload, &state->bits, 0, 1);
+    }
+    else if (dod >= -63 && dod <= 64)
+    {
+        write_bits(payload, &state->bits, 0x2, 2);
+        write_bits(payload, &state->bits, (uint64_t)(dod + 63), 7);
+    }
+    else if (dod >= -255 && dod <= 256)
+    {
+        write_bits(payload, &state->bits, 0x6, 3);
+        write_bits(payload, &state->bits, (uint64_t)(dod + 255), 9);
+    }
+    else if (dod >= -2047 && dod <= 2048)
+    {
+        write_bits(payload, &state->bits, 0xe, 4);
+        write_bits(payload, &state->bits, (uint64_t)(dod + 2047), 12);
+    }
+    else
+    {
+        write_bits(payload, &state->bits, 0xf, 4);
+        write_bits(payload, &state->bits, (uint64_t)dod, 64);
+    }
+
+    // Valor: XOR con el anterior; si los bits distintos caben en la ventana vigente se reutiliza
+    uint64_t xor = bits ^ state->value;
+    if (xor == 0)
+    {
+        write_bits(payload, &state->bits, 0, 1);
+    }
+    else
+    {
+        unsigned leading = (unsigned)__builtin_clzll(xor);
+        unsigned trailing = (unsigned)__builtin_ctzll(xor);
+        if (leading > 31)
+        {
+            leading = 31;
+        }
+        if (state->leading != HISTORY_NO_WINDOW && leading >= state->leading && trailing >= state->trailing)
+        {
+            write_bits(payload, &state->bits, 0x2, 2);
+            write_bits(payload, &state->bits, xor >> state->trailing, 64 - state->leading - state->trailing);
+        }
+        else
+        {
+            unsigned significant = 64 - leading - trailing;
+            write_bits(payload, &state->bits, 0x3, 2);
+            write_bits(payload, &state->bits, leading, 5);
+            write_bits(payload, &state->bits, significant & 63, 6);
+            write_bits(payload, &state->bits, xor >> trailing, significant);
+            state->leading = (uint8_t)leading;
+            state->trailing = (uint8_t)trailing;
+        }
+    }
+    state->timestamp = timestamp;
+    state->delta = delta;
+    state->value = bits;
+    state->count++;
+}
+
+/**
+ * @brief Lee el siguiente punto del flujo de bits de un chunk.
+ * @param payload Flujo de bits.
+ * @param limit Bits válidos del flujo.
+ * @param state Estado de decodificación; `count` en 0 para el primer punto.
+ * @param timestamp Tiempo del punto.
+ * @param value Valor del punto.
+ * @return 0 en caso de éxito, -1 si el flujo es inválido.
+ */
+static int decode_point(const uint8_t* payload, uint32_t limit, HistoryEncoder* state, int64_t* timestamp,
+                        double* value)
+{
+    uint64_t bits;
+    if (state->count == 0)
+    {
+        if (read_bits(payload, limit, &state->bits, 64, &bits) != 0 ||
+            read_bits(payload, limit, &state->bits, 64, &state->value) != 0)
+        {
+            return -1;
+        }
+        state->timestamp = (int64_t)bits;
+        state->delta = 0;
+        state->leading = HISTORY_NO_WINDOW;
+    }
+    else
+    {
+        // Prefijo del delta de delta: hasta cuatro unos
+        unsigned ones = 0;
+        while (ones < 4)
+        {
+            if (read_bits(payload, limit, &state->bits, 1, &bits) != 0)
+            {
+                return -1;
+            }
+            if (bits == 0)
+            {
+                break;
+            }
+            ones++;
+        }
+        static const unsigned widths[] = {0, 7, 9, 12, 64};
+        static const int64_t offsets[] = {0, 63, 255, 2047, 0};
+        int64_t dod = 0;
+        if (ones > 0)
+        {
+            if (read_bits(payload, limit, &state->bits, widths[ones], &bits) != 0)
+            {
+                return -1;
+            }
+            dod = (int64_t)bits - offsets[ones];
+        }
+        state->delta += dod;
+        state->timestamp += state->delta;
+
+        if (read_bits(payload, limit, &state->bits, 1, &bits) != 0)
+        {
+            return -1;
+        }
+        if (bits == 1)
+        {
+            if (read_bits(payload, limit, &state->bits, 1, &bits) != 0)
+            {
+                return -1;
+            }
+            if (bits == 1)
+            {
+                uint64_t leading;
+                uint64_t significant;
+                if (read_bits(payload, limit, &state->bits, 5, &leading) != 0 ||
+                    read_bits(payload, limit, &state->bits, 6, &significant) != 0)
+                {
+                    return -1;
+                }
+                if (significant == 0)
+                {
+                    significant = 64;
+                }
+                if (leading + significant > 64)
+                {
+                    return -1;
+                }
+                state->leading = (uint8_t)leading;
+                state->trailing = (uint8_t)(64 - leading - significant);
+            }
+            else if (state->leading == HISTORY_NO_WINDOW)
+            {
+                return -1;
+            }
+            uint64_t xor;
+            if (read_bits(payload, limit, &state->bits, 64 - state->leading - state->trailing, &xor) != 0)
+            {
+                return -1;
+            }
+            state->value ^= xor << state->trailing;
+        }
+    }
+    state->count++;
+    *timestamp = state->timestamp;
+    memcpy(value, &state->value, sizeof(*value));
+    return 0;
+}
+
+/**
+ * @brief Reconstruye el estado de compresión del chunk abierto de una serie al retomar el archivo.
+ *
+ * Si el proceso terminó a mitad de un punto, el chunk puede tener bits escritos después de
+ * los publicados: se limpian, porque los puntos siguientes se combinan con OR.
+ *
+ * @param index Índice de la serie.
+ */
+static void restore_encoder(size_t index)
+{
+    HistoryEncoder* encoder = &encoders[index];
+    memset(encoder, 0, sizeof(*encoder));
+    uint32_t head = atomic_load(&entries[index].head);
+    if (head >= header->chunks_per_series)
+    {
+        atomic_store(&entries[index].head, 0);
+        return;
+    }
+    HistoryChunk* chunk = chunk_at(index, head);
+    uint32_t count = atomic_load(&chunk->count);
+    uint32_t bits = atomic_load(&chunk->bits);
+    if (atomic_load(&chunk->sequence) == 0 || count == 0 || bits > HISTORY_PAYLOAD_BYTES * 8)
+    {
+        return;
+    }
+
+    int64_t timestamp;
+    double value;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (decode_point(chunk->payload, bits, encoder, &timestamp, &value) != 0)
+        {
+            // Chunk inconsistente: se deja como está y el próximo punto abre el siguiente
+            encoder->count = UINT32_MAX;
+            encoder->bits = HISTORY_PAYLOAD_BYTES * 8;
+            return;
+        }
+    }
+    bits = encoder->bits;
+    if (bits % 8 != 0)
+    {
+        chunk->payload[bits / 8] &= (uint8_t)(0xff00 >> (bits % 8));
+    }
+    size_t used = (bits + 7) / 8;
+    memset(chunk->payload + used, 0, HISTORY_PAYLOAD_BYTES - used);
+}
+
+/**
+ * @brief Agrega un punto a una serie de la historia, abriendo otro chunk si el actual no alcanza.
+ * @param index Índice de la serie.
+ * @param timestamp Tiempo del punto en milisegundos.
+ * @param value Valor del punto.
+ * @return 1 si se reutilizó un chunk del anillo, 0 en caso contrario.
+ */
+static int append_point(size_t index, int64_t timestamp, double value)
+{
+    HistoryEntry* entry = &entries[index];
+    HistoryEncoder* encoder = &encoders[index];
+    uint32_t head = atomic_load_explicit(&entry->head, memory_order_relaxed);
+    HistoryChunk* chunk = chunk_at(index, head);
+    int rotated = 0;
+
+    if (encoder->count == 0 || encoder->bits + HISTORY_MAX_POINT_BITS > HISTORY_PAYLOAD_BYTES * 8)
+    {
+        if (encoder->count != 0)
+        {
+            head = (head + 1) % header->chunks_per_series;
+            chunk = chunk_at(index, head);
+            rotated = atomic_load_explicit(&chunk->sequence, memory_order_relaxed) != 0;
+        }
+
+        // Como en un seqlock: la secuencia en 0 invalida las copias que estén haciendo los lectores
+        atomic_store_explicit(&chunk->sequence, 0, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        memset(chunk->payload, 0, HISTORY_PAYLOAD_BYTES);
+        atomic_store_explicit(&chunk->count, 0, memory_order_relaxed);
+        atomic_store_explicit(&chunk->bits, 0, memory_order_relaxed);
+        chunk->first_timestamp = timestamp;
+        memset(encoder, 0, sizeof(*encoder));
+        encode_point(chunk->payload, encoder, timestamp, value);
+        atomic_store_explicit(&chunk->last_timestamp, timestamp, memory_order_relaxed);
+        atomic_store_explicit(&chunk->bits, encoder->bits, memory_order_relaxed);
+        atomic_store_explicit(&chunk->count, encoder->count, memory_order_relaxed);
+        atomic_store_explicit(&chunk->sequence, entry->next_sequence++, memory_order_release);
+        atomic_store_explicit(&entry->head, head, memory_order_release);
+        return rotated;
+    }
+
+    encode_point(chunk->payload, encoder, timestamp, value);
+    atomic_store_explicit(&chunk->last_timestamp, timestamp, memory_order_relaxed);
+    atomic_store_explicit(&chunk->bits, encoder->bits, memory_order_relaxed);
+    atomic_store_explicit(&chunk->count, encoder->count, memory_order_release);
+    return 0;
+}
+
+int history_series_key(MetricSeries series, char* key)
+{
+    const MetricSeriesInfo* info = metric_store_series(series);
+    if (info == NULL)
+    {
+        return -1;
+    }
+    int len = snprintf(key, HISTORY_KEY_SIZE, "%s%s%s", metric_store_family(info->family)->name, info->suffix,
+                       info->labels);
+    return len < 0 || len >= HISTORY_KEY_SIZE ? -1 : 0;
+}
+
+int history_enabled()
+{
+    return map != NULL;
+}
+
+size_t history_series_count()
+{
+    return map != NULL ? atomic_load_explicit(&header->series_count, memory_order_acquire) : 0;
+}
+
+const char* history_key(size_t index)
+{
+    return index < history_series_count() ? entries[index].key : NULL;
+}
+
+int history_find(const char* key)
+{
+    size_t count = history_series_count();
+    for (size_t i = 0; i < count; i++)
+    {
+        if (strncmp(entries[i].key, key, HISTORY_KEY_SIZE) == 0)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Busca o crea la entrada de una serie del almacén.
+ * @param series Serie del almacén.
+ * @return Índice en la historia, o `HISTORY_SLOT_NONE` si no tiene lugar.
+ */
+static int32_t assign_slot(MetricSeries series)
+{
+    char key[HISTORY_KEY_SIZE];
+    if (history_series_key(series, key) != 0)
+    {
+        return HISTORY_SLOT_NONE;
+    }
+    int found = history_find(key);
+    if (found >= 0)
+    {
+        return found;
+    }
+
+    uint32_t count = atomic_load_explicit(&header->series_count, memory_order_relaxed);
+    if (count >= header->max_series)
+    {
+        return HISTORY_SLOT_NONE;
+    }
+    HistoryEntry* entry = &entries[count];
+    memset(entry, 0, sizeof(*entry));
+    memcpy(entry->key, key, sizeof(key));
+    entry->next_sequence = 1;
+    memset(&encoders[count], 0, sizeof(encoders[count]));
+    atomic_store_explicit(&header->series_count, count + 1, memory_order_release);
+    metric_store_stage(series_metric, (double)(count + 1));
+    return (int32_t)count;
+}
+
+/**
+ * @brief Garantiza lugar en `slots` para todas las series del almacén.
+ * @param count Series del almacén.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int reserve_slots(size_t count)
+{
+    if (count <= slots_capacity)
+    {
+        return 0;
+    }
+    int32_t* grown = realloc(slots, count * sizeof(*slots));
+    if (grown == NULL)
+    {
+        fprintf(stderr, "Error al reservar memoria para la historia\n");
+        return -1;
+    }
+    for (size_t i = slots_capacity; i < count; i++)
+    {
+        grown[i] = HISTORY_SLOT_UNKNOWN;
+    }
+    slots = grown;
+    slots_capacity = count;
+    return 0;
+}
+
+/**
+ * @brief Agrega un punto por cada serie presente de la generación recién publicada (PublishFn).
+ * @param generation Generación publicada.
+ * @param arg Argumento no utilizado.
+ */
+static void history_publish(uint64_t generation, void* arg)
+{
+    (void)generation;
+    (void)arg;
+
+    size_t series_count = metric_store_series_count();
+    if (reserve_slots(series_count) != 0)
+    {
+        return;
+    }
+
+    // Ninguna publicación puede pisar el buffer frontal mientras corre esta función
+    const double* values;
+    metric_store_read_begin(&values);
+    int64_t timestamp = now_ms();
+    size_t appended = 0;
+    size_t rotations = 0;
+    size_t overflow = 0;
+
+    for (MetricSeries series = 0; series < series_count; series++)
+    {
+        if (isnan(values[series]))
+        {
+            continue;
+        }
+        if (slots[series] == HISTORY_SLOT_UNKNOWN)
+        {
+            slots[series] = assign_slot(series);
+            overflow += slots[series] == HISTORY_SLOT_NONE;
+        }
+        if (slots[series] == HISTORY_SLOT_NONE)
+        {
+            continue;
+        }
+
+        size_t index = (size_t)slots[series];
+        HistoryEncoder* encoder = &encoders[index];
+        if (encoder->count != 0 && timestamp - encoder->timestamp < min_gap_ms)
+        {
+            continue;
+        }
+        rotations += (size_t)append_point(index, timestamp, values[series]);
+        appended++;
+    }
+
+    metric_store_stage_add(samples_metric, (double)appended);
+    if (rotations > 0)
+    {
+        metric_store_stage_add(rotations_metric, (double)rotations);
+    }
+    if (overflow > 0)
+    {
+        metric_store_stage_add(overflow_metric, (double)overflow);
+    }
+}
+
+long history_read(size_t index, int64_t from_ms, int64_t to_ms, HistoryVisitFn visit, void* arg)
+{
+    if (index >= history_series_count())
+    {
+        return -1;
+    }
+
+    uint32_t chunks_per_series = header->chunks_per_series;
+    uint32_t head = atomic_load_explicit(&entries[index].head, memory_order_acquire);
+    uint8_t copy[HISTORY_PAYLOAD_BYTES];
+    int64_t last_visited = INT64_MIN;
+    long visited = 0;
+
+    // Del chunk más viejo (el siguiente a la cabeza) al que se está escribiendo
+    for (uint32_t i = 1; i <= chunks_per_series; i++)
+    {
+        HistoryChunk* chunk = chunk_at(index, (head + i) % chunks_per_series);
+        uint64_t sequence = atomic_load_explicit(&chunk->sequence, memory_order_acquire);
+        if (sequence == 0)
+        {
+            continue;
+        }
+        uint32_t count = atomic_load_explicit(&chunk->count, memory_order_acquire);
+        uint32_t bits = atomic_load_explicit(&chunk->bits, memory_order_relaxed);
+        int64_t first = chunk->first_timestamp;
+        int64_t last = atomic_load_explicit(&chunk->last_timestamp, memory_order_relaxed);
+        if (bits > sizeof(copy) * 8)
+        {
+            continue;
+        }
+        memcpy(copy, chunk->payload, (bits + 7) / 8);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&chunk->sequence, memory_order_relaxed) != sequence)
+        {
+            continue;
+        }
+        if (first > to_ms)
+        {
+            break;
+        }
+        if (last < from_ms)
+        {
+            continue;
+        }
+
+        HistoryEncoder state;
+        memset(&state, 0, sizeof(state));
+        for (uint32_t j = 0; j < count; j++)
+        {
+            int64_t timestamp;
+            double value;
+            if (decode_point(copy, bits, &state, &timestamp, &value) != 0 || timestamp > to_ms)
+            {
+                break;
+            }
+            // Si el reloj retrocedió, se conserva el orden de tiempo descartando lo que no avanza
+            if (timestamp >= from_ms && timestamp > last_visited)
+            {
+                visit(timestamp, value, arg);
+                last_visited = timestamp;
+                visited++;
+            }
+        }
+    }
+    return visited;
+}
+
+/**
+ * @brief Abre el archivo y lo mapea, recreándolo si no tiene la geometría esperada.
+ * @param config Configuración de la historia.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int open_file(const HistoryConfig* config)
+{
+    uint64_t samples = (uint64_t)config->retention_hours * 3600 / (uint64_t)config->resolution_seconds;
+    uint64_t chunks_per_series = (samples * HISTORY_BYTES_PER_SAMPLE + HISTORY_PAYLOAD_BYTES - 1) /
+                                     HISTORY_PAYLOAD_BYTES +
+                                 1; // el chunk abierto está a medio llenar
+    size_t table_bytes = ((size_t)config->max_series * HISTORY_ENTRY_BYTES + HISTORY_CHUNK_BYTES - 1) /
+                         HISTORY_CHUNK_BYTES * HISTORY_CHUNK_BYTES;
+    uint64_t size = HISTORY_HEADER_BYTES + table_bytes +
+                    (uint64_t)config->max_series * chunks_per_series * HISTORY_CHUNK_BYTES;
+    if (size > SIZE_MAX || chunks_per_series > UINT32_MAX)
+    {
+        fprintf(stderr, "La historia configurada no entra en memoria\n");
+        return -1;
+    }
+
+    int fd = open(config->path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        perror("Error al abrir el archivo de historia");
+        return -1;
+    }
+
+    HistoryFileHeader existing;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        perror("Error al consultar el archivo de historia");
+        close(fd);
+        return -1;
+    }
+    int reuse = (uint64_t)st.st_size == size &&
+                pread(fd, &existing, sizeof(existing), 0) == (ssize_t)sizeof(existing) &&
+                memcmp(existing.magic, HISTORY_MAGIC, sizeof(existing.magic)) == 0 &&
+                existing.chunk_bytes == HISTORY_CHUNK_BYTES && existing.chunks_per_series == chunks_per_series &&
+                existing.max_series == (uint32_t)config->max_series;
+    if (!reuse)
+    {
+        if (st.st_size > 0)
+        {
+            fprintf(stderr, "El archivo de historia %s tiene otra geometría; se recrea vacío\n", config->path);
+        }
+        // El archivo queda disperso: solo ocupa disco lo que se escribe
+        if (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)size) != 0)
+        {
+            perror("Error al dimensionar el archivo de historia");
+            close(fd);
+            return -1;
+        }
+    }
+
+    void* mapped = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        perror("Error al mapear el archivo de historia");
+        return -1;
+    }
+    map = mapped;
+    header = (HistoryFileHeader*)map;
+    entries = (HistoryEntry*)(map + HISTORY_HEADER_BYTES);
+    chunks = map + HISTORY_HEADER_BYTES + table_bytes;
+
+    if (!reuse)
+    {
+        header->chunk_bytes = HISTORY_CHUNK_BYTES;
+        header->chunks_per_series = (uint32_t)chunks_per_series;
+        header->max_series = (uint32_t)config->max_series;
+        atomic_store(&header->series_count, 0);
+        // La marca va al final: un archivo a medio inicializar no se retoma
+        memcpy(header->magic, HISTORY_MAGIC, sizeof(header->magic));
+    }
+    else if (atomic_load(&header->series_count) > header->max_series)
+    {
+        atomic_store(&header->series_count, header->max_series);
+    }
+    return 0;
+}
+
+int history_init()
+{
+    HistoryConfig config = config_current_history();
+    if (config.path[0] == '\0')
+    {
+        return 0;
+    }
+
+    min_gap_ms = (int64_t)config.resolution_seconds * 900;
+    encoders = calloc((size_t)config.max_series, sizeof(*encoders));
+    if (encoders == NULL)
+    {
+        fprintf(stderr, "Error al reservar memoria para la historia\n");
+        return -1;
+    }
+    if (open_file(&config) != 0)
+    {
+        free(encoders);
+        encoders = NULL;
+        return -1;
+    }
+    size_t restored = history_series_count();
+    for (size_t i = 0; i < restored; i++)
+    {
+        restore_encoder(i);
+    }
+
+    samples_metric =
+        metric_store_register("history_samples_total", "Puntos agregados a la historia local", METRIC_TYPE_COUNTER);
+    series_metric = metric_store_register("history_series", "Series con historia local", METRIC_TYPE_GAUGE);
+    rotations_metric = metric_store_register("history_chunk_rotations_total",
+                                             "Chunks de la historia reutilizados al dar la vuelta el anillo",
+                                             METRIC_TYPE_COUNTER);
+    overflow_metric = metric_store_register("history_series_overflow_total",
+                                            "Series sin historia porque la tabla está llena o la clave es muy larga",
+                                            METRIC_TYPE_COUNTER);
+    if (samples_metric == METRIC_SERIES_INVALID || series_metric == METRIC_SERIES_INVALID ||
+        rotations_metric == METRIC_SERIES_INVALID || overflow_metric == METRIC_SERIES_INVALID)
+    {
+        fprintf(stderr, "Error al registrar las métricas de la historia\n");
+        return -1;
+    }
+    metric_store_stage_add(samples_metric, 0.0);
+    metric_store_stage(series_metric, (double)restored);
+    metric_store_stage_add(rotations_metric, 0.0);
+    metric_store_stage_add(overflow_metric, 0.0);
+
+    return collection_add_publish_callback(history_publish, NULL);
+}
@@ -0,0 +1,305 @@
+#include "../include/http_client.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/**
+ * @brief Tamaño máximo de la cabecera de una respuesta.
+ */
+#define HTTP_CLIENT_RESPONSE_HEAD 8192
+
+int http_client_init(HttpClient* client, const char* url, int timeout)
+{
+    memset(client, 0, sizeof(*client));
+    client->fd = -1;
+    client->timeout = timeout;
+    if (strncmp(url, "http://", 7) != 0)
+    {
+        fprintf(stderr, "Error: URL no soportada (solo http://): %s\n", url);
+        return -1;
+    }
+
+    const char* authority = url + 7;
+    const char* path = strchr(authority, '/');
+    size_t authority_len = path != NULL ? (size_t)(path - authority) : strlen(authority);
+    const char* host_end = authority + authority_len;
+    const char* host = authority;
+    const char* port = NULL;
+
+    if (*host == '[')
+    {
+        // IPv6 literal: [dirección]:puerto
+        const char* close = memchr(host, ']', authority_len);
+        if (close == NULL)
+        {
+            fprintf(stderr, "Error: URL inválida: %s\n", url);
+            return -1;
+        }
+        port = close + 1 < host_end && close[1] == ':' ? close + 2 : NULL;
+        host++;
+        host_end = close;
+    }
+    else
+    {
+        const char* colon = memchr(host, ':', authority_len);
+        if (colon != NULL)
+        {
+            port = colon + 1;
+            host_end = colon;
+        }
+    }
+
+    size_t host_len = (size_t)(host_end - host);
+    size_t port_len = port != NULL ? (size_t)(authority + authority_len - port) : 0;
+    if (host_len == 0 || host_len >= sizeof(client->host) || port_len >= sizeof(client->port) ||
+        (path != NULL && strlen(path) >= sizeof(client->path)))
+    {
+        fprintf(stderr, "Error: URL inválida: %s\n", url);
+        return -1;
+    }
+    memcpy(client->host, host, host_len);
+    if (port_len > 0)
+    {
+        memcpy(client->port, port, port_len);
+    }
+    else
+    {
+        strcpy(client->port, "80");
+    }
+    strcpy(client->path, path != NULL ? path : "/");
+    return 0;
+}
+
+/**
+ * @brief Conecta con el servidor respetando el timeout.
+ * @param client Cliente sin conexión abierta.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int connect_client(HttpClient* client)
+{
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* result;
+    int status = getaddrinfo(client->host, client->port, &hints, &result);
+    if (status != 0)
+    {
+        fprintf(stderr, "Error al resolver %s: %s\n", client->host, gai_strerror(status));
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo* ai = result; ai != NULL && fd < 0; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        // Conexión no bloqueante para acotar la espera con poll
+        int error = 0;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0)
+        {
+            error = errno;
+            if (error == EINPROGRESS)
+            {
+                struct pollfd pfd = {fd, POLLOUT, 0};
+                socklen_t len = sizeof(error);
+                if (poll(&pfd, 1, client->timeout * 1000) != 1 ||
+                    getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0)
+                {
+                    error = ETIMEDOUT;
+                }
+            }
+        }
+        if (error != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(result);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error al conectar con %s:%s\n", client->host, client->port);
+        return -1;
+    }
+
+    // El resto de las operaciones son bloqueantes con timeout
+    struct timeval tv = {client->timeout, 0};
+    int one = 1;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    client->fd = fd;
+    return 0;
+}
+
+/**
+ * @brief Envía un bloque completo.
+ * @param fd Socket.
+ * @param data Datos.
+ * @param len Cantidad de bytes.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int send_all(int fd, const char* data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t sent = send(fd, data, len, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent <= 0)
+        {
+            return -1;
+        }
+        data += sent;
+        len -= (size_t)sent;
+    }
+    return 0;
+}
+
+/**
+ * @brief Lee la respuesta y descarta su cuerpo.
+ *
+ * Si el cuerpo no tiene Content-Length (chunked o hasta el cierre) o el servidor pidió
+ * cerrar, la conexión se cierra en lugar de reutilizarse.
+ *
+ * @param client Cliente con la conexión abierta.
+ * @return Código de estado, o -1 si la respuesta no es válida.
+ */
+static int read_response(HttpClient* client)
+{
+    char head[HTTP_CLIENT_RESPONSE_HEAD];
+    size_t len = 0;
+    char* end = NULL;
+    while (end == NULL)
+    {
+        if (len == sizeof(head) - 1)
+        {
+            return -1;
+        }
+        ssize_t received = recv(client->fd, head + len, sizeof(head) - 1 - len, 0);
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (received <= 0)
+        {
+            return -1;
+        }
+        len += (size_t)received;
+        head[len] = '\0';
+        end = strstr(head, "\r\n\r\n");
+    }
+
+    int status;
+    if (sscanf(head, "HTTP/1.%*d %d", &status) != 1)
+    {
+        return -1;
+    }
+
+    long content_length = -1;
+    int keep_alive = 1;
+    for (char* line = strstr(head, "\r\n") + 2; line < end; line = strstr(line, "\r\n") + 2)
+    {
+        if (strncasecmp(line, "Content-Length:", 15) == 0)
+        {
+            content_length = strtol(line + 15, NULL, 10);
+        }
+        else if (strncasecmp(line, "Connection:", 11) == 0 &&
+                 strncasecmp(line + 11 + strspn(line + 11, " "), "close", 5) == 0)
+        {
+            keep_alive = 0;
+        }
+    }
+    if (status == 204 || status == 304)
+    {
+        content_length = 0;
+    }
+
+    // Descartar el cuerpo para dejar la conexión lista para la próxima petición
+    size_t body = len - (size_t)(end + 4 - head);
+    while (content_length >= 0 && body < (size_t)content_length)
+    {
+        ssize_t received = recv(client->fd, head, sizeof(head), 0);
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (received <= 0)
+        {
+            return -1;
+        }
+        body += (size_t)received;
+    }
+    if (content_length < 0 || !keep_alive)
+    {
+        http_client_close(client);
+    }
+    return status;
+}
+
+int http_client_post(HttpClient* client, const char* headers, const void* body, size_t len)
+{
+    char head[HTTP_CLIENT_RESPONSE_HEAD];
+    // Una dirección IPv6 va entre corchetes, como en la URL (RFC 7230, sección 5.4)
+    int ipv6 = strchr(client->host, ':') != NULL;
+    int head_len = snprintf(head, sizeof(head),
+                            "POST %s HTTP/1.1\r\nHost: %s%s%s:%s\r\n%sContent-Length: %zu\r\n\r\n", client->path,
+                            ipv6 ? "[" : "", client->host, ipv6 ? "]" : "", client->port,
+                            headers != NULL ? headers : "", len);
+    if (head_len < 0 || (size_t)head_len >= sizeof(head))
+    {
+        return -1;
+    }
+
+    // Una conexión reutilizada pudo haberla cerrado el servidor: se reintenta una vez en una nueva
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        int reused = client->fd >= 0;
+        if (!reused && connect_client(client) != 0)
+        {
+            return -1;
+        }
+        if (send_all(client->fd, head, (size_t)head_len) == 0 && send_all(client->fd, body, len) == 0)
+        {
+            int status = read_response(client);
+            if (status >= 0)
+            {
+                return status;
+            }
+        }
+        http_client_close(client);
+        if (!reused)
+        {
+            break;
+        }
+    }
+    return -1;
+}
+
+void http_client_close(HttpClient* client)
+{
+    if (client->fd >= 0)
+    {
+        close(client->fd);
+        client->fd = -1;
+    }
+}
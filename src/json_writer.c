@@ -0,0 +1,271 @@
+#include "../include/json_writer.h"
+#include "../include/dtoa.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Escribe la coma que separa el valor siguiente del anterior, si corresponde.
+ * @param writer Escritor.
+ * @return 0 si se puede escribir el valor, -1 si el escritor tiene un error.
+ */
+static int begin_value(JsonWriter* writer)
+{
+    if (writer->error)
+    {
+        return -1;
+    }
+    if (writer->after_key)
+    {
+        writer->after_key = 0;
+        return 0;
+    }
+    if (writer->depth > 0)
+    {
+        uint64_t bit = 1ULL << (writer->depth - 1);
+        if ((writer->has_items & bit) && buffer_append_char(writer->out, ',') != 0)
+        {
+            writer->error = 1;
+            return -1;
+        }
+        writer->has_items |= bit;
+    }
+    return 0;
+}
+
+/**
+ * @brief Agrega texto sin escapar, anotando el error si no hay memoria.
+ * @param writer Escritor.
+ * @param text Texto.
+ * @param len Longitud.
+ */
+static void append(JsonWriter* writer, const char* text, size_t len)
+{
+    if (buffer_append(writer->out, text, len) != 0)
+    {
+        writer->error = 1;
+    }
+}
+
+/**
+ * @brief Agrega una cadena entre comillas, escapando lo que JSON exige.
+ * @param writer Escritor.
+ * @param value Cadena.
+ */
+static void append_escaped(JsonWriter* writer, const char* value)
+{
+    // Caso común (claves, nombres de métricas): nada que escapar, una sola reserva y una copia
+    size_t plain = 0;
+    unsigned char first;
+    while ((first = (unsigned char)value[plain]) >= 0x20 && first != '"' && first != '\\')
+    {
+        plain++;
+    }
+    if (first == '\0')
+    {
+        Buffer* out = writer->out;
+        if (buffer_reserve(out, plain + 2) != 0)
+        {
+            writer->error = 1;
+            return;
+        }
+        out->data[out->len] = '"';
+        memcpy(out->data + out->len + 1, value, plain);
+        out->data[out->len + plain + 1] = '"';
+        out->len += plain + 2;
+        out->data[out->len] = '\0';
+        return;
+    }
+
+    append(writer, "\"", 1);
+    const char* start = value;
+    for (const char* p = value; !writer->error; p++)
+    {
+        // Los tramos sin caracteres especiales se recorren sin tocar el buffer y se copian de una vez
+        unsigned char c;
+        while ((c = (unsigned char)*p) >= 0x20 && c != '"' && c != '\\')
+        {
+            p++;
+        }
+        append(writer, start, (size_t)(p - start));
+        if (c == '\0')
+        {
+            break;
+        }
+        char escape[8];
+        switch (c)
+        {
+        case '"':
+            append(writer, "\\\"", 2);
+            break;
+        case '\\':
+            append(writer, "\\\\", 2);
+            break;
+        case '\n':
+            append(writer, "\\n", 2);
+            break;
+        case '\t':
+            append(writer, "\\t", 2);
+            break;
+        case '\r':
+            append(writer, "\\r", 2);
+            break;
+        default:
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            append(writer, escape, 6);
+            break;
+        }
+        start = p + 1;
+    }
+    append(writer, "\"", 1);
+}
+
+void json_writer_init(JsonWriter* writer, Buffer* out)
+{
+    writer->out = out;
+    writer->has_items = 0;
+    writer->depth = 0;
+    writer->after_key = 0;
+    writer->error = 0;
+}
+
+int json_writer_error(const JsonWriter* writer)
+{
+    return writer->error || writer->depth != 0 || writer->after_key ? -1 : 0;
+}
+
+/**
+ * @brief Abre un contenedor.
+ * @param writer Escritor.
+ * @param open Carácter de apertura.
+ */
+static void begin_container(JsonWriter* writer, char open)
+{
+    if (begin_value(writer) != 0)
+    {
+        return;
+    }
+    if (writer->depth == JSON_WRITER_MAX_DEPTH)
+    {
+        writer->error = 1;
+        return;
+    }
+    append(writer, &open, 1);
+    writer->depth++;
+    writer->has_items &= ~(1ULL << (writer->depth - 1));
+}
+
+/**
+ * @brief Cierra el contenedor abierto.
+ * @param writer Escritor.
+ * @param close Carácter de cierre.
+ */
+static void end_container(JsonWriter* writer, char close)
+{
+    if (writer->error)
+    {
+        return;
+    }
+    if (writer->depth == 0 || writer->after_key)
+    {
+        writer->error = 1;
+        return;
+    }
+    writer->depth--;
+    append(writer, &close, 1);
+}
+
+void json_begin_object(JsonWriter* writer)
+{
+    begin_container(writer, '{');
+}
+
+void json_end_object(JsonWriter* writer)
+{
+    end_container(writer, '}');
+}
+
+void json_begin_array(JsonWriter* writer)
+{
+    begin_container(writer, '[');
+}
+
+void json_end_array(JsonWriter* writer)
+{
+    end_container(writer, ']');
+}
+
+void json_key(JsonWriter* writer, const char* key)
+{
+    if (writer->after_key)
+    {
+        writer->error = 1;
+        return;
+    }
+    if (begin_value(writer) != 0)
+    {
+        return;
+    }
+    append_escaped(writer, key);
+    append(writer, ":", 1);
+    writer->after_key = 1;
+}
+
+void json_string(JsonWriter* writer, const char* value)
+{
+    if (begin_value(writer) == 0)
+    {
+        append_escaped(writer, value);
+    }
+}
+
+void json_number(JsonWriter* writer, double value)
+{
+    if (!isfinite(value))
+    {
+        json_null(writer);
+        return;
+    }
+    if (begin_value(writer) != 0)
+    {
+        return;
+    }
+    // Se convierte directamente en el buffer (dtoa deja el '\0' final)
+    if (buffer_reserve(writer->out, DTOA_BUFFER_SIZE) != 0)
+    {
+        writer->error = 1;
+        return;
+    }
+    writer->out->len += (size_t)dtoa_shortest(value, writer->out->data + writer->out->len);
+}
+
+void json_int(JsonWriter* writer, long long value)
+{
+    if (begin_value(writer) != 0)
+    {
+        return;
+    }
+    if (buffer_reserve(writer->out, DTOA_BUFFER_SIZE) != 0)
+    {
+        writer->error = 1;
+        return;
+    }
+    writer->out->len += (size_t)dtoa_integer(value, writer->out->data + writer->out->len);
+}
+
+void json_bool(JsonWriter* writer, int value)
+{
+    if (begin_value(writer) == 0)
+    {
+        append(writer, value ? "true" : "false", value ? 4 : 5);
+    }
+}
+
+void json_null(JsonWriter* writer)
+{
+    if (begin_value(writer) == 0)
+    {
+        append(writer, "null", 4);
+    }
+}
@@ -0,0 +1,123 @@
+#include "../include/listener.h"
+#include <errno.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ * @brief Cantidad de conexiones pendientes de aceptar por listener.
+ */
+#define LISTEN_BACKLOG 128
+
+/**
+ * @brief Abre un socket TCP en escucha.
+ * @param listener Listener con dirección numérica y puerto.
+ * @return Descriptor del socket, o -1 en caso de error.
+ */
+static int open_tcp(const HttpListener* listener)
+{
+    char port[8];
+    snprintf(port, sizeof(port), "%d", listener->port);
+
+    struct addrinfo hints = {0};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+    struct addrinfo* info;
+    int err = getaddrinfo(listener->address, port, &hints, &info);
+    if (err != 0)
+    {
+        fprintf(stderr, "Error en la dirección de escucha %s: %s\n", listener->address, gai_strerror(err));
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = socket(info->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        freeaddrinfo(info);
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (info->ai_family == AF_INET6)
+    {
+        // Una dirección IPv6 escucha solo IPv6; "0.0.0.0" se configura como listener aparte
+        setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &one, sizeof(one));
+    }
+    if (bind(fd, info->ai_addr, info->ai_addrlen) != 0 || listen(fd, LISTEN_BACKLOG) != 0)
+    {
+        close(fd);
+        freeaddrinfo(info);
+        return -1;
+    }
+    freeaddrinfo(info);
+    return fd;
+}
+
+/**
+ * @brief Abre un socket AF_UNIX en escucha con los permisos configurados.
+ * @param listener Listener con la ruta y los permisos.
+ * @return Descriptor del socket, o -1 en caso de error.
+ */
+static int open_unix(const HttpListener* listener)
+{
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    if (strlen(listener->address) >= sizeof(addr.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, listener->address);
+
+    // Un socket que quedó de una ejecución anterior impide el bind
+    struct stat st;
+    if (lstat(listener->address, &st) == 0 && S_ISSOCK(st.st_mode))
+    {
+        unlink(listener->address);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    // Los permisos se aplican antes de listen para no aceptar conexiones con los del umask
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || chmod(listener->address, listener->permissions) != 0 ||
+        listen(fd, LISTEN_BACKLOG) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int listener_open(const HttpListener* listener)
+{
+    int fd = listener->type == HTTP_LISTENER_UNIX ? open_unix(listener) : open_tcp(listener);
+    if (fd < 0)
+    {
+        char name[HTTP_LISTENER_ADDRESS_SIZE + 16];
+        listener_describe(listener, name, sizeof(name));
+        fprintf(stderr, "Error al abrir el listener %s: %s\n", name, strerror(errno));
+    }
+    return fd;
+}
+
+void listener_describe(const HttpListener* listener, char* out, size_t size)
+{
+    if (listener->type == HTTP_LISTENER_UNIX)
+    {
+        snprintf(out, size, "unix:%s", listener->address);
+    }
+    else if (strchr(listener->address, ':') != NULL)
+    {
+        snprintf(out, size, "[%s]:%d", listener->address, listener->port);
+    }
+    else
+    {
+        snprintf(out, size, "%s:%d", listener->address, listener->port);
+    }
+}
@@ -3,7 +3,7 @@
  * @brief Entry point of the system
  */
 
-//#include "../include/config.h"
+#include "../include/config.h"
 #include "../include/expose_metrics.h"
 #include "../include/metrics.h"
 #include <stdbool.h>
@@ -16,16 +16,21 @@
 /**
  * @brief Entry point of the system.
  *
- * Este es el punto de entrada de la aplicación. Se encarga de inicializar las métricas,
- * crear un hilo para exponer las métricas a través de HTTP y actualizar periódicamente
- * las métricas del sistema en un bucle infinito.
+ * Este es el punto de entrada de la aplicación. Se encarga de cargar la configuración,
+ * inicializar las métricas, crear un hilo para exponer las métricas a través de HTTP y otro
+ * para recargar la configuración en caliente, y actualizar periódicamente las métricas
+ * habilitadas en un bucle infinito (salvo en modo scrape, donde recolecta cada scrape).
  *
  * @param argc Número de argumentos de línea de comandos.
- * @param argv Array de argumentos de línea de comandos.
+ * @param argv Array de argumentos de línea de comandos. argv[1] opcional: ruta del archivo
+ *             de configuración (por defecto DEFAULT_CONFIG_FILE).
  * @return EXIT_SUCCESS si la ejecución fue exitosa, EXIT_FAILURE en caso de error.
  */
 int main(int argc, char* argv[])
 {
+    // Cargar la configuración antes de crear hilos para que hereden SIGHUP bloqueado
+    config_init(argc > 1 ? argv[1] : DEFAULT_CONFIG_FILE);
+
     init_metrics();
     // Creamos un hilo para exponer las métricas vía HTTP
     pthread_t tid;
@@ -35,16 +40,23 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
+    // Creamos un hilo para recargar la configuración ante cambios o SIGHUP
+    pthread_t config_tid;
+    if (pthread_create(&config_tid, NULL, config_watch, NULL) != 0)
+    {
+        fprintf(stderr, "Error al crear el hilo de recarga de configuración\n");
+        return EXIT_FAILURE;
+    }
+
     // Bucle principal para actualizar las métricas cada segundo
     while (true)
     {
-        update_cpu_gauge();
-        update_memory_gauge();
-        update_memory_fragmentation();
-        update_disk_gauge();
-        update_network_gauge();
-        update_procs_gauge();
-        update_ctxt_gauge();
+        // En modo scrape recolectan los scrapes; el bucle solo vuelve a mirar la configuración
+        if (config_current_collection().mode == COLLECTION_MODE_INTERVAL)
+        {
+            // Recolecta y publica el ciclo completo: los scrapes ven todas las series de la misma generación
+            collection_run();
+        }
 
         //send_metrics_to_monitor();
 
@@ -0,0 +1,626 @@
+#include "../include/metric_store.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Familias registradas */
+static MetricFamily families[METRIC_STORE_MAX_FAMILIES];
+
+/** Cantidad de familias publicadas para los lectores */
+static atomic_size_t family_count;
+
+/** Descriptores de series */
+static MetricSeriesInfo* series_info;
+
+/** Cantidad de series publicadas para los lectores */
+static atomic_size_t series_count;
+
+/** Capacidad de series */
+static size_t series_capacity;
+
+/** Buffers de valores: el frontal es buffers[generation & 1] */
+static double* buffers[2];
+
+/** Generación publicada */
+static atomic_uint_fast64_t generation;
+
+/** Valores escritos desde otros hilos (bits del double), aplicados al publicar */
+static _Atomic uint64_t* staged_values;
+
+/** Marca las series que ya están en la lista de series con valores desde otros hilos */
+static atomic_uchar* staged_flags;
+
+/** Series con valores desde otros hilos, en orden de primer uso */
+static MetricSeries* staged_list;
+
+/** Cantidad de series en staged_list */
+static atomic_size_t staged_count;
+
+/**
+ * @struct SeriesIndexEntry
+ * @brief Entrada del índice de series: hash de (familia, sufijo, etiquetas) y la serie, en línea.
+ */
+typedef struct
+{
+    _Atomic uint64_t hash;       /**< Hash de la serie; 0 si la entrada está libre. */
+    _Atomic MetricSeries series; /**< Serie a la que apunta la entrada. */
+} SeriesIndexEntry;
+
+/** Índice de series con direccionamiento abierto (potencia de dos, carga máxima 1/2) */
+static SeriesIndexEntry* series_index;
+
+/** Máscara de posiciones del índice */
+static size_t series_index_mask;
+
+/** Serializa los registros de familias y series */
+static pthread_mutex_t register_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Buffer trasero de la generación vigente.
+ * @return Buffer en el que escribe el recolector.
+ */
+static inline double* back_buffer()
+{
+    return buffers[(atomic_load_explicit(&generation, memory_order_relaxed) + 1) & 1];
+}
+
+int metric_store_init(size_t max_series)
+{
+    series_info = calloc(max_series, sizeof(MetricSeriesInfo));
+    buffers[0] = malloc(max_series * sizeof(double));
+    buffers[1] = malloc(max_series * sizeof(double));
+    staged_values = calloc(max_series, sizeof(*staged_values));
+    staged_flags = calloc(max_series, sizeof(*staged_flags));
+    staged_list = calloc(max_series, sizeof(*staged_list));
+
+    size_t index_size = 16;
+    while (index_size < max_series * 2)
+    {
+        index_size *= 2;
+    }
+    series_index = calloc(index_size, sizeof(SeriesIndexEntry));
+    series_index_mask = index_size - 1;
+
+    if (series_info == NULL || buffers[0] == NULL || buffers[1] == NULL || staged_values == NULL ||
+        staged_flags == NULL || staged_list == NULL || series_index == NULL)
+    {
+        fprintf(stderr, "Error al reservar memoria para el almacén de métricas\n");
+        return -1;
+    }
+
+    for (size_t i = 0; i < max_series; i++)
+    {
+        buffers[0][i] = METRIC_VALUE_ABSENT;
+        buffers[1][i] = METRIC_VALUE_ABSENT;
+    }
+    series_capacity = max_series;
+    return 0;
+}
+
+int metric_store_add_family(const char* name, const char* help, MetricType type)
+{
+    pthread_mutex_lock(&register_lock);
+
+    size_t index = atomic_load(&family_count);
+    if (index >= METRIC_STORE_MAX_FAMILIES)
+    {
+        pthread_mutex_unlock(&register_lock);
+        fprintf(stderr, "Límite de familias de métricas alcanzado: %s\n", name);
+        return -1;
+    }
+
+    MetricFamily* family = &families[index];
+    family->name = strdup(name);
+    family->help = strdup(help);
+    family->type = type;
+    atomic_init(&family->head, METRIC_SERIES_INVALID);
+    family->tail = METRIC_SERIES_INVALID;
+
+    // Publicar la familia recién completa
+    atomic_store_explicit(&family_count, index + 1, memory_order_release);
+    pthread_mutex_unlock(&register_lock);
+    return (int)index;
+}
+
+/**
+ * @brief Separa etiquetas formateadas (`{k="v",...}`) en pares nombre/valor sin escapar.
+ * @param labels Etiquetas formateadas.
+ * @param count Recibe la cantidad de pares.
+ * @return Arreglo de 2 * count cadenas, o NULL si no hay etiquetas o el formato es inválido.
+ */
+static char** parse_label_pairs(const char* labels, size_t* count)
+{
+    *count = 0;
+    if (labels == NULL || labels[0] != '{')
+    {
+        return NULL;
+    }
+
+    // Cota superior de pares: cada uno lleva al menos un '='
+    size_t capacity = 0;
+    for (const char* c = labels; *c != '\0'; c++)
+    {
+        capacity += *c == '=';
+    }
+    char** pairs = calloc(capacity * 2 + 1, sizeof(char*));
+    char* value = malloc(strlen(labels) + 1);
+    if (pairs == NULL || value == NULL)
+    {
+        free(pairs);
+        free(value);
+        return NULL;
+    }
+
+    const char* cursor = labels + 1;
+    size_t parsed = 0;
+    while (*cursor != '}' && *cursor != '\0' && parsed < capacity)
+    {
+        const char* name = cursor;
+        while (*cursor != '=' && *cursor != '\0')
+        {
+            cursor++;
+        }
+        if (cursor[0] != '=' || cursor[1] != '"')
+        {
+            break;
+        }
+        size_t name_len = (size_t)(cursor - name);
+        cursor += 2;
+
+        size_t len = 0;
+        while (*cursor != '"' && *cursor != '\0')
+        {
+            if (*cursor == '\\' && cursor[1] != '\0')
+            {
+                cursor++;
+                value[len++] = *cursor == 'n' ? '\n' : *cursor;
+            }
+            else
+            {
+                value[len++] = *cursor;
+            }
+            cursor++;
+        }
+        if (*cursor != '"')
+        {
+            break;
+        }
+        cursor++;
+        if (*cursor == ',')
+        {
+            cursor++;
+        }
+
+        pairs[parsed * 2] = strndup(name, name_len);
+        pairs[parsed * 2 + 1] = strndup(value, len);
+        parsed++;
+    }
+
+    free(value);
+    *count = parsed;
+    return pairs;
+}
+
+/**
+ * @brief Hash FNV-1a de la identidad de una serie.
+ * @param family Índice de la familia.
+ * @param suffix Sufijo del nombre de la muestra.
+ * @param labels Etiquetas formateadas, o NULL.
+ * @return Hash distinto de cero (0 marca las entradas libres del índice).
+ */
+static uint64_t series_hash(int family, const char* suffix, const char* labels)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    hash = (hash ^ (uint64_t)(uint32_t)family) * 1099511628211ULL;
+    for (const char* c = suffix; *c != '\0'; c++)
+    {
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+    }
+    hash = (hash ^ '|') * 1099511628211ULL;
+    for (const char* c = labels ? labels : ""; *c != '\0'; c++)
+    {
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+/**
+ * @brief Busca una serie en el índice.
+ * @param family Índice de la familia.
+ * @param suffix Sufijo del nombre de la muestra.
+ * @param labels Etiquetas formateadas, o NULL.
+ * @param hash Hash de la identidad.
+ * @return Serie encontrada, o METRIC_SERIES_INVALID.
+ */
+static MetricSeries find_series(int family, const char* suffix, const char* labels, uint64_t hash)
+{
+    if (series_index == NULL)
+    {
+        return METRIC_SERIES_INVALID;
+    }
+
+    const char* wanted = labels ? labels : "";
+    for (size_t pos = hash & series_index_mask;; pos = (pos + 1) & series_index_mask)
+    {
+        uint64_t entry = atomic_load_explicit(&series_index[pos].hash, memory_order_acquire);
+        if (entry == 0)
+        {
+            return METRIC_SERIES_INVALID;
+        }
+        if (entry == hash)
+        {
+            MetricSeries series = atomic_load_explicit(&series_index[pos].series, memory_order_relaxed);
+            const MetricSeriesInfo* info = &series_info[series];
+            if (info->family == (uint32_t)family && strcmp(info->suffix, suffix) == 0 &&
+                strcmp(info->labels, wanted) == 0)
+            {
+                return series;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Agrega una serie al índice. Requiere `register_lock`.
+ * @param series Serie ya completa.
+ * @param hash Hash de su identidad.
+ */
+static void index_series(MetricSeries series, uint64_t hash)
+{
+    size_t pos = hash & series_index_mask;
+    while (atomic_load_explicit(&series_index[pos].hash, memory_order_relaxed) != 0)
+    {
+        pos = (pos + 1) & series_index_mask;
+    }
+    // La serie se escribe antes que el hash que hace visible la entrada
+    atomic_store_explicit(&series_index[pos].series, series, memory_order_relaxed);
+    atomic_store_explicit(&series_index[pos].hash, hash, memory_order_release);
+}
+
+/**
+ * @brief Registra una serie con `register_lock` ya tomado.
+ * @param family Índice de la familia.
+ * @param labels Etiquetas formateadas, o NULL.
+ * @param suffix Sufijo del nombre de la muestra.
+ * @return Identificador de la serie (la existente si ya estaba registrada), o
+ *         METRIC_SERIES_INVALID en caso de error.
+ */
+static MetricSeries add_series_locked(int family, const char* labels, const char* suffix)
+{
+    size_t index = atomic_load(&series_count);
+    if (family < 0 || (size_t)family >= atomic_load(&family_count))
+    {
+        fprintf(stderr, "No se pudo registrar la serie (familia %d)\n", family);
+        return METRIC_SERIES_INVALID;
+    }
+
+    uint64_t hash = series_hash(family, suffix, labels);
+    MetricSeries existing = find_series(family, suffix, labels, hash);
+    if (existing != METRIC_SERIES_INVALID)
+    {
+        return existing;
+    }
+    if (index >= series_capacity)
+    {
+        fprintf(stderr, "No se pudo registrar la serie (familia %d): capacidad agotada\n", family);
+        return METRIC_SERIES_INVALID;
+    }
+
+    MetricSeriesInfo* info = &series_info[index];
+    info->family = (uint32_t)family;
+    info->labels = strdup(labels ? labels : "");
+    info->label_pairs = parse_label_pairs(labels, &info->label_count);
+    info->suffix = suffix;
+    info->histogram_buckets = 0;
+    info->bound = 0.0;
+    atomic_init(&info->next, METRIC_SERIES_INVALID);
+
+    // Enlazar al final de la familia: el enlace se publica después de completar el descriptor
+    MetricFamily* owner = &families[family];
+    if (owner->tail == METRIC_SERIES_INVALID)
+    {
+        atomic_store_explicit(&owner->head, (MetricSeries)index, memory_order_release);
+    }
+    else
+    {
+        atomic_store_explicit(&series_info[owner->tail].next, (MetricSeries)index, memory_order_release);
+    }
+    owner->tail = (MetricSeries)index;
+
+    atomic_store_explicit(&series_count, index + 1, memory_order_release);
+    index_series((MetricSeries)index, hash);
+    return (MetricSeries)index;
+}
+
+uint64_t metric_store_labels_hash(int family, const char* labels)
+{
+    return series_hash(family, "", labels);
+}
+
+MetricSeries metric_store_find_series(int family, const char* labels, uint64_t hash)
+{
+    return find_series(family, "", labels, hash);
+}
+
+MetricSeries metric_store_add_series(int family, const char* labels)
+{
+    pthread_mutex_lock(&register_lock);
+    MetricSeries series = add_series_locked(family, labels, "");
+    pthread_mutex_unlock(&register_lock);
+    return series;
+}
+
+int metric_store_add_histogram(int family, const char* labels, const double* bounds, size_t bound_count,
+                               MetricHistogram* histogram)
+{
+    // Las etiquetas comunes sin llaves, para agregarles "le"
+    const char* common = labels != NULL && labels[0] == '{' ? labels + 1 : "";
+    size_t common_len = strlen(common);
+    if (common_len > 0 && common[common_len - 1] == '}')
+    {
+        common_len--;
+    }
+
+    size_t size = common_len + 64;
+    char* bucket_labels = malloc(size);
+    if (bucket_labels == NULL)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&register_lock);
+    MetricSeries first = METRIC_SERIES_INVALID;
+    int ret = 0;
+    for (size_t i = 0; i <= bound_count && ret == 0; i++)
+    {
+        if (i < bound_count)
+        {
+            // La representación más corta que conserva el valor exacto del límite
+            char bound[32];
+            for (int precision = 15; precision <= 17; precision++)
+            {
+                snprintf(bound, sizeof(bound), "%.*g", precision, bounds[i]);
+                if (strtod(bound, NULL) == bounds[i])
+                {
+                    break;
+                }
+            }
+            snprintf(bucket_labels, size, "{%.*s%sle=\"%s\"}", (int)common_len, common, common_len ? "," : "", bound);
+        }
+        else
+        {
+            snprintf(bucket_labels, size, "{%.*s%sle=\"+Inf\"}", (int)common_len, common, common_len ? "," : "");
+        }
+
+        MetricSeries series = add_series_locked(family, bucket_labels, "_bucket");
+        if (series == METRIC_SERIES_INVALID)
+        {
+            ret = -1;
+            break;
+        }
+        series_info[series].bound = i < bound_count ? bounds[i] : INFINITY;
+        if (first == METRIC_SERIES_INVALID)
+        {
+            first = series;
+        }
+    }
+    if (ret == 0 && (add_series_locked(family, labels, "_sum") == METRIC_SERIES_INVALID ||
+                     add_series_locked(family, labels, "_count") == METRIC_SERIES_INVALID))
+    {
+        ret = -1;
+    }
+    if (ret == 0)
+    {
+        series_info[first].histogram_buckets = (uint32_t)(bound_count + 1);
+    }
+    pthread_mutex_unlock(&register_lock);
+    free(bucket_labels);
+
+    if (ret != 0)
+    {
+        return -1;
+    }
+
+    histogram->first = first;
+    histogram->bounds = bounds;
+    histogram->bound_count = bound_count;
+
+    // Un histograma sin observaciones se expone completo en cero
+    for (size_t i = 0; i < bound_count + 3; i++)
+    {
+        metric_store_stage_add(first + (MetricSeries)i, 0.0);
+    }
+    return 0;
+}
+
+void metric_store_stage_observe(const MetricHistogram* histogram, double value)
+{
+    for (size_t i = 0; i < histogram->bound_count; i++)
+    {
+        if (value <= histogram->bounds[i])
+        {
+            metric_store_stage_add(histogram->first + (MetricSeries)i, 1.0);
+        }
+    }
+    MetricSeries inf = histogram->first + (MetricSeries)histogram->bound_count;
+    metric_store_stage_add(inf, 1.0);
+    metric_store_stage_add(inf + 1, value);
+    metric_store_stage_add(inf + 2, 1.0);
+}
+
+MetricSeries metric_store_register(const char* name, const char* help, MetricType type)
+{
+    int family = metric_store_add_family(name, help, type);
+    if (family < 0)
+    {
+        return METRIC_SERIES_INVALID;
+    }
+    return metric_store_add_series(family, NULL);
+}
+
+void metric_store_set(MetricSeries series, double value)
+{
+    if (series < series_capacity)
+    {
+        back_buffer()[series] = value;
+    }
+}
+
+void metric_store_add(MetricSeries series, double value)
+{
+    if (series < series_capacity)
+    {
+        double* back = back_buffer();
+        back[series] = isnan(back[series]) ? value : back[series] + value;
+    }
+}
+
+void metric_store_clear(MetricSeries series)
+{
+    metric_store_set(series, METRIC_VALUE_ABSENT);
+}
+
+/**
+ * @brief Convierte un double a su representación en bits.
+ */
+static inline uint64_t double_to_bits(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/**
+ * @brief Convierte bits a double.
+ */
+static inline double bits_to_double(uint64_t bits)
+{
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Agrega la serie a la lista de series con valores desde otros hilos (solo la primera vez).
+ * @param series Serie a marcar.
+ */
+static void mark_staged(MetricSeries series)
+{
+    if (atomic_load_explicit(&staged_flags[series], memory_order_acquire))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&register_lock);
+    if (!atomic_load(&staged_flags[series]))
+    {
+        size_t index = atomic_load(&staged_count);
+        staged_list[index] = series;
+        atomic_store_explicit(&staged_count, index + 1, memory_order_release);
+        atomic_store_explicit(&staged_flags[series], 1, memory_order_release);
+    }
+    pthread_mutex_unlock(&register_lock);
+}
+
+void metric_store_stage(MetricSeries series, double value)
+{
+    if (series >= series_capacity)
+    {
+        return;
+    }
+    atomic_store_explicit(&staged_values[series], double_to_bits(value), memory_order_relaxed);
+    mark_staged(series);
+}
+
+void metric_store_stage_add(MetricSeries series, double value)
+{
+    if (series >= series_capacity)
+    {
+        return;
+    }
+
+    uint64_t expected = atomic_load_explicit(&staged_values[series], memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&staged_values[series], &expected,
+                                                  double_to_bits(bits_to_double(expected) + value),
+                                                  memory_order_relaxed, memory_order_relaxed))
+    {
+    }
+    mark_staged(series);
+}
+
+uint64_t metric_store_publish()
+{
+    uint64_t published = atomic_load_explicit(&generation, memory_order_relaxed) + 1;
+
+    // Incorporar los valores que otros hilos dejaron desde la publicación anterior
+    double* back = back_buffer();
+    size_t staged = atomic_load_explicit(&staged_count, memory_order_acquire);
+    for (size_t i = 0; i < staged; i++)
+    {
+        MetricSeries series = staged_list[i];
+        back[series] = bits_to_double(atomic_load_explicit(&staged_values[series], memory_order_relaxed));
+    }
+
+    // El buffer trasero pasa a ser el frontal con un único incremento
+    atomic_store_explicit(&generation, published, memory_order_release);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    // El nuevo trasero (frontal anterior) arranca con los valores publicados; un lector que
+    // todavía lea la generación anterior lo detecta al validar y repite la lectura
+    size_t count = atomic_load_explicit(&series_count, memory_order_acquire);
+    memcpy(buffers[(published + 1) & 1], buffers[published & 1], count * sizeof(double));
+
+    return published;
+}
+
+uint64_t metric_store_generation()
+{
+    return atomic_load_explicit(&generation, memory_order_acquire);
+}
+
+uint64_t metric_store_read_begin(const double** values)
+{
+    uint64_t current = atomic_load_explicit(&generation, memory_order_acquire);
+    *values = buffers[current & 1];
+    return current;
+}
+
+int metric_store_read_valid(uint64_t read_generation)
+{
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&generation, memory_order_relaxed) == read_generation;
+}
+
+size_t metric_store_family_count()
+{
+    return atomic_load_explicit(&family_count, memory_order_acquire);
+}
+
+const MetricFamily* metric_store_family(size_t family)
+{
+    return &families[family];
+}
+
+int metric_store_find_family(const char* name)
+{
+    size_t count = metric_store_family_count();
+    for (size_t i = 0; i < count; i++)
+    {
+        if (strcmp(families[i].name, name) == 0)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+size_t metric_store_series_count()
+{
+    return atomic_load_explicit(&series_count, memory_order_acquire);
+}
+
+const MetricSeriesInfo* metric_store_series(MetricSeries series)
+{
+    return &series_info[series];
+}
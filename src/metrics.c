@@ -1,10 +1,126 @@
 #include "../include/metrics.h"
+#include <errno.h>
+#include <fcntl.h>
 
 /**
  * @brief Tamaño del buffer utilizado para almacenar el nombre del disco.
  */
 #define SIZE_BUFF 32
 
+/** Ruta de cada archivo relativa a la raíz del sistema, indexada por ProcfsFile */
+static const char* const procfs_files[PROCFS_FILE_COUNT] = {
+    "proc/meminfo",
+    "proc/stat",
+    "proc/diskstats",
+    "proc/net/dev",
+    "proc/loadavg",
+    "proc/pressure/cpu",
+    "proc/pressure/memory",
+    "proc/pressure/io",
+    "sys/fs/cgroup/cpu.stat",
+    "sys/fs/cgroup/unified/cpu.stat",
+    "sys/fs/cgroup/cpu.max",
+};
+
+/** Ruta completa de cada archivo; se arma al cambiar la raíz para no formatearla en cada lectura */
+static char procfs_paths[PROCFS_FILE_COUNT][METRICS_PATH_SIZE] = {
+    "/proc/meminfo",
+    "/proc/stat",
+    "/proc/diskstats",
+    "/proc/net/dev",
+    "/proc/loadavg",
+    "/proc/pressure/cpu",
+    "/proc/pressure/memory",
+    "/proc/pressure/io",
+    "/sys/fs/cgroup/cpu.stat",
+    "/sys/fs/cgroup/unified/cpu.stat",
+    "/sys/fs/cgroup/cpu.max",
+};
+
+/** El archivo está bajo una raíz distinta de la real y hay que reabrirlo para ver cambios */
+static int procfs_replaced[PROCFS_FILE_COUNT];
+
+/**
+ * @brief Rearma las rutas de los archivos de un montaje bajo otra raíz.
+ * @param mount Prefijo del montaje en `procfs_files` ("proc" o "sys").
+ * @param root Directorio que reemplaza al montaje.
+ * @return 0 en caso de éxito, -1 si alguna ruta no entra en METRICS_PATH_SIZE.
+ */
+static int set_root(const char* mount, const char* root)
+{
+    char paths[PROCFS_FILE_COUNT][METRICS_PATH_SIZE];
+    memcpy(paths, procfs_paths, sizeof(paths));
+    size_t mount_len = strlen(mount);
+    for (int i = 0; i < PROCFS_FILE_COUNT; i++)
+    {
+        if (strncmp(procfs_files[i], mount, mount_len) != 0 || procfs_files[i][mount_len] != '/')
+        {
+            continue;
+        }
+        int len = snprintf(paths[i], sizeof(paths[i]), "%s%s", root, procfs_files[i] + mount_len);
+        if (len < 0 || (size_t)len >= sizeof(paths[i]))
+        {
+            fprintf(stderr, "Error: la raíz de %s '%s' es demasiado larga\n", mount, root);
+            return -1;
+        }
+    }
+    memcpy(procfs_paths, paths, sizeof(paths));
+    for (int i = 0; i < PROCFS_FILE_COUNT; i++)
+    {
+        procfs_replaced[i] = procfs_paths[i][0] != '/' || strcmp(procfs_paths[i] + 1, procfs_files[i]) != 0;
+    }
+    return 0;
+}
+
+int metrics_set_procfs_root(const char* root)
+{
+    return set_root("proc", root);
+}
+
+int metrics_set_sysfs_root(const char* root)
+{
+    return set_root("sys", root);
+}
+
+const char* metrics_procfs_file(ProcfsFile file)
+{
+    return procfs_files[file];
+}
+
+const char* metrics_procfs_path(ProcfsFile file)
+{
+    return procfs_paths[file];
+}
+
+void metrics_procfs_refresh(ProcfsFile file, int fd)
+{
+    if (!procfs_replaced[file])
+    {
+        return;
+    }
+    int fresh = open(procfs_paths[file], O_RDONLY | O_CLOEXEC);
+    if (fresh >= 0)
+    {
+        dup2(fresh, fd);
+        close(fresh);
+    }
+}
+
+/**
+ * @brief Abre un archivo de procfs bajo la raíz configurada.
+ * @param file Archivo.
+ * @return Archivo abierto para lectura, o NULL (con el error ya informado).
+ */
+static FILE* open_procfs(ProcfsFile file)
+{
+    FILE* fp = fopen(procfs_paths[file], "r");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Error al abrir %s: %s\n", procfs_paths[file], strerror(errno));
+    }
+    return fp;
+}
+
 double get_memory_usage()
 {
     FILE* fp;
@@ -12,10 +128,9 @@ double get_memory_usage()
     unsigned long long total_mem = 0, free_mem = 0;
 
     // Abrir el archivo /proc/meminfo
-    fp = fopen("/proc/meminfo", "r");
+    fp = open_procfs(PROCFS_MEMINFO);
     if (fp == NULL)
     {
-        perror("Error al abrir /proc/meminfo");
         return -1.0;
     }
 
@@ -50,10 +165,9 @@ double get_memory_usage()
 
 double get_memory_fragmentation()
 {
-    FILE* fp = fopen("/proc/meminfo", "r");
+    FILE* fp = open_procfs(PROCFS_MEMINFO);
     if (fp == NULL)
     {
-        perror("Error al abrir /proc/meminfo");
         return -1.0;
     }
 
@@ -93,10 +207,9 @@ double get_cpu_usage()
     double cpu_usage_percent;
 
     // Abrir el archivo /proc/stat
-    FILE* fp = fopen("/proc/stat", "r");
+    FILE* fp = open_procfs(PROCFS_STAT);
     if (fp == NULL)
     {
-        perror("Error al abrir /proc/stat");
         return -1.0;
     }
 
@@ -161,10 +274,9 @@ double get_disk_usage()
     double usage = 0;
 
     // Abrir el archivo /proc/diskstats
-    fp = fopen("/proc/diskstats", "r");
+    fp = open_procfs(PROCFS_DISKSTATS);
     if (fp == NULL)
     {
-        perror("Error al abrir /proc/diskstats");
         return -1.0;
     }
 
@@ -206,10 +318,9 @@ double get_network_usage(const char* interface)
     unsigned long long int rx_bytes = 0, tx_bytes = 0;
 
     // Abrir el archivo /proc/net/dev
-    fp = fopen("/proc/net/dev", "r");
+    fp = open_procfs(PROCFS_NET_DEV);
     if (fp == NULL)
     {
-        perror("Error al abrir /proc/net/dev");
         return -1.0;
     }
 
@@ -244,11 +355,10 @@ int get_process_usage()
     char buffer[BUFFER_SIZE];
     unsigned int total_process = 0;
 
-    // Abrir el archivo /proc/meminfo
-    fp = fopen("/proc/stat", "r");
+    // Abrir el archivo /proc/stat
+    fp = open_procfs(PROCFS_STAT);
     if (fp == NULL)
     {
-        perror("Error al abrir /proc/stat");
         return -1.0;
     }
 
@@ -281,11 +391,10 @@ double get_ctxt_usage()
     char buffer[BUFFER_SIZE];
     unsigned long ctxt = 0;
 
-    // Abrir el archivo /proc/meminfo
-    fp = fopen("/proc/stat", "r");
+    // Abrir el archivo /proc/stat
+    fp = open_procfs(PROCFS_STAT);
     if (fp == NULL)
     {
-        perror("Error al abrir /proc/stat");
         return -1.0;
     }
 
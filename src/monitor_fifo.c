@@ -0,0 +1,658 @@
+#include "../include/monitor_fifo.h"
+#include "../include/buffer.h"
+#include "../include/cbor.h"
+#include "../include/collection.h"
+#include "../include/delta_stream.h"
+#include "../include/json_writer.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Espera entre intentos de abrir el FIFO sin lector, y máximo de cada espera de escritura.
+ */
+#define MONITOR_RETRY_MS 1000
+
+/**
+ * @brief Bytes de la longitud que precede a cada mensaje, en la cola y en el framing "length".
+ */
+#define MONITOR_LENGTH_BYTES 4
+
+/**
+ * @brief Cantidad de métricas del sistema que lleva cada mensaje.
+ */
+#define MONITOR_FIELD_COUNT 6
+
+/**
+ * @struct MonitorField
+ * @brief Métrica del sistema incluida en los mensajes.
+ */
+typedef struct
+{
+    const char* key;     /**< Clave en el mensaje (la que usa el monitor). */
+    const char* family;  /**< Familia del almacén de la que se toma el valor. */
+    MetricSeries series; /**< Serie resuelta, o METRIC_SERIES_INVALID si aún no se registró. */
+} MonitorField;
+
+/** Métricas de cada mensaje; se registran después de iniciar el envío y se resuelven al usarlas */
+static MonitorField fields[MONITOR_FIELD_COUNT] = {
+    {"cpu_usage", "cpu_usage_percentage", METRIC_SERIES_INVALID},
+    {"memory_usage", "memory_usage_percentage", METRIC_SERIES_INVALID},
+    {"disk_usage", "disk_usage", METRIC_SERIES_INVALID},
+    {"network_usage", "network_usage_metric", METRIC_SERIES_INVALID},
+    {"process_count", "procs_usage_count", METRIC_SERIES_INVALID},
+    {"context_switches", "ctxt_usage_count", METRIC_SERIES_INVALID},
+};
+
+/** Opciones leídas al iniciar */
+static MonitorConfig config;
+
+/** El envío está iniciado; lo protege `queue_lock` */
+static int running;
+
+/** Se pidió detener el hilo escritor */
+static int stopping;
+
+/** Hilo escritor */
+static pthread_t writer;
+
+/** Protege la cola, `running` y `stopping` */
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Avisa al escritor que hay mensajes o que debe terminar */
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+
+/** Anillo de mensajes: cada uno es su longitud (nativa) seguida de los bytes ya delimitados */
+static unsigned char* ring;
+
+/** Capacidad del anillo */
+static size_t ring_capacity;
+
+/** Posición del mensaje más viejo */
+static size_t ring_head;
+
+/** Bytes ocupados */
+static size_t ring_used;
+
+/** Protege `encoded` y la resolución de `fields` */
+static pthread_mutex_t encode_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Mensaje en construcción; se reutiliza entre ciclos */
+static Buffer encoded;
+
+/** Estado del modo delta; lo protege `encode_lock` salvo los pedidos de keyframe */
+static DeltaStream delta;
+
+/** Mensaje que está escribiendo el hilo escritor */
+static Buffer frame;
+
+/** FIFO abierto para escritura, o -1 */
+static int fifo_fd = -1;
+
+/** Ya se informó un error al abrir o escribir; se vuelve a informar tras una escritura exitosa */
+static int failure_reported;
+
+/** Mensajes encolados */
+static MetricSeries messages_metric = METRIC_SERIES_INVALID;
+
+/** Mensajes escritos completos en el FIFO */
+static MetricSeries sent_metric = METRIC_SERIES_INVALID;
+
+/** Mensajes descartados porque la cola estaba llena */
+static MetricSeries dropped_metric = METRIC_SERIES_INVALID;
+
+/** Bytes en la cola */
+static MetricSeries queued_metric = METRIC_SERIES_INVALID;
+
+/**
+ * @brief Copia bytes al anillo a partir de una posición, dando la vuelta si hace falta.
+ * @param offset Posición inicial.
+ * @param data Bytes.
+ * @param len Cantidad.
+ */
+static void ring_write(size_t offset, const void* data, size_t len)
+{
+    size_t first = len < ring_capacity - offset ? len : ring_capacity - offset;
+    memcpy(ring + offset, data, first);
+    memcpy(ring, (const unsigned char*)data + first, len - first);
+}
+
+/**
+ * @brief Copia bytes del anillo a partir de una posición, dando la vuelta si hace falta.
+ * @param offset Posición inicial.
+ * @param data Destino.
+ * @param len Cantidad.
+ */
+static void ring_read(size_t offset, void* data, size_t len)
+{
+    size_t first = len < ring_capacity - offset ? len : ring_capacity - offset;
+    memcpy(data, ring + offset, first);
+    memcpy((unsigned char*)data + first, ring, len - first);
+}
+
+/**
+ * @brief Saca el mensaje más viejo de la cola; debe tenerse `queue_lock`.
+ * @param out Recibe el mensaje, o NULL para descartarlo.
+ * @return 0 en caso de éxito, -1 si no hay memoria (el mensaje se descarta igual).
+ */
+static int ring_pop(Buffer* out)
+{
+    uint32_t len;
+    ring_read(ring_head, &len, sizeof(len));
+    size_t data_offset = (ring_head + sizeof(len)) % ring_capacity;
+    int ret = 0;
+    if (out != NULL)
+    {
+        buffer_reset(out);
+        ret = buffer_reserve(out, len);
+        if (ret == 0)
+        {
+            ring_read(data_offset, out->data, len);
+            out->len = len;
+        }
+    }
+    ring_head = (data_offset + len) % ring_capacity;
+    ring_used -= sizeof(len) + len;
+    return ret;
+}
+
+int monitor_fifo_enqueue(const void* message, size_t len)
+{
+    size_t framed = len + (config.framing == MONITOR_FRAMING_LENGTH ? MONITOR_LENGTH_BYTES : 1);
+    uint32_t entry_len = (uint32_t)framed;
+    pthread_mutex_lock(&queue_lock);
+    if (!running || sizeof(entry_len) + framed > ring_capacity)
+    {
+        int was_running = running;
+        pthread_mutex_unlock(&queue_lock);
+        if (was_running)
+        {
+            delta_stream_request_keyframe(&delta);
+            metric_store_stage_add(dropped_metric, 1.0);
+        }
+        return -1;
+    }
+    size_t dropped = 0;
+    while (ring_used + sizeof(entry_len) + framed > ring_capacity)
+    {
+        ring_pop(NULL);
+        dropped++;
+    }
+    if (dropped > 0)
+    {
+        // El lector perdió mensajes: los deltas siguientes no le sirven hasta un keyframe
+        delta_stream_request_keyframe(&delta);
+    }
+
+    size_t offset = (ring_head + ring_used) % ring_capacity;
+    ring_write(offset, &entry_len, sizeof(entry_len));
+    offset = (offset + sizeof(entry_len)) % ring_capacity;
+    if (config.framing == MONITOR_FRAMING_LENGTH)
+    {
+        unsigned char prefix[MONITOR_LENGTH_BYTES] = {(unsigned char)(len >> 24), (unsigned char)(len >> 16),
+                                                      (unsigned char)(len >> 8), (unsigned char)len};
+        ring_write(offset, prefix, sizeof(prefix));
+        ring_write((offset + sizeof(prefix)) % ring_capacity, message, len);
+    }
+    else
+    {
+        ring_write(offset, message, len);
+        ring_write((offset + len) % ring_capacity, "\n", 1);
+    }
+    ring_used += sizeof(entry_len) + framed;
+    size_t used = ring_used;
+    pthread_cond_signal(&queue_cond);
+    pthread_mutex_unlock(&queue_lock);
+
+    metric_store_stage_add(messages_metric, 1.0);
+    metric_store_stage_add(dropped_metric, (double)dropped);
+    metric_store_stage(queued_metric, (double)used);
+    return 0;
+}
+
+/**
+ * @brief Resuelve la serie de una métrica del sistema buscando su familia por nombre.
+ * @param field Métrica; queda sin resolver si la familia todavía no existe.
+ */
+static void resolve_field(MonitorField* field)
+{
+    int family = metric_store_find_family(field->family);
+    if (family >= 0)
+    {
+        field->series = atomic_load(&metric_store_family((size_t)family)->head);
+    }
+}
+
+/**
+ * @brief Agrega al mensaje CBOR o JSON un valor, o null si está ausente.
+ * @param json Escritor JSON sobre `encoded` (no se usa con CBOR).
+ * @param key Clave.
+ * @param value Valor, NaN si está ausente.
+ * @return 0 en caso de éxito, -1 si no hay memoria (con JSON, el error queda en `json`).
+ */
+static int encode_field(JsonWriter* json, const char* key, double value)
+{
+    if (config.encoding == MONITOR_ENCODING_CBOR)
+    {
+        return cbor_text(&encoded, key) | (isnan(value) ? cbor_null(&encoded) : cbor_double(&encoded, value));
+    }
+    json_key(json, key);
+    if (isnan(value))
+    {
+        json_null(json);
+    }
+    else
+    {
+        json_number(json, value);
+    }
+    return 0;
+}
+
+/**
+ * @brief Codifica en `encoded` un mensaje; debe tenerse `encode_lock`.
+ *
+ * En modo delta avanza el stream y codifica solo lo que cambió (o todo en un keyframe); en
+ * modo completo codifica los valores presentes.
+ *
+ * @param values Valor de cada métrica de `fields`, NaN si está ausente.
+ * @param timestamp_ms Milisegundos desde la época.
+ * @return 0 si hay un mensaje, 1 si en modo delta no cambió nada, -1 si no hay memoria.
+ */
+static int encode_message(const double* values, uint64_t timestamp_ms)
+{
+    uint32_t mask = 0;
+    DeltaFrame kind = DELTA_FRAME_KEYFRAME;
+    if (config.delta.enabled)
+    {
+        kind = delta_stream_next(&delta, values, &mask);
+        if (kind == DELTA_FRAME_NONE)
+        {
+            return 1;
+        }
+        values = delta.reference;
+    }
+    else
+    {
+        for (int i = 0; i < MONITOR_FIELD_COUNT; i++)
+        {
+            mask |= isnan(values[i]) ? 0 : 1u << i;
+        }
+    }
+
+    buffer_reset(&encoded);
+    JsonWriter json;
+    int ret = 0;
+    if (config.encoding == MONITOR_ENCODING_CBOR)
+    {
+        uint64_t pairs = (uint64_t)__builtin_popcount(mask) + (config.delta.enabled ? 3 : 1);
+        ret |= cbor_map(&encoded, pairs);
+        if (config.delta.enabled)
+        {
+            ret |= cbor_text(&encoded, "seq") | cbor_uint(&encoded, delta.sequence) | cbor_text(&encoded, "keyframe") |
+                   cbor_bool(&encoded, kind == DELTA_FRAME_KEYFRAME);
+        }
+        ret |= cbor_text(&encoded, "timestamp") | cbor_uint(&encoded, timestamp_ms);
+    }
+    else
+    {
+        json_writer_init(&json, &encoded);
+        json_begin_object(&json);
+        if (config.delta.enabled)
+        {
+            json_key(&json, "seq");
+            json_int(&json, (long long)delta.sequence);
+            json_key(&json, "keyframe");
+            json_bool(&json, kind == DELTA_FRAME_KEYFRAME);
+        }
+        json_key(&json, "timestamp");
+        json_int(&json, (long long)timestamp_ms);
+    }
+    for (int i = 0; i < MONITOR_FIELD_COUNT; i++)
+    {
+        if (mask & (1u << i))
+        {
+            ret |= encode_field(&json, fields[i].key, values[i]);
+        }
+    }
+    if (config.encoding == MONITOR_ENCODING_JSON)
+    {
+        json_end_object(&json);
+        ret |= json_writer_error(&json) ? -1 : 0;
+    }
+    return ret;
+}
+
+int monitor_fifo_send_current()
+{
+    if (!running)
+    {
+        return -1;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t timestamp_ms = (uint64_t)now.tv_sec * 1000u + (uint64_t)now.tv_nsec / 1000000u;
+
+    pthread_mutex_lock(&encode_lock);
+    for (int i = 0; i < MONITOR_FIELD_COUNT; i++)
+    {
+        if (fields[i].series == METRIC_SERIES_INVALID)
+        {
+            resolve_field(&fields[i]);
+        }
+    }
+    double present[MONITOR_FIELD_COUNT];
+    uint64_t generation;
+    do
+    {
+        const double* values;
+        generation = metric_store_read_begin(&values);
+        for (int i = 0; i < MONITOR_FIELD_COUNT; i++)
+        {
+            present[i] = fields[i].series == METRIC_SERIES_INVALID ? NAN : values[fields[i].series];
+        }
+    } while (!metric_store_read_valid(generation));
+    int ret = encode_message(present, timestamp_ms);
+    if (ret == 0)
+    {
+        ret = monitor_fifo_enqueue(encoded.data, encoded.len);
+    }
+    pthread_mutex_unlock(&encode_lock);
+    return ret < 0 ? -1 : 0;
+}
+
+/**
+ * @brief Encola un mensaje con la generación recién publicada (PublishFn).
+ * @param generation Generación publicada.
+ * @param arg Argumento no utilizado.
+ */
+static void monitor_fifo_publish(uint64_t generation, void* arg)
+{
+    (void)generation;
+    (void)arg;
+    monitor_fifo_send_current();
+}
+
+/**
+ * @brief Informa un error de apertura o escritura la primera vez que ocurre.
+ * @param what Operación que falló.
+ */
+static void report_failure(const char* what)
+{
+    if (!failure_reported)
+    {
+        fprintf(stderr, "monitor_fifo: error al %s %s: %s\n", what, config.fifo_path, strerror(errno));
+        failure_reported = 1;
+    }
+}
+
+/**
+ * @brief Espera hasta `MONITOR_RETRY_MS`, hasta que llegue un mensaje o hasta que se pida detener
+ *        el escritor; así un lector que se conecta empieza a recibir en el ciclo siguiente.
+ * @return 1 si se pidió detenerlo, 0 en caso contrario.
+ */
+static int wait_retry()
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += MONITOR_RETRY_MS / 1000;
+    pthread_mutex_lock(&queue_lock);
+    if (!stopping)
+    {
+        pthread_cond_timedwait(&queue_cond, &queue_lock, &deadline);
+    }
+    int stop = stopping;
+    pthread_mutex_unlock(&queue_lock);
+    return stop;
+}
+
+/**
+ * @brief Cierra el FIFO y descarta el SIGPIPE pendiente que dejó escribir sin lector.
+ */
+static void close_fifo()
+{
+    close(fifo_fd);
+    fifo_fd = -1;
+    sigset_t pipe_set;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    struct timespec zero = {0, 0};
+    while (sigtimedwait(&pipe_set, NULL, &zero) == SIGPIPE)
+    {
+    }
+}
+
+/**
+ * @brief Escribe `frame` completo en el FIFO, reintentando hasta que haya un lector.
+ * @return 0 si se escribió, -1 si se pidió detener el escritor antes.
+ */
+static int write_frame()
+{
+    // Un lector que se fue sin leer todo deja bytes en el pipe mientras siga abierto: se reabre
+    if (fifo_fd >= 0)
+    {
+        struct pollfd pfd = {fifo_fd, 0, 0};
+        if (poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLERR))
+        {
+            close_fifo();
+        }
+    }
+
+    size_t offset = 0;
+    while (offset < frame.len)
+    {
+        if (fifo_fd < 0)
+        {
+            // Sin lector open devuelve ENXIO: el mensaje espera y la cola sigue llenándose
+            fifo_fd = open(config.fifo_path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+            if (fifo_fd >= 0)
+            {
+                // Un lector nuevo necesita una referencia completa cuanto antes
+                delta_stream_request_keyframe(&delta);
+            }
+            if (fifo_fd < 0)
+            {
+                if (errno != ENXIO)
+                {
+                    report_failure("abrir");
+                }
+                if (wait_retry())
+                {
+                    return -1;
+                }
+                continue;
+            }
+        }
+
+        ssize_t written = write(fifo_fd, frame.data + offset, frame.len - offset);
+        if (written > 0)
+        {
+            offset += (size_t)written;
+            continue;
+        }
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written < 0 && errno == EAGAIN)
+        {
+            // Lector lento: se espera lugar sin soltar el mensaje a medio escribir
+            struct pollfd pfd = {fifo_fd, POLLOUT, 0};
+            poll(&pfd, 1, MONITOR_RETRY_MS);
+            pthread_mutex_lock(&queue_lock);
+            int stop = stopping;
+            pthread_mutex_unlock(&queue_lock);
+            if (stop)
+            {
+                return -1;
+            }
+            continue;
+        }
+
+        // EPIPE: el lector se fue; al cerrar se vacía el pipe y el próximo lector recibe el mensaje entero
+        if (errno != EPIPE)
+        {
+            report_failure("escribir en");
+        }
+        close_fifo();
+        offset = 0;
+    }
+    failure_reported = 0;
+    return 0;
+}
+
+/**
+ * @brief Hilo escritor: saca mensajes de la cola y los escribe en el FIFO.
+ * @param arg Argumento no utilizado.
+ * @return Siempre NULL.
+ */
+static void* writer_main(void* arg)
+{
+    (void)arg;
+
+    // Escribir sin lector genera SIGPIPE: en este hilo queda bloqueada y se usa EPIPE
+    sigset_t pipe_set;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, NULL);
+
+    for (;;)
+    {
+        pthread_mutex_lock(&queue_lock);
+        while (ring_used == 0 && !stopping)
+        {
+            pthread_cond_wait(&queue_cond, &queue_lock);
+        }
+        if (stopping)
+        {
+            pthread_mutex_unlock(&queue_lock);
+            break;
+        }
+        int ret = ring_pop(&frame);
+        size_t used = ring_used;
+        pthread_mutex_unlock(&queue_lock);
+        metric_store_stage(queued_metric, (double)used);
+
+        if (ret != 0)
+        {
+            metric_store_stage_add(dropped_metric, 1.0);
+            continue;
+        }
+        if (write_frame() != 0)
+        {
+            break;
+        }
+        metric_store_stage_add(sent_metric, 1.0);
+    }
+
+    if (fifo_fd >= 0)
+    {
+        close_fifo();
+    }
+    return NULL;
+}
+
+int monitor_fifo_start(const MonitorConfig* options)
+{
+    config = *options;
+    const char* families[MONITOR_FIELD_COUNT];
+    for (int i = 0; i < MONITOR_FIELD_COUNT; i++)
+    {
+        families[i] = fields[i].family;
+    }
+    delta_stream_init(&delta, &config.delta, families, MONITOR_FIELD_COUNT);
+
+    struct stat st;
+    if (mkfifo(config.fifo_path, 0600) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Error al crear el FIFO %s: %s\n", config.fifo_path, strerror(errno));
+        return -1;
+    }
+    if (stat(config.fifo_path, &st) != 0 || !S_ISFIFO(st.st_mode))
+    {
+        fprintf(stderr, "Error: %s existe y no es un FIFO\n", config.fifo_path);
+        return -1;
+    }
+
+    messages_metric =
+        metric_store_register("monitor_fifo_messages_total", "Mensajes encolados para el monitor", METRIC_TYPE_COUNTER);
+    sent_metric = metric_store_register("monitor_fifo_sent_messages_total", "Mensajes escritos completos en el FIFO",
+                                        METRIC_TYPE_COUNTER);
+    dropped_metric = metric_store_register("monitor_fifo_dropped_messages_total",
+                                           "Mensajes descartados por la cola del monitor llena", METRIC_TYPE_COUNTER);
+    queued_metric =
+        metric_store_register("monitor_fifo_queued_bytes", "Bytes en la cola del monitor", METRIC_TYPE_GAUGE);
+    if (messages_metric == METRIC_SERIES_INVALID || sent_metric == METRIC_SERIES_INVALID ||
+        dropped_metric == METRIC_SERIES_INVALID || queued_metric == METRIC_SERIES_INVALID)
+    {
+        fprintf(stderr, "Error al registrar las métricas del FIFO del monitor\n");
+        return -1;
+    }
+    metric_store_stage_add(messages_metric, 0.0);
+    metric_store_stage_add(sent_metric, 0.0);
+    metric_store_stage_add(dropped_metric, 0.0);
+    metric_store_stage(queued_metric, 0.0);
+
+    ring_capacity = (size_t)config.queue_kb * 1024;
+    ring = malloc(ring_capacity);
+    if (ring == NULL)
+    {
+        fprintf(stderr, "Error al reservar la cola del monitor\n");
+        return -1;
+    }
+    ring_head = 0;
+    ring_used = 0;
+    stopping = 0;
+    running = 1;
+    if (pthread_create(&writer, NULL, writer_main, NULL) != 0)
+    {
+        fprintf(stderr, "Error al crear el hilo del FIFO del monitor\n");
+        running = 0;
+        free(ring);
+        ring = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void monitor_fifo_stop()
+{
+    if (!running)
+    {
+        return;
+    }
+    pthread_mutex_lock(&queue_lock);
+    stopping = 1;
+    running = 0;
+    pthread_cond_signal(&queue_cond);
+    pthread_mutex_unlock(&queue_lock);
+    pthread_join(writer, NULL);
+
+    free(ring);
+    ring = NULL;
+    ring_used = 0;
+    buffer_free(&frame);
+}
+
+int monitor_fifo_init()
+{
+    MonitorConfig options = config_current_monitor();
+    if (options.fifo_path[0] == '\0')
+    {
+        return 0;
+    }
+    if (monitor_fifo_start(&options) != 0)
+    {
+        return -1;
+    }
+    return collection_add_publish_callback(monitor_fifo_publish, NULL);
+}
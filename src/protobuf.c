@@ -0,0 +1,74 @@
+#include "../include/protobuf.h"
+#include <string.h>
+
+/**
+ * @brief Máximo de bytes de un varint de 64 bits.
+ */
+#define PB_MAX_VARINT 10
+
+size_t pb_varint_size(uint64_t value)
+{
+    size_t size = 1;
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+size_t pb_length_field_size(uint32_t field, size_t len)
+{
+    return pb_varint_size((uint64_t)field << 3) + pb_varint_size(len) + len;
+}
+
+void pb_put_varint(Buffer* out, uint64_t value)
+{
+    uint8_t bytes[PB_MAX_VARINT];
+    size_t len = 0;
+    while (value >= 0x80)
+    {
+        bytes[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    bytes[len++] = (uint8_t)value;
+    buffer_append(out, bytes, len);
+}
+
+void pb_put_tag(Buffer* out, uint32_t field, uint32_t wire_type)
+{
+    pb_put_varint(out, ((uint64_t)field << 3) | wire_type);
+}
+
+void pb_put_double(Buffer* out, uint32_t field, double value)
+{
+    uint64_t bits;
+    uint8_t bytes[8];
+    memcpy(&bits, &value, sizeof(bits));
+
+    // El wire format es little-endian sin importar la arquitectura
+    for (int i = 0; i < 8; i++)
+    {
+        bytes[i] = (uint8_t)(bits >> (8 * i));
+    }
+    pb_put_tag(out, field, PB_WIRE_FIXED64);
+    buffer_append(out, bytes, sizeof(bytes));
+}
+
+void pb_put_uint64(Buffer* out, uint32_t field, uint64_t value)
+{
+    pb_put_tag(out, field, PB_WIRE_VARINT);
+    pb_put_varint(out, value);
+}
+
+void pb_put_bytes(Buffer* out, uint32_t field, const void* data, size_t len)
+{
+    pb_put_message_header(out, field, len);
+    buffer_append(out, data, len);
+}
+
+void pb_put_message_header(Buffer* out, uint32_t field, size_t len)
+{
+    pb_put_tag(out, field, PB_WIRE_LENGTH);
+    pb_put_varint(out, len);
+}
@@ -0,0 +1,1004 @@
+// accept4 es una extensión de GNU
+#define _GNU_SOURCE
+#include "../include/pubsub.h"
+#include "../include/buffer.h"
+#include "../include/cbor.h"
+#include "../include/collection.h"
+#include "../include/collector_plan.h"
+#include "../include/delta_stream.h"
+#include "../include/json_writer.h"
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Bytes máximos de una línea de filtro; una más larga desconecta al suscriptor.
+ */
+#define PUBSUB_FILTER_SIZE 1024
+
+/**
+ * @brief Eventos atendidos por cada llamada a epoll_wait.
+ */
+#define PUBSUB_EVENTS 64
+
+/**
+ * @brief Mensajes de la cola de un suscriptor escritos con un solo sendmsg.
+ */
+#define PUBSUB_IOV_MAX 16
+
+/**
+ * @brief Bytes de la longitud que precede a cada mensaje con el framing "length".
+ */
+#define PUBSUB_LENGTH_BYTES 4
+
+/**
+ * @brief Backlog de listen para el socket de suscripción.
+ */
+#define PUBSUB_BACKLOG 16
+
+/**
+ * @brief Permisos del socket: el dueño y su grupo pueden suscribirse.
+ */
+#define PUBSUB_SOCKET_MODE 0660
+
+/**
+ * @struct PubsubMessage
+ * @brief Mensaje delimitado, compartido por las colas de todos los suscriptores que lo reciben.
+ */
+typedef struct
+{
+    atomic_int refs;      /**< Colas (y caché del ciclo) que lo referencian. */
+    size_t len;           /**< Bytes de `data`. */
+    unsigned char data[]; /**< Mensaje con su delimitación. */
+} PubsubMessage;
+
+/**
+ * @struct Subscriber
+ * @brief Consumidor conectado con su filtro y su cola.
+ */
+typedef struct
+{
+    int fd;                         /**< Socket de la conexión. */
+    uint32_t mask;                  /**< Métricas pedidas (un bit por CollectorId). */
+    uint64_t min_interval_ns;       /**< Tiempo mínimo entre dos mensajes encolados. */
+    uint64_t last_ns;               /**< Último mensaje encolado (CLOCK_MONOTONIC), o 0. */
+    PubsubMessage** queue;          /**< Anillo de `queue_messages` mensajes. */
+    size_t head;                    /**< Posición del mensaje más viejo. */
+    size_t count;                   /**< Mensajes en la cola. */
+    size_t offset;                  /**< Bytes ya escritos del mensaje más viejo. */
+    int need_keyframe;              /**< En modo delta, su próximo mensaje debe ser un keyframe. */
+    int closing;                    /**< Debe desconectarse en la próxima vuelta del hilo. */
+    int want_write;                 /**< Tiene EPOLLOUT registrado. */
+    char input[PUBSUB_FILTER_SIZE]; /**< Línea de filtro en construcción. */
+    size_t input_len;               /**< Bytes en `input`. */
+} Subscriber;
+
+/** Opciones leídas al iniciar */
+static PubsubConfig config;
+
+/** El socket está abierto; se lee sin bloquear desde la publicación */
+static atomic_int running;
+
+/** Se pidió detener el hilo; lo protege `subscribers_lock` */
+static int stopping;
+
+/** Hilo que atiende a los suscriptores */
+static pthread_t worker;
+
+/** Socket en escucha, o -1 */
+static int listen_fd = -1;
+
+/** eventfd con el que la publicación y `pubsub_stop` despiertan al hilo */
+static int wake_fd = -1;
+
+/** Instancia de epoll del hilo */
+static int epoll_fd = -1;
+
+/** Protege `subscribers` y todo lo que comparten la publicación y el hilo dentro de cada suscriptor */
+static pthread_mutex_t subscribers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Suscriptores conectados (hasta `max_subscribers`) */
+static Subscriber** subscribers;
+
+/** Cantidad de suscriptores */
+static size_t subscriber_count;
+
+/** Valores del ciclo codificados una vez, uno a continuación del otro */
+static Buffer fragments;
+
+/** Inicio de cada fragmento dentro de `fragments`, indexado por CollectorId */
+static size_t fragment_start[COLLECTOR_COUNT];
+
+/** Longitud de cada fragmento */
+static size_t fragment_len[COLLECTOR_COUNT];
+
+/** Timestamp del ciclo, codificado una vez */
+static Buffer header;
+
+/** Mensaje en construcción; se reutiliza entre ciclos */
+static Buffer frame;
+
+/** Mensajes armados en el ciclo en curso, para compartirlos entre suscriptores con el mismo filtro */
+static PubsubMessage** cycle_messages;
+
+/** Métricas de cada mensaje de `cycle_messages` */
+static uint32_t* cycle_masks;
+
+/** Indica si cada mensaje de `cycle_messages` es un keyframe */
+static int* cycle_keyframes;
+
+/** Estado del modo delta; solo lo usa la publicación */
+static DeltaStream delta;
+
+/** Suscriptores conectados */
+static MetricSeries subscribers_metric = METRIC_SERIES_INVALID;
+
+/** Mensajes encolados a suscriptores */
+static MetricSeries messages_metric = METRIC_SERIES_INVALID;
+
+/** Mensajes escritos completos */
+static MetricSeries sent_metric = METRIC_SERIES_INVALID;
+
+/** Mensajes descartados por colas llenas */
+static MetricSeries dropped_metric = METRIC_SERIES_INVALID;
+
+/** Suscriptores desconectados por lentos */
+static MetricSeries slow_disconnects_metric = METRIC_SERIES_INVALID;
+
+/** Conexiones rechazadas por exceder `max_subscribers` */
+static MetricSeries rejected_metric = METRIC_SERIES_INVALID;
+
+/**
+ * @brief Lee el reloj monotónico.
+ * @return Nanosegundos desde un origen arbitrario.
+ */
+static uint64_t monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Suelta una referencia a un mensaje y lo libera si era la última.
+ * @param message Mensaje.
+ */
+static void message_release(PubsubMessage* message)
+{
+    if (atomic_fetch_sub_explicit(&message->refs, 1, memory_order_acq_rel) == 1)
+    {
+        free(message);
+    }
+}
+
+/**
+ * @brief Codifica en `header` y `fragments` el timestamp y los valores.
+ *
+ * En modo delta se codifican los valores de referencia y los ausentes como null, para que un
+ * delta pueda anunciar que una métrica desapareció; en modo completo los ausentes se omiten.
+ *
+ * @param values Valor de cada métrica, NaN si está ausente.
+ * @param timestamp_ms Milisegundos desde la época.
+ * @return 0 en caso de éxito, -1 si no hay memoria.
+ */
+static int encode_cycle(const double* values, uint64_t timestamp_ms)
+{
+    buffer_reset(&header);
+    buffer_reset(&fragments);
+    int ret;
+    if (config.encoding == MONITOR_ENCODING_CBOR)
+    {
+        ret = cbor_text(&header, "timestamp") | cbor_uint(&header, timestamp_ms);
+    }
+    else
+    {
+        JsonWriter json;
+        json_writer_init(&json, &header);
+        json_int(&json, (long long)timestamp_ms);
+        ret = json_writer_error(&json) ? -1 : 0;
+    }
+
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+    {
+        fragment_start[i] = fragments.len;
+        if (isnan(values[i]) && !config.delta.enabled)
+        {
+            fragment_len[i] = 0;
+            continue;
+        }
+        const char* family = collector_descriptor((CollectorId)i)->family;
+        if (config.encoding == MONITOR_ENCODING_CBOR)
+        {
+            ret |= cbor_text(&fragments, family) |
+                   (isnan(values[i]) ? cbor_null(&fragments) : cbor_double(&fragments, values[i]));
+        }
+        else
+        {
+            // Los nombres de familia no necesitan escaparse
+            ret |= buffer_append_str(&fragments, ",\"") | buffer_append_str(&fragments, family) |
+                   buffer_append_str(&fragments, "\":");
+            JsonWriter json;
+            json_writer_init(&json, &fragments);
+            if (isnan(values[i]))
+            {
+                json_null(&json);
+            }
+            else
+            {
+                json_number(&json, values[i]);
+            }
+            ret |= json_writer_error(&json) ? -1 : 0;
+        }
+        fragment_len[i] = fragments.len - fragment_start[i];
+    }
+    return ret;
+}
+
+/**
+ * @brief Arma un mensaje con las métricas de `mask` concatenando los fragmentos del ciclo.
+ * @param mask Métricas que van en el mensaje.
+ * @param keyframe En modo delta, si el mensaje es un keyframe.
+ * @return Mensaje con una referencia, o NULL si no hay memoria.
+ */
+static PubsubMessage* build_message(uint32_t mask, int keyframe)
+{
+    buffer_reset(&frame);
+    int ret = 0;
+    if (config.framing == MONITOR_FRAMING_LENGTH)
+    {
+        // La longitud se completa al final
+        ret |= buffer_append(&frame, "\0\0\0\0", PUBSUB_LENGTH_BYTES);
+    }
+    uint64_t pairs = (uint64_t)__builtin_popcount(mask) + (config.delta.enabled ? 3 : 1);
+    if (config.encoding == MONITOR_ENCODING_CBOR)
+    {
+        ret |= cbor_map(&frame, pairs);
+        if (config.delta.enabled)
+        {
+            ret |= cbor_text(&frame, "seq") | cbor_uint(&frame, delta.sequence) | cbor_text(&frame, "keyframe") |
+                   cbor_bool(&frame, keyframe);
+        }
+    }
+    else
+    {
+        if (config.delta.enabled)
+        {
+            JsonWriter json;
+            json_writer_init(&json, &frame);
+            ret |= buffer_append_str(&frame, "{\"seq\":");
+            json_int(&json, (long long)delta.sequence);
+            ret |= json_writer_error(&json) ? -1 : 0;
+            ret |= buffer_append_str(&frame, keyframe ? ",\"keyframe\":true," : ",\"keyframe\":false,");
+        }
+        else
+        {
+            ret |= buffer_append_char(&frame, '{');
+        }
+        ret |= buffer_append_str(&frame, "\"timestamp\":");
+    }
+    ret |= buffer_append(&frame, header.data, header.len);
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+    {
+        if (mask & (1u << i))
+        {
+            ret |= buffer_append(&frame, fragments.data + fragment_start[i], fragment_len[i]);
+        }
+    }
+    if (config.encoding == MONITOR_ENCODING_JSON)
+    {
+        ret |= buffer_append_char(&frame, '}');
+    }
+    if (config.framing == MONITOR_FRAMING_NDJSON)
+    {
+        ret |= buffer_append_char(&frame, '\n');
+    }
+    else
+    {
+        size_t len = frame.len - PUBSUB_LENGTH_BYTES;
+        unsigned char* prefix = (unsigned char*)frame.data;
+        prefix[0] = (unsigned char)(len >> 24);
+        prefix[1] = (unsigned char)(len >> 16);
+        prefix[2] = (unsigned char)(len >> 8);
+        prefix[3] = (unsigned char)len;
+    }
+    if (ret != 0)
+    {
+        return NULL;
+    }
+
+    PubsubMessage* message = malloc(sizeof(PubsubMessage) + frame.len);
+    if (message == NULL)
+    {
+        return NULL;
+    }
+    atomic_init(&message->refs, 1);
+    message->len = frame.len;
+    memcpy(message->data, frame.data, frame.len);
+    return message;
+}
+
+/**
+ * @brief Encola un mensaje para un suscriptor; debe tenerse `subscribers_lock`.
+ * @param subscriber Suscriptor.
+ * @param message Mensaje; la cola toma su propia referencia.
+ * @param now Instante del ciclo.
+ * @param dropped Se incrementa con los mensajes descartados.
+ * @param disconnects Se incrementa si el suscriptor queda marcado para desconectarse.
+ */
+static void subscriber_enqueue(Subscriber* subscriber, PubsubMessage* message, uint64_t now, size_t* dropped,
+                               size_t* disconnects)
+{
+    size_t capacity = (size_t)config.queue_messages;
+    if (subscriber->count == capacity)
+    {
+        if (config.slow_policy == PUBSUB_SLOW_DISCONNECT)
+        {
+            subscriber->closing = 1;
+            (*disconnects)++;
+            return;
+        }
+        // El mensaje a medio escribir no se descarta: saldría cortado; se descarta el siguiente
+        size_t victim = subscriber->offset > 0 ? (subscriber->head + 1) % capacity : subscriber->head;
+        message_release(subscriber->queue[victim]);
+        if (subscriber->offset > 0)
+        {
+            subscriber->queue[victim] = subscriber->queue[subscriber->head];
+        }
+        subscriber->head = (subscriber->head + 1) % capacity;
+        subscriber->count--;
+        (*dropped)++;
+    }
+    atomic_fetch_add_explicit(&message->refs, 1, memory_order_relaxed);
+    subscriber->queue[(subscriber->head + subscriber->count) % capacity] = message;
+    subscriber->count++;
+    subscriber->last_ns = now;
+}
+
+void pubsub_publish_current()
+{
+    if (!atomic_load(&running))
+    {
+        return;
+    }
+    uint64_t now = monotonic_ns();
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    uint64_t timestamp_ms = (uint64_t)wall.tv_sec * 1000u + (uint64_t)wall.tv_nsec / 1000000u;
+
+    double values[COLLECTOR_COUNT];
+    uint64_t generation;
+    do
+    {
+        const double* store;
+        generation = metric_store_read_begin(&store);
+        for (int i = 0; i < COLLECTOR_COUNT; i++)
+        {
+            MetricSeries series = collector_series_of((CollectorId)i);
+            values[i] = series == METRIC_SERIES_INVALID ? NAN : store[series];
+        }
+    } while (!metric_store_read_valid(generation));
+    uint32_t present = 0;
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+    {
+        present |= isnan(values[i]) ? 0 : 1u << i;
+    }
+
+    // En modo delta la referencia avanza en todos los ciclos, haya o no suscriptores
+    DeltaFrame kind = DELTA_FRAME_KEYFRAME;
+    uint32_t changed = 0;
+    const double* encoded_values = values;
+    if (config.delta.enabled)
+    {
+        kind = delta_stream_next(&delta, values, &changed);
+        present = delta_stream_present(&delta);
+        encoded_values = delta.reference;
+    }
+
+    size_t messages = 0;
+    size_t dropped = 0;
+    size_t disconnects = 0;
+    size_t cached = 0;
+    // Tras `pubsub_stop` no se toca nada: los buffers ya pueden estar liberados
+    pthread_mutex_lock(&subscribers_lock);
+    int encoded = !stopping && subscriber_count > 0 ? encode_cycle(encoded_values, timestamp_ms) : -1;
+    for (size_t i = 0; i < subscriber_count && encoded == 0; i++)
+    {
+        Subscriber* subscriber = subscribers[i];
+        if (subscriber->closing)
+        {
+            continue;
+        }
+        if (subscriber->last_ns != 0 && now - subscriber->last_ns < subscriber->min_interval_ns)
+        {
+            // Se salteó cambios: el próximo mensaje que reciba tiene que ser completo
+            subscriber->need_keyframe = 1;
+            continue;
+        }
+        // Un delta encolado tras descartar otro no se podría aplicar: si la cola está llena va un keyframe
+        int keyframe = kind == DELTA_FRAME_KEYFRAME || subscriber->need_keyframe ||
+                       (subscriber->count == (size_t)config.queue_messages && config.slow_policy == PUBSUB_SLOW_DROP);
+        if (!keyframe && kind == DELTA_FRAME_NONE)
+        {
+            continue;
+        }
+        uint32_t mask = subscriber->mask & (keyframe ? present : changed);
+        PubsubMessage* message = NULL;
+        for (size_t j = 0; j < cached && message == NULL; j++)
+        {
+            message = cycle_masks[j] == mask && cycle_keyframes[j] == keyframe ? cycle_messages[j] : NULL;
+        }
+        if (message == NULL)
+        {
+            message = build_message(mask, keyframe);
+            if (message == NULL)
+            {
+                subscriber->need_keyframe = 1;
+                dropped++;
+                continue;
+            }
+            cycle_messages[cached] = message;
+            cycle_masks[cached] = mask;
+            cycle_keyframes[cached] = keyframe;
+            cached++;
+        }
+        subscriber_enqueue(subscriber, message, now, &dropped, &disconnects);
+        subscriber->need_keyframe = subscriber->need_keyframe && !keyframe;
+        messages++;
+    }
+    for (size_t i = 0; i < cached; i++)
+    {
+        message_release(cycle_messages[i]);
+    }
+    if (messages > 0 || disconnects > 0)
+    {
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) < 0)
+        {
+            // El contador del eventfd ya es distinto de cero: el hilo se despierta igual
+        }
+    }
+    pthread_mutex_unlock(&subscribers_lock);
+    metric_store_stage_add(messages_metric, (double)messages);
+    metric_store_stage_add(dropped_metric, (double)dropped);
+    metric_store_stage_add(slow_disconnects_metric, (double)disconnects);
+}
+
+/**
+ * @brief Publica los valores de la generación recién publicada (PublishFn).
+ * @param generation Generación publicada.
+ * @param arg Argumento no utilizado.
+ */
+static void pubsub_publish(uint64_t generation, void* arg)
+{
+    (void)generation;
+    (void)arg;
+    pubsub_publish_current();
+}
+
+/**
+ * @brief Aplica una línea de filtro; debe tenerse `subscribers_lock`.
+ * @param subscriber Suscriptor.
+ * @param line Línea sin el salto final.
+ * @return 0 si el filtro es válido, -1 en caso contrario.
+ */
+static int apply_filter(Subscriber* subscriber, const char* line)
+{
+    cJSON* filter = cJSON_Parse(line);
+    if (!cJSON_IsObject(filter))
+    {
+        cJSON_Delete(filter);
+        return -1;
+    }
+
+    uint32_t mask = subscriber->mask;
+    cJSON* names = cJSON_GetObjectItem(filter, "names");
+    if (cJSON_IsArray(names))
+    {
+        mask = 0;
+        cJSON* name;
+        cJSON_ArrayForEach(name, names)
+        {
+            for (int i = 0; i < COLLECTOR_COUNT && cJSON_IsString(name); i++)
+            {
+                if (strcmp(cJSON_GetStringValue(name), collector_descriptor((CollectorId)i)->family) == 0)
+                {
+                    mask |= 1u << i;
+                }
+            }
+        }
+    }
+    uint64_t interval_ns = subscriber->min_interval_ns;
+    cJSON* interval = cJSON_GetObjectItem(filter, "min_interval_ms");
+    if (cJSON_IsNumber(interval))
+    {
+        interval_ns = cJSON_GetNumberValue(interval) > 0 ? (uint64_t)(cJSON_GetNumberValue(interval) * 1e6) : 0;
+    }
+    cJSON* resync = cJSON_GetObjectItem(filter, "resync");
+    int valid = (names == NULL || cJSON_IsArray(names)) && (interval == NULL || cJSON_IsNumber(interval)) &&
+                (resync == NULL || cJSON_IsBool(resync));
+    // Con otras métricas la referencia del suscriptor ya no sirve
+    int keyframe = cJSON_IsTrue(resync) || mask != subscriber->mask;
+    cJSON_Delete(filter);
+    if (!valid)
+    {
+        return -1;
+    }
+
+    subscriber->mask = mask;
+    subscriber->min_interval_ns = interval_ns;
+    subscriber->need_keyframe |= keyframe;
+    return 0;
+}
+
+/**
+ * @brief Lee las líneas de filtro que envió un suscriptor.
+ * @param subscriber Suscriptor.
+ * @return 0 si sigue conectado, -1 si cerró la conexión o envió algo inválido.
+ */
+static int read_filters(Subscriber* subscriber)
+{
+    for (;;)
+    {
+        ssize_t received = recv(subscriber->fd, subscriber->input + subscriber->input_len,
+                                sizeof(subscriber->input) - 1 - subscriber->input_len, MSG_DONTWAIT);
+        if (received < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+        if (received == 0)
+        {
+            return -1;
+        }
+        subscriber->input_len += (size_t)received;
+
+        char* line = subscriber->input;
+        char* newline;
+        while ((newline = memchr(line, '\n', subscriber->input_len - (size_t)(line - subscriber->input))) != NULL)
+        {
+            *newline = '\0';
+            pthread_mutex_lock(&subscribers_lock);
+            int ret = apply_filter(subscriber, line);
+            pthread_mutex_unlock(&subscribers_lock);
+            if (ret != 0)
+            {
+                return -1;
+            }
+            line = newline + 1;
+        }
+        subscriber->input_len -= (size_t)(line - subscriber->input);
+        memmove(subscriber->input, line, subscriber->input_len);
+        if (subscriber->input_len == sizeof(subscriber->input) - 1)
+        {
+            return -1;
+        }
+    }
+}
+
+/**
+ * @brief Registra o quita el interés en EPOLLOUT de un suscriptor.
+ * @param subscriber Suscriptor.
+ * @param want_write Distinto de 0 para esperar lugar en el socket.
+ */
+static void set_want_write(Subscriber* subscriber, int want_write)
+{
+    if (subscriber->want_write != want_write)
+    {
+        struct epoll_event event = {EPOLLIN | (want_write ? EPOLLOUT : 0), {.ptr = subscriber}};
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, subscriber->fd, &event);
+        subscriber->want_write = want_write;
+    }
+}
+
+/**
+ * @brief Escribe sin bloquear lo encolado para un suscriptor; debe tenerse `subscribers_lock`.
+ * @param subscriber Suscriptor; queda marcado para desconectarse si la escritura falla.
+ * @return Mensajes escritos completos.
+ */
+static size_t flush_subscriber(Subscriber* subscriber)
+{
+    size_t capacity = (size_t)config.queue_messages;
+    size_t sent = 0;
+    while (subscriber->count > 0)
+    {
+        struct iovec iov[PUBSUB_IOV_MAX];
+        int iov_count = 0;
+        for (size_t i = 0; i < subscriber->count && iov_count < PUBSUB_IOV_MAX; i++)
+        {
+            PubsubMessage* message = subscriber->queue[(subscriber->head + i) % capacity];
+            size_t skip = i == 0 ? subscriber->offset : 0;
+            iov[iov_count].iov_base = message->data + skip;
+            iov[iov_count].iov_len = message->len - skip;
+            iov_count++;
+        }
+        // sendmsg en lugar de writev para pasar MSG_NOSIGNAL: un suscriptor que se fue da EPIPE
+        struct msghdr msg = {0};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)iov_count;
+        ssize_t written = sendmsg(subscriber->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                set_want_write(subscriber, 1);
+                return sent;
+            }
+            subscriber->closing = 1;
+            return sent;
+        }
+
+        size_t left = (size_t)written;
+        while (left > 0)
+        {
+            PubsubMessage* message = subscriber->queue[subscriber->head];
+            size_t pending = message->len - subscriber->offset;
+            if (left < pending)
+            {
+                subscriber->offset += left;
+                break;
+            }
+            left -= pending;
+            message_release(message);
+            subscriber->head = (subscriber->head + 1) % capacity;
+            subscriber->count--;
+            subscriber->offset = 0;
+            sent++;
+        }
+    }
+    set_want_write(subscriber, 0);
+    return sent;
+}
+
+/**
+ * @brief Desconecta a un suscriptor y libera su cola; debe tenerse `subscribers_lock`.
+ * @param index Posición en `subscribers`; el último pasa a ocuparla.
+ */
+static void remove_subscriber(size_t index)
+{
+    Subscriber* subscriber = subscribers[index];
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, subscriber->fd, NULL);
+    close(subscriber->fd);
+    size_t capacity = (size_t)config.queue_messages;
+    for (size_t i = 0; i < subscriber->count; i++)
+    {
+        message_release(subscriber->queue[(subscriber->head + i) % capacity]);
+    }
+    free(subscriber->queue);
+    free(subscriber);
+    subscribers[index] = subscribers[--subscriber_count];
+}
+
+/**
+ * @brief Acepta las conexiones pendientes.
+ */
+static void accept_subscribers()
+{
+    for (;;)
+    {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                fprintf(stderr, "pubsub: error al aceptar un suscriptor: %s\n", strerror(errno));
+            }
+            return;
+        }
+
+        Subscriber* subscriber = calloc(1, sizeof(Subscriber));
+        PubsubMessage** queue = calloc((size_t)config.queue_messages, sizeof(PubsubMessage*));
+        pthread_mutex_lock(&subscribers_lock);
+        if (subscriber == NULL || queue == NULL || subscriber_count == (size_t)config.max_subscribers)
+        {
+            pthread_mutex_unlock(&subscribers_lock);
+            free(subscriber);
+            free(queue);
+            close(fd);
+            metric_store_stage_add(rejected_metric, 1.0);
+            continue;
+        }
+        subscriber->fd = fd;
+        subscriber->mask = (1u << COLLECTOR_COUNT) - 1;
+        subscriber->need_keyframe = 1;
+        subscriber->queue = queue;
+        struct epoll_event event = {EPOLLIN, {.ptr = subscriber}};
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            pthread_mutex_unlock(&subscribers_lock);
+            free(subscriber);
+            free(queue);
+            close(fd);
+            continue;
+        }
+        subscribers[subscriber_count++] = subscriber;
+        size_t count = subscriber_count;
+        pthread_mutex_unlock(&subscribers_lock);
+        metric_store_stage(subscribers_metric, (double)count);
+    }
+}
+
+/**
+ * @brief Hilo que acepta suscriptores, lee sus filtros y vacía sus colas.
+ * @param arg Argumento no utilizado.
+ * @return Siempre NULL.
+ */
+static void* pubsub_main(void* arg)
+{
+    (void)arg;
+    struct epoll_event events[PUBSUB_EVENTS];
+    for (;;)
+    {
+        int ready = epoll_wait(epoll_fd, events, PUBSUB_EVENTS, -1);
+        if (ready < 0 && errno != EINTR)
+        {
+            fprintf(stderr, "pubsub: error en epoll_wait: %s\n", strerror(errno));
+            break;
+        }
+        for (int i = 0; i < ready; i++)
+        {
+            void* source = events[i].data.ptr;
+            if (source == &listen_fd)
+            {
+                accept_subscribers();
+            }
+            else if (source == &wake_fd)
+            {
+                uint64_t count;
+                if (read(wake_fd, &count, sizeof(count)) < 0)
+                {
+                    // Otro evento ya lo vació
+                }
+            }
+            else if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && read_filters(source) != 0)
+            {
+                pthread_mutex_lock(&subscribers_lock);
+                ((Subscriber*)source)->closing = 1;
+                pthread_mutex_unlock(&subscribers_lock);
+            }
+        }
+
+        // Se desconecta en esta vuelta, después de los eventos, para no tocar un suscriptor liberado
+        size_t sent = 0;
+        pthread_mutex_lock(&subscribers_lock);
+        if (stopping)
+        {
+            pthread_mutex_unlock(&subscribers_lock);
+            break;
+        }
+        size_t before = subscriber_count;
+        for (size_t i = 0; i < subscriber_count;)
+        {
+            if (!subscribers[i]->closing)
+            {
+                sent += flush_subscriber(subscribers[i]);
+            }
+            if (subscribers[i]->closing)
+            {
+                remove_subscriber(i);
+                continue;
+            }
+            i++;
+        }
+        size_t count = subscriber_count;
+        pthread_mutex_unlock(&subscribers_lock);
+        metric_store_stage_add(sent_metric, (double)sent);
+        if (count != before)
+        {
+            metric_store_stage(subscribers_metric, (double)count);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Abre el socket en escucha; reemplaza uno que haya quedado de una ejecución anterior.
+ * @param path Ruta del socket.
+ * @return Descriptor, o -1 en caso de error.
+ */
+static int open_socket(const char* path)
+{
+    struct sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+    {
+        unlink(path);
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || chmod(path, PUBSUB_SOCKET_MODE) != 0 ||
+        listen(fd, PUBSUB_BACKLOG) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Cierra los descriptores y libera la memoria del envío.
+ */
+static void release_resources()
+{
+    if (epoll_fd >= 0)
+    {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+    if (wake_fd >= 0)
+    {
+        close(wake_fd);
+        wake_fd = -1;
+    }
+    if (listen_fd >= 0)
+    {
+        close(listen_fd);
+        listen_fd = -1;
+    }
+    free(subscribers);
+    subscribers = NULL;
+    free(cycle_messages);
+    cycle_messages = NULL;
+    free(cycle_masks);
+    cycle_masks = NULL;
+    free(cycle_keyframes);
+    cycle_keyframes = NULL;
+    buffer_free(&fragments);
+    buffer_free(&header);
+    buffer_free(&frame);
+}
+
+int pubsub_start(const PubsubConfig* options)
+{
+    config = *options;
+    const char* families[COLLECTOR_COUNT];
+    for (int i = 0; i < COLLECTOR_COUNT; i++)
+    {
+        families[i] = collector_descriptor((CollectorId)i)->family;
+    }
+    delta_stream_init(&delta, &config.delta, families, COLLECTOR_COUNT);
+
+    subscribers_metric = metric_store_register("pubsub_subscribers", "Suscriptores conectados", METRIC_TYPE_GAUGE);
+    messages_metric = metric_store_register("pubsub_messages_total", "Mensajes encolados a suscriptores",
+                                            METRIC_TYPE_COUNTER);
+    sent_metric =
+        metric_store_register("pubsub_sent_messages_total", "Mensajes escritos completos", METRIC_TYPE_COUNTER);
+    dropped_metric = metric_store_register("pubsub_dropped_messages_total",
+                                           "Mensajes descartados por colas llenas", METRIC_TYPE_COUNTER);
+    slow_disconnects_metric = metric_store_register("pubsub_slow_disconnects_total",
+                                                    "Suscriptores desconectados por lentos", METRIC_TYPE_COUNTER);
+    rejected_metric = metric_store_register("pubsub_rejected_subscribers_total",
+                                            "Conexiones rechazadas por exceder max_subscribers", METRIC_TYPE_COUNTER);
+    if (subscribers_metric == METRIC_SERIES_INVALID || messages_metric == METRIC_SERIES_INVALID ||
+        sent_metric == METRIC_SERIES_INVALID || dropped_metric == METRIC_SERIES_INVALID ||
+        slow_disconnects_metric == METRIC_SERIES_INVALID || rejected_metric == METRIC_SERIES_INVALID)
+    {
+        fprintf(stderr, "Error al registrar las métricas del socket de suscripción\n");
+        return -1;
+    }
+    metric_store_stage(subscribers_metric, 0.0);
+    metric_store_stage_add(messages_metric, 0.0);
+    metric_store_stage_add(sent_metric, 0.0);
+    metric_store_stage_add(dropped_metric, 0.0);
+    metric_store_stage_add(slow_disconnects_metric, 0.0);
+    metric_store_stage_add(rejected_metric, 0.0);
+
+    size_t max = (size_t)config.max_subscribers;
+    subscribers = calloc(max, sizeof(Subscriber*));
+    cycle_messages = calloc(max, sizeof(PubsubMessage*));
+    cycle_masks = calloc(max, sizeof(uint32_t));
+    cycle_keyframes = calloc(max, sizeof(int));
+    if (subscribers == NULL || cycle_messages == NULL || cycle_masks == NULL || cycle_keyframes == NULL)
+    {
+        fprintf(stderr, "Error al reservar los suscriptores\n");
+        release_resources();
+        return -1;
+    }
+
+    listen_fd = open_socket(config.socket_path);
+    if (listen_fd < 0)
+    {
+        fprintf(stderr, "Error al abrir el socket de suscripción %s: %s\n", config.socket_path, strerror(errno));
+        release_resources();
+        return -1;
+    }
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event listen_event = {EPOLLIN, {.ptr = &listen_fd}};
+    struct epoll_event wake_event = {EPOLLIN, {.ptr = &wake_fd}};
+    if (wake_fd < 0 || epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &listen_event) != 0 ||
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &wake_event) != 0)
+    {
+        fprintf(stderr, "Error al preparar el socket de suscripción: %s\n", strerror(errno));
+        unlink(config.socket_path);
+        release_resources();
+        return -1;
+    }
+
+    subscriber_count = 0;
+    stopping = 0;
+    if (pthread_create(&worker, NULL, pubsub_main, NULL) != 0)
+    {
+        fprintf(stderr, "Error al crear el hilo del socket de suscripción\n");
+        unlink(config.socket_path);
+        release_resources();
+        return -1;
+    }
+    atomic_store(&running, 1);
+    return 0;
+}
+
+void pubsub_stop()
+{
+    if (!atomic_load(&running))
+    {
+        return;
+    }
+    atomic_store(&running, 0);
+    pthread_mutex_lock(&subscribers_lock);
+    stopping = 1;
+    pthread_mutex_unlock(&subscribers_lock);
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0)
+    {
+        // El contador ya es distinto de cero
+    }
+    pthread_join(worker, NULL);
+
+    pthread_mutex_lock(&subscribers_lock);
+    while (subscriber_count > 0)
+    {
+        remove_subscriber(subscriber_count - 1);
+    }
+    pthread_mutex_unlock(&subscribers_lock);
+    unlink(config.socket_path);
+    release_resources();
+}
+
+int pubsub_init()
+{
+    PubsubConfig options = config_current_pubsub();
+    if (options.socket_path[0] == '\0')
+    {
+        return 0;
+    }
+    if (pubsub_start(&options) != 0)
+    {
+        return -1;
+    }
+    return collection_add_publish_callback(pubsub_publish, NULL);
+}
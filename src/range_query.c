@@ -0,0 +1,254 @@
+#include "../include/range_query.h"
+#include "../include/history.h"
+#include "../include/json_writer.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @struct StepAggregate
+ * @brief Acumulado del paso en curso de una serie.
+ */
+typedef struct
+{
+    JsonWriter* writer; /**< Destino de los pasos completos. */
+    int64_t start_ms;   /**< Inicio de la consulta. */
+    int64_t step_ms;    /**< Ancho de cada paso. */
+    int64_t step;       /**< Paso en curso, o -1 si todavía no hay puntos. */
+    double min;         /**< Mínimo del paso. */
+    double max;         /**< Máximo del paso. */
+    double sum;         /**< Suma del paso. */
+    double last;        /**< Último valor del paso. */
+    long count;         /**< Puntos del paso. */
+} StepAggregate;
+
+/**
+ * @brief Parsea una duración: segundos con decimales, o con sufijo s, m, h o d.
+ * @param text Texto.
+ * @param ms Duración en milisegundos.
+ * @return 0 en caso de éxito, -1 si no es una duración válida.
+ */
+static int parse_duration(const char* text, int64_t* ms)
+{
+    char* end;
+    double value = strtod(text, &end);
+    if (end == text || !isfinite(value))
+    {
+        return -1;
+    }
+    double unit = 1.0;
+    switch (*end)
+    {
+    case '\0':
+    case 's':
+        break;
+    case 'm':
+        unit = 60.0;
+        break;
+    case 'h':
+        unit = 3600.0;
+        break;
+    case 'd':
+        unit = 86400.0;
+        break;
+    default:
+        return -1;
+    }
+    if (*end != '\0' && end[1] != '\0')
+    {
+        return -1;
+    }
+    double result = value * unit * 1000.0;
+    if (fabs(result) > 1e15)
+    {
+        return -1;
+    }
+    *ms = (int64_t)llround(result);
+    return 0;
+}
+
+/**
+ * @brief Parsea un instante: segundos Unix, "now" o "now-<duración>".
+ * @param text Texto.
+ * @param now Momento actual en milisegundos.
+ * @param ms Instante en milisegundos.
+ * @return 0 en caso de éxito, -1 si no es un instante válido.
+ */
+static int parse_time(const char* text, int64_t now, int64_t* ms)
+{
+    if (strncmp(text, "now", 3) == 0)
+    {
+        int64_t offset = 0;
+        if (text[3] != '\0' && (text[3] != '-' || parse_duration(text + 4, &offset) != 0))
+        {
+            return -1;
+        }
+        *ms = now - offset;
+        return 0;
+    }
+    char* end;
+    double seconds = strtod(text, &end);
+    if (end == text || *end != '\0' || !isfinite(seconds) || fabs(seconds) > 1e12)
+    {
+        return -1;
+    }
+    *ms = (int64_t)llround(seconds * 1000.0);
+    return 0;
+}
+
+const char* range_query_parse(RangeQuery* query, const char* metric, const char* start, const char* end,
+                              const char* step)
+{
+    if (metric == NULL || metric[0] == '\0')
+    {
+        return "missing metric";
+    }
+    query->metric = metric;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    int64_t now = (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+    query->end_ms = now;
+    if (end != NULL && parse_time(end, now, &query->end_ms) != 0)
+    {
+        return "invalid end";
+    }
+    query->start_ms = query->end_ms - RANGE_QUERY_DEFAULT_WINDOW_MS;
+    if (start != NULL && parse_time(start, now, &query->start_ms) != 0)
+    {
+        return "invalid start";
+    }
+    query->step_ms = RANGE_QUERY_DEFAULT_STEP_MS;
+    if (step != NULL && (parse_duration(step, &query->step_ms) != 0 || query->step_ms <= 0))
+    {
+        return "invalid step";
+    }
+    if (query->end_ms < query->start_ms)
+    {
+        return "end before start";
+    }
+    if ((query->end_ms - query->start_ms) / query->step_ms >= RANGE_QUERY_MAX_STEPS)
+    {
+        return "too many steps; increase step";
+    }
+    return NULL;
+}
+
+/**
+ * @brief Escribe el paso acumulado como fila `[timestamp, min, max, avg, last, count]`.
+ * @param aggregate Acumulado.
+ */
+static void flush_step(StepAggregate* aggregate)
+{
+    if (aggregate->count == 0)
+    {
+        return;
+    }
+    JsonWriter* writer = aggregate->writer;
+    json_begin_array(writer);
+    json_number(writer, (double)(aggregate->start_ms + aggregate->step * aggregate->step_ms) / 1000.0);
+    json_number(writer, aggregate->min);
+    json_number(writer, aggregate->max);
+    json_number(writer, aggregate->sum / (double)aggregate->count);
+    json_number(writer, aggregate->last);
+    json_int(writer, aggregate->count);
+    json_end_array(writer);
+    aggregate->count = 0;
+}
+
+/**
+ * @brief Acumula un punto en su paso, escribiendo el anterior si cambió (HistoryVisitFn).
+ * @param timestamp_ms Tiempo del punto.
+ * @param value Valor del punto.
+ * @param arg StepAggregate.
+ */
+static void aggregate_point(int64_t timestamp_ms, double value, void* arg)
+{
+    StepAggregate* aggregate = arg;
+    int64_t step = (timestamp_ms - aggregate->start_ms) / aggregate->step_ms;
+    if (step != aggregate->step)
+    {
+        flush_step(aggregate);
+        aggregate->step = step;
+    }
+    if (aggregate->count == 0)
+    {
+        aggregate->min = value;
+        aggregate->max = value;
+        aggregate->sum = 0.0;
+    }
+    aggregate->min = fmin(aggregate->min, value);
+    aggregate->max = fmax(aggregate->max, value);
+    aggregate->sum += value;
+    aggregate->last = value;
+    aggregate->count++;
+}
+
+/**
+ * @brief Indica si la clave de una serie corresponde a la métrica pedida.
+ * @param key Clave de la serie.
+ * @param metric Clave exacta o nombre sin etiquetas.
+ * @return 1 si corresponde, 0 en caso contrario.
+ */
+static int key_matches(const char* key, const char* metric)
+{
+    size_t len = strlen(metric);
+    if (strncmp(key, metric, len) != 0)
+    {
+        return 0;
+    }
+    return key[len] == '\0' || (key[len] == '{' && strchr(metric, '{') == NULL);
+}
+
+int range_query_write(const RangeQuery* query, Buffer* out)
+{
+    JsonWriter writer;
+    json_writer_init(&writer, out);
+    json_begin_object(&writer);
+    json_key(&writer, "status");
+    json_string(&writer, "success");
+    json_key(&writer, "data");
+    json_begin_object(&writer);
+    json_key(&writer, "start");
+    json_number(&writer, (double)query->start_ms / 1000.0);
+    json_key(&writer, "end");
+    json_number(&writer, (double)query->end_ms / 1000.0);
+    json_key(&writer, "step");
+    json_number(&writer, (double)query->step_ms / 1000.0);
+    json_key(&writer, "columns");
+    json_begin_array(&writer);
+    static const char* const columns[] = {"timestamp", "min", "max", "avg", "last", "count"};
+    for (size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++)
+    {
+        json_string(&writer, columns[i]);
+    }
+    json_end_array(&writer);
+
+    json_key(&writer, "series");
+    json_begin_array(&writer);
+    size_t series_count = history_series_count();
+    for (size_t i = 0; i < series_count && !writer.error; i++)
+    {
+        const char* key = history_key(i);
+        if (!key_matches(key, query->metric))
+        {
+            continue;
+        }
+        json_begin_object(&writer);
+        json_key(&writer, "metric");
+        json_string(&writer, key);
+        json_key(&writer, "values");
+        json_begin_array(&writer);
+        StepAggregate aggregate = {&writer, query->start_ms, query->step_ms, -1, 0.0, 0.0, 0.0, 0.0, 0};
+        history_read(i, query->start_ms, query->end_ms, aggregate_point, &aggregate);
+        flush_step(&aggregate);
+        json_end_array(&writer);
+        json_end_object(&writer);
+    }
+    json_end_array(&writer);
+    json_end_object(&writer);
+    json_end_object(&writer);
+    return json_writer_error(&writer);
+}
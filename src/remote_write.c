@@ -0,0 +1,414 @@
+#include "../include/remote_write.h"
+#include "../include/collection.h"
+#include "../include/http_client.h"
+#include "../include/protobuf.h"
+#include "../include/snappy.h"
+#include "../include/wal.h"
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+/**
+ * @brief Etiquetas por serie que admite la codificación (incluida `__name__`).
+ */
+#define REMOTE_WRITE_MAX_LABELS 32
+
+/**
+ * @brief Encabezados fijos de cada petición, según la especificación de remote_write 1.0.
+ */
+#define REMOTE_WRITE_HEADERS                                                                                           \
+    "Content-Encoding: snappy\r\n"                                                                                     \
+    "Content-Type: application/x-protobuf\r\n"                                                                         \
+    "User-Agent: monitoring_project\r\n"                                                                               \
+    "X-Prometheus-Remote-Write-Version: 0.1.0\r\n"
+
+/**
+ * @enum DropReason
+ * @brief Motivo por el que se descartaron muestras.
+ */
+typedef enum
+{
+    DROP_WAL_FULL,        /**< Se descartó un segmento sin enviar por superar `wal_max_segments`. */
+    DROP_REJECTED,        /**< El endpoint respondió 4xx (salvo 429). */
+    DROP_WAL_ERROR,       /**< No se pudo escribir el lote en el WAL. */
+    DROP_TOO_MANY_LABELS, /**< La serie supera REMOTE_WRITE_MAX_LABELS etiquetas. */
+    DROP_REASON_COUNT
+} DropReason;
+
+/**
+ * @struct RemoteWriteShard
+ * @brief Un shard: lote en construcción, WAL, conexión e hilo de envío propios.
+ */
+typedef struct
+{
+    Buffer request;    /**< WriteRequest en construcción (solo el hilo recolector). */
+    uint32_t samples;  /**< Muestras en `request`. */
+    Wal wal;           /**< Lotes comprimidos pendientes de envío. */
+    HttpClient client; /**< Conexión con el endpoint (solo el hilo del shard). */
+    pthread_t thread;  /**< Hilo de envío. */
+} RemoteWriteShard;
+
+/** Opciones leídas al iniciar */
+static RemoteWriteConfig config;
+
+/** Shards del envío */
+static RemoteWriteShard* shards;
+
+/** Cantidad de shards */
+static int shard_count;
+
+/** Lote comprimido (solo el hilo recolector) */
+static Buffer compressed;
+
+/** Nombre de la muestra en construcción: familia y sufijo (solo el hilo recolector) */
+static Buffer sample_name;
+
+/** Límites de los buckets de duración de los envíos, en segundos */
+static const double send_duration_bounds[] = {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0};
+
+/** Duración de cada petición al endpoint */
+static MetricHistogram send_duration_metric;
+
+/** Muestras escritas en el WAL que aún no se confirmaron */
+static MetricSeries pending_metric = METRIC_SERIES_INVALID;
+
+/** Segmentos del WAL en disco, sumando todos los shards */
+static MetricSeries segments_metric = METRIC_SERIES_INVALID;
+
+/** Muestras aceptadas por el endpoint */
+static MetricSeries sent_metric = METRIC_SERIES_INVALID;
+
+/** Peticiones repetidas tras un error */
+static MetricSeries retries_metric = METRIC_SERIES_INVALID;
+
+/** Muestras descartadas, por motivo */
+static MetricSeries dropped_metric[DROP_REASON_COUNT] = {METRIC_SERIES_INVALID, METRIC_SERIES_INVALID,
+                                                         METRIC_SERIES_INVALID, METRIC_SERIES_INVALID};
+
+/** Ya se informó una serie con demasiadas etiquetas */
+static int labels_reported;
+
+/**
+ * @brief Lee el reloj monotónico.
+ * @return Nanosegundos desde un origen arbitrario.
+ */
+static uint64_t monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Agrega una serie con una muestra a un WriteRequest.
+ *
+ * Las etiquetas se ordenan por nombre, como exige remote_write, y se omiten las de valor
+ * vacío. Los mensajes son `TimeSeries{labels=1 Label{name=1, value=2}, samples=2 Sample{value=1,
+ * timestamp=2}}` dentro del campo 1 de `WriteRequest`.
+ *
+ * @param out WriteRequest en construcción.
+ * @param info Descriptor de la serie.
+ * @param value Valor de la muestra.
+ * @param timestamp Marca de tiempo en milisegundos desde la época.
+ * @return 0 si se agregó, -1 si la serie tiene demasiadas etiquetas.
+ */
+static int encode_series(Buffer* out, const MetricSeriesInfo* info, double value, int64_t timestamp)
+{
+    if (info->label_count >= REMOTE_WRITE_MAX_LABELS)
+    {
+        return -1;
+    }
+
+    buffer_reset(&sample_name);
+    buffer_append_str(&sample_name, metric_store_family(info->family)->name);
+    buffer_append_str(&sample_name, info->suffix);
+
+    const char* names[REMOTE_WRITE_MAX_LABELS];
+    const char* values[REMOTE_WRITE_MAX_LABELS];
+    size_t count = 0;
+    names[count] = "__name__";
+    values[count++] = sample_name.data;
+    for (size_t i = 0; i < info->label_count; i++)
+    {
+        const char* name = info->label_pairs[2 * i];
+        const char* label_value = info->label_pairs[2 * i + 1];
+        if (label_value[0] == '\0')
+        {
+            continue;
+        }
+
+        // Inserción ordenada: son pocas etiquetas
+        size_t pos = count++;
+        while (pos > 0 && strcmp(names[pos - 1], name) > 0)
+        {
+            names[pos] = names[pos - 1];
+            values[pos] = values[pos - 1];
+            pos--;
+        }
+        names[pos] = name;
+        values[pos] = label_value;
+    }
+
+    size_t label_sizes[REMOTE_WRITE_MAX_LABELS];
+    size_t series_size = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        label_sizes[i] = pb_length_field_size(1, strlen(names[i])) + pb_length_field_size(2, strlen(values[i]));
+        series_size += pb_length_field_size(1, label_sizes[i]);
+    }
+    size_t sample_size = 1 + 8 + 1 + pb_varint_size((uint64_t)timestamp);
+    series_size += pb_length_field_size(2, sample_size);
+
+    pb_put_message_header(out, 1, series_size);
+    for (size_t i = 0; i < count; i++)
+    {
+        pb_put_message_header(out, 1, label_sizes[i]);
+        pb_put_bytes(out, 1, names[i], strlen(names[i]));
+        pb_put_bytes(out, 2, values[i], strlen(values[i]));
+    }
+    pb_put_message_header(out, 2, sample_size);
+    pb_put_double(out, 1, value);
+    pb_put_uint64(out, 2, (uint64_t)timestamp);
+    return 0;
+}
+
+/**
+ * @brief Comprime el lote de un shard y lo agrega a su WAL.
+ * @param shard Shard con al menos una muestra en el lote.
+ */
+static void flush_shard(RemoteWriteShard* shard)
+{
+    if (snappy_compress(shard->request.data, shard->request.len, &compressed) != 0 ||
+        wal_append(&shard->wal, compressed.data, compressed.len, shard->samples) != 0)
+    {
+        metric_store_stage_add(dropped_metric[DROP_WAL_ERROR], (double)shard->samples);
+    }
+    buffer_reset(&shard->request);
+    shard->samples = 0;
+}
+
+/**
+ * @brief Encola las muestras de la generación recién publicada (PublishFn).
+ * @param generation Generación publicada.
+ * @param arg Argumento no utilizado.
+ */
+static void remote_write_publish(uint64_t generation, void* arg)
+{
+    (void)generation;
+    (void)arg;
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t timestamp = (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+
+    // Ninguna publicación puede pisar el buffer frontal mientras corre esta función
+    const double* values;
+    metric_store_read_begin(&values);
+    size_t series_count = metric_store_series_count();
+    for (MetricSeries series = 0; series < series_count; series++)
+    {
+        if (isnan(values[series]))
+        {
+            continue;
+        }
+        RemoteWriteShard* shard = &shards[series % (MetricSeries)shard_count];
+        const MetricSeriesInfo* info = metric_store_series(series);
+        if (encode_series(&shard->request, info, values[series], timestamp) != 0)
+        {
+            metric_store_stage_add(dropped_metric[DROP_TOO_MANY_LABELS], 1.0);
+            if (!labels_reported)
+            {
+                fprintf(stderr, "remote_write: se descartan las muestras de %s (%zu etiquetas, máximo %d)\n",
+                        metric_store_family(info->family)->name, info->label_count, REMOTE_WRITE_MAX_LABELS - 1);
+                labels_reported = 1;
+            }
+            continue;
+        }
+        if (++shard->samples == (uint32_t)config.max_samples_per_send)
+        {
+            flush_shard(shard);
+        }
+    }
+
+    uint64_t pending = 0;
+    uint64_t dropped = 0;
+    int segments = 0;
+    for (int i = 0; i < shard_count; i++)
+    {
+        if (shards[i].samples > 0)
+        {
+            flush_shard(&shards[i]);
+        }
+        WalStats stats;
+        wal_stats(&shards[i].wal, &stats);
+        pending += stats.pending_samples;
+        dropped += stats.dropped_samples;
+        segments += stats.segments;
+    }
+    metric_store_stage(pending_metric, (double)pending);
+    metric_store_stage(segments_metric, (double)segments);
+    metric_store_stage(dropped_metric[DROP_WAL_FULL], (double)dropped);
+}
+
+/**
+ * @brief Espera entre reintentos.
+ * @param ms Milisegundos.
+ */
+static void sleep_ms(int ms)
+{
+    struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000L};
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+    {
+    }
+}
+
+/**
+ * @brief Función del hilo de envío de un shard.
+ *
+ * Toma los lotes del WAL en orden y no pasa al siguiente hasta que el actual se aceptó o se
+ * descartó, así el endpoint nunca recibe muestras de una serie fuera de orden.
+ *
+ * @param arg Shard.
+ * @return NULL
+ */
+static void* remote_write_send(void* arg)
+{
+    RemoteWriteShard* shard = arg;
+    Buffer batch;
+    buffer_init(&batch);
+    WalPosition position;
+
+    while (wal_read(&shard->wal, &batch, &position) == 0)
+    {
+        int backoff = config.min_backoff_ms;
+        for (;;)
+        {
+            uint64_t start = monotonic_ns();
+            int status = http_client_post(&shard->client, REMOTE_WRITE_HEADERS, batch.data, batch.len);
+            metric_store_stage_observe(&send_duration_metric, (double)(monotonic_ns() - start) / 1e9);
+            if (status >= 200 && status < 300)
+            {
+                metric_store_stage_add(sent_metric, (double)position.samples);
+                break;
+            }
+            if (status >= 400 && status < 500 && status != 429)
+            {
+                fprintf(stderr, "remote_write: el endpoint rechazó %u muestras (HTTP %d)\n", position.samples,
+                        status);
+                metric_store_stage_add(dropped_metric[DROP_REJECTED], (double)position.samples);
+                break;
+            }
+
+            metric_store_stage_add(retries_metric, 1.0);
+            sleep_ms(backoff);
+            backoff = backoff > config.max_backoff_ms / 2 ? config.max_backoff_ms : backoff * 2;
+        }
+        wal_ack(&shard->wal, &position);
+    }
+
+    buffer_free(&batch);
+    return NULL;
+}
+
+/**
+ * @brief Registra las métricas del envío.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int register_metrics()
+{
+    int duration_family = metric_store_add_family("remote_write_send_duration_seconds",
+                                                  "Duración de las peticiones de remote_write", METRIC_TYPE_HISTOGRAM);
+    int dropped_family = metric_store_add_family("remote_write_samples_dropped_total",
+                                                 "Muestras descartadas sin enviar", METRIC_TYPE_COUNTER);
+    if (duration_family < 0 || dropped_family < 0 ||
+        metric_store_add_histogram(duration_family, "", send_duration_bounds,
+                                   sizeof(send_duration_bounds) / sizeof(send_duration_bounds[0]),
+                                   &send_duration_metric) != 0)
+    {
+        return -1;
+    }
+    dropped_metric[DROP_WAL_FULL] = metric_store_add_series(dropped_family, "{reason=\"wal_full\"}");
+    dropped_metric[DROP_REJECTED] = metric_store_add_series(dropped_family, "{reason=\"rejected\"}");
+    dropped_metric[DROP_WAL_ERROR] = metric_store_add_series(dropped_family, "{reason=\"wal_error\"}");
+    dropped_metric[DROP_TOO_MANY_LABELS] = metric_store_add_series(dropped_family, "{reason=\"too_many_labels\"}");
+    pending_metric = metric_store_register("remote_write_queue_pending_samples",
+                                           "Muestras en el WAL pendientes de envío", METRIC_TYPE_GAUGE);
+    segments_metric =
+        metric_store_register("remote_write_wal_segments", "Segmentos del WAL en disco", METRIC_TYPE_GAUGE);
+    sent_metric = metric_store_register("remote_write_samples_sent_total", "Muestras aceptadas por el endpoint",
+                                        METRIC_TYPE_COUNTER);
+    retries_metric = metric_store_register("remote_write_retries_total", "Peticiones de remote_write repetidas",
+                                           METRIC_TYPE_COUNTER);
+    for (int i = 0; i < DROP_REASON_COUNT; i++)
+    {
+        if (dropped_metric[i] == METRIC_SERIES_INVALID)
+        {
+            return -1;
+        }
+    }
+    if (pending_metric == METRIC_SERIES_INVALID || segments_metric == METRIC_SERIES_INVALID ||
+        sent_metric == METRIC_SERIES_INVALID || retries_metric == METRIC_SERIES_INVALID)
+    {
+        return -1;
+    }
+
+    metric_store_stage_add(dropped_metric[DROP_REJECTED], 0.0);
+    metric_store_stage_add(dropped_metric[DROP_WAL_ERROR], 0.0);
+    metric_store_stage_add(dropped_metric[DROP_TOO_MANY_LABELS], 0.0);
+    metric_store_stage_add(sent_metric, 0.0);
+    metric_store_stage_add(retries_metric, 0.0);
+    return 0;
+}
+
+int remote_write_init()
+{
+    config = config_current_remote_write();
+    if (config.url[0] == '\0')
+    {
+        return 0;
+    }
+
+    if (register_metrics() != 0)
+    {
+        fprintf(stderr, "Error al registrar las métricas de remote_write\n");
+        return -1;
+    }
+    if (mkdir(config.wal_dir, 0755) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Error al crear el directorio %s: %s\n", config.wal_dir, strerror(errno));
+        return -1;
+    }
+    shards = calloc((size_t)config.concurrency, sizeof(RemoteWriteShard));
+    if (shards == NULL)
+    {
+        fprintf(stderr, "Error al reservar memoria para remote_write\n");
+        return -1;
+    }
+
+    for (int i = 0; i < config.concurrency; i++)
+    {
+        RemoteWriteShard* shard = &shards[i];
+        char dir[WAL_PATH_SIZE];
+        snprintf(dir, sizeof(dir), "%s/shard-%d", config.wal_dir, i);
+        buffer_init(&shard->request);
+        if (http_client_init(&shard->client, config.url, config.timeout) != 0 ||
+            wal_open(&shard->wal, dir, (size_t)config.wal_segment_kb * 1024, config.wal_max_segments) != 0)
+        {
+            fprintf(stderr, "Error al iniciar el shard %d de remote_write\n", i);
+            return -1;
+        }
+        if (pthread_create(&shard->thread, NULL, remote_write_send, shard) != 0)
+        {
+            fprintf(stderr, "Error al crear el hilo de remote_write\n");
+            wal_close(&shard->wal);
+            return -1;
+        }
+        shard_count++;
+    }
+    return collection_add_publish_callback(remote_write_publish, NULL);
+}
@@ -0,0 +1,634 @@
+#include "../include/sampler.h"
+#include "../include/collection.h"
+#include "../include/ddsketch.h"
+#include "../include/metrics.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Error relativo de los cuantiles.
+ */
+#define SAMPLER_RELATIVE_ACCURACY 0.01
+
+/**
+ * @brief Cuantiles exportados de cada fuente.
+ */
+#define SAMPLER_QUANTILE_COUNT 3
+
+/**
+ * @brief Frecuencia máxima de las fuentes lentas (cola de ejecución y PSI).
+ *
+ * El "total" de PSI ya acumula cada demora en microsegundos, así que leerlo más seguido no
+ * agrega información; cada lectura de más solo suma costo al tick.
+ */
+#define SAMPLER_SLOW_RATE_HZ 10
+
+/**
+ * @enum SamplerSourceKind
+ * @brief Fuentes que puede leer el muestreador.
+ */
+typedef enum
+{
+    SAMPLER_CPU,
+    SAMPLER_RUN_QUEUE,
+    SAMPLER_PSI_CPU,
+    SAMPLER_PSI_MEMORY,
+    SAMPLER_PSI_IO,
+    SAMPLER_SOURCE_COUNT
+} SamplerSourceKind;
+
+/**
+ * @struct SampleWindow
+ * @brief Resumen de las muestras de una fuente en una ventana.
+ */
+typedef struct
+{
+    double min;      /**< Mínimo. */
+    double max;      /**< Máximo. */
+    double sum;      /**< Suma, para la media. */
+    DDSketch sketch; /**< Distribución; `sketch.count` es la cantidad de muestras. */
+} SampleWindow;
+
+/**
+ * @struct SamplerSource
+ * @brief Estado de una fuente.
+ */
+typedef struct
+{
+    int fd;                                         /**< Archivo abierto, o -1 si la fuente no se muestrea. */
+    ProcfsFile file;                                /**< Archivo abierto, entre el principal y sus alternativas. */
+    int registered;                                 /**< Sus familias ya están en el almacén. */
+    int primed;                                     /**< Ya hay una lectura anterior para calcular diferencias. */
+    uint64_t previous_busy;                         /**< Tiempo ocupado (o demorado) de la lectura anterior. */
+    uint64_t previous_total;                        /**< Tiempo total de la lectura anterior. */
+    SampleWindow current;                           /**< Ventana en curso; solo la toca el hilo de muestreo. */
+    SampleWindow completed;                         /**< Última ventana completa; protegida por `windows_lock`. */
+    MetricSeries quantiles[SAMPLER_QUANTILE_COUNT]; /**< Series de los cuantiles. */
+    MetricSeries min_metric;                        /**< Serie del mínimo. */
+    MetricSeries max_metric;                        /**< Serie del máximo. */
+    MetricSeries mean_metric;                       /**< Serie de la media. */
+} SamplerSource;
+
+/** Archivo (bajo las raíces de procfs y sysfs) y nombre de la familia de cada fuente */
+static const struct
+{
+    ProcfsFile file;
+    const char* name;
+    const char* help;
+} source_specs[SAMPLER_SOURCE_COUNT] = {
+    {SYSFS_CGROUP_CPU_STAT, "sampled_cpu_usage_percent", "Uso de CPU muestreado a alta frecuencia"},
+    {PROCFS_LOADAVG, "sampled_run_queue_length", "Procesos ejecutables muestreados a alta frecuencia"},
+    {PROCFS_PRESSURE_CPU, "sampled_psi_cpu_some_percent", "Tiempo con tareas demoradas por CPU (PSI)"},
+    {PROCFS_PRESSURE_MEMORY, "sampled_psi_memory_some_percent", "Tiempo con tareas demoradas por memoria (PSI)"},
+    {PROCFS_PRESSURE_IO, "sampled_psi_io_some_percent", "Tiempo con tareas demoradas por E/S (PSI)"},
+};
+
+/** Alternativas para el uso de CPU si no está el cpu.stat del cgroup raíz (v2 puro) */
+static const ProcfsFile cpu_fallback_files[] = {SYSFS_CGROUP_UNIFIED_CPU_STAT, PROCFS_STAT};
+
+/** Cuantiles exportados y su etiqueta */
+static const struct
+{
+    double quantile;
+    const char* labels;
+} quantile_specs[SAMPLER_QUANTILE_COUNT] = {
+    {0.5, "{quantile=\"0.5\"}"},
+    {0.9, "{quantile=\"0.9\"}"},
+    {0.99, "{quantile=\"0.99\"}"},
+};
+
+/** Fuentes; las deshabilitadas tienen fd -1 */
+static SamplerSource sources[SAMPLER_SOURCE_COUNT];
+
+/** Protege las ventanas completas de todas las fuentes */
+static pthread_mutex_t windows_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Capacidad de CPU del cgroup en milésimas de CPU (cuota de cpu.max o CPUs en línea) */
+static uint64_t cpu_capacity_milli;
+
+/** Hay al menos una ventana completa */
+static int has_completed;
+
+/** Opciones con que se inició */
+static SamplerConfig config;
+
+/** Hilo de muestreo */
+static pthread_t thread;
+
+/** El hilo está corriendo */
+static int running;
+
+/** Pide al hilo que termine */
+static atomic_int stopping;
+
+/** Ticks realizados */
+static atomic_uint_fast64_t ticks;
+
+/** Ticks salteados porque el hilo no llegó a tiempo */
+static atomic_uint_fast64_t overruns;
+
+/** Ticks muestreados */
+static MetricSeries ticks_metric = METRIC_SERIES_INVALID;
+
+/** Ticks salteados */
+static MetricSeries overruns_metric = METRIC_SERIES_INVALID;
+
+/** CPU del hilo de muestreo */
+static MetricSeries cpu_metric = METRIC_SERIES_INVALID;
+
+/**
+ * @brief Lee el reloj monotónico.
+ * @return Nanosegundos desde un origen arbitrario.
+ */
+static uint64_t monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Vacía una ventana.
+ * @param window Ventana.
+ */
+static void window_clear(SampleWindow* window)
+{
+    window->min = INFINITY;
+    window->max = -INFINITY;
+    window->sum = 0.0;
+    ddsketch_clear(&window->sketch);
+}
+
+/**
+ * @brief Agrega una muestra a la ventana en curso de una fuente.
+ * @param source Fuente.
+ * @param value Muestra.
+ */
+static void window_add(SamplerSource* source, double value)
+{
+    SampleWindow* window = &source->current;
+    window->min = fmin(window->min, value);
+    window->max = fmax(window->max, value);
+    window->sum += value;
+    ddsketch_add(&window->sketch, value);
+}
+
+/**
+ * @brief Relee una fuente desde el principio.
+ * @param source Fuente.
+ * @param buffer Destino, terminado en '\0'.
+ * @param size Tamaño de `buffer`.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int read_source(const SamplerSource* source, char* buffer, size_t size)
+{
+    metrics_procfs_refresh(source->file, source->fd);
+    ssize_t len = pread(source->fd, buffer, size - 1, 0);
+    if (len <= 0)
+    {
+        return -1;
+    }
+    buffer[len] = '\0';
+    return 0;
+}
+
+/**
+ * @brief Calcula el porcentaje ocupado entre la lectura anterior y la actual y lo agrega.
+ * @param source Fuente, con la lectura anterior.
+ * @param busy Tiempo ocupado acumulado.
+ * @param total Tiempo total acumulado.
+ */
+static void add_busy_fraction(SamplerSource* source, uint64_t busy, uint64_t total)
+{
+    if (source->primed && total > source->previous_total && busy >= source->previous_busy)
+    {
+        double fraction = (double)(busy - source->previous_busy) / (double)(total - source->previous_total);
+        window_add(source, fmin(fraction, 1.0) * 100.0);
+    }
+    // Sin avance del total (mismo tick de /proc/stat) se espera a la próxima lectura
+    if (!source->primed || total > source->previous_total)
+    {
+        source->previous_busy = busy;
+        source->previous_total = total;
+        source->primed = 1;
+    }
+}
+
+/**
+ * @brief Muestrea el uso de CPU.
+ *
+ * Con el `usage_usec` de cpu.stat (cgroup v2) la precisión es de microsegundos y la lectura
+ * cuesta la mitad que /proc/stat, que además genera las líneas de interrupciones. El uso es el
+ * del cgroup raíz visible (el del contenedor, si corre en uno) sobre su capacidad: la cuota de
+ * cpu.max si tiene, o los CPUs en línea. Con la línea "cpu" de /proc/stat es el de la máquina,
+ * con precisión de un tick (10 ms).
+ *
+ * @param source Fuente.
+ * @param now_ns Instante de la lectura.
+ */
+static void sample_cpu(SamplerSource* source, uint64_t now_ns)
+{
+    char buffer[256];
+    if (read_source(source, buffer, sizeof(buffer)) != 0)
+    {
+        return;
+    }
+    if (strncmp(buffer, "usage_usec ", 11) == 0)
+    {
+        uint64_t usage_us = strtoull(buffer + 11, NULL, 10);
+        add_busy_fraction(source, usage_us, sampler_cpu_capacity_us(now_ns, cpu_capacity_milli));
+        return;
+    }
+    if (strncmp(buffer, "cpu ", 4) != 0)
+    {
+        return;
+    }
+    // user nice system idle iowait irq softirq steal
+    uint64_t fields[8] = {0};
+    char* p = buffer + 4;
+    for (int i = 0; i < 8; i++)
+    {
+        fields[i] = strtoull(p, &p, 10);
+    }
+    uint64_t total = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        total += fields[i];
+    }
+    add_busy_fraction(source, total - fields[3] - fields[4], total);
+}
+
+/**
+ * @brief Muestrea los procesos ejecutables (cuarto campo de /proc/loadavg, "ejecutables/total").
+ * @param source Fuente.
+ */
+static void sample_run_queue(SamplerSource* source)
+{
+    char buffer[128];
+    if (read_source(source, buffer, sizeof(buffer)) != 0)
+    {
+        return;
+    }
+    char* p = buffer;
+    for (int spaces = 0; spaces < 3 && p != NULL; spaces++)
+    {
+        p = strchr(p, ' ');
+        p = p != NULL ? p + 1 : NULL;
+    }
+    if (p == NULL)
+    {
+        return;
+    }
+    // El propio muestreador está ejecutándose mientras lee el archivo
+    unsigned long running_tasks = strtoul(p, NULL, 10);
+    window_add(source, running_tasks > 0 ? (double)(running_tasks - 1) : 0.0);
+}
+
+/**
+ * @brief Muestrea el porcentaje de tiempo demorado a partir del "total=" de la línea "some" de PSI.
+ * @param source Fuente.
+ * @param now_ns Instante de la lectura.
+ */
+static void sample_psi(SamplerSource* source, uint64_t now_ns)
+{
+    char buffer[256];
+    if (read_source(source, buffer, sizeof(buffer)) != 0)
+    {
+        return;
+    }
+    char* total = strstr(buffer, "total=");
+    if (strncmp(buffer, "some ", 5) != 0 || total == NULL)
+    {
+        return;
+    }
+    uint64_t stall_us = strtoull(total + 6, NULL, 10);
+    add_busy_fraction(source, stall_us, now_ns / 1000);
+}
+
+/**
+ * @brief Pasa la ventana en curso de cada fuente a completa y empieza otra.
+ */
+static void rotate_windows()
+{
+    pthread_mutex_lock(&windows_lock);
+    for (int i = 0; i < SAMPLER_SOURCE_COUNT; i++)
+    {
+        if (sources[i].fd >= 0)
+        {
+            sources[i].completed = sources[i].current;
+        }
+    }
+    has_completed = 1;
+    pthread_mutex_unlock(&windows_lock);
+
+    for (int i = 0; i < SAMPLER_SOURCE_COUNT; i++)
+    {
+        window_clear(&sources[i].current);
+    }
+}
+
+/**
+ * @brief Hilo de muestreo: lee todas las fuentes en cada tick, en instantes absolutos.
+ * @param arg Argumento no utilizado.
+ * @return Siempre NULL.
+ */
+static void* sampler_thread(void* arg)
+{
+    (void)arg;
+    uint64_t period_ns = 1000000000ull / (uint64_t)config.rate_hz;
+    uint64_t ticks_per_window = (uint64_t)config.rate_hz * (uint64_t)config.window_seconds;
+    uint64_t window_ticks = 0;
+    // Las fuentes lentas se leen en uno de cada `slow_every` ticks
+    uint64_t slow_every = (uint64_t)(config.rate_hz + SAMPLER_SLOW_RATE_HZ - 1) / SAMPLER_SLOW_RATE_HZ;
+
+    // Una holgura del 5% del período permite al kernel agrupar este despertar con otros
+    prctl(PR_SET_TIMERSLACK, (unsigned long)(period_ns / 20), 0, 0, 0);
+
+    uint64_t next_ns = monotonic_ns();
+    while (!atomic_load_explicit(&stopping, memory_order_relaxed))
+    {
+        next_ns += period_ns;
+        struct timespec next = {(time_t)(next_ns / 1000000000ull), (long)(next_ns % 1000000000ull)};
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+        {
+        }
+
+        // Si el hilo se demoró más de un período, los ticks perdidos no se recuperan en ráfaga
+        uint64_t now_ns = monotonic_ns();
+        if (now_ns > next_ns + period_ns)
+        {
+            uint64_t missed = (now_ns - next_ns) / period_ns;
+            next_ns += missed * period_ns;
+            atomic_fetch_add_explicit(&overruns, missed, memory_order_relaxed);
+        }
+
+        for (int i = 0; i < SAMPLER_SOURCE_COUNT; i++)
+        {
+            SamplerSource* source = &sources[i];
+            if (source->fd < 0 || (i != SAMPLER_CPU && window_ticks % slow_every != 0))
+            {
+                continue;
+            }
+            switch (i)
+            {
+            case SAMPLER_CPU:
+                sample_cpu(source, now_ns);
+                break;
+            case SAMPLER_RUN_QUEUE:
+                sample_run_queue(source);
+                break;
+            default:
+                sample_psi(source, now_ns);
+                break;
+            }
+        }
+        atomic_fetch_add_explicit(&ticks, 1, memory_order_relaxed);
+
+        if (++window_ticks == ticks_per_window)
+        {
+            rotate_windows();
+            window_ticks = 0;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Exporta la última ventana completa de cada fuente (CollectFn).
+ * @param arg Argumento no utilizado.
+ */
+static void sampler_collect(void* arg)
+{
+    (void)arg;
+
+    metric_store_set(ticks_metric, (double)atomic_load(&ticks));
+    metric_store_set(overruns_metric, (double)atomic_load(&overruns));
+    metric_store_set(cpu_metric, sampler_cpu_seconds());
+
+    pthread_mutex_lock(&windows_lock);
+    for (int i = 0; i < SAMPLER_SOURCE_COUNT && has_completed; i++)
+    {
+        const SamplerSource* source = &sources[i];
+        const SampleWindow* window = &source->completed;
+        if (source->fd < 0 || window->sketch.count == 0)
+        {
+            continue;
+        }
+        for (int q = 0; q < SAMPLER_QUANTILE_COUNT; q++)
+        {
+            // El sketch acota el error relativo; el valor nunca sale del rango observado
+            double value = ddsketch_quantile(&window->sketch, quantile_specs[q].quantile);
+            metric_store_set(source->quantiles[q], fmin(fmax(value, window->min), window->max));
+        }
+        metric_store_set(source->min_metric, window->min);
+        metric_store_set(source->max_metric, window->max);
+        metric_store_set(source->mean_metric, window->sum / (double)window->sketch.count);
+    }
+    pthread_mutex_unlock(&windows_lock);
+}
+
+/**
+ * @brief Registra las familias de una fuente.
+ * @param source Fuente.
+ * @param kind Índice de la fuente.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int register_source(SamplerSource* source, int kind)
+{
+    const char* name = source_specs[kind].name;
+    const char* help = source_specs[kind].help;
+    int family = metric_store_add_family(name, help, METRIC_TYPE_GAUGE);
+    if (family < 0)
+    {
+        return -1;
+    }
+    for (int q = 0; q < SAMPLER_QUANTILE_COUNT; q++)
+    {
+        source->quantiles[q] = metric_store_add_series(family, quantile_specs[q].labels);
+        if (source->quantiles[q] == METRIC_SERIES_INVALID)
+        {
+            return -1;
+        }
+    }
+
+    char stat_name[128];
+    snprintf(stat_name, sizeof(stat_name), "%s_min", name);
+    source->min_metric = metric_store_register(stat_name, help, METRIC_TYPE_GAUGE);
+    snprintf(stat_name, sizeof(stat_name), "%s_max", name);
+    source->max_metric = metric_store_register(stat_name, help, METRIC_TYPE_GAUGE);
+    snprintf(stat_name, sizeof(stat_name), "%s_mean", name);
+    source->mean_metric = metric_store_register(stat_name, help, METRIC_TYPE_GAUGE);
+    source->registered = 1;
+    return source->min_metric == METRIC_SERIES_INVALID || source->max_metric == METRIC_SERIES_INVALID ||
+                   source->mean_metric == METRIC_SERIES_INVALID
+               ? -1
+               : 0;
+}
+
+/**
+ * @brief Lee la capacidad de CPU del cgroup raíz visible: la cuota de cpu.max, acotada por los
+ *        CPUs en línea.
+ * @return Milésimas de CPU.
+ */
+static uint64_t read_cpu_capacity()
+{
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    uint64_t capacity = (uint64_t)(online > 0 ? online : 1) * 1000;
+
+    // "max 100000" sin límite, "150000 100000" para 1.5 CPUs; el cgroup raíz del host no lo tiene
+    FILE* fp = fopen(metrics_procfs_path(SYSFS_CGROUP_CPU_MAX), "r");
+    if (fp == NULL)
+    {
+        return capacity;
+    }
+    unsigned long long quota;
+    unsigned long long period;
+    if (fscanf(fp, "%llu %llu", &quota, &period) == 2 && quota > 0 && period > 0)
+    {
+        uint64_t limited = quota * 1000 / period;
+        capacity = limited > 0 && limited < capacity ? limited : capacity;
+    }
+    fclose(fp);
+    return capacity;
+}
+
+int sampler_start(const SamplerConfig* sampler_config)
+{
+    if (running || sampler_config->rate_hz <= 0 || sampler_config->rate_hz > SAMPLER_MAX_RATE_HZ)
+    {
+        return -1;
+    }
+    config = *sampler_config;
+    cpu_capacity_milli = read_cpu_capacity();
+
+    int enabled[SAMPLER_SOURCE_COUNT] = {config.cpu, config.run_queue, config.psi, config.psi, config.psi};
+    int opened = 0;
+    for (int i = 0; i < SAMPLER_SOURCE_COUNT; i++)
+    {
+        SamplerSource* source = &sources[i];
+        source->fd = -1;
+        source->primed = 0;
+        ddsketch_init(&source->current.sketch, SAMPLER_RELATIVE_ACCURACY);
+        ddsketch_init(&source->completed.sketch, SAMPLER_RELATIVE_ACCURACY);
+        window_clear(&source->current);
+        if (!enabled[i])
+        {
+            continue;
+        }
+        source->file = source_specs[i].file;
+        source->fd = open(metrics_procfs_path(source->file), O_RDONLY | O_CLOEXEC);
+        for (size_t f = 0; i == SAMPLER_CPU && source->fd < 0 && f < sizeof(cpu_fallback_files) / sizeof(ProcfsFile);
+             f++)
+        {
+            source->file = cpu_fallback_files[f];
+            source->fd = open(metrics_procfs_path(source->file), O_RDONLY | O_CLOEXEC);
+        }
+        if (source->fd < 0)
+        {
+            // PSI requiere un kernel 4.20+ con CONFIG_PSI; sin él se muestrea el resto
+            fprintf(stderr, "No se puede muestrear %s: %s\n", metrics_procfs_path(source_specs[i].file),
+                    strerror(errno));
+            continue;
+        }
+        // Las métricas se registran una sola vez aunque el muestreo se reinicie
+        if (!source->registered && register_source(source, i) != 0)
+        {
+            fprintf(stderr, "Error al registrar las métricas de %s\n", source_specs[i].name);
+            close(source->fd);
+            source->fd = -1;
+            continue;
+        }
+        opened++;
+    }
+    if (opened == 0)
+    {
+        fprintf(stderr, "El muestreo de alta frecuencia no tiene fuentes disponibles\n");
+        return -1;
+    }
+
+    if (ticks_metric == METRIC_SERIES_INVALID)
+    {
+        ticks_metric = metric_store_register("sampler_ticks_total", "Ticks del muestreo de alta frecuencia",
+                                             METRIC_TYPE_COUNTER);
+        overruns_metric = metric_store_register(
+            "sampler_overruns_total", "Ticks del muestreo salteados por demoras del hilo", METRIC_TYPE_COUNTER);
+        cpu_metric = metric_store_register("sampler_cpu_seconds_total", "CPU consumido por el hilo de muestreo",
+                                           METRIC_TYPE_COUNTER);
+    }
+
+    has_completed = 0;
+    atomic_store(&stopping, 0);
+    int err = pthread_create(&thread, NULL, sampler_thread, NULL);
+    if (err != 0)
+    {
+        fprintf(stderr, "Error al crear el hilo de muestreo: %s\n", strerror(err));
+        sampler_stop();
+        return -1;
+    }
+    running = 1;
+    return 0;
+}
+
+void sampler_stop()
+{
+    if (running)
+    {
+        atomic_store(&stopping, 1);
+        pthread_join(thread, NULL);
+        running = 0;
+    }
+    for (int i = 0; i < SAMPLER_SOURCE_COUNT; i++)
+    {
+        if (sources[i].fd >= 0)
+        {
+            close(sources[i].fd);
+            sources[i].fd = -1;
+        }
+    }
+}
+
+double sampler_cpu_seconds()
+{
+    clockid_t clock;
+    struct timespec ts;
+    if (!running || pthread_getcpuclockid(thread, &clock) != 0 || clock_gettime(clock, &ts) != 0)
+    {
+        return 0.0;
+    }
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+uint64_t sampler_cpu_capacity_us(uint64_t now_ns, uint64_t capacity_milli)
+{
+    // Milisegundos por milésimas da microsegundos; el resto se agrega aparte
+    uint64_t now_us = now_ns / 1000;
+    return now_us / 1000 * capacity_milli + now_us % 1000 * capacity_milli / 1000;
+}
+
+uint64_t sampler_ticks()
+{
+    return atomic_load(&ticks);
+}
+
+int sampler_init()
+{
+    SamplerConfig sampler_config = config_current_sampler();
+    if (sampler_config.rate_hz == 0)
+    {
+        return 0;
+    }
+    if (sampler_start(&sampler_config) != 0)
+    {
+        return -1;
+    }
+    return collection_add_callback(sampler_collect, NULL);
+}
@@ -0,0 +1,260 @@
+#include "../include/shm_output.h"
+#include "../include/collection.h"
+#include "../include/config.h"
+#include "../include/metrics.h"
+#include <errno.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * @brief Cantidad de métricas del almacén copiadas al segmento.
+ */
+#define SHM_FIELD_COUNT 7
+
+/**
+ * @brief Cantidad de archivos de PSI leídos en cada actualización.
+ */
+#define SHM_PSI_COUNT 3
+
+/**
+ * @struct ShmField
+ * @brief Métrica del almacén copiada a un campo del segmento.
+ */
+typedef struct
+{
+    const char* family;  /**< Familia del almacén. */
+    size_t offset;       /**< Posición del campo dentro de ShmMetricsValues. */
+    MetricSeries series; /**< Serie resuelta, o METRIC_SERIES_INVALID si aún no se registró. */
+} ShmField;
+
+/**
+ * @struct ShmPsiSource
+ * @brief Archivo de PSI copiado a un campo del segmento.
+ */
+typedef struct
+{
+    ProcfsFile file; /**< Archivo de PSI bajo la raíz de procfs. */
+    size_t offset;   /**< Posición del campo dentro de ShmMetricsValues. */
+    int fd;          /**< Descriptor abierto, o -1 si el kernel no tiene PSI. */
+} ShmPsiSource;
+
+/** Métricas del sistema; se registran después de iniciar el segmento y se resuelven al usarlas */
+static ShmField fields[SHM_FIELD_COUNT] = {
+    {"cpu_usage_percentage", offsetof(ShmMetricsValues, cpu_usage_percent), METRIC_SERIES_INVALID},
+    {"memory_usage_percentage", offsetof(ShmMetricsValues, memory_usage_percent), METRIC_SERIES_INVALID},
+    {"memory_fragmentation_percentage", offsetof(ShmMetricsValues, memory_fragmentation_percent),
+     METRIC_SERIES_INVALID},
+    {"disk_usage", offsetof(ShmMetricsValues, disk_usage), METRIC_SERIES_INVALID},
+    {"network_usage_metric", offsetof(ShmMetricsValues, network_usage), METRIC_SERIES_INVALID},
+    {"procs_usage_count", offsetof(ShmMetricsValues, process_count), METRIC_SERIES_INVALID},
+    {"ctxt_usage_count", offsetof(ShmMetricsValues, context_switches), METRIC_SERIES_INVALID},
+};
+
+/** PSI: el almacén no lo tiene salvo con el muestreo de alta frecuencia, así que se lee aparte */
+static ShmPsiSource psi_sources[SHM_PSI_COUNT] = {
+    {PROCFS_PRESSURE_CPU, offsetof(ShmMetricsValues, psi_cpu_some_avg10), -1},
+    {PROCFS_PRESSURE_MEMORY, offsetof(ShmMetricsValues, psi_memory_some_avg10), -1},
+    {PROCFS_PRESSURE_IO, offsetof(ShmMetricsValues, psi_io_some_avg10), -1},
+};
+
+/** Segmento mapeado en lectura y escritura, o NULL */
+static ShmMetricsSegment* segment;
+
+/** Bytes mapeados */
+static size_t segment_size;
+
+/** Actualizaciones del segmento */
+static MetricSeries updates_metric = METRIC_SERIES_INVALID;
+
+/**
+ * @brief Lee el "avg10" de la línea "some" de un archivo de PSI.
+ * @param source Fuente abierta.
+ * @return Porcentaje, o NaN si no se pudo leer.
+ */
+static double read_psi(const ShmPsiSource* source)
+{
+    char buffer[256];
+    metrics_procfs_refresh(source->file, source->fd);
+    ssize_t len = pread(source->fd, buffer, sizeof(buffer) - 1, 0);
+    if (len <= 0)
+    {
+        return NAN;
+    }
+    buffer[len] = '\0';
+    // some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+    if (strncmp(buffer, "some avg10=", 11) != 0)
+    {
+        return NAN;
+    }
+    return strtod(buffer + 11, NULL);
+}
+
+/**
+ * @brief Copia valores al segmento bajo el seqlock.
+ * @param values Valores.
+ */
+static void write_values(const ShmMetricsValues* values)
+{
+    uint64_t sequence = atomic_load_explicit(&segment->sequence, memory_order_relaxed);
+    atomic_store_explicit(&segment->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&segment->values, values, sizeof(*values));
+    atomic_store_explicit(&segment->sequence, sequence + 2, memory_order_release);
+}
+
+void shm_output_update()
+{
+    if (segment == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < SHM_FIELD_COUNT; i++)
+    {
+        if (fields[i].series == METRIC_SERIES_INVALID)
+        {
+            int family = metric_store_find_family(fields[i].family);
+            if (family >= 0)
+            {
+                fields[i].series = atomic_load(&metric_store_family((size_t)family)->head);
+            }
+        }
+    }
+
+    ShmMetricsValues values;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    values.timestamp_ns = (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+    uint64_t generation;
+    do
+    {
+        const double* store;
+        generation = metric_store_read_begin(&store);
+        values.generation = generation;
+        for (int i = 0; i < SHM_FIELD_COUNT; i++)
+        {
+            double value = fields[i].series == METRIC_SERIES_INVALID ? NAN : store[fields[i].series];
+            memcpy((char*)&values + fields[i].offset, &value, sizeof(value));
+        }
+    } while (!metric_store_read_valid(generation));
+    for (int i = 0; i < SHM_PSI_COUNT; i++)
+    {
+        double value = psi_sources[i].fd >= 0 ? read_psi(&psi_sources[i]) : NAN;
+        memcpy((char*)&values + psi_sources[i].offset, &value, sizeof(value));
+    }
+
+    write_values(&values);
+    metric_store_stage_add(updates_metric, 1.0);
+}
+
+/**
+ * @brief Actualiza el segmento con la generación recién publicada (PublishFn).
+ * @param generation Generación publicada.
+ * @param arg Argumento no utilizado.
+ */
+static void shm_output_publish(uint64_t generation, void* arg)
+{
+    (void)generation;
+    (void)arg;
+    shm_output_update();
+}
+
+int shm_output_start(const char* name)
+{
+    // Se reutiliza un segmento existente: los lectores que ya lo mapearon siguen viendo los cambios
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error al abrir el segmento %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    long page = sysconf(_SC_PAGESIZE);
+    size_t size = (sizeof(ShmMetricsSegment) + (size_t)page - 1) / (size_t)page * (size_t)page;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || ((size_t)st.st_size != size && ftruncate(fd, (off_t)size) != 0))
+    {
+        fprintf(stderr, "Error al dimensionar el segmento %s: %s\n", name, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        fprintf(stderr, "Error al mapear el segmento %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+
+    updates_metric = metric_store_register("shm_output_updates_total",
+                                           "Actualizaciones del segmento de memoria compartida", METRIC_TYPE_COUNTER);
+    if (updates_metric == METRIC_SERIES_INVALID)
+    {
+        fprintf(stderr, "Error al registrar las métricas del segmento de memoria compartida\n");
+        munmap(map, size);
+        return -1;
+    }
+    metric_store_stage_add(updates_metric, 0.0);
+
+    segment = map;
+    segment_size = size;
+    segment->version = SHM_METRICS_VERSION;
+    segment->values_size = sizeof(ShmMetricsValues);
+    segment->writer_pid = (int32_t)getpid();
+    segment->magic = SHM_METRICS_MAGIC;
+    // Un agente anterior pudo morir con la secuencia impar; se redondea para no trabar a los lectores
+    uint64_t sequence = atomic_load_explicit(&segment->sequence, memory_order_relaxed);
+    atomic_store_explicit(&segment->sequence, (sequence + 1) & ~1ull, memory_order_release);
+
+    ShmMetricsValues empty = {0};
+    double absent = NAN;
+    for (int i = 0; i < SHM_FIELD_COUNT; i++)
+    {
+        memcpy((char*)&empty + fields[i].offset, &absent, sizeof(absent));
+    }
+    for (int i = 0; i < SHM_PSI_COUNT; i++)
+    {
+        memcpy((char*)&empty + psi_sources[i].offset, &absent, sizeof(absent));
+    }
+    write_values(&empty);
+
+    for (int i = 0; i < SHM_PSI_COUNT; i++)
+    {
+        // PSI requiere un kernel 4.20+ con CONFIG_PSI; sin él esos campos quedan en NaN
+        psi_sources[i].fd = open(metrics_procfs_path(psi_sources[i].file), O_RDONLY | O_CLOEXEC);
+    }
+    return 0;
+}
+
+void shm_output_stop()
+{
+    if (segment == NULL)
+    {
+        return;
+    }
+    munmap(segment, segment_size);
+    segment = NULL;
+    for (int i = 0; i < SHM_PSI_COUNT; i++)
+    {
+        if (psi_sources[i].fd >= 0)
+        {
+            close(psi_sources[i].fd);
+            psi_sources[i].fd = -1;
+        }
+    }
+}
+
+int shm_output_init()
+{
+    ShmConfig config = config_current_shm();
+    if (config.name[0] == '\0')
+    {
+        return 0;
+    }
+    if (shm_output_start(config.name) != 0)
+    {
+        return -1;
+    }
+    return collection_add_publish_callback(shm_output_publish, NULL);
+}
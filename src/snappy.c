@@ -0,0 +1,329 @@
+#include "../include/snappy.h"
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Tamaño de los bloques que se comprimen de forma independiente.
+ */
+#define SNAPPY_BLOCK_SIZE 65536
+
+/**
+ * @brief Bits de la tabla de hash de cada bloque (16384 entradas).
+ */
+#define SNAPPY_HASH_BITS 14
+
+/**
+ * @brief Bytes finales de un bloque donde ya no se buscan coincidencias.
+ */
+#define SNAPPY_INPUT_MARGIN 15
+
+/**
+ * @brief Lee 4 bytes sin requerir alineación.
+ * @param p Posición.
+ * @return Valor leído en el orden de la máquina.
+ */
+static uint32_t load32(const uint8_t* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Hash multiplicativo de 4 bytes para la tabla de coincidencias.
+ * @param value Bytes leídos con `load32`.
+ * @return Índice en la tabla.
+ */
+static uint32_t hash32(uint32_t value)
+{
+    return (value * 0x1e35a7bdU) >> (32 - SNAPPY_HASH_BITS);
+}
+
+/**
+ * @brief Escribe un literal.
+ * @param op Posición de salida.
+ * @param literal Bytes del literal.
+ * @param len Longitud (mayor que 0).
+ * @return Posición de salida tras el literal.
+ */
+static uint8_t* emit_literal(uint8_t* op, const uint8_t* literal, size_t len)
+{
+    size_t n = len - 1;
+    if (n < 60)
+    {
+        *op++ = (uint8_t)(n << 2);
+    }
+    else
+    {
+        // La longitud va a continuación de la etiqueta, en 1 a 4 bytes little-endian
+        uint8_t* tag = op++;
+        int count = 0;
+        while (n > 0)
+        {
+            *op++ = (uint8_t)n;
+            n >>= 8;
+            count++;
+        }
+        *tag = (uint8_t)((59 + count) << 2);
+    }
+    memcpy(op, literal, len);
+    return op + len;
+}
+
+/**
+ * @brief Escribe una copia de 4 a 64 bytes.
+ * @param op Posición de salida.
+ * @param offset Distancia hacia atrás (menor que 65536).
+ * @param len Longitud de la copia.
+ * @return Posición de salida tras la copia.
+ */
+static uint8_t* emit_copy_upto64(uint8_t* op, size_t offset, size_t len)
+{
+    if (len < 12 && offset < 2048)
+    {
+        *op++ = (uint8_t)(1 | ((len - 4) << 2) | ((offset >> 8) << 5));
+        *op++ = (uint8_t)offset;
+    }
+    else
+    {
+        *op++ = (uint8_t)(2 | ((len - 1) << 2));
+        *op++ = (uint8_t)offset;
+        *op++ = (uint8_t)(offset >> 8);
+    }
+    return op;
+}
+
+/**
+ * @brief Escribe una copia de cualquier longitud partiéndola en copias de hasta 64 bytes.
+ * @param op Posición de salida.
+ * @param offset Distancia hacia atrás (menor que 65536).
+ * @param len Longitud de la copia (al menos 4).
+ * @return Posición de salida tras la copia.
+ */
+static uint8_t* emit_copy(uint8_t* op, size_t offset, size_t len)
+{
+    while (len >= 68)
+    {
+        op = emit_copy_upto64(op, offset, 64);
+        len -= 64;
+    }
+    // Dejar al menos 4 bytes para la última copia
+    if (len > 64)
+    {
+        op = emit_copy_upto64(op, offset, 60);
+        len -= 60;
+    }
+    return emit_copy_upto64(op, offset, len);
+}
+
+/**
+ * @brief Comprime un bloque de hasta SNAPPY_BLOCK_SIZE bytes.
+ * @param in Inicio del bloque.
+ * @param len Longitud del bloque.
+ * @param op Posición de salida.
+ * @param table Tabla de hash (1 << SNAPPY_HASH_BITS entradas); se reinicia aquí.
+ * @return Posición de salida tras el bloque.
+ */
+static uint8_t* compress_block(const uint8_t* in, size_t len, uint8_t* op, uint16_t* table)
+{
+    const uint8_t* end = in + len;
+    const uint8_t* next_emit = in;
+
+    if (len >= SNAPPY_INPUT_MARGIN)
+    {
+        memset(table, 0, sizeof(uint16_t) << SNAPPY_HASH_BITS);
+        const uint8_t* ip = in + 1;
+        const uint8_t* ip_limit = end - SNAPPY_INPUT_MARGIN;
+        uint32_t skip = 32;
+
+        while (ip <= ip_limit)
+        {
+            uint32_t bytes = load32(ip);
+            uint32_t hash = hash32(bytes);
+            const uint8_t* candidate = in + table[hash];
+            table[hash] = (uint16_t)(ip - in);
+            if (candidate >= ip || load32(candidate) != bytes)
+            {
+                // Sin coincidencias se avanza cada vez más rápido sobre datos incompresibles
+                ip += skip >> 5;
+                skip++;
+                continue;
+            }
+
+            if (ip > next_emit)
+            {
+                op = emit_literal(op, next_emit, (size_t)(ip - next_emit));
+            }
+            size_t matched = 4;
+            while (ip + matched < end && candidate[matched] == ip[matched])
+            {
+                matched++;
+            }
+            op = emit_copy(op, (size_t)(ip - candidate), matched);
+            ip += matched;
+            next_emit = ip;
+            skip = 32;
+            if (ip > ip_limit)
+            {
+                break;
+            }
+            table[hash32(load32(ip - 1))] = (uint16_t)(ip - 1 - in);
+        }
+    }
+
+    if (next_emit < end)
+    {
+        op = emit_literal(op, next_emit, (size_t)(end - next_emit));
+    }
+    return op;
+}
+
+size_t snappy_max_compressed_length(size_t len)
+{
+    return 32 + len + len / 6;
+}
+
+int snappy_compress(const char* data, size_t len, Buffer* out)
+{
+    buffer_reset(out);
+    if (len > UINT32_MAX || buffer_reserve(out, snappy_max_compressed_length(len)) != 0)
+    {
+        return -1;
+    }
+
+    uint8_t* op = (uint8_t*)out->data;
+    size_t remaining = len;
+    while (remaining >= 0x80)
+    {
+        *op++ = (uint8_t)(remaining | 0x80);
+        remaining >>= 7;
+    }
+    *op++ = (uint8_t)remaining;
+
+    uint16_t table[1 << SNAPPY_HASH_BITS];
+    const uint8_t* in = (const uint8_t*)data;
+    for (size_t offset = 0; offset < len; offset += SNAPPY_BLOCK_SIZE)
+    {
+        size_t block = len - offset < SNAPPY_BLOCK_SIZE ? len - offset : SNAPPY_BLOCK_SIZE;
+        op = compress_block(in + offset, block, op, table);
+    }
+
+    out->len = (size_t)(op - (uint8_t*)out->data);
+    out->data[out->len] = '\0';
+    return 0;
+}
+
+int snappy_uncompress(const char* data, size_t len, Buffer* out)
+{
+    const uint8_t* ip = (const uint8_t*)data;
+    const uint8_t* end = ip + len;
+
+    // Longitud sin comprimir: varint de hasta 5 bytes
+    uint64_t total = 0;
+    for (int shift = 0;; shift += 7)
+    {
+        if (ip == end || shift > 28)
+        {
+            return -1;
+        }
+        uint8_t byte = *ip++;
+        total |= (uint64_t)(byte & 0x7f) << shift;
+        if (byte < 0x80)
+        {
+            break;
+        }
+    }
+    if (total > UINT32_MAX)
+    {
+        return -1;
+    }
+
+    buffer_reset(out);
+    if (buffer_reserve(out, (size_t)total) != 0)
+    {
+        return -1;
+    }
+    uint8_t* base = (uint8_t*)out->data;
+    size_t pos = 0;
+
+    while (ip < end)
+    {
+        uint8_t tag = *ip++;
+        size_t length;
+        size_t offset;
+
+        switch (tag & 3)
+        {
+        case 0:
+            length = tag >> 2;
+            if (length >= 60)
+            {
+                size_t bytes = length - 59;
+                if ((size_t)(end - ip) < bytes)
+                {
+                    return -1;
+                }
+                length = 0;
+                for (size_t i = 0; i < bytes; i++)
+                {
+                    length |= (size_t)ip[i] << (8 * i);
+                }
+                ip += bytes;
+            }
+            length++;
+            if ((size_t)(end - ip) < length || total - pos < length)
+            {
+                return -1;
+            }
+            memcpy(base + pos, ip, length);
+            ip += length;
+            pos += length;
+            continue;
+        case 1:
+            if (ip == end)
+            {
+                return -1;
+            }
+            length = 4 + ((tag >> 2) & 7);
+            offset = ((size_t)(tag >> 5) << 8) | *ip++;
+            break;
+        case 2:
+            if (end - ip < 2)
+            {
+                return -1;
+            }
+            length = (size_t)(tag >> 2) + 1;
+            offset = (size_t)ip[0] | (size_t)ip[1] << 8;
+            ip += 2;
+            break;
+        default:
+            if (end - ip < 4)
+            {
+                return -1;
+            }
+            length = (size_t)(tag >> 2) + 1;
+            offset = (size_t)ip[0] | (size_t)ip[1] << 8 | (size_t)ip[2] << 16 | (size_t)ip[3] << 24;
+            ip += 4;
+            break;
+        }
+
+        if (offset == 0 || offset > pos || total - pos < length)
+        {
+            return -1;
+        }
+        // Las copias pueden solaparse con su propio resultado: se copian byte a byte
+        for (size_t i = 0; i < length; i++)
+        {
+            base[pos + i] = base[pos - offset + i];
+        }
+        pos += length;
+    }
+
+    if (pos != total)
+    {
+        return -1;
+    }
+    out->len = pos;
+    out->data[pos] = '\0';
+    return 0;
+}
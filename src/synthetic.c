@@ -0,0 +1,76 @@
+#include "../include/synthetic.h"
+#include "../include/collection.h"
+#include "../include/metric_store.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/** Series registradas, en orden; NULL si no hay series sintéticas */
+static MetricSeries* synthetic_series;
+
+/** Cantidad de series en `synthetic_series` */
+static size_t synthetic_count;
+
+/** Recolecciones desde el inicio; desplaza los valores en cada una */
+static uint64_t synthetic_cycles;
+
+/**
+ * @brief Cambia el valor de todas las series sintéticas (CollectFn).
+ * @param arg Argumento no utilizado.
+ */
+static void synthetic_collect(void* arg)
+{
+    (void)arg;
+    synthetic_cycles++;
+    for (size_t i = 0; i < synthetic_count; i++)
+    {
+        metric_store_set(synthetic_series[i], (double)((synthetic_cycles + i) % 1000) * 1.5);
+    }
+}
+
+size_t synthetic_series_count()
+{
+    SyntheticConfig config = config_current_synthetic();
+    return (size_t)config.series;
+}
+
+int synthetic_init()
+{
+    SyntheticConfig config = config_current_synthetic();
+    if (config.series == 0)
+    {
+        return 0;
+    }
+
+    synthetic_series = malloc((size_t)config.series * sizeof(MetricSeries));
+    if (synthetic_series == NULL)
+    {
+        fprintf(stderr, "Error al reservar memoria para las series sintéticas\n");
+        return -1;
+    }
+
+    int family = -1;
+    char name[64];
+    char labels[64];
+    for (int i = 0; i < config.series; i++)
+    {
+        if (i % config.per_family == 0)
+        {
+            snprintf(name, sizeof(name), "synthetic_series_%d", i / config.per_family);
+            family = metric_store_add_family(name, "Serie sintética para pruebas de carga", METRIC_TYPE_GAUGE);
+            if (family < 0)
+            {
+                fprintf(stderr, "Error al crear la familia %s\n", name);
+                return -1;
+            }
+        }
+        snprintf(labels, sizeof(labels), "{instance=\"%d\",shard=\"%d\"}", i, i % 16);
+        MetricSeries series = metric_store_add_series(family, labels);
+        if (series == METRIC_SERIES_INVALID)
+        {
+            fprintf(stderr, "Error al crear la serie sintética %d: el almacén está lleno\n", i);
+            return -1;
+        }
+        synthetic_series[synthetic_count++] = series;
+    }
+    return collection_add_callback(synthetic_collect, NULL);
+}
@@ -0,0 +1,529 @@
+#include "../include/wal.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <zlib.h>
+
+/**
+ * @brief Bytes de la cabecera de cada registro (longitud, muestras y crc32).
+ */
+#define WAL_HEADER_SIZE 12
+
+/**
+ * @brief Nombre del archivo con la última posición confirmada en orden.
+ */
+#define WAL_CHECKPOINT_FILE "checkpoint"
+
+/**
+ * @brief Tamaño máximo de la ruta de un segmento.
+ */
+#define WAL_SEGMENT_PATH_SIZE (WAL_PATH_SIZE + 32)
+
+/**
+ * @brief Obtiene el i-ésimo segmento contando desde el más viejo.
+ * @param wal WAL.
+ * @param i Posición (0 a count - 1).
+ * @return Segmento.
+ */
+static WalSegment* segment_at(Wal* wal, int i)
+{
+    return &wal->segments[(wal->first + i) % WAL_MAX_SEGMENTS];
+}
+
+/**
+ * @brief Busca un segmento por número.
+ * @param wal WAL.
+ * @param id Número de segmento.
+ * @return Posición contando desde el más viejo, o -1 si ya no existe.
+ */
+static int find_segment(Wal* wal, uint64_t id)
+{
+    for (int i = 0; i < wal->count; i++)
+    {
+        if (segment_at(wal, i)->id == id)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Arma la ruta del archivo de un segmento.
+ * @param wal WAL.
+ * @param id Número de segmento.
+ * @param path Destino (WAL_SEGMENT_PATH_SIZE bytes).
+ */
+static void segment_path(const Wal* wal, uint64_t id, char* path)
+{
+    snprintf(path, WAL_SEGMENT_PATH_SIZE, "%s/%016" PRIx64 ".seg", wal->dir, id);
+}
+
+/**
+ * @brief Borra el segmento más viejo y mueve el cursor de lectura si apuntaba a él.
+ * @param wal WAL (con el lock tomado).
+ */
+static void remove_oldest(Wal* wal)
+{
+    WalSegment* oldest = segment_at(wal, 0);
+    char path[WAL_SEGMENT_PATH_SIZE];
+    segment_path(wal, oldest->id, path);
+    close(oldest->fd);
+    if (unlink(path) != 0)
+    {
+        fprintf(stderr, "Error al borrar el segmento %s: %s\n", path, strerror(errno));
+    }
+
+    uint64_t id = oldest->id;
+    wal->first = (wal->first + 1) % WAL_MAX_SEGMENTS;
+    wal->count--;
+    if (wal->read_segment == id && wal->count > 0)
+    {
+        wal->read_segment = segment_at(wal, 0)->id;
+        wal->read_offset = 0;
+    }
+}
+
+/**
+ * @brief Da por perdido lo que queda sin leer de un segmento.
+ * @param wal WAL (con el lock tomado).
+ * @param segment Segmento.
+ */
+static void skip_unread(Wal* wal, WalSegment* segment)
+{
+    uint64_t unread = segment->samples - segment->read_samples;
+    wal->dropped_samples += unread;
+    wal->pending_samples -= unread;
+    segment->acked += segment->records - segment->read_records;
+    segment->read_samples = segment->samples;
+    segment->read_records = segment->records;
+}
+
+/**
+ * @brief Borra desde el más viejo los segmentos cerrados cuyos registros ya se confirmaron.
+ * @param wal WAL (con el lock tomado).
+ */
+static void release_acked(Wal* wal)
+{
+    // El último segmento es el que recibe escrituras: nunca se borra
+    while (wal->count > 1 && segment_at(wal, 0)->acked == segment_at(wal, 0)->records)
+    {
+        remove_oldest(wal);
+    }
+}
+
+/**
+ * @brief Crea un segmento vacío al final, descartando el más viejo si se alcanzó el máximo.
+ * @param wal WAL (con el lock tomado).
+ * @param id Número del segmento nuevo.
+ * @return 0 en caso de éxito, -1 si no se pudo crear el archivo.
+ */
+static int open_segment(Wal* wal, uint64_t id)
+{
+    char path[WAL_SEGMENT_PATH_SIZE];
+    segment_path(wal, id, path);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error al crear el segmento %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    // El segmento que deja de recibir escrituras queda en disco antes de seguir en el nuevo
+    if (wal->count > 0 && fdatasync(segment_at(wal, wal->count - 1)->fd) != 0)
+    {
+        perror("Error al sincronizar el segmento del WAL");
+    }
+    if (wal->count == wal->max_segments)
+    {
+        skip_unread(wal, segment_at(wal, 0));
+        remove_oldest(wal);
+    }
+    WalSegment* segment = segment_at(wal, wal->count);
+    memset(segment, 0, sizeof(*segment));
+    segment->id = id;
+    segment->fd = fd;
+    wal->count++;
+    return 0;
+}
+
+/**
+ * @brief Recorre un segmento existente validando sus registros.
+ *
+ * Trunca el archivo en el primer registro incompleto, de longitud imposible o con crc
+ * inválido (escritura interrumpida o archivo dañado) y cuenta los registros y muestras
+ * válidos. Los que terminan antes de `confirmed` ya se habían enviado: se cuentan como
+ * leídos y confirmados.
+ *
+ * @param segment Segmento con `fd` abierto; se completan tamaño, registros y muestras.
+ * @param scratch Buffer auxiliar para leer el contenido.
+ * @param confirmed Posición confirmada según el checkpoint (0 si no aplica a este segmento).
+ * @param max_record Longitud máxima del contenido de un registro (`segment_bytes`).
+ */
+static void scan_segment(WalSegment* segment, Buffer* scratch, size_t confirmed, size_t max_record)
+{
+    struct stat st;
+    if (fstat(segment->fd, &st) != 0)
+    {
+        perror("Error al consultar el segmento del WAL");
+        return;
+    }
+    size_t file_size = (size_t)st.st_size;
+    size_t offset = 0;
+    for (;;)
+    {
+        uint32_t header[3];
+        if (pread(segment->fd, header, sizeof(header), (off_t)offset) != (ssize_t)sizeof(header))
+        {
+            break;
+        }
+        // Una longitud dañada no debe reservar memoria antes de fallar la lectura
+        if (header[0] > max_record || header[0] > file_size - offset - WAL_HEADER_SIZE)
+        {
+            break;
+        }
+        buffer_reset(scratch);
+        if (buffer_reserve(scratch, header[0]) != 0 ||
+            pread(segment->fd, scratch->data, header[0], (off_t)(offset + WAL_HEADER_SIZE)) != (ssize_t)header[0] ||
+            (uint32_t)crc32(0L, (const Bytef*)scratch->data, header[0]) != header[2])
+        {
+            break;
+        }
+        offset += WAL_HEADER_SIZE + header[0];
+        segment->records++;
+        segment->samples += header[1];
+        if (offset <= confirmed)
+        {
+            segment->read_records++;
+            segment->acked++;
+            segment->read_samples += header[1];
+            segment->acked_size = offset;
+        }
+    }
+
+    if (file_size != offset)
+    {
+        fprintf(stderr, "Segmento del WAL truncado en %zu de %zu bytes\n", offset, file_size);
+        if (ftruncate(segment->fd, (off_t)offset) != 0)
+        {
+            perror("Error al truncar el segmento");
+        }
+    }
+    segment->size = offset;
+}
+
+/**
+ * @brief Compara números de segmento para qsort.
+ * @param a Primer número.
+ * @param b Segundo número.
+ * @return Negativo, cero o positivo según el orden.
+ */
+static int compare_ids(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Carga los segmentos que dejó una ejecución anterior.
+ *
+ * Se descartan los segmentos anteriores al del checkpoint y, en ese, lo ya confirmado. Si
+ * quedan más segmentos de los que se conservan, los más viejos se descartan y sus muestras
+ * sin confirmar se cuentan como perdidas.
+ *
+ * @param wal WAL con el directorio ya creado y `checkpoint_fd` abierto.
+ * @return Número del último segmento encontrado, o 0 si no había ninguno.
+ */
+static uint64_t replay_segments(Wal* wal)
+{
+    uint64_t checkpoint[2] = {0, 0};
+    if (pread(wal->checkpoint_fd, checkpoint, sizeof(checkpoint), 0) != (ssize_t)sizeof(checkpoint))
+    {
+        checkpoint[0] = 0;
+        checkpoint[1] = 0;
+    }
+
+    DIR* dir = opendir(wal->dir);
+    if (dir == NULL)
+    {
+        return 0;
+    }
+
+    uint64_t ids[WAL_MAX_SEGMENTS * 2];
+    size_t id_count = 0;
+    uint64_t last = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        uint64_t id;
+        int consumed = 0;
+        if (sscanf(entry->d_name, "%16" SCNx64 ".seg%n", &id, &consumed) != 1 || consumed == 0 ||
+            entry->d_name[consumed] != '\0')
+        {
+            continue;
+        }
+        last = id > last ? id : last;
+        if (id_count < sizeof(ids) / sizeof(ids[0]))
+        {
+            ids[id_count++] = id;
+        }
+    }
+    closedir(dir);
+    qsort(ids, id_count, sizeof(ids[0]), compare_ids);
+
+    // Se deja lugar para el segmento nuevo de esta ejecución
+    size_t keep = (size_t)wal->max_segments - 1;
+    Buffer scratch;
+    buffer_init(&scratch);
+    for (size_t i = 0; i < id_count; i++)
+    {
+        char path[WAL_SEGMENT_PATH_SIZE];
+        segment_path(wal, ids[i], path);
+        if (ids[i] < checkpoint[0])
+        {
+            unlink(path);
+            continue;
+        }
+        int fd = open(path, O_RDWR | O_CLOEXEC);
+        if (fd < 0)
+        {
+            fprintf(stderr, "Descartando el segmento %s: %s\n", path, strerror(errno));
+            unlink(path);
+            continue;
+        }
+
+        WalSegment* segment = segment_at(wal, wal->count);
+        memset(segment, 0, sizeof(*segment));
+        segment->id = ids[i];
+        segment->fd = fd;
+        scan_segment(segment, &scratch, ids[i] == checkpoint[0] ? (size_t)checkpoint[1] : 0,
+                     wal->segment_bytes);
+        if (i + keep < id_count && segment->acked < segment->records)
+        {
+            uint64_t unread = segment->samples - segment->read_samples;
+            fprintf(stderr, "Descartando el segmento %s con %" PRIu64 " muestras sin enviar\n", path, unread);
+            wal->dropped_samples += unread;
+            segment->acked = segment->records;
+        }
+        if (segment->acked == segment->records)
+        {
+            close(fd);
+            unlink(path);
+            continue;
+        }
+        wal->pending_samples += segment->samples - segment->read_samples;
+        wal->count++;
+    }
+    buffer_free(&scratch);
+    return last;
+}
+
+int wal_open(Wal* wal, const char* dir, size_t segment_bytes, int max_segments)
+{
+    memset(wal, 0, sizeof(*wal));
+    if (strlen(dir) >= sizeof(wal->dir) || max_segments < 2 || max_segments > WAL_MAX_SEGMENTS)
+    {
+        fprintf(stderr, "Error: parámetros inválidos para el WAL en %s\n", dir);
+        return -1;
+    }
+    strcpy(wal->dir, dir);
+    wal->segment_bytes = segment_bytes;
+    wal->max_segments = max_segments;
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Error al crear el directorio del WAL %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    char path[WAL_SEGMENT_PATH_SIZE];
+    snprintf(path, sizeof(path), "%s/" WAL_CHECKPOINT_FILE, dir);
+    wal->checkpoint_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (wal->checkpoint_fd < 0)
+    {
+        fprintf(stderr, "Error al abrir %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    uint64_t last = replay_segments(wal);
+    if (open_segment(wal, last + 1) != 0)
+    {
+        for (int i = 0; i < wal->count; i++)
+        {
+            close(segment_at(wal, i)->fd);
+        }
+        close(wal->checkpoint_fd);
+        return -1;
+    }
+    wal->read_segment = segment_at(wal, 0)->id;
+    wal->read_offset = segment_at(wal, 0)->acked_size;
+    pthread_mutex_init(&wal->lock, NULL);
+    pthread_cond_init(&wal->available, NULL);
+    return 0;
+}
+
+int wal_append(Wal* wal, const void* data, size_t len, uint32_t samples)
+{
+    if (len > UINT32_MAX || len > wal->segment_bytes)
+    {
+        fprintf(stderr, "Error al escribir en el WAL: registro de %zu bytes mayor que un segmento\n", len);
+        return -1;
+    }
+
+    pthread_mutex_lock(&wal->lock);
+    WalSegment* last = segment_at(wal, wal->count - 1);
+    if (wal->closed || (last->size >= wal->segment_bytes && open_segment(wal, last->id + 1) != 0))
+    {
+        pthread_mutex_unlock(&wal->lock);
+        return -1;
+    }
+    last = segment_at(wal, wal->count - 1);
+
+    uint32_t header[3] = {(uint32_t)len, samples, (uint32_t)crc32(0L, (const Bytef*)data, (uInt)len)};
+    struct iovec iov[2] = {{header, sizeof(header)}, {(void*)data, len}};
+    if (pwritev(last->fd, iov, 2, (off_t)last->size) != (ssize_t)(sizeof(header) + len))
+    {
+        // Un registro a medias se pisaría con el siguiente, pero no debe quedar al releer
+        fprintf(stderr, "Error al escribir en el WAL: %s\n", strerror(errno));
+        if (ftruncate(last->fd, (off_t)last->size) != 0)
+        {
+            perror("Error al truncar el segmento");
+        }
+        pthread_mutex_unlock(&wal->lock);
+        return -1;
+    }
+    last->size += sizeof(header) + len;
+    last->records++;
+    last->samples += samples;
+    wal->pending_samples += samples;
+    release_acked(wal);
+    pthread_cond_signal(&wal->available);
+    pthread_mutex_unlock(&wal->lock);
+    return 0;
+}
+
+int wal_read(Wal* wal, Buffer* out, WalPosition* position)
+{
+    pthread_mutex_lock(&wal->lock);
+    for (;;)
+    {
+        if (wal->closed)
+        {
+            pthread_mutex_unlock(&wal->lock);
+            return -1;
+        }
+
+        int index = find_segment(wal, wal->read_segment);
+        if (index < 0)
+        {
+            // El segmento del cursor se descartó: seguir por el más viejo que queda
+            index = 0;
+            wal->read_segment = segment_at(wal, 0)->id;
+            wal->read_offset = 0;
+        }
+        WalSegment* segment = segment_at(wal, index);
+        if (wal->read_offset >= segment->size)
+        {
+            // Los números pueden tener huecos (segmentos vacíos o descartados al reanudar)
+            if (index < wal->count - 1)
+            {
+                wal->read_segment = segment_at(wal, index + 1)->id;
+                wal->read_offset = 0;
+                continue;
+            }
+            pthread_cond_wait(&wal->available, &wal->lock);
+            continue;
+        }
+
+        uint32_t header[3];
+        buffer_reset(out);
+        if (pread(segment->fd, header, sizeof(header), (off_t)wal->read_offset) != (ssize_t)sizeof(header) ||
+            buffer_reserve(out, header[0]) != 0 ||
+            pread(segment->fd, out->data, header[0], (off_t)(wal->read_offset + WAL_HEADER_SIZE)) !=
+                (ssize_t)header[0])
+        {
+            fprintf(stderr, "Error al leer el WAL; se descarta el resto del segmento\n");
+            skip_unread(wal, segment);
+            wal->read_offset = segment->size;
+            release_acked(wal);
+            continue;
+        }
+
+        out->len = header[0];
+        out->data[out->len] = '\0';
+        position->segment = segment->id;
+        position->offset = wal->read_offset;
+        position->size = WAL_HEADER_SIZE + header[0];
+        position->samples = header[1];
+        wal->read_offset += position->size;
+        segment->read_records++;
+        segment->read_samples += header[1];
+        pthread_mutex_unlock(&wal->lock);
+        return 0;
+    }
+}
+
+void wal_ack(Wal* wal, const WalPosition* position)
+{
+    pthread_mutex_lock(&wal->lock);
+    if (!wal->closed)
+    {
+        // Si el segmento ya se descartó, sus muestras siguen contadas como pendientes hasta aquí
+        int index = find_segment(wal, position->segment);
+        if (index >= 0)
+        {
+            WalSegment* segment = segment_at(wal, index);
+            segment->acked++;
+            if (segment->acked_size == position->offset)
+            {
+                // 16 bytes en una sola escritura: no queda un checkpoint a medias
+                uint64_t checkpoint[2] = {segment->id, position->offset + position->size};
+                segment->acked_size = (size_t)checkpoint[1];
+                if (pwrite(wal->checkpoint_fd, checkpoint, sizeof(checkpoint), 0) != (ssize_t)sizeof(checkpoint))
+                {
+                    perror("Error al escribir el checkpoint del WAL");
+                }
+            }
+        }
+        wal->pending_samples -= position->samples;
+        release_acked(wal);
+    }
+    pthread_mutex_unlock(&wal->lock);
+}
+
+void wal_stats(Wal* wal, WalStats* stats)
+{
+    pthread_mutex_lock(&wal->lock);
+    stats->pending_samples = wal->pending_samples;
+    stats->dropped_samples = wal->dropped_samples;
+    stats->segments = wal->count;
+    pthread_mutex_unlock(&wal->lock);
+}
+
+void wal_close(Wal* wal)
+{
+    pthread_mutex_lock(&wal->lock);
+    if (!wal->closed)
+    {
+        wal->closed = 1;
+        // Los segmentos anteriores se sincronizaron al rotar: falta el último y el checkpoint
+        if (fdatasync(segment_at(wal, wal->count - 1)->fd) != 0 || fdatasync(wal->checkpoint_fd) != 0)
+        {
+            perror("Error al sincronizar el WAL");
+        }
+        for (int i = 0; i < wal->count; i++)
+        {
+            close(segment_at(wal, i)->fd);
+        }
+        close(wal->checkpoint_fd);
+        pthread_cond_broadcast(&wal->available);
+    }
+    pthread_mutex_unlock(&wal->lock);
+}
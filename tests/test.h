@@ -0,0 +1,177 @@
+/**
+ * @file test.h
+ * @brief Utilidades comunes de los tests: verificaciones, reloj, archivos temporales y lectura
+ *        del almacén de métricas.
+ *
+ * Cada test es un ejecutable que corre ctest; termina con EXIT_FAILURE si alguna verificación
+ * falló. Las verificaciones no abortan, para informar todas las fallas de una corrida.
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+// nftw, mkdtemp y SOCK_NONBLOCK: los tests incluyen este encabezado antes que cualquier otro
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "../include/metric_store.h"
+#include <errno.h>
+#include <ftw.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Verificaciones fallidas en la corrida */
+static int test_failures;
+
+/**
+ * @brief Verifica una condición; si no se cumple informa el mensaje y cuenta la falla.
+ */
+#define TEST_CHECK(condition, ...)                                                                                     \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(condition))                                                                                              \
+        {                                                                                                              \
+            fprintf(stderr, "FALLO %s:%d: ", __FILE__, __LINE__);                                                      \
+            fprintf(stderr, __VA_ARGS__);                                                                              \
+            fputc('\n', stderr);                                                                                       \
+            test_failures++;                                                                                           \
+        }                                                                                                              \
+    } while (0)
+
+/**
+ * @brief Verifica que un valor esté a no más de `tolerance` del esperado.
+ */
+#define TEST_CHECK_NEAR(value, expected, tolerance)                                                                    \
+    TEST_CHECK(fabs((double)(value) - (double)(expected)) <= (double)(tolerance), "%s = %g, se esperaba %g ± %g",     \
+               #value, (double)(value), (double)(expected), (double)(tolerance))
+
+/**
+ * @brief Resultado de la corrida para devolver desde main.
+ * @return EXIT_SUCCESS si no hubo fallas.
+ */
+static inline int test_result()
+{
+    if (test_failures > 0)
+    {
+        fprintf(stderr, "%d verificaciones fallidas\n", test_failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Tiempo monotónico en nanosegundos.
+ * @return Nanosegundos desde un origen arbitrario.
+ */
+static inline uint64_t test_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Duerme la cantidad de milisegundos indicada.
+ * @param ms Milisegundos.
+ */
+static inline void test_sleep_ms(long ms)
+{
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+    {
+    }
+}
+
+/**
+ * @brief Escribe un archivo de forma atómica (temporal y rename), creando los directorios.
+ * @param dir Directorio base.
+ * @param name Ruta relativa a `dir`.
+ * @param content Contenido.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static inline int test_write_file(const char* dir, const char* name, const char* content)
+{
+    char path[512];
+    char temp[520];
+    if (snprintf(path, sizeof(path), "%s/%s", dir, name) >= (int)sizeof(path) ||
+        snprintf(temp, sizeof(temp), "%s.tmp", path) >= (int)sizeof(temp))
+    {
+        return -1;
+    }
+    for (char* slash = strchr(path + strlen(dir) + 1, '/'); slash != NULL; slash = strchr(slash + 1, '/'))
+    {
+        *slash = '\0';
+        int err = mkdir(path, 0755) != 0 && errno != EEXIST;
+        *slash = '/';
+        if (err)
+        {
+            return -1;
+        }
+    }
+    FILE* fp = fopen(temp, "w");
+    if (fp == NULL)
+    {
+        return -1;
+    }
+    int ok = fputs(content, fp) >= 0;
+    ok &= fclose(fp) == 0;
+    return ok && rename(temp, path) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Borra un archivo o directorio vacío (callback de nftw).
+ */
+static inline int test_remove_entry(const char* path, const struct stat* st, int type, struct FTW* ftw)
+{
+    (void)st;
+    (void)type;
+    (void)ftw;
+    return remove(path);
+}
+
+/**
+ * @brief Borra un directorio temporal con todo su contenido.
+ * @param dir Directorio.
+ */
+static inline void test_remove_tree(const char* dir)
+{
+    nftw(dir, test_remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+/**
+ * @brief Valor publicado de una serie del almacén.
+ * @param name Familia.
+ * @param labels Etiquetas ya formateadas, o NULL.
+ * @return Valor, o NaN si la serie no existe o no tiene dato.
+ */
+static inline double test_metric_value(const char* name, const char* labels)
+{
+    int family = metric_store_find_family(name);
+    if (family < 0)
+    {
+        return NAN;
+    }
+    MetricSeries series = metric_store_find_series(family, labels, metric_store_labels_hash(family, labels));
+    if (series == METRIC_SERIES_INVALID)
+    {
+        return NAN;
+    }
+    const double* values;
+    double value;
+    uint64_t generation;
+    do
+    {
+        generation = metric_store_read_begin(&values);
+        value = values[series];
+    } while (!metric_store_read_valid(generation));
+    return value;
+}
+
+#endif // TEST_H
@@ -0,0 +1,174 @@
+/**
+ * @file test_fixture_replay.c
+ * @brief El muestreador y el segmento de memoria compartida leen un fixture bajo las raíces de
+ *        procfs y sysfs configuradas, y ven cada archivo que la reproducción reemplaza.
+ *
+ * Arma un fixture en un directorio temporal y lo configura con "paths". Un hilo hace de
+ * `procfs_fixture replay`: reemplaza con rename, cada 5 ms, el cpu.stat del cgroup y el PSI de
+ * CPU, con contadores que avanzan a un cuarto de CPU y al 25% del tiempo. El cgroup tiene una
+ * cuota de medio CPU en cpu.max, así que su uso es del 50% con cualquier cantidad de CPUs.
+ * Tras un par de ventanas se comprueba que el muestreo y el segmento exportan los valores del
+ * fixture, que son imposibles de confundir con los de la máquina.
+ */
+
+#include "test.h"
+#include "../include/collection.h"
+#include "../include/config.h"
+#include "../include/metrics.h"
+#include "../include/sampler.h"
+#include "../include/shm_metrics.h"
+#include "../include/shm_output.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+/**
+ * @brief Milisegundos entre reemplazos del fixture.
+ */
+#define REPLAY_STEP_MS 5
+
+/** Directorio del fixture */
+static char fixture_dir[] = "/tmp/test_fixture_XXXXXX";
+
+/** Pide al hilo de reproducción que termine */
+static atomic_int stopping;
+
+/** Fallas al escribir el fixture desde el hilo de reproducción */
+static atomic_int replay_errors;
+
+/**
+ * @brief Escribe el PSI de un recurso con el "avg10" y el total indicados.
+ * @param name Ruta relativa al fixture.
+ * @param avg10 Porcentaje de los últimos 10 s.
+ * @param total_us Tiempo demorado acumulado.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int write_pressure(const char* name, double avg10, unsigned long long total_us)
+{
+    char content[256];
+    snprintf(content, sizeof(content),
+             "some avg10=%.2f avg60=0.00 avg300=0.00 total=%llu\nfull avg10=0.00 avg60=0.00 avg300=0.00 total=0\n",
+             avg10, total_us);
+    return test_write_file(fixture_dir, name, content);
+}
+
+/**
+ * @brief Reproduce el fixture: avanza los contadores y reemplaza los archivos.
+ * @param arg Argumento no utilizado.
+ * @return Siempre NULL.
+ */
+static void* replay_thread(void* arg)
+{
+    (void)arg;
+    uint64_t start = test_now_ns();
+    while (!atomic_load(&stopping))
+    {
+        unsigned long long elapsed_us = (test_now_ns() - start) / 1000;
+        char content[128];
+        snprintf(content, sizeof(content), "usage_usec %llu\nuser_usec 0\nsystem_usec 0\n", elapsed_us / 4);
+        if (test_write_file(fixture_dir, "sys/fs/cgroup/cpu.stat", content) != 0 ||
+            write_pressure("proc/pressure/cpu", 12.5, elapsed_us / 4) != 0)
+        {
+            atomic_fetch_add(&replay_errors, 1);
+        }
+        test_sleep_ms(REPLAY_STEP_MS);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Escribe el fixture inicial y la configuración que lo usa.
+ * @param config_path Destino de la ruta de la configuración.
+ * @param size Tamaño de `config_path`.
+ * @param shm_name Nombre del segmento.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int write_fixture(char* config_path, size_t size, const char* shm_name)
+{
+    int ret = 0;
+    ret |= test_write_file(fixture_dir, "proc/loadavg", "0.50 0.40 0.30 5/321 4242\n");
+    ret |= test_write_file(fixture_dir, "sys/fs/cgroup/cpu.stat", "usage_usec 0\nuser_usec 0\nsystem_usec 0\n");
+    ret |= test_write_file(fixture_dir, "sys/fs/cgroup/cpu.max", "50000 100000\n");
+    ret |= write_pressure("proc/pressure/cpu", 12.5, 0);
+    ret |= write_pressure("proc/pressure/memory", 3.25, 1000);
+    ret |= write_pressure("proc/pressure/io", 0.5, 2000);
+
+    char config[1024];
+    snprintf(config, sizeof(config),
+             "{\"metrics\": {\"cpu\": false, \"memory\": false, \"disk\": false, \"network\": false,"
+             " \"processes\": false, \"context_switches\": false},"
+             " \"paths\": {\"procfs\": \"%s/proc/\", \"sysfs\": \"%s/sys\"},"
+             " \"sampler\": {\"rate_hz\": 50, \"window_seconds\": 1},"
+             " \"shm\": {\"name\": \"%s\"}}\n",
+             fixture_dir, fixture_dir, shm_name);
+    ret |= test_write_file(fixture_dir, "config.json", config);
+    snprintf(config_path, size, "%s/config.json", fixture_dir);
+    return ret;
+}
+
+int main()
+{
+    if (mkdtemp(fixture_dir) == NULL)
+    {
+        perror("Error al crear el directorio del fixture");
+        return EXIT_FAILURE;
+    }
+    char shm_name[64];
+    snprintf(shm_name, sizeof(shm_name), "/test_fixture_%d", (int)getpid());
+    char config_path[512];
+    if (write_fixture(config_path, sizeof(config_path), shm_name) != 0 || config_init(config_path) != 0)
+    {
+        fprintf(stderr, "Error al preparar el fixture en %s\n", fixture_dir);
+        test_remove_tree(fixture_dir);
+        return EXIT_FAILURE;
+    }
+
+    PathsConfig paths = config_current_paths();
+    TEST_CHECK(strcmp(paths.procfs + strlen(fixture_dir), "/proc") == 0, "procfs = %s", paths.procfs);
+    metric_store_init(1024);
+    TEST_CHECK(metrics_set_procfs_root(paths.procfs) == 0 && metrics_set_sysfs_root(paths.sysfs) == 0,
+               "no se pudieron configurar las raíces");
+    TEST_CHECK(collection_init() == 0, "collection_init");
+
+    pthread_t replay;
+    pthread_create(&replay, NULL, replay_thread, NULL);
+    TEST_CHECK(sampler_init() == 0, "sampler_init");
+    TEST_CHECK(shm_output_init() == 0, "shm_output_init");
+
+    // Dos ventanas completas de 1 s: la primera incluye el arranque de los contadores
+    test_sleep_ms(2300);
+    collection_run();
+    atomic_store(&stopping, 1);
+    pthread_join(replay, NULL);
+    TEST_CHECK(atomic_load(&replay_errors) == 0, "%d fallas al reproducir el fixture", atomic_load(&replay_errors));
+
+    // loadavg: 5 ejecutables, sin contar al muestreador
+    TEST_CHECK_NEAR(test_metric_value("sampled_run_queue_length_mean", NULL), 4.0, 0.0);
+    TEST_CHECK_NEAR(test_metric_value("sampled_run_queue_length_max", NULL), 4.0, 0.0);
+    // Los contadores reemplazados avanzan al 50% de la cuota y al 25%: solo se ven si se reabren
+    TEST_CHECK_NEAR(test_metric_value("sampled_cpu_usage_percent_mean", NULL), 50.0, 10.0);
+    TEST_CHECK_NEAR(test_metric_value("sampled_psi_cpu_some_percent_mean", NULL), 25.0, 8.0);
+    // Memoria y E/S no cambian
+    TEST_CHECK_NEAR(test_metric_value("sampled_psi_memory_some_percent_max", NULL), 0.0, 0.0);
+    TEST_CHECK_NEAR(test_metric_value("sampled_psi_io_some_percent_max", NULL), 0.0, 0.0);
+
+    ShmMetricsReader reader;
+    ShmMetricsValues values;
+    if (shm_metrics_open(&reader, shm_name) == 0)
+    {
+        TEST_CHECK(shm_metrics_read(&reader, &values) == 0, "no se pudo leer el segmento");
+        TEST_CHECK_NEAR(values.psi_cpu_some_avg10, 12.5, 0.0);
+        TEST_CHECK_NEAR(values.psi_memory_some_avg10, 3.25, 0.0);
+        TEST_CHECK_NEAR(values.psi_io_some_avg10, 0.5, 0.0);
+        shm_metrics_close(&reader);
+    }
+    else
+    {
+        TEST_CHECK(0, "no se pudo abrir el segmento %s", shm_name);
+    }
+
+    sampler_stop();
+    shm_output_stop();
+    shm_unlink(shm_name);
+    test_remove_tree(fixture_dir);
+    return test_result();
+}
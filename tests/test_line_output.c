@@ -0,0 +1,324 @@
+/**
+ * @file test_line_output.c
+ * @brief Por TCP, un ciclo más grande que lo que acepta el socket llega completo y sin líneas
+ *        cortadas, sobre una única conexión.
+ *
+ * El receptor es un socket en 127.0.0.1 con un buffer de recepción chico que no lee durante el
+ * primer ciclo, así que la escritura no bloqueante queda corta. Después lee entre ciclos: los
+ * ciclos siguientes deben completar lo pendiente sin cerrar la conexión y sin descartar nada.
+ * Cada línea recibida se valida entera y se cuenta por ciclo.
+ */
+
+#include "test.h"
+#include "../include/collection.h"
+#include "../include/config.h"
+#include "../include/line_output.h"
+#include "../include/metrics.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+/**
+ * @brief Series del ciclo; con unos 40 bytes por línea superan el buffer de envío máximo (4 MiB
+ *        con el `tcp_wmem` por defecto) más el de recepción.
+ */
+#define SERIES_COUNT 150000
+
+/**
+ * @brief Ciclos con datos; los siguientes solo llevan las métricas del envío.
+ */
+#define DATA_CYCLES 3
+
+/**
+ * @brief Buffer de recepción del receptor (el kernel lo duplica).
+ */
+#define RECEIVER_BUFFER 4096
+
+/**
+ * @brief Máximo de ciclos sin datos para terminar de recibir lo pendiente.
+ */
+#define MAX_DRAIN_CYCLES 500
+
+/** Nombre de la familia de prueba */
+#define SERIES_NAME "test_line_series"
+
+/** Series de prueba */
+static MetricSeries series[SERIES_COUNT];
+
+/** Ciclo en curso; su número es el valor de todas las series, y 0 las deja ausentes */
+static int current_cycle;
+
+/** Bytes recibidos que aún no forman una línea completa */
+static char partial[4096];
+
+/** Longitud de `partial` */
+static size_t partial_len;
+
+/** Líneas de prueba recibidas por ciclo */
+static size_t received[DATA_CYCLES + 1];
+
+/** Líneas con formato inválido */
+static size_t malformed;
+
+/** Bytes recibidos en total */
+static size_t received_bytes;
+
+/** El emisor cerró la conexión */
+static int closed;
+
+/**
+ * @brief Fija el valor de las series de prueba (CollectFn).
+ * @param arg Argumento no utilizado.
+ */
+static void set_values(void* arg)
+{
+    (void)arg;
+    for (size_t i = 0; i < SERIES_COUNT; i++)
+    {
+        metric_store_set(series[i], current_cycle > 0 ? (double)current_cycle : NAN);
+    }
+}
+
+/**
+ * @brief Valida una línea de Graphite completa (`nombre valor timestamp`) y la cuenta.
+ * @param line Línea sin el fin de línea, terminada en '\0'.
+ */
+static void check_line(const char* line)
+{
+    double value;
+    long timestamp;
+    int end = -1;
+    if (sscanf(line, "%*s %lf %ld%n", &value, &timestamp, &end) != 2 || line[end] != '\0' || timestamp <= 0)
+    {
+        if (malformed++ == 0)
+        {
+            fprintf(stderr, "Línea inválida: \"%s\"\n", line);
+        }
+        return;
+    }
+    if (strncmp(line, SERIES_NAME ";id=", strlen(SERIES_NAME ";id=")) == 0)
+    {
+        int cycle = (int)value;
+        if (cycle >= 1 && cycle <= DATA_CYCLES && cycle == value)
+        {
+            received[cycle]++;
+        }
+        else
+        {
+            malformed++;
+        }
+    }
+}
+
+/**
+ * @brief Separa en líneas los bytes recibidos.
+ * @param data Bytes recibidos.
+ * @param len Longitud de `data`.
+ */
+static void consume(const char* data, size_t len)
+{
+    received_bytes += len;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (data[i] != '\n')
+        {
+            if (partial_len + 1 < sizeof(partial))
+            {
+                partial[partial_len++] = data[i];
+            }
+            continue;
+        }
+        partial[partial_len] = '\0';
+        check_line(partial);
+        partial_len = 0;
+    }
+}
+
+/**
+ * @brief Lee del receptor hasta que pasen `idle_ms` sin datos.
+ * @param fd Conexión aceptada.
+ * @param idle_ms Milisegundos de espera sin datos.
+ * @return Bytes leídos.
+ */
+static size_t receive(int fd, int idle_ms)
+{
+    size_t total = 0;
+    char data[65536];
+    struct pollfd pfd = {fd, POLLIN, 0};
+    while (!closed && poll(&pfd, 1, idle_ms) > 0)
+    {
+        ssize_t n = recv(fd, data, sizeof(data), MSG_DONTWAIT);
+        if (n == 0)
+        {
+            closed = 1;
+            break;
+        }
+        if (n < 0)
+        {
+            if (errno == EAGAIN || errno == EINTR)
+            {
+                continue;
+            }
+            closed = 1;
+            break;
+        }
+        consume(data, (size_t)n);
+        total += (size_t)n;
+    }
+    return total;
+}
+
+/**
+ * @brief Abre el receptor en un puerto libre de 127.0.0.1.
+ * @param port Recibe el puerto.
+ * @return Socket en escucha, o -1 en caso de error.
+ */
+static int open_receiver(int* port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int size = RECEIVER_BUFFER;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    // El tamaño del buffer se hereda en las conexiones aceptadas y fija la ventana anunciada
+    if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) != 0 ||
+        bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 4) != 0 ||
+        getsockname(fd, (struct sockaddr*)&addr, &len) != 0)
+    {
+        perror("Error al abrir el receptor");
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+/**
+ * @brief Escribe la configuración del envío por TCP al receptor.
+ * @param dir Directorio temporal.
+ * @param port Puerto del receptor.
+ * @param config_path Destino de la ruta de la configuración.
+ * @param size Tamaño de `config_path`.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int write_config(const char* dir, int port, char* config_path, size_t size)
+{
+    char config[1024];
+    snprintf(config, sizeof(config),
+             "{\"metrics\": {\"cpu\": false, \"memory\": false, \"disk\": false, \"network\": false,"
+             " \"processes\": false, \"context_switches\": false},"
+             " \"line_output\": {\"address\": \"127.0.0.1\", \"port\": %d, \"transport\": \"tcp\","
+             " \"protocol\": \"graphite\"}}\n",
+             port);
+    snprintf(config_path, size, "%s/config.json", dir);
+    return test_write_file(dir, "config.json", config);
+}
+
+/**
+ * @brief Registra las series de prueba.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int register_series()
+{
+    int family = metric_store_add_family(SERIES_NAME, "Serie de prueba de line_output", METRIC_TYPE_GAUGE);
+    if (family < 0)
+    {
+        return -1;
+    }
+    for (size_t i = 0; i < SERIES_COUNT; i++)
+    {
+        char labels[64];
+        snprintf(labels, sizeof(labels), "{id=\"%zu\"}", i);
+        series[i] = metric_store_add_series(family, labels);
+        if (series[i] == METRIC_SERIES_INVALID)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main()
+{
+    char dir[] = "/tmp/test_line_output_XXXXXX";
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("Error al crear el directorio temporal");
+        return EXIT_FAILURE;
+    }
+    int port;
+    char config_path[512];
+    int listener = open_receiver(&port);
+    if (listener < 0 || write_config(dir, port, config_path, sizeof(config_path)) != 0 ||
+        config_init(config_path) != 0)
+    {
+        fprintf(stderr, "Error al preparar la configuración en %s\n", dir);
+        test_remove_tree(dir);
+        return EXIT_FAILURE;
+    }
+
+    metric_store_init(SERIES_COUNT + 256);
+    TEST_CHECK(register_series() == 0, "no se pudieron registrar las series");
+    TEST_CHECK(collection_init() == 0, "collection_init");
+    TEST_CHECK(collection_add_callback(set_values, NULL) == 0, "collection_add_callback");
+    TEST_CHECK(line_output_init() == 0, "line_output_init");
+
+    // Primer ciclo sin leer: el socket acepta solo una parte
+    current_cycle = 1;
+    collection_run();
+    int fd = accept(listener, NULL, NULL);
+    TEST_CHECK(fd >= 0, "el envío no se conectó");
+    if (fd < 0)
+    {
+        close(listener);
+        test_remove_tree(dir);
+        return test_result();
+    }
+    size_t first = receive(fd, 100);
+    TEST_CHECK(first > 0 && received[1] < SERIES_COUNT, "el primer ciclo no quedó corto: %zu bytes, %zu líneas",
+               first, received[1]);
+
+    for (current_cycle = 2; current_cycle <= DATA_CYCLES; current_cycle++)
+    {
+        collection_run();
+        receive(fd, 20);
+    }
+
+    // Ciclos sin datos hasta que no llegue nada más: cada uno completa una parte de lo pendiente
+    current_cycle = 0;
+    int idle = 0;
+    for (int i = 0; i < MAX_DRAIN_CYCLES && idle < 10 && !closed; i++)
+    {
+        size_t before = received[DATA_CYCLES];
+        collection_run();
+        receive(fd, 10);
+        idle = received[DATA_CYCLES] == before && received[DATA_CYCLES] > 0 ? idle + 1 : 0;
+    }
+
+    TEST_CHECK(!closed, "el envío cerró la conexión");
+    TEST_CHECK(malformed == 0, "%zu líneas inválidas", malformed);
+    TEST_CHECK(partial_len == 0, "quedó una línea cortada de %zu bytes", partial_len);
+    for (int cycle = 1; cycle <= DATA_CYCLES; cycle++)
+    {
+        TEST_CHECK(received[cycle] == SERIES_COUNT, "ciclo %d: %zu de %d líneas", cycle, received[cycle],
+                   SERIES_COUNT);
+    }
+    collection_run();
+    TEST_CHECK_NEAR(test_metric_value("line_output_dropped_lines_total", NULL), 0.0, 0.0);
+    TEST_CHECK_NEAR(test_metric_value("line_output_send_errors_total", NULL), 0.0, 0.0);
+
+    // Una sola conexión: no hay otra esperando en el receptor
+    struct pollfd pfd = {listener, POLLIN, 0};
+    TEST_CHECK(poll(&pfd, 1, 0) == 0, "el envío abrió otra conexión");
+
+    close(fd);
+    close(listener);
+    test_remove_tree(dir);
+    return test_result();
+}
@@ -0,0 +1,305 @@
+/**
+ * @file test_remote_write.c
+ * @brief remote_write acumula en el WAL mientras el receptor no está y, cuando aparece, le
+ *        entrega todo en lotes que decodifica sin errores.
+ *
+ * Se ejecuta con la ruta de `remote_write_receiver`. Primero se recolecta varias veces sin
+ * receptor: los lotes quedan pendientes en el WAL y el envío reintenta. Después se inicia el
+ * receptor en el puerto configurado, que descomprime con snappy y recorre cada `WriteRequest`;
+ * el test espera a que no quede nada pendiente y compara las muestras que el receptor
+ * decodificó con las que el envío dio por aceptadas. Una serie con más etiquetas de las que
+ * admite la codificación debe contarse como descartada.
+ */
+
+#include "test.h"
+#include "../include/collection.h"
+#include "../include/config.h"
+#include "../include/remote_write.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+/**
+ * @brief Series de prueba con pocas etiquetas.
+ */
+#define SERIES_COUNT 100
+
+/**
+ * @brief Etiquetas de la serie que excede el máximo de la codificación.
+ */
+#define WIDE_LABELS 40
+
+/**
+ * @brief Recolecciones mientras el receptor no está.
+ */
+#define OFFLINE_CYCLES 5
+
+/**
+ * @brief Milisegundos máximos de espera a que se vacíe el WAL.
+ */
+#define DRAIN_TIMEOUT_MS 10000
+
+/** Series de prueba */
+static MetricSeries series[SERIES_COUNT];
+
+/** Serie con demasiadas etiquetas */
+static MetricSeries wide_series;
+
+/** Recolecciones hechas; es el valor de las series */
+static int cycles;
+
+/**
+ * @brief Fija el valor de las series de prueba (CollectFn).
+ * @param arg Argumento no utilizado.
+ */
+static void set_values(void* arg)
+{
+    (void)arg;
+    cycles++;
+    for (size_t i = 0; i < SERIES_COUNT; i++)
+    {
+        metric_store_set(series[i], (double)cycles + (double)i / 1000.0);
+    }
+    metric_store_set(wide_series, (double)cycles);
+}
+
+/**
+ * @brief Registra las series de prueba.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int register_series()
+{
+    int family = metric_store_add_family("test_remote_write_series", "Serie de prueba de remote_write",
+                                         METRIC_TYPE_GAUGE);
+    if (family < 0)
+    {
+        return -1;
+    }
+    for (size_t i = 0; i < SERIES_COUNT; i++)
+    {
+        char labels[64];
+        snprintf(labels, sizeof(labels), "{id=\"%zu\",group=\"g%zu\"}", i, i % 7);
+        series[i] = metric_store_add_series(family, labels);
+        if (series[i] == METRIC_SERIES_INVALID)
+        {
+            return -1;
+        }
+    }
+
+    Buffer labels;
+    buffer_init(&labels);
+    for (int i = 0; i < WIDE_LABELS; i++)
+    {
+        buffer_printf(&labels, "%sl%02d=\"v\"", i == 0 ? "{" : ",", i);
+    }
+    buffer_append_char(&labels, '}');
+    wide_series = metric_store_add_series(family, labels.data);
+    buffer_free(&labels);
+    return wide_series == METRIC_SERIES_INVALID ? -1 : 0;
+}
+
+/**
+ * @brief Busca un puerto TCP libre en 127.0.0.1.
+ * @return Puerto, o -1 en caso de error.
+ */
+static int free_port()
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    int port = -1;
+    if (fd >= 0 && bind(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0 &&
+        getsockname(fd, (struct sockaddr*)&addr, &len) == 0)
+    {
+        port = ntohs(addr.sin_port);
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    return port;
+}
+
+/**
+ * @brief Escribe la configuración del envío al receptor.
+ * @param dir Directorio temporal; el WAL va en un subdirectorio.
+ * @param port Puerto del receptor.
+ * @param config_path Destino de la ruta de la configuración.
+ * @param size Tamaño de `config_path`.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int write_config(const char* dir, int port, char* config_path, size_t size)
+{
+    char config[1024];
+    snprintf(config, sizeof(config),
+             "{\"metrics\": {\"cpu\": false, \"memory\": false, \"disk\": false, \"network\": false,"
+             " \"processes\": false, \"context_switches\": false},"
+             " \"remote_write\": {\"url\": \"http://127.0.0.1:%d/api/v1/write\", \"wal_dir\": \"%s/wal\","
+             " \"concurrency\": 2, \"max_samples_per_send\": 40, \"min_backoff_ms\": 10,"
+             " \"max_backoff_ms\": 100, \"timeout_seconds\": 2}}\n",
+             port, dir);
+    snprintf(config_path, size, "%s/config.json", dir);
+    return test_write_file(dir, "config.json", config);
+}
+
+/**
+ * @brief Inicia el receptor con la salida en un pipe y espera a que escuche.
+ * @param path Ejecutable de `remote_write_receiver`.
+ * @param port Puerto.
+ * @param output Recibe el extremo de lectura de la salida.
+ * @return PID del receptor, o -1 en caso de error.
+ */
+static pid_t start_receiver(const char* path, int port, FILE** output)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        char port_text[8];
+        snprintf(port_text, sizeof(port_text), "%d", port);
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execl(path, path, port_text, "0", (char*)NULL);
+        _exit(127);
+    }
+    close(fds[1]);
+    *output = fdopen(fds[0], "r");
+    char line[256];
+    if (pid < 0 || *output == NULL || fgets(line, sizeof(line), *output) == NULL ||
+        strncmp(line, "Escuchando", 10) != 0)
+    {
+        fprintf(stderr, "Error al iniciar %s\n", path);
+        return -1;
+    }
+    return pid;
+}
+
+/**
+ * @brief Recolecta hasta que el endpoint aceptó todo lo que estaba pendiente en una recolección.
+ *
+ * Cada recolección agrega un lote, así que el WAL nunca queda vacío al publicar: alcanza con
+ * que entre dos recolecciones se envíen al menos las muestras pendientes en la primera.
+ *
+ * @return 0 si se vació, -1 si venció el plazo.
+ */
+static int wait_drained()
+{
+    uint64_t deadline = test_now_ns() + (uint64_t)DRAIN_TIMEOUT_MS * 1000000ull;
+    while (test_now_ns() < deadline)
+    {
+        collection_run();
+        double pending = test_metric_value("remote_write_queue_pending_samples", NULL);
+        double sent = test_metric_value("remote_write_samples_sent_total", NULL);
+        test_sleep_ms(200);
+        collection_run();
+        if (test_metric_value("remote_write_samples_sent_total", NULL) - sent >= pending)
+        {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Uso: %s remote_write_receiver\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    char dir[] = "/tmp/test_remote_write_XXXXXX";
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("Error al crear el directorio temporal");
+        return EXIT_FAILURE;
+    }
+    char config_path[512];
+    int port = free_port();
+    if (port < 0 || write_config(dir, port, config_path, sizeof(config_path)) != 0 || config_init(config_path) != 0)
+    {
+        fprintf(stderr, "Error al preparar la configuración en %s\n", dir);
+        test_remove_tree(dir);
+        return EXIT_FAILURE;
+    }
+
+    metric_store_init(1024);
+    TEST_CHECK(register_series() == 0, "no se pudieron registrar las series");
+    TEST_CHECK(collection_init() == 0, "collection_init");
+    TEST_CHECK(collection_add_callback(set_values, NULL) == 0, "collection_add_callback");
+    TEST_CHECK(remote_write_init() == 0, "remote_write_init");
+
+    // Sin receptor: todo queda en el WAL y el envío reintenta
+    for (int i = 0; i < OFFLINE_CYCLES; i++)
+    {
+        collection_run();
+        test_sleep_ms(20);
+    }
+    collection_run();
+    double pending = test_metric_value("remote_write_queue_pending_samples", NULL);
+    TEST_CHECK(pending >= OFFLINE_CYCLES * SERIES_COUNT, "pendientes sin receptor: %g", pending);
+    TEST_CHECK_NEAR(test_metric_value("remote_write_samples_sent_total", NULL), 0.0, 0.0);
+    TEST_CHECK(test_metric_value("remote_write_retries_total", NULL) > 0, "el envío no reintentó");
+
+    FILE* output = NULL;
+    pid_t receiver = start_receiver(argv[1], port, &output);
+    TEST_CHECK(receiver > 0, "no se pudo iniciar el receptor");
+    if (receiver > 0)
+    {
+        TEST_CHECK(wait_drained() == 0, "el WAL no se vació: %g pendientes",
+                   test_metric_value("remote_write_queue_pending_samples", NULL));
+        // El último lote pudo salir después de la recolección: se lo deja terminar antes de cortar
+        test_sleep_ms(200);
+        kill(receiver, SIGTERM);
+        waitpid(receiver, NULL, 0);
+        collection_run();
+    }
+
+    // Cada línea del receptor es una petición decodificada; una serie lleva una muestra
+    unsigned long long received_series = 0;
+    unsigned long long received_samples = 0;
+    int invalid = 0;
+    char line[256];
+    while (output != NULL && fgets(line, sizeof(line), output) != NULL)
+    {
+        size_t in_len, out_len, request_series, request_samples;
+        unsigned long long total;
+        if (strstr(line, "inválido") != NULL || strstr(line, ": 503") != NULL)
+        {
+            invalid++;
+        }
+        else if (sscanf(line, "petición %*u: %zu -> %zu bytes, %zu series, %zu muestras (total %llu muestras)",
+                        &in_len, &out_len, &request_series, &request_samples, &total) == 5)
+        {
+            TEST_CHECK(out_len > in_len, "lote sin comprimir: %zu -> %zu bytes", in_len, out_len);
+            received_series += request_series;
+            received_samples += request_samples;
+        }
+    }
+    if (output != NULL)
+    {
+        fclose(output);
+    }
+
+    double sent = test_metric_value("remote_write_samples_sent_total", NULL);
+    TEST_CHECK(invalid == 0, "%d peticiones rechazadas por el receptor", invalid);
+    TEST_CHECK(received_samples == received_series, "%llu muestras en %llu series", received_samples,
+               received_series);
+    TEST_CHECK_NEAR(received_samples, sent, 0.0);
+    TEST_CHECK(sent >= (double)cycles * SERIES_COUNT, "enviadas %g de al menos %d", sent, cycles * SERIES_COUNT);
+    TEST_CHECK_NEAR(test_metric_value("remote_write_samples_dropped_total", "{reason=\"too_many_labels\"}"), cycles,
+                    1.0);
+    TEST_CHECK_NEAR(test_metric_value("remote_write_samples_dropped_total", "{reason=\"rejected\"}"), 0.0, 0.0);
+
+    test_remove_tree(dir);
+    return test_result();
+}
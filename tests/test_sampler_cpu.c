@@ -0,0 +1,64 @@
+/**
+ * @file test_sampler_cpu.c
+ * @brief El total de CPU contra el que se compara el `usage_usec` del cgroup no desborda con
+ *        instantes grandes ni con capacidades altas, y sigue avanzando entre ticks.
+ *
+ * Con el producto directo de microsegundos por milésimas de CPU, 256 CPUs desbordaban a los
+ * ~834 días de uptime: el total volvía a empezar por debajo del anterior y el muestreo de CPU
+ * se congelaba. Se compara contra el cálculo exacto en 128 bits.
+ */
+
+#include "test.h"
+#include "../include/sampler.h"
+
+/**
+ * @brief Nanosegundos por día.
+ */
+#define DAY_NS (86400ull * 1000000000ull)
+
+/**
+ * @brief Período de un tick a 50 Hz, en nanosegundos.
+ */
+#define TICK_NS 20000000ull
+
+/**
+ * @brief Cálculo exacto de referencia.
+ * @param now_ns Instante en nanosegundos.
+ * @param capacity_milli Capacidad en milésimas de CPU.
+ * @return Microsegundos de CPU.
+ */
+static uint64_t reference_us(uint64_t now_ns, uint64_t capacity_milli)
+{
+    return (uint64_t)((unsigned __int128)(now_ns / 1000) * capacity_milli / 1000);
+}
+
+int main()
+{
+    static const struct
+    {
+        uint64_t now_ns;
+        uint64_t capacity_milli;
+    } cases[] = {
+        {0, 1000},
+        {TICK_NS + 123456, 500},
+        {834 * DAY_NS, 256000},
+        {1000 * DAY_NS + 987654321, 256000},
+        {10 * 365 * DAY_NS + 1, 1024000},
+        {3650 * DAY_NS, 10000000},
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        uint64_t now_ns = cases[i].now_ns;
+        uint64_t capacity = cases[i].capacity_milli;
+        uint64_t total = sampler_cpu_capacity_us(now_ns, capacity);
+        TEST_CHECK(total == reference_us(now_ns, capacity), "caso %zu: %llu, se esperaba %llu", i,
+                   (unsigned long long)total, (unsigned long long)reference_us(now_ns, capacity));
+
+        // Un tick después el total avanza lo que la capacidad permite en 20 ms
+        uint64_t next = sampler_cpu_capacity_us(now_ns + TICK_NS, capacity);
+        TEST_CHECK(next > total, "caso %zu: el total no avanzó en un tick", i);
+        TEST_CHECK_NEAR((double)(next - total), (double)(TICK_NS / 1000 * capacity / 1000), 1.0);
+    }
+    return test_result();
+}
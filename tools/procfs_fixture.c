@@ -0,0 +1,800 @@
+/**
+ * @file procfs_fixture.c
+ * @brief Graba, sintetiza y reproduce fixtures de procfs para correr los collectors contra el
+ *        /proc (y el /sys) de otra máquina, real o imaginaria.
+ *
+ * Un fixture es una secuencia de capturas de los archivos que leen los collectors, el
+ * muestreador y el segmento compartido (ver `metrics_procfs_file`: stat, meminfo, loadavg,
+ * pressure, el cpu.stat del cgroup, ...), cada una con su instante relativo a la primera. Se guarda comprimido
+ * con gzip; descomprimido es "PFX1" seguido, por captura, del instante en ms (u64), la
+ * cantidad de archivos (u32) y, por archivo, su ruta relativa a la raíz (u16 + bytes, p. ej.
+ * "proc/stat" o "sys/fs/cgroup/cpu.stat") y su contenido (u32 + bytes), todo big-endian.
+ *
+ * - record: captura los archivos del sistema (o de otra raíz) cada `intervalo_ms`.
+ * - synth: genera las capturas de una máquina de la escala pedida (CPUs, interfaces, discos y
+ *   procesos en ejecución) con contadores que avanzan entre capturas.
+ * - replay: escribe cada captura bajo el directorio en su instante, dividido por la velocidad.
+ *   Cada archivo se reemplaza con rename, así que un collector nunca lee uno a medias. Al
+ *   empezar otra vuelta los contadores retroceden y la primera muestra de CPU sale inválida.
+ * - extract: escribe una sola captura y termina; alcanza para los benchmarks.
+ *
+ * Con "paths.procfs" (o `monitoring_bench -r`) en <directorio>/proc y "paths.sysfs" en
+ * <directorio>/sys los collectors leen el fixture en lugar del /proc y el /sys reales.
+ *
+ * Uso:
+ *   procfs_fixture record <archivo> <capturas> <intervalo_ms> [raíz]
+ *   procfs_fixture synth <archivo> <capturas> <intervalo_ms> <cpus> <interfaces> <discos> <procesos>
+ *   procfs_fixture replay <archivo> <directorio> [velocidad] [vueltas]
+ *   procfs_fixture extract <archivo> <directorio> [captura]
+ */
+
+#include "../include/buffer.h"
+#include "../include/metrics.h"
+#include <errno.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <zlib.h>
+
+/**
+ * @brief Encabezado del archivo descomprimido.
+ */
+#define FIXTURE_MAGIC "PFX1"
+
+/**
+ * @brief Archivos por captura como máximo.
+ */
+#define FIXTURE_MAX_FILES 32
+
+/**
+ * @brief Tamaño de una ruta relativa dentro del fixture.
+ */
+#define FIXTURE_NAME_SIZE 128
+
+/**
+ * @brief Tamaño de una ruta completa al grabar o reproducir.
+ */
+#define FIXTURE_PATH_SIZE 512
+
+/**
+ * @brief Jiffies por segundo de los tiempos de CPU en /proc/stat (USER_HZ).
+ */
+#define FIXTURE_USER_HZ 100
+
+/**
+ * @struct Capture
+ * @brief Una captura leída del fixture; los buffers se reutilizan entre capturas.
+ */
+typedef struct
+{
+    uint64_t offset_ms;                               /**< Instante relativo a la primera captura. */
+    size_t count;                                     /**< Archivos de la captura. */
+    char names[FIXTURE_MAX_FILES][FIXTURE_NAME_SIZE]; /**< Ruta relativa a la raíz de cada archivo. */
+    Buffer contents[FIXTURE_MAX_FILES];               /**< Contenido de cada archivo. */
+} Capture;
+
+/**
+ * @struct SynthHost
+ * @brief Contadores de la máquina sintética; avanzan en cada captura.
+ */
+typedef struct
+{
+    int cpus;                      /**< CPUs. */
+    int interfaces;                /**< Interfaces de red además de lo. */
+    int disks;                     /**< Discos. */
+    int running;                   /**< Procesos en ejecución. */
+    unsigned long long (*cpu)[8];  /**< Tiempos de cada CPU: user, nice, system, idle, iowait, irq, softirq, steal. */
+    unsigned long long (*disk)[2]; /**< Lecturas y escrituras completadas de cada disco. */
+    unsigned long long (*net)[2];  /**< Bytes recibidos y enviados de cada interfaz (la 0 es lo). */
+    unsigned long long ctxt;       /**< Cambios de contexto. */
+    unsigned long long stall[3];   /**< Tiempo demorado acumulado (PSI "some") de CPU, memoria y E/S, en µs. */
+    double stall_avg10[3];         /**< Porcentaje demorado en el último intervalo, como "avg10". */
+    unsigned long long processes;  /**< Procesos creados desde el arranque. */
+    uint64_t random;               /**< Estado del generador (xorshift64). */
+} SynthHost;
+
+/**
+ * @brief Tiempo monotónico en nanosegundos.
+ * @return Nanosegundos desde un origen arbitrario.
+ */
+static uint64_t monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Duerme hasta un instante monotónico.
+ * @param deadline_ns Instante en nanosegundos (de `monotonic_ns`).
+ */
+static void sleep_until(uint64_t deadline_ns)
+{
+    struct timespec ts = {(time_t)(deadline_ns / 1000000000ull), (long)(deadline_ns % 1000000000ull)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    {
+    }
+}
+
+/**
+ * @brief Escribe un entero big-endian.
+ * @param gz Archivo.
+ * @param value Valor.
+ * @param bytes Ancho en bytes (2, 4 u 8).
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int write_uint(gzFile gz, uint64_t value, int bytes)
+{
+    unsigned char data[8];
+    for (int i = 0; i < bytes; i++)
+    {
+        data[i] = (unsigned char)(value >> (8 * (bytes - 1 - i)));
+    }
+    return gzwrite(gz, data, (unsigned)bytes) == bytes ? 0 : -1;
+}
+
+/**
+ * @brief Escribe el encabezado de una captura.
+ * @param gz Archivo.
+ * @param offset_ms Instante relativo a la primera captura.
+ * @param count Archivos que siguen.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int write_capture_header(gzFile gz, uint64_t offset_ms, size_t count)
+{
+    return write_uint(gz, offset_ms, 8) | write_uint(gz, count, 4);
+}
+
+/**
+ * @brief Escribe un archivo de una captura.
+ * @param gz Archivo.
+ * @param name Ruta relativa a la raíz.
+ * @param data Contenido.
+ * @param len Longitud del contenido.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int write_entry(gzFile gz, const char* name, const void* data, size_t len)
+{
+    size_t name_len = strlen(name);
+    if (write_uint(gz, name_len, 2) != 0 || gzwrite(gz, name, (unsigned)name_len) != (int)name_len ||
+        write_uint(gz, len, 4) != 0)
+    {
+        return -1;
+    }
+    return len == 0 || gzwrite(gz, data, (unsigned)len) == (int)len ? 0 : -1;
+}
+
+/**
+ * @brief Lee un entero big-endian.
+ * @param gz Archivo.
+ * @param bytes Ancho en bytes (2, 4 u 8).
+ * @param value Valor leído.
+ * @return 0 en caso de éxito, 1 si el archivo terminó antes del primer byte, -1 si está truncado.
+ */
+static int read_uint(gzFile gz, int bytes, uint64_t* value)
+{
+    unsigned char data[8];
+    int got = gzread(gz, data, (unsigned)bytes);
+    if (got != bytes)
+    {
+        return got == 0 ? 1 : -1;
+    }
+    *value = 0;
+    for (int i = 0; i < bytes; i++)
+    {
+        *value = *value << 8 | data[i];
+    }
+    return 0;
+}
+
+/**
+ * @brief Abre un fixture para leer y verifica el encabezado.
+ * @param path Ruta del archivo.
+ * @return Archivo posicionado en la primera captura, o NULL en caso de error.
+ */
+static gzFile open_fixture(const char* path)
+{
+    gzFile gz = gzopen(path, "rb");
+    if (gz == NULL)
+    {
+        fprintf(stderr, "Error al abrir %s\n", path);
+        return NULL;
+    }
+    char magic[sizeof(FIXTURE_MAGIC) - 1];
+    if (gzread(gz, magic, sizeof(magic)) != (int)sizeof(magic) || memcmp(magic, FIXTURE_MAGIC, sizeof(magic)) != 0)
+    {
+        fprintf(stderr, "%s no es un fixture de procfs\n", path);
+        gzclose(gz);
+        return NULL;
+    }
+    return gz;
+}
+
+/**
+ * @brief Lee la próxima captura.
+ * @param gz Fixture abierto con `open_fixture`.
+ * @param capture Destino.
+ * @return 0 si se leyó una captura, 1 si no quedan más, -1 si el fixture está dañado.
+ */
+static int read_capture(gzFile gz, Capture* capture)
+{
+    uint64_t offset_ms;
+    uint64_t count;
+    int ret = read_uint(gz, 8, &offset_ms);
+    if (ret != 0)
+    {
+        return ret;
+    }
+    if (read_uint(gz, 4, &count) != 0 || count > FIXTURE_MAX_FILES)
+    {
+        return -1;
+    }
+
+    capture->offset_ms = offset_ms;
+    capture->count = 0;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        uint64_t name_len;
+        uint64_t len;
+        if (read_uint(gz, 2, &name_len) != 0 || name_len == 0 || name_len >= FIXTURE_NAME_SIZE ||
+            gzread(gz, capture->names[i], (unsigned)name_len) != (int)name_len || read_uint(gz, 4, &len) != 0)
+        {
+            return -1;
+        }
+        capture->names[i][name_len] = '\0';
+        // Las rutas quedan siempre debajo del directorio de reproducción
+        if (capture->names[i][0] == '/' || strstr(capture->names[i], "..") != NULL)
+        {
+            return -1;
+        }
+
+        Buffer* content = &capture->contents[i];
+        buffer_reset(content);
+        if (buffer_reserve(content, len + 1) != 0 ||
+            (len > 0 && gzread(gz, content->data, (unsigned)len) != (int)len))
+        {
+            return -1;
+        }
+        content->len = len;
+        content->data[len] = '\0';
+        capture->count++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Crea los directorios que faltan hasta el padre de una ruta.
+ * @param path Ruta de un archivo.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int create_parents(const char* path)
+{
+    char dir[FIXTURE_PATH_SIZE];
+    int len = snprintf(dir, sizeof(dir), "%s", path);
+    if (len < 0 || (size_t)len >= sizeof(dir))
+    {
+        fprintf(stderr, "Error al crear los directorios de %s: ruta demasiado larga\n", path);
+        return -1;
+    }
+    for (char* slash = strchr(dir + 1, '/'); slash != NULL; slash = strchr(slash + 1, '/'))
+    {
+        *slash = '\0';
+        if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+        {
+            fprintf(stderr, "Error al crear %s: %s\n", dir, strerror(errno));
+            return -1;
+        }
+        *slash = '/';
+    }
+    return 0;
+}
+
+/**
+ * @brief Escribe una captura bajo un directorio, reemplazando cada archivo de forma atómica.
+ * @param dir Directorio raíz del fixture.
+ * @param capture Captura.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int write_capture(const char* dir, const Capture* capture)
+{
+    for (size_t i = 0; i < capture->count; i++)
+    {
+        char path[FIXTURE_PATH_SIZE];
+        char temp[FIXTURE_PATH_SIZE + 8];
+        int len = snprintf(path, sizeof(path), "%s/%s", dir, capture->names[i]);
+        if (len < 0 || (size_t)len >= sizeof(path) || snprintf(temp, sizeof(temp), "%s.tmp", path) != len + 4)
+        {
+            fprintf(stderr, "Error al escribir %s/%s: ruta demasiado larga\n", dir, capture->names[i]);
+            return -1;
+        }
+        if (create_parents(path) != 0)
+        {
+            return -1;
+        }
+
+        FILE* fp = fopen(temp, "w");
+        if (fp == NULL)
+        {
+            fprintf(stderr, "Error al crear %s: %s\n", temp, strerror(errno));
+            return -1;
+        }
+        size_t written = fwrite(capture->contents[i].data, 1, capture->contents[i].len, fp);
+        if (fclose(fp) != 0 || written != capture->contents[i].len || rename(temp, path) != 0)
+        {
+            fprintf(stderr, "Error al escribir %s: %s\n", path, strerror(errno));
+            unlink(temp);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Lee un archivo completo; los de /proc no informan su tamaño.
+ * @param path Ruta.
+ * @param out Destino; se vacía antes de leer.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int read_file(const char* path, Buffer* out)
+{
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        return -1;
+    }
+    buffer_reset(out);
+    char chunk[4096];
+    size_t got;
+    int ret = 0;
+    while ((got = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+    {
+        ret |= buffer_append(out, chunk, got);
+    }
+    ret |= ferror(fp) ? -1 : 0;
+    fclose(fp);
+    return ret;
+}
+
+/**
+ * @brief Graba capturas de los archivos que leen los collectors.
+ * @param archive Archivo de salida.
+ * @param captures Capturas a grabar.
+ * @param interval_ms Intervalo entre capturas.
+ * @param root Raíz del sistema de archivos ("" para el sistema real).
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int record(const char* archive, long captures, long interval_ms, const char* root)
+{
+    gzFile gz = gzopen(archive, "wb9");
+    if (gz == NULL || gzwrite(gz, FIXTURE_MAGIC, sizeof(FIXTURE_MAGIC) - 1) != (int)sizeof(FIXTURE_MAGIC) - 1)
+    {
+        fprintf(stderr, "Error al crear %s\n", archive);
+        return -1;
+    }
+
+    char paths[PROCFS_FILE_COUNT][FIXTURE_PATH_SIZE];
+    Buffer contents[PROCFS_FILE_COUNT];
+    int ret = 0;
+    for (int i = 0; i < PROCFS_FILE_COUNT; i++)
+    {
+        buffer_init(&contents[i]);
+        int len = snprintf(paths[i], sizeof(paths[i]), "%s/%s", root, metrics_procfs_file((ProcfsFile)i));
+        if (len < 0 || (size_t)len >= sizeof(paths[i]))
+        {
+            fprintf(stderr, "Error al leer %s/%s: ruta demasiado larga\n", root, metrics_procfs_file((ProcfsFile)i));
+            ret = -1;
+        }
+    }
+
+    uint64_t start = monotonic_ns();
+    for (long c = 0; c < captures && ret == 0; c++)
+    {
+        sleep_until(start + (uint64_t)c * (uint64_t)interval_ms * 1000000ull);
+        uint64_t offset_ms = (monotonic_ns() - start) / 1000000ull;
+
+        // Los archivos que no existen en esta máquina se omiten de la captura
+        int present[PROCFS_FILE_COUNT];
+        size_t count = 0;
+        for (int i = 0; i < PROCFS_FILE_COUNT; i++)
+        {
+            present[i] = read_file(paths[i], &contents[i]) == 0;
+            if (!present[i] && c == 0)
+            {
+                fprintf(stderr, "Se omite %s: %s\n", paths[i], strerror(errno));
+            }
+            count += (size_t)present[i];
+        }
+
+        ret = write_capture_header(gz, offset_ms, count);
+        for (int i = 0; i < PROCFS_FILE_COUNT && ret == 0; i++)
+        {
+            if (present[i])
+            {
+                ret = write_entry(gz, metrics_procfs_file((ProcfsFile)i), contents[i].data, contents[i].len);
+            }
+        }
+    }
+
+    for (int i = 0; i < PROCFS_FILE_COUNT; i++)
+    {
+        buffer_free(&contents[i]);
+    }
+    if (gzclose(gz) != Z_OK || ret != 0)
+    {
+        fprintf(stderr, "Error al escribir %s\n", archive);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Genera un número pseudoaleatorio (xorshift64).
+ * @param host Máquina sintética con el estado.
+ * @param bound Cota exclusiva.
+ * @return Número entre 0 y bound - 1.
+ */
+static unsigned long long next_random(SynthHost* host, unsigned long long bound)
+{
+    host->random ^= host->random << 13;
+    host->random ^= host->random >> 7;
+    host->random ^= host->random << 17;
+    return bound > 0 ? host->random % bound : 0;
+}
+
+/**
+ * @brief Avanza los contadores de la máquina sintética un intervalo.
+ * @param host Máquina sintética.
+ * @param interval_ms Intervalo.
+ */
+static void synth_advance(SynthHost* host, long interval_ms)
+{
+    unsigned long long jiffies = (unsigned long long)interval_ms * FIXTURE_USER_HZ / 1000;
+    for (int i = 0; i < host->cpus; i++)
+    {
+        // Cada CPU reparte sus jiffies entre user, system, iowait e idle
+        unsigned long long user = next_random(host, jiffies + 1);
+        unsigned long long system = next_random(host, jiffies - user + 1);
+        unsigned long long iowait = next_random(host, (jiffies - user - system) / 8 + 1);
+        host->cpu[i][0] += user;
+        host->cpu[i][2] += system;
+        host->cpu[i][4] += iowait;
+        host->cpu[i][3] += jiffies - user - system - iowait;
+    }
+    host->ctxt += (unsigned long long)host->cpus * (unsigned long long)interval_ms * 5 + next_random(host, 1000);
+    host->processes += (unsigned long long)interval_ms / 10 + next_random(host, 100);
+    for (int i = 0; i < host->disks; i++)
+    {
+        host->disk[i][0] += next_random(host, (unsigned long long)interval_ms);
+        host->disk[i][1] += next_random(host, (unsigned long long)interval_ms);
+    }
+    for (int i = 0; i <= host->interfaces; i++)
+    {
+        host->net[i][0] += next_random(host, (unsigned long long)interval_ms * 12500);
+        host->net[i][1] += next_random(host, (unsigned long long)interval_ms * 12500);
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        // Hasta un 20% del intervalo con alguna tarea demorada
+        unsigned long long stall = next_random(host, (unsigned long long)interval_ms * 200 + 1);
+        host->stall[i] += stall;
+        host->stall_avg10[i] = (double)stall / ((double)interval_ms * 10.0);
+    }
+}
+
+/**
+ * @brief Escribe en una captura los archivos de la máquina sintética.
+ * @param gz Archivo.
+ * @param host Máquina sintética.
+ * @param offset_ms Instante de la captura.
+ * @param out Buffer de trabajo.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int synth_capture(gzFile gz, const SynthHost* host, uint64_t offset_ms, Buffer* out)
+{
+    // Todos los archivos menos el cpu.stat de la jerarquía híbrida: la máquina es cgroup v2 puro
+    int ret = write_capture_header(gz, offset_ms, PROCFS_FILE_COUNT - 1);
+
+    unsigned long long total_kb = (unsigned long long)host->cpus * 4ull * 1024 * 1024;
+    unsigned long long free_kb = total_kb / 4 + (unsigned long long)host->processes % (total_kb / 8);
+    buffer_reset(out);
+    ret |= buffer_printf(out,
+                         "MemTotal:       %llu kB\nMemFree:        %llu kB\nMemAvailable:   %llu kB\n"
+                         "Buffers:        %llu kB\nCached:         %llu kB\n",
+                         total_kb, free_kb, free_kb * 2, total_kb / 64, total_kb / 8);
+    ret |= write_entry(gz, "proc/meminfo", out->data, out->len);
+
+    unsigned long long sum[8] = {0};
+    for (int i = 0; i < host->cpus; i++)
+    {
+        for (int f = 0; f < 8; f++)
+        {
+            sum[f] += host->cpu[i][f];
+        }
+    }
+    buffer_reset(out);
+    ret |= buffer_printf(out, "cpu  %llu %llu %llu %llu %llu %llu %llu %llu 0 0\n", sum[0], sum[1], sum[2], sum[3],
+                         sum[4], sum[5], sum[6], sum[7]);
+    for (int i = 0; i < host->cpus; i++)
+    {
+        const unsigned long long* t = host->cpu[i];
+        ret |= buffer_printf(out, "cpu%d %llu %llu %llu %llu %llu %llu %llu %llu 0 0\n", i, t[0], t[1], t[2], t[3],
+                             t[4], t[5], t[6], t[7]);
+    }
+    ret |= buffer_printf(out,
+                         "intr 0\nctxt %llu\nbtime 1700000000\nprocesses %llu\nprocs_running %d\nprocs_blocked 0\n"
+                         "softirq 0 0 0 0 0 0 0 0 0 0 0\n",
+                         host->ctxt, host->processes, host->running);
+    ret |= write_entry(gz, "proc/stat", out->data, out->len);
+
+    buffer_reset(out);
+    for (int i = 0; i < host->disks; i++)
+    {
+        // sda, sdb, ..., sdz, sdaa, sdab, ...
+        char name[8];
+        if (i < 26)
+        {
+            snprintf(name, sizeof(name), "sd%c", 'a' + i);
+        }
+        else
+        {
+            snprintf(name, sizeof(name), "sd%c%c", 'a' + (i / 26 - 1) % 26, 'a' + i % 26);
+        }
+        ret |= buffer_printf(out, "%4d %7d %s %llu 0 %llu 0 %llu 0 %llu 0 0 0 0 0 0 0 0 0 0\n", 8, i * 16, name,
+                             host->disk[i][0], host->disk[i][0] * 8, host->disk[i][1], host->disk[i][1] * 8);
+    }
+    ret |= write_entry(gz, "proc/diskstats", out->data, out->len);
+
+    buffer_reset(out);
+    ret |= buffer_append_str(out, "Inter-|   Receive                                                |  Transmit\n"
+                                  " face |bytes    packets errs drop fifo frame compressed multicast|"
+                                  "bytes    packets errs drop fifo colls carrier compressed\n");
+    for (int i = 0; i <= host->interfaces; i++)
+    {
+        char name[16];
+        snprintf(name, sizeof(name), i == 0 ? "lo" : "eth%d", i - 1);
+        ret |= buffer_printf(out, "%6s: %llu %llu 0 0 0 0 0 0 %llu %llu 0 0 0 0 0 0\n", name, host->net[i][0],
+                             host->net[i][0] / 1000, host->net[i][1], host->net[i][1] / 1000);
+    }
+    ret |= write_entry(gz, "proc/net/dev", out->data, out->len);
+
+    buffer_reset(out);
+    ret |= buffer_printf(out, "%d.00 %d.00 %d.00 %d/%d %llu\n", host->running, host->running, host->running,
+                         host->running, host->running * 50, host->processes);
+    ret |= write_entry(gz, "proc/loadavg", out->data, out->len);
+
+    static const char* const pressure[3] = {"proc/pressure/cpu", "proc/pressure/memory", "proc/pressure/io"};
+    for (int i = 0; i < 3; i++)
+    {
+        buffer_reset(out);
+        ret |= buffer_printf(out,
+                             "some avg10=%.2f avg60=%.2f avg300=%.2f total=%llu\n"
+                             "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n",
+                             host->stall_avg10[i], host->stall_avg10[i], host->stall_avg10[i], host->stall[i]);
+        ret |= write_entry(gz, pressure[i], out->data, out->len);
+    }
+
+    // usage_usec es el tiempo ocupado de todos los CPUs; los jiffies son de 10 ms
+    unsigned long long busy = sum[0] + sum[1] + sum[2] + sum[5] + sum[6] + sum[7];
+    buffer_reset(out);
+    ret |= buffer_printf(out, "usage_usec %llu\nuser_usec %llu\nsystem_usec %llu\n", busy * 10000ull,
+                         (sum[0] + sum[1]) * 10000ull, sum[2] * 10000ull);
+    ret |= write_entry(gz, "sys/fs/cgroup/cpu.stat", out->data, out->len);
+    // Sin cuota: el uso se normaliza contra todos los CPUs
+    ret |= write_entry(gz, "sys/fs/cgroup/cpu.max", "max 100000\n", strlen("max 100000\n"));
+    return ret != 0 ? -1 : 0;
+}
+
+/**
+ * @brief Genera capturas de una máquina sintética de la escala pedida.
+ * @param archive Archivo de salida.
+ * @param captures Capturas a generar.
+ * @param interval_ms Intervalo simulado entre capturas.
+ * @param host Máquina sintética con las cantidades ya cargadas.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int synthesize(const char* archive, long captures, long interval_ms, SynthHost* host)
+{
+    host->cpu = calloc((size_t)host->cpus, sizeof(*host->cpu));
+    host->disk = calloc((size_t)host->disks + 1, sizeof(*host->disk));
+    host->net = calloc((size_t)host->interfaces + 1, sizeof(*host->net));
+    gzFile gz = gzopen(archive, "wb9");
+    int ret = host->cpu != NULL && host->disk != NULL && host->net != NULL && gz != NULL ? 0 : -1;
+    if (ret == 0 && gzwrite(gz, FIXTURE_MAGIC, sizeof(FIXTURE_MAGIC) - 1) != (int)sizeof(FIXTURE_MAGIC) - 1)
+    {
+        ret = -1;
+    }
+
+    Buffer out;
+    buffer_init(&out);
+    host->random = 88172645463325252ull;
+    for (long c = 0; c < captures && ret == 0; c++)
+    {
+        synth_advance(host, interval_ms);
+        ret = synth_capture(gz, host, (uint64_t)c * (uint64_t)interval_ms, &out);
+    }
+    buffer_free(&out);
+    if ((gz != NULL && gzclose(gz) != Z_OK) || ret != 0)
+    {
+        fprintf(stderr, "Error al escribir %s\n", archive);
+        ret = -1;
+    }
+    free(host->cpu);
+    free(host->disk);
+    free(host->net);
+    return ret;
+}
+
+/**
+ * @brief Reproduce un fixture bajo un directorio respetando los instantes de las capturas.
+ * @param archive Fixture.
+ * @param dir Directorio raíz de la reproducción.
+ * @param speed Factor de velocidad (2 reproduce al doble).
+ * @param laps Vueltas; 0 repite sin fin.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int replay(const char* archive, const char* dir, double speed, long laps)
+{
+    Capture* capture = calloc(1, sizeof(Capture));
+    if (capture == NULL)
+    {
+        return -1;
+    }
+    int ret = 0;
+    for (long lap = 0; (laps == 0 || lap < laps) && ret == 0; lap++)
+    {
+        gzFile gz = open_fixture(archive);
+        if (gz == NULL)
+        {
+            ret = -1;
+            break;
+        }
+        uint64_t start = monotonic_ns();
+        size_t captures = 0;
+        while ((ret = read_capture(gz, capture)) == 0)
+        {
+            sleep_until(start + (uint64_t)((double)capture->offset_ms * 1e6 / speed));
+            if (write_capture(dir, capture) != 0)
+            {
+                ret = -1;
+                break;
+            }
+            captures++;
+        }
+        gzclose(gz);
+        if (ret < 0)
+        {
+            fprintf(stderr, "Error en la captura %zu de %s\n", captures, archive);
+            break;
+        }
+        ret = 0;
+        printf("vuelta %ld: %zu capturas\n", lap + 1, captures);
+        fflush(stdout);
+    }
+
+    for (size_t i = 0; i < FIXTURE_MAX_FILES; i++)
+    {
+        buffer_free(&capture->contents[i]);
+    }
+    free(capture);
+    return ret;
+}
+
+/**
+ * @brief Escribe una sola captura de un fixture bajo un directorio.
+ * @param archive Fixture.
+ * @param dir Directorio raíz.
+ * @param index Número de captura, desde 0.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int extract(const char* archive, const char* dir, long index)
+{
+    gzFile gz = open_fixture(archive);
+    Capture* capture = calloc(1, sizeof(Capture));
+    int ret = gz != NULL && capture != NULL ? 0 : -1;
+    for (long i = 0; i <= index && ret == 0; i++)
+    {
+        ret = read_capture(gz, capture);
+    }
+    if (ret == 0)
+    {
+        ret = write_capture(dir, capture);
+    }
+    else if (gz != NULL && capture != NULL)
+    {
+        fprintf(stderr, "%s no tiene la captura %ld o está dañado\n", archive, index);
+        ret = -1;
+    }
+
+    if (capture != NULL)
+    {
+        for (size_t i = 0; i < FIXTURE_MAX_FILES; i++)
+        {
+            buffer_free(&capture->contents[i]);
+        }
+        free(capture);
+    }
+    if (gz != NULL)
+    {
+        gzclose(gz);
+    }
+    return ret;
+}
+
+/**
+ * @brief Muestra el uso de la herramienta.
+ * @param program Nombre del ejecutable.
+ * @return EXIT_FAILURE.
+ */
+static int usage(const char* program)
+{
+    fprintf(stderr,
+            "Uso:\n"
+            "  %s record <archivo> <capturas> <intervalo_ms> [raíz]\n"
+            "  %s synth <archivo> <capturas> <intervalo_ms> <cpus> <interfaces> <discos> <procesos>\n"
+            "  %s replay <archivo> <directorio> [velocidad] [vueltas]\n"
+            "  %s extract <archivo> <directorio> [captura]\n",
+            program, program, program, program);
+    return EXIT_FAILURE;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 4)
+    {
+        return usage(argv[0]);
+    }
+    const char* command = argv[1];
+    const char* archive = argv[2];
+    int ret;
+
+    if (strcmp(command, "record") == 0 && argc >= 5)
+    {
+        long captures = strtol(argv[3], NULL, 10);
+        long interval_ms = strtol(argv[4], NULL, 10);
+        if (captures <= 0 || interval_ms < 0)
+        {
+            return usage(argv[0]);
+        }
+        ret = record(archive, captures, interval_ms, argc > 5 ? argv[5] : "");
+    }
+    else if (strcmp(command, "synth") == 0 && argc >= 9)
+    {
+        long captures = strtol(argv[3], NULL, 10);
+        long interval_ms = strtol(argv[4], NULL, 10);
+        SynthHost host = {0};
+        host.cpus = atoi(argv[5]);
+        host.interfaces = atoi(argv[6]);
+        host.disks = atoi(argv[7]);
+        host.running = atoi(argv[8]);
+        if (captures <= 0 || interval_ms <= 0 || host.cpus <= 0 || host.interfaces < 0 || host.disks < 0 ||
+            host.disks > 26 * 27 || host.running <= 0)
+        {
+            return usage(argv[0]);
+        }
+        ret = synthesize(archive, captures, interval_ms, &host);
+    }
+    else if (strcmp(command, "replay") == 0)
+    {
+        double speed = argc > 4 ? strtod(argv[4], NULL) : 1.0;
+        long laps = argc > 5 ? strtol(argv[5], NULL, 10) : 1;
+        if (speed <= 0 || laps < 0)
+        {
+            return usage(argv[0]);
+        }
+        ret = replay(archive, argv[3], speed, laps);
+    }
+    else if (strcmp(command, "extract") == 0)
+    {
+        long index = argc > 4 ? strtol(argv[4], NULL, 10) : 0;
+        if (index < 0)
+        {
+            return usage(argv[0]);
+        }
+        ret = extract(archive, argv[3], index);
+    }
+    else
+    {
+        return usage(argv[0]);
+    }
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
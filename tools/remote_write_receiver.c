@@ -0,0 +1,332 @@
+/**
+ * @file remote_write_receiver.c
+ * @brief Receptor local de remote_write para probar el envío sin un Prometheus real.
+ *
+ * Acepta POSTs en cualquier ruta, descomprime el cuerpo con snappy, recorre el
+ * `WriteRequest` y muestra cuántas series y muestras trae. Las primeras `fallos` peticiones
+ * se responden con 503 para ejercitar los reintentos; el resto con 204, o 400 si el cuerpo
+ * no es válido.
+ *
+ * Uso: remote_write_receiver [puerto] [fallos]
+ */
+
+#include "../include/snappy.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * @brief Conexiones simultáneas atendidas.
+ */
+#define RECEIVER_MAX_CONNECTIONS 64
+
+/**
+ * @brief Puerto por defecto (el de remote_write en los ejemplos de Prometheus).
+ */
+#define RECEIVER_DEFAULT_PORT 9201
+
+/**
+ * @struct Connection
+ * @brief Conexión de un cliente con los bytes recibidos sin procesar.
+ */
+typedef struct
+{
+    int fd;         /**< Socket, o -1 si la posición está libre. */
+    Buffer pending; /**< Bytes recibidos que aún no forman una petición completa. */
+} Connection;
+
+/** Peticiones que faltan responder con 503 */
+static long failures;
+
+/** Totales desde el inicio */
+static unsigned long long total_requests, total_series, total_samples;
+
+/**
+ * @brief Lee un varint.
+ * @param p Posición; avanza tras el varint.
+ * @param end Fin de los datos.
+ * @param value Valor leído.
+ * @return 0 en caso de éxito, -1 si está truncado.
+ */
+static int read_varint(const uint8_t** p, const uint8_t* end, uint64_t* value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (*p == end)
+        {
+            return -1;
+        }
+        uint8_t byte = *(*p)++;
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if (byte < 0x80)
+        {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Lee la clave de un campo y, si es de longitud variable, delimita su contenido.
+ * @param p Posición; avanza tras el campo.
+ * @param end Fin del mensaje.
+ * @param field Número de campo.
+ * @param start Inicio del contenido (solo campos de longitud variable).
+ * @param len Longitud del contenido (solo campos de longitud variable).
+ * @return 0 en caso de éxito, -1 si el mensaje es inválido.
+ */
+static int read_field(const uint8_t** p, const uint8_t* end, uint64_t* field, const uint8_t** start, uint64_t* len)
+{
+    uint64_t key;
+    uint64_t ignored;
+    if (read_varint(p, end, &key) != 0)
+    {
+        return -1;
+    }
+    *field = key >> 3;
+    *len = 0;
+    switch (key & 7)
+    {
+    case 0:
+        return read_varint(p, end, &ignored);
+    case 1:
+        if (end - *p < 8)
+        {
+            return -1;
+        }
+        *p += 8;
+        return 0;
+    case 2:
+        if (read_varint(p, end, len) != 0 || (uint64_t)(end - *p) < *len)
+        {
+            return -1;
+        }
+        *start = *p;
+        *p += *len;
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+/**
+ * @brief Recorre un WriteRequest contando series y muestras.
+ * @param data Mensaje sin comprimir.
+ * @param len Longitud.
+ * @param series Recibe la cantidad de series.
+ * @param samples Recibe la cantidad de muestras.
+ * @return 0 si el mensaje es válido, -1 en caso contrario.
+ */
+static int decode_write_request(const char* data, size_t len, size_t* series, size_t* samples)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    const uint8_t* end = p + len;
+    *series = 0;
+    *samples = 0;
+    while (p < end)
+    {
+        uint64_t field;
+        uint64_t ts_len;
+        const uint8_t* ts = NULL;
+        if (read_field(&p, end, &field, &ts, &ts_len) != 0)
+        {
+            return -1;
+        }
+        if (field != 1 || ts == NULL)
+        {
+            continue;
+        }
+
+        // TimeSeries: etiquetas (1) y muestras (2)
+        const uint8_t* q = ts;
+        const uint8_t* ts_end = ts + ts_len;
+        size_t labels = 0;
+        while (q < ts_end)
+        {
+            uint64_t inner_field;
+            uint64_t inner_len;
+            const uint8_t* inner = NULL;
+            if (read_field(&q, ts_end, &inner_field, &inner, &inner_len) != 0)
+            {
+                return -1;
+            }
+            labels += inner_field == 1;
+            *samples += inner_field == 2;
+        }
+        if (labels == 0)
+        {
+            return -1;
+        }
+        (*series)++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Procesa una petición completa y escribe la respuesta.
+ * @param fd Socket del cliente.
+ * @param body Cuerpo de la petición.
+ * @param len Longitud del cuerpo.
+ */
+static void handle_request(int fd, const char* body, size_t len)
+{
+    static Buffer uncompressed;
+    const char* response = "HTTP/1.1 204 No Content\r\n\r\n";
+    size_t series = 0;
+    size_t samples = 0;
+
+    total_requests++;
+    if (failures > 0)
+    {
+        failures--;
+        response = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+        printf("petición %llu: 503 (%zu bytes)\n", total_requests, len);
+    }
+    else if (snappy_uncompress(body, len, &uncompressed) != 0 ||
+             decode_write_request(uncompressed.data, uncompressed.len, &series, &samples) != 0)
+    {
+        response = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+        printf("petición %llu: cuerpo inválido (%zu bytes)\n", total_requests, len);
+    }
+    else
+    {
+        total_series += series;
+        total_samples += samples;
+        printf("petición %llu: %zu -> %zu bytes, %zu series, %zu muestras (total %llu muestras)\n", total_requests,
+               len, uncompressed.len, series, samples, total_samples);
+    }
+    fflush(stdout);
+    if (send(fd, response, strlen(response), MSG_NOSIGNAL) < 0)
+    {
+        perror("send");
+    }
+}
+
+/**
+ * @brief Procesa las peticiones completas acumuladas en una conexión.
+ * @param connection Conexión.
+ * @return 0 para seguir atendiéndola, -1 para cerrarla.
+ */
+static int process_pending(Connection* connection)
+{
+    Buffer* pending = &connection->pending;
+    for (;;)
+    {
+        char* end = pending->len > 0 ? strstr(pending->data, "\r\n\r\n") : NULL;
+        if (end == NULL)
+        {
+            return 0;
+        }
+
+        size_t content_length = 0;
+        for (char* line = strstr(pending->data, "\r\n") + 2; line < end; line = strstr(line, "\r\n") + 2)
+        {
+            if (strncasecmp(line, "Content-Length:", 15) == 0)
+            {
+                content_length = strtoul(line + 15, NULL, 10);
+            }
+        }
+        size_t head = (size_t)(end + 4 - pending->data);
+        if (pending->len - head < content_length)
+        {
+            return 0;
+        }
+        if (strncmp(pending->data, "POST ", 5) != 0)
+        {
+            return -1;
+        }
+
+        handle_request(connection->fd, pending->data + head, content_length);
+        size_t consumed = head + content_length;
+        memmove(pending->data, pending->data + consumed, pending->len - consumed);
+        pending->len -= consumed;
+        pending->data[pending->len] = '\0';
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : RECEIVER_DEFAULT_PORT;
+    failures = argc > 2 ? atol(argv[2]) : 0;
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 16) != 0)
+    {
+        perror("Error al escuchar");
+        return EXIT_FAILURE;
+    }
+    printf("Escuchando remote_write en 127.0.0.1:%d\n", port);
+    fflush(stdout);
+
+    Connection connections[RECEIVER_MAX_CONNECTIONS];
+    struct pollfd fds[RECEIVER_MAX_CONNECTIONS + 1];
+    for (int i = 0; i < RECEIVER_MAX_CONNECTIONS; i++)
+    {
+        connections[i].fd = -1;
+        buffer_init(&connections[i].pending);
+    }
+
+    for (;;)
+    {
+        fds[0].fd = listen_fd;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < RECEIVER_MAX_CONNECTIONS; i++)
+        {
+            fds[i + 1].fd = connections[i].fd;
+            fds[i + 1].events = POLLIN;
+        }
+        if (poll(fds, RECEIVER_MAX_CONNECTIONS + 1, -1) < 0)
+        {
+            continue;
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            int fd = accept(listen_fd, NULL, NULL);
+            for (int i = 0; fd >= 0 && i < RECEIVER_MAX_CONNECTIONS; i++)
+            {
+                if (connections[i].fd < 0)
+                {
+                    connections[i].fd = fd;
+                    buffer_reset(&connections[i].pending);
+                    fd = -1;
+                }
+            }
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+
+        for (int i = 0; i < RECEIVER_MAX_CONNECTIONS; i++)
+        {
+            if (connections[i].fd < 0 || !(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)))
+            {
+                continue;
+            }
+            char chunk[65536];
+            ssize_t received = recv(connections[i].fd, chunk, sizeof(chunk), 0);
+            if (received <= 0 || buffer_append(&connections[i].pending, chunk, (size_t)received) != 0 ||
+                process_pending(&connections[i]) != 0)
+            {
+                close(connections[i].fd);
+                connections[i].fd = -1;
+            }
+        }
+    }
+}
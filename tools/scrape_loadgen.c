@@ -0,0 +1,877 @@
+/**
+ * @file scrape_loadgen.c
+ * @brief Generador de carga de scrapes: cuántos scrapes por segundo sostiene el endpoint y con
+ *        qué latencia, a medida que crece el registro.
+ *
+ * Abre N conexiones keep-alive (TCP o AF_UNIX) repartidas entre hilos con epoll. Cada conexión
+ * pide la ruta, lee la respuesta completa (Content-Length) y vuelve a pedir de inmediato,
+ * durante el tiempo indicado. Al terminar informa peticiones, errores, throughput, cuantiles
+ * de latencia (DDSketch al 1%) y un histograma en potencias de 2 de microsegundos; con -j, un
+ * objeto JSON para graficar curvas de escalado.
+ *
+ * Con -x lanza el agente indicado con una configuración temporal que escucha en el destino y
+ * registra -s series sintéticas de -f series por familia (sección "synthetic"), espera a que
+ * acepte conexiones, mide y lo detiene. Una curva de escalado es un bucle sobre -s.
+ *
+ * Uso: scrape_loadgen [-c conexiones] [-t hilos] [-d segundos] [-h host] [-p puerto]
+ *                     [-u socket] [-P ruta] [-A accept] [-e accept_encoding] [-j]
+ *                     [-x agente -s series [-f por_familia]]
+ */
+
+// memmem y strcasestr son extensiones de GNU
+#define _GNU_SOURCE
+
+#include "../include/buffer.h"
+#include "../include/ddsketch.h"
+#include "../include/json_writer.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief Buckets del histograma: el b cubre hasta 2^b microsegundos.
+ */
+#define LOADGEN_HISTOGRAM_BUCKETS 32
+
+/**
+ * @brief Bytes leídos por llamada a recv.
+ */
+#define LOADGEN_READ_CHUNK 65536
+
+/**
+ * @brief Encabezados de respuesta más largos que se aceptan.
+ */
+#define LOADGEN_MAX_HEADER 16384
+
+/**
+ * @brief Segundos que se espera a que el agente lanzado con -x acepte conexiones.
+ */
+#define LOADGEN_AGENT_START_SECONDS 10
+
+/**
+ * @brief Milisegundos que espera una conexión fallida antes de reabrirse.
+ */
+#define LOADGEN_RETRY_MS 10
+
+/**
+ * @enum ConnectionState
+ * @brief Etapa de una conexión.
+ */
+typedef enum
+{
+    CONNECTION_CLOSED,     /**< Sin socket; se reabre en la próxima vuelta. */
+    CONNECTION_CONNECTING, /**< connect no bloqueante en curso. */
+    CONNECTION_SENDING,    /**< Enviando la petición. */
+    CONNECTION_READING,    /**< Leyendo la respuesta. */
+} ConnectionState;
+
+/**
+ * @struct Connection
+ * @brief Conexión keep-alive con una petición en curso.
+ */
+typedef struct
+{
+    int fd;                /**< Socket, o -1 si está cerrada. */
+    ConnectionState state; /**< Etapa. */
+    size_t sent;           /**< Bytes de la petición ya enviados. */
+    Buffer header;         /**< Encabezados recibidos hasta completar la línea en blanco. */
+    int header_done;       /**< Los encabezados están completos. */
+    size_t body_left;      /**< Bytes del cuerpo que faltan leer. */
+    int close_after;       /**< El servidor pidió cerrar tras la respuesta. */
+    int status;            /**< Código de estado de la respuesta en curso. */
+    uint64_t start_ns;     /**< Inicio de la petición en curso. */
+    uint64_t retry_ns;     /**< Instante desde el que puede reabrirse tras una falla. */
+} Connection;
+
+/**
+ * @struct Worker
+ * @brief Hilo con su epoll, sus conexiones y sus resultados.
+ */
+typedef struct
+{
+    pthread_t thread;                              /**< Hilo. */
+    int epoll_fd;                                  /**< epoll de sus conexiones. */
+    Connection* connections;                       /**< Conexiones propias. */
+    size_t count;                                  /**< Cantidad de conexiones. */
+    uint64_t requests;                             /**< Respuestas 200 completas. */
+    uint64_t errors;                               /**< Respuestas no 200 y fallas de conexión. */
+    uint64_t reconnects;                           /**< Conexiones reabiertas. */
+    uint64_t bytes;                                /**< Bytes de cuerpo recibidos. */
+    double max_us;                                 /**< Latencia máxima. */
+    DDSketch latency;                              /**< Latencias en microsegundos. */
+    uint64_t histogram[LOADGEN_HISTOGRAM_BUCKETS]; /**< Latencias por potencia de 2 de microsegundos. */
+} Worker;
+
+/** Dirección del agente */
+static struct sockaddr_storage target;
+
+/** Longitud de `target` */
+static socklen_t target_len;
+
+/** Petición HTTP completa que envían todas las conexiones */
+static char request[1024];
+
+/** Longitud de `request` */
+static size_t request_len;
+
+/** Instante monotónico en que termina la medición */
+static uint64_t deadline_ns;
+
+/**
+ * @brief Tiempo monotónico en nanosegundos.
+ * @return Nanosegundos desde un origen arbitrario.
+ */
+static uint64_t monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Cierra una conexión; se reabre en la próxima vuelta del hilo.
+ * @param connection Conexión.
+ */
+static void connection_close(Connection* connection)
+{
+    if (connection->fd >= 0)
+    {
+        close(connection->fd);
+        connection->fd = -1;
+    }
+    connection->state = CONNECTION_CLOSED;
+}
+
+/**
+ * @brief Abre el socket y empieza el connect no bloqueante.
+ * @param worker Hilo dueño.
+ * @param connection Conexión cerrada.
+ * @return 0 si el connect está en curso o terminó, -1 en caso de error.
+ */
+static int connection_open(Worker* worker, Connection* connection)
+{
+    int fd = socket(target.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (target.ss_family != AF_UNIX)
+    {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    if (connect(fd, (const struct sockaddr*)&target, target_len) != 0 && errno != EINPROGRESS)
+    {
+        close(fd);
+        return -1;
+    }
+
+    struct epoll_event event = {.events = EPOLLOUT, .data.ptr = connection};
+    if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    connection->fd = fd;
+    connection->state = CONNECTION_CONNECTING;
+    return 0;
+}
+
+/**
+ * @brief Empieza una petición nueva sobre la conexión.
+ * @param worker Hilo dueño.
+ * @param connection Conexión abierta.
+ */
+static void connection_start_request(Worker* worker, Connection* connection)
+{
+    connection->state = CONNECTION_SENDING;
+    connection->sent = 0;
+    buffer_reset(&connection->header);
+    connection->header_done = 0;
+    connection->close_after = 0;
+    connection->start_ns = monotonic_ns();
+    struct epoll_event event = {.events = EPOLLOUT, .data.ptr = connection};
+    epoll_ctl(worker->epoll_fd, EPOLL_CTL_MOD, connection->fd, &event);
+}
+
+/**
+ * @brief Registra una respuesta completa.
+ * @param worker Hilo dueño.
+ * @param connection Conexión con la respuesta recién terminada.
+ */
+static void record_response(Worker* worker, const Connection* connection)
+{
+    if (connection->status != 200)
+    {
+        worker->errors++;
+        return;
+    }
+    double us = (double)(monotonic_ns() - connection->start_ns) / 1000.0;
+    worker->requests++;
+    ddsketch_add(&worker->latency, us);
+    worker->max_us = us > worker->max_us ? us : worker->max_us;
+    int bucket = 0;
+    while (bucket < LOADGEN_HISTOGRAM_BUCKETS - 1 && us > (double)(1ull << bucket))
+    {
+        bucket++;
+    }
+    worker->histogram[bucket]++;
+}
+
+/**
+ * @brief Interpreta los encabezados ya completos de la respuesta.
+ * @param connection Conexión.
+ * @param end Bytes de encabezado, incluida la línea en blanco.
+ * @return 0 en caso de éxito, -1 si la respuesta no es válida o no trae Content-Length.
+ */
+static int parse_header(Connection* connection, size_t end)
+{
+    char* header = connection->header.data;
+    header[end - 2] = '\0';
+    if (sscanf(header, "HTTP/1.%*d %d", &connection->status) != 1)
+    {
+        return -1;
+    }
+    const char* length = strcasestr(header, "\r\nContent-Length:");
+    if (length == NULL)
+    {
+        return -1;
+    }
+    unsigned long long body = strtoull(length + strlen("\r\nContent-Length:"), NULL, 10);
+    connection->close_after = strcasestr(header, "\r\nConnection: close") != NULL;
+
+    // Lo que llegó después de los encabezados ya es parte del cuerpo
+    size_t extra = connection->header.len - end;
+    if (extra > body)
+    {
+        return -1;
+    }
+    connection->body_left = (size_t)(body - extra);
+    connection->header_done = 1;
+    return 0;
+}
+
+/**
+ * @brief Atiende un evento de la conexión según su etapa.
+ * @param worker Hilo dueño.
+ * @param connection Conexión.
+ * @param events Eventos de epoll.
+ * @param chunk Buffer de lectura del hilo.
+ * @return 0 si la conexión sigue, -1 si falló y debe reabrirse.
+ */
+static int connection_handle(Worker* worker, Connection* connection, uint32_t events, char* chunk)
+{
+    if (connection->state == CONNECTION_CONNECTING)
+    {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (getsockopt(connection->fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0 || error != 0)
+        {
+            return -1;
+        }
+        connection_start_request(worker, connection);
+    }
+
+    if (connection->state == CONNECTION_SENDING)
+    {
+        ssize_t sent = send(connection->fd, request + connection->sent, request_len - connection->sent, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            return errno == EAGAIN ? 0 : -1;
+        }
+        connection->sent += (size_t)sent;
+        if (connection->sent == request_len)
+        {
+            connection->state = CONNECTION_READING;
+            struct epoll_event event = {.events = EPOLLIN, .data.ptr = connection};
+            epoll_ctl(worker->epoll_fd, EPOLL_CTL_MOD, connection->fd, &event);
+        }
+        return 0;
+    }
+
+    if (connection->state != CONNECTION_READING || !(events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+    {
+        return 0;
+    }
+    for (;;)
+    {
+        ssize_t got = recv(connection->fd, chunk, LOADGEN_READ_CHUNK, 0);
+        if (got < 0)
+        {
+            return errno == EAGAIN ? 0 : -1;
+        }
+        if (got == 0)
+        {
+            // El servidor cerró a mitad de una respuesta
+            return -1;
+        }
+
+        size_t body = (size_t)got;
+        if (!connection->header_done)
+        {
+            if (buffer_append(&connection->header, chunk, (size_t)got) != 0)
+            {
+                return -1;
+            }
+            const char* blank = memmem(connection->header.data, connection->header.len, "\r\n\r\n", 4);
+            if (blank == NULL)
+            {
+                if (connection->header.len > LOADGEN_MAX_HEADER)
+                {
+                    return -1;
+                }
+                continue;
+            }
+            size_t end = (size_t)(blank - connection->header.data) + 4;
+            body = connection->header.len - end;
+            if (parse_header(connection, end) != 0)
+            {
+                return -1;
+            }
+        }
+        else if (body > connection->body_left)
+        {
+            // Las respuestas no se encadenan: llegó más de lo anunciado
+            return -1;
+        }
+        else
+        {
+            connection->body_left -= body;
+        }
+        worker->bytes += body;
+
+        if (connection->body_left == 0)
+        {
+            record_response(worker, connection);
+            if (connection->close_after)
+            {
+                return -1;
+            }
+            connection_start_request(worker, connection);
+            return 0;
+        }
+    }
+}
+
+/**
+ * @brief Función de cada hilo: mantiene sus conexiones pidiendo hasta el final de la medición.
+ * @param arg Worker propio.
+ * @return NULL
+ */
+static void* worker_run(void* arg)
+{
+    Worker* worker = arg;
+    char* chunk = malloc(LOADGEN_READ_CHUNK);
+    if (chunk == NULL)
+    {
+        return NULL;
+    }
+
+    struct epoll_event events[64];
+    for (uint64_t now = monotonic_ns(); now < deadline_ns; now = monotonic_ns())
+    {
+        for (size_t i = 0; i < worker->count; i++)
+        {
+            Connection* connection = &worker->connections[i];
+            if (connection->state != CONNECTION_CLOSED || now < connection->retry_ns)
+            {
+                continue;
+            }
+            if (connection_open(worker, connection) != 0)
+            {
+                worker->errors++;
+                connection->retry_ns = now + LOADGEN_RETRY_MS * 1000000ull;
+            }
+        }
+
+        int timeout_ms = (int)((deadline_ns - now) / 1000000ull) + 1;
+        timeout_ms = timeout_ms < LOADGEN_RETRY_MS ? timeout_ms : LOADGEN_RETRY_MS;
+        int ready = epoll_wait(worker->epoll_fd, events, 64, timeout_ms);
+        for (int i = 0; i < ready; i++)
+        {
+            Connection* connection = events[i].data.ptr;
+            if (connection_handle(worker, connection, events[i].events, chunk) != 0)
+            {
+                // Los cierres pedidos por el servidor no son errores, solo reconexiones
+                if (!(connection->header_done && connection->body_left == 0 && connection->close_after))
+                {
+                    worker->errors++;
+                    connection->retry_ns = monotonic_ns() + LOADGEN_RETRY_MS * 1000000ull;
+                }
+                connection_close(connection);
+                worker->reconnects++;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < worker->count; i++)
+    {
+        connection_close(&worker->connections[i]);
+    }
+    free(chunk);
+    return NULL;
+}
+
+/**
+ * @brief Escribe la configuración temporal del agente lanzado con -x.
+ * @param path Plantilla para mkstemps; recibe la ruta creada.
+ * @param socket_path Socket AF_UNIX del destino, o NULL para TCP.
+ * @param port Puerto TCP del destino.
+ * @param series Series sintéticas.
+ * @param per_family Series sintéticas por familia.
+ * @return 0 en caso de éxito, -1 en caso de error.
+ */
+static int write_agent_config(char* path, const char* socket_path, int port, long series, long per_family)
+{
+    int fd = mkstemps(path, 5);
+    if (fd < 0)
+    {
+        perror("Error al crear la configuración temporal");
+        return -1;
+    }
+    Buffer config;
+    buffer_init(&config);
+    JsonWriter json;
+    json_writer_init(&json, &config);
+    json_begin_object(&json);
+    json_key(&json, "metrics");
+    json_begin_object(&json);
+    static const char* const metrics[] = {"cpu", "memory", "disk", "network", "processes", "context_switches"};
+    for (size_t i = 0; i < sizeof(metrics) / sizeof(metrics[0]); i++)
+    {
+        json_key(&json, metrics[i]);
+        json_bool(&json, 1);
+    }
+    json_end_object(&json);
+    json_key(&json, "http");
+    json_begin_object(&json);
+    if (socket_path != NULL)
+    {
+        json_key(&json, "listeners");
+        json_begin_array(&json);
+        json_begin_object(&json);
+        json_key(&json, "path");
+        json_string(&json, socket_path);
+        json_end_object(&json);
+        json_end_array(&json);
+    }
+    else
+    {
+        json_key(&json, "port");
+        json_int(&json, port);
+    }
+    json_end_object(&json);
+    json_key(&json, "synthetic");
+    json_begin_object(&json);
+    json_key(&json, "series");
+    json_int(&json, series);
+    json_key(&json, "per_family");
+    json_int(&json, per_family);
+    json_end_object(&json);
+    json_end_object(&json);
+
+    int ret = !json_writer_error(&json) && write(fd, config.data, config.len) == (ssize_t)config.len ? 0 : -1;
+    close(fd);
+    buffer_free(&config);
+    return ret;
+}
+
+/**
+ * @brief Lanza el agente y espera a que acepte conexiones en el destino.
+ * @param agent Ejecutable del agente.
+ * @param config_path Configuración temporal.
+ * @return PID del agente, o -1 si no arrancó.
+ */
+static pid_t start_agent(const char* agent, const char* config_path)
+{
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("Error al lanzar el agente");
+        return -1;
+    }
+    if (pid == 0)
+    {
+        // Solo los errores del agente llegan a la terminal
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0)
+        {
+            dup2(devnull, STDOUT_FILENO);
+        }
+        execl(agent, agent, config_path, (char*)NULL);
+        perror("Error al ejecutar el agente");
+        _exit(127);
+    }
+
+    uint64_t limit = monotonic_ns() + LOADGEN_AGENT_START_SECONDS * 1000000000ull;
+    while (monotonic_ns() < limit)
+    {
+        int status;
+        if (waitpid(pid, &status, WNOHANG) == pid)
+        {
+            fprintf(stderr, "El agente terminó antes de aceptar conexiones\n");
+            return -1;
+        }
+        int fd = socket(target.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int connected = fd >= 0 && connect(fd, (const struct sockaddr*)&target, target_len) == 0;
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        if (connected)
+        {
+            return pid;
+        }
+        usleep(50000);
+    }
+    fprintf(stderr, "El agente no aceptó conexiones en %d s\n", LOADGEN_AGENT_START_SECONDS);
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return -1;
+}
+
+/**
+ * @brief Detiene el agente lanzado con -x; si no termina en 2 s, lo mata.
+ * @param pid PID del agente.
+ */
+static void stop_agent(pid_t pid)
+{
+    kill(pid, SIGTERM);
+    for (int i = 0; i < 40; i++)
+    {
+        if (waitpid(pid, NULL, WNOHANG) == pid)
+        {
+            return;
+        }
+        usleep(50000);
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+}
+
+/**
+ * @brief Informa los resultados combinados de todos los hilos.
+ * @param total Resultados combinados.
+ * @param seconds Duración efectiva.
+ * @param connections Conexiones.
+ * @param threads Hilos.
+ * @param series Series sintéticas del agente lanzado, o -1 si no se lanzó.
+ * @param json_output Imprimir un objeto JSON en lugar de texto.
+ */
+static void report(const Worker* total, double seconds, int connections, int threads, long series, int json_output)
+{
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    static const char* const names[] = {"p50", "p90", "p99", "p999"};
+    double rate = (double)total->requests / seconds;
+    double throughput = (double)total->bytes / seconds;
+
+    if (json_output)
+    {
+        Buffer out;
+        buffer_init(&out);
+        JsonWriter json;
+        json_writer_init(&json, &out);
+        json_begin_object(&json);
+        json_key(&json, "connections");
+        json_int(&json, connections);
+        json_key(&json, "threads");
+        json_int(&json, threads);
+        json_key(&json, "synthetic_series");
+        json_int(&json, series);
+        json_key(&json, "seconds");
+        json_number(&json, seconds);
+        json_key(&json, "requests");
+        json_int(&json, (long long)total->requests);
+        json_key(&json, "errors");
+        json_int(&json, (long long)total->errors);
+        json_key(&json, "reconnects");
+        json_int(&json, (long long)total->reconnects);
+        json_key(&json, "requests_per_second");
+        json_number(&json, rate);
+        json_key(&json, "bytes_per_second");
+        json_number(&json, throughput);
+        json_key(&json, "latency_us");
+        json_begin_object(&json);
+        for (size_t i = 0; i < sizeof(quantiles) / sizeof(quantiles[0]); i++)
+        {
+            json_key(&json, names[i]);
+            json_number(&json, ddsketch_quantile(&total->latency, quantiles[i]));
+        }
+        json_key(&json, "max");
+        json_number(&json, total->max_us);
+        json_end_object(&json);
+        json_key(&json, "histogram_us");
+        json_begin_array(&json);
+        for (int b = 0; b < LOADGEN_HISTOGRAM_BUCKETS; b++)
+        {
+            if (total->histogram[b] > 0)
+            {
+                json_begin_array(&json);
+                json_int(&json, 1ll << b);
+                json_int(&json, (long long)total->histogram[b]);
+                json_end_array(&json);
+            }
+        }
+        json_end_array(&json);
+        json_end_object(&json);
+        printf("%s\n", out.data);
+        buffer_free(&out);
+        return;
+    }
+
+    printf("conexiones=%d hilos=%d series_sintéticas=%ld duración=%.1f s\n", connections, threads, series, seconds);
+    printf("peticiones=%llu errores=%llu reconexiones=%llu\n", (unsigned long long)total->requests,
+           (unsigned long long)total->errors, (unsigned long long)total->reconnects);
+    printf("throughput=%.1f scrapes/s %.1f MB/s cuerpo medio=%.0f bytes\n", rate, throughput / 1e6,
+           total->requests > 0 ? (double)total->bytes / (double)total->requests : 0.0);
+    printf("latencia µs:");
+    for (size_t i = 0; i < sizeof(quantiles) / sizeof(quantiles[0]); i++)
+    {
+        printf(" %s=%.0f", names[i], ddsketch_quantile(&total->latency, quantiles[i]));
+    }
+    printf(" max=%.0f\n", total->max_us);
+
+    uint64_t cumulative = 0;
+    for (int b = 0; b < LOADGEN_HISTOGRAM_BUCKETS; b++)
+    {
+        if (total->histogram[b] > 0)
+        {
+            cumulative += total->histogram[b];
+            printf("  <= %10llu µs %10llu %7.3f%%\n", 1ull << b, (unsigned long long)total->histogram[b],
+                   100.0 * (double)cumulative / (double)total->requests);
+        }
+    }
+}
+
+/**
+ * @brief Muestra el uso de la herramienta.
+ * @param program Nombre del ejecutable.
+ * @return EXIT_FAILURE.
+ */
+static int usage(const char* program)
+{
+    fprintf(stderr,
+            "Uso: %s [-c conexiones] [-t hilos] [-d segundos] [-h host] [-p puerto] [-u socket] [-P ruta]\n"
+            "       [-A accept] [-e accept_encoding] [-j] [-x agente -s series [-f por_familia]]\n",
+            program);
+    return EXIT_FAILURE;
+}
+
+int main(int argc, char* argv[])
+{
+    int connections = 16;
+    int threads = 1;
+    double duration = 10.0;
+    const char* host = "127.0.0.1";
+    int port = 8000;
+    const char* socket_path = NULL;
+    const char* path = "/metrics";
+    const char* accept_header = NULL;
+    const char* encoding = NULL;
+    const char* agent = NULL;
+    long series = -1;
+    long per_family = 100;
+    int json_output = 0;
+    int option;
+    while ((option = getopt(argc, argv, "c:t:d:h:p:u:P:A:e:jx:s:f:")) != -1)
+    {
+        switch (option)
+        {
+        case 'c':
+            connections = atoi(optarg);
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'd':
+            duration = strtod(optarg, NULL);
+            break;
+        case 'h':
+            host = optarg;
+            break;
+        case 'p':
+            port = atoi(optarg);
+            break;
+        case 'u':
+            socket_path = optarg;
+            break;
+        case 'P':
+            path = optarg;
+            break;
+        case 'A':
+            accept_header = optarg;
+            break;
+        case 'e':
+            encoding = optarg;
+            break;
+        case 'j':
+            json_output = 1;
+            break;
+        case 'x':
+            agent = optarg;
+            break;
+        case 's':
+            series = strtol(optarg, NULL, 10);
+            break;
+        case 'f':
+            per_family = strtol(optarg, NULL, 10);
+            break;
+        default:
+            return usage(argv[0]);
+        }
+    }
+    if (connections < 1 || threads < 1 || duration <= 0 || port < 1 || port > 65535 || per_family < 1 ||
+        (agent != NULL && series < 0) || (agent == NULL && series >= 0))
+    {
+        return usage(argv[0]);
+    }
+    threads = threads < connections ? threads : connections;
+
+    memset(&target, 0, sizeof(target));
+    if (socket_path != NULL)
+    {
+        struct sockaddr_un* address = (struct sockaddr_un*)&target;
+        if (strlen(socket_path) >= sizeof(address->sun_path))
+        {
+            fprintf(stderr, "Ruta de socket demasiado larga: %s\n", socket_path);
+            return EXIT_FAILURE;
+        }
+        address->sun_family = AF_UNIX;
+        strcpy(address->sun_path, socket_path);
+        target_len = sizeof(*address);
+    }
+    else
+    {
+        struct sockaddr_in* address = (struct sockaddr_in*)&target;
+        address->sin_family = AF_INET;
+        address->sin_port = htons((uint16_t)port);
+        if (inet_pton(AF_INET, host, &address->sin_addr) != 1)
+        {
+            fprintf(stderr, "Dirección IPv4 inválida: %s\n", host);
+            return EXIT_FAILURE;
+        }
+        target_len = sizeof(*address);
+    }
+
+    int len = snprintf(request, sizeof(request),
+                       "GET %s HTTP/1.1\r\nHost: %s\r\n%s%s%s%s%s%sConnection: keep-alive\r\n\r\n", path,
+                       socket_path != NULL ? "localhost" : host, accept_header != NULL ? "Accept: " : "",
+                       accept_header != NULL ? accept_header : "", accept_header != NULL ? "\r\n" : "",
+                       encoding != NULL ? "Accept-Encoding: " : "", encoding != NULL ? encoding : "",
+                       encoding != NULL ? "\r\n" : "");
+    if (len < 0 || (size_t)len >= sizeof(request))
+    {
+        fprintf(stderr, "Petición demasiado larga\n");
+        return EXIT_FAILURE;
+    }
+    request_len = (size_t)len;
+
+    char config_path[] = "/tmp/scrape_loadgen_XXXXXX.json";
+    pid_t agent_pid = -1;
+    if (agent != NULL)
+    {
+        if (write_agent_config(config_path, socket_path, port, series, per_family) != 0)
+        {
+            return EXIT_FAILURE;
+        }
+        agent_pid = start_agent(agent, config_path);
+        if (agent_pid < 0)
+        {
+            unlink(config_path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    Worker* workers = calloc((size_t)threads, sizeof(Worker));
+    Connection* all = calloc((size_t)connections, sizeof(Connection));
+    if (workers == NULL || all == NULL)
+    {
+        fprintf(stderr, "Error al reservar memoria\n");
+        return EXIT_FAILURE;
+    }
+    uint64_t start = monotonic_ns();
+    deadline_ns = start + (uint64_t)(duration * 1e9);
+    int ret = EXIT_SUCCESS;
+    int started = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        Worker* worker = &workers[t];
+        // Las conexiones se reparten lo más parejo posible
+        size_t first = (size_t)connections * (size_t)t / (size_t)threads;
+        size_t last = (size_t)connections * (size_t)(t + 1) / (size_t)threads;
+        worker->connections = all + first;
+        worker->count = last - first;
+        for (size_t i = 0; i < worker->count; i++)
+        {
+            worker->connections[i].fd = -1;
+            buffer_init(&worker->connections[i].header);
+        }
+        ddsketch_init(&worker->latency, 0.01);
+        worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (worker->epoll_fd < 0 || pthread_create(&worker->thread, NULL, worker_run, worker) != 0)
+        {
+            fprintf(stderr, "Error al crear el hilo %d\n", t);
+            ret = EXIT_FAILURE;
+            break;
+        }
+        started++;
+    }
+
+    Worker total = {0};
+    ddsketch_init(&total.latency, 0.01);
+    for (int t = 0; t < started; t++)
+    {
+        pthread_join(workers[t].thread, NULL);
+        total.requests += workers[t].requests;
+        total.errors += workers[t].errors;
+        total.reconnects += workers[t].reconnects;
+        total.bytes += workers[t].bytes;
+        total.max_us = workers[t].max_us > total.max_us ? workers[t].max_us : total.max_us;
+        ddsketch_merge(&total.latency, &workers[t].latency);
+        for (int b = 0; b < LOADGEN_HISTOGRAM_BUCKETS; b++)
+        {
+            total.histogram[b] += workers[t].histogram[b];
+        }
+    }
+    double seconds = (double)(monotonic_ns() - start) / 1e9;
+
+    if (agent_pid > 0)
+    {
+        stop_agent(agent_pid);
+        unlink(config_path);
+    }
+    if (ret == EXIT_SUCCESS)
+    {
+        report(&total, seconds, connections, threads, series, json_output);
+    }
+
+    for (int t = 0; t < threads; t++)
+    {
+        if (workers[t].epoll_fd > 0)
+        {
+            close(workers[t].epoll_fd);
+        }
+    }
+    for (int i = 0; i < connections; i++)
+    {
+        buffer_free(&all[i].header);
+    }
+    free(all);
+    free(workers);
+    return ret;
+}